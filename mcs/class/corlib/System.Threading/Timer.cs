@@ -29,8 +29,8 @@
 //
 
 using System.Runtime.InteropServices;
+using System.Runtime.CompilerServices;
 using System.Collections.Generic;
-using System.Collections;
 
 namespace System.Threading
 {
@@ -44,7 +44,9 @@ namespace System.Threading
 		object state;
 		long due_time_ms;
 		long period_ms;
-		long next_run; // in ticks. Only 'Scheduler' can change it except for new timers without due time.
+		// Only 'Scheduler' can change these, under its lock.
+		long timer_id;
+		IntPtr native_timer;
 		bool disposed;
 #endregion
 		public Timer (TimerCallback callback, object state, int dueTime, int period)
@@ -142,21 +144,11 @@ namespace System.Threading
 
 			due_time_ms = dueTime;
 			period_ms = period;
-			long nr;
-			if (dueTime == 0) {
-				nr = 0; // Due now
-			} else if (dueTime < 0) { // Infinite == -1
-				nr = long.MaxValue;
-				/* No need to call Change () */
-				if (first) {
-					next_run = nr;
-					return true;
-				}
-			} else {
-				nr = dueTime * TimeSpan.TicksPerMillisecond + DateTime.GetTimeMonotonic ();
-			}
+			/* No need to call Change () */
+			if (first && dueTime == Timeout.Infinite)
+				return true;
 
-			scheduler.Change (this, nr);
+			scheduler.Change (this, dueTime);
 			return true;
 		}
 
@@ -169,26 +161,26 @@ namespace System.Threading
 			return true;
 		}
 
-		sealed class TimerComparer : IComparer {
-			public int Compare (object x, object y)
-			{
-				Timer tx = (x as Timer);
-				if (tx == null)
-					return -1;
-				Timer ty = (y as Timer);
-				if (ty == null)
-					return 1;
-				long result = tx.next_run - ty.next_run;
-				if (result == 0)
-					return x == y ? 0 : -1;
-				return result > 0 ? 1 : -1;
-			}
-		}
+		// The timers are kept in the runtime's timer wheel, which collects
+		// the ids of the expired ones and signals the wait handle of the queue.
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		static extern IntPtr CreateTimerQueue (IntPtr wait_handle);
+
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		static extern IntPtr AddTimer (IntPtr queue, long due_time_ms, long id);
+
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		static extern void CancelTimer (IntPtr timer);
+
+		[MethodImplAttribute (MethodImplOptions.InternalCall)]
+		static extern int GetExpiredTimers (IntPtr queue, long[] ids);
 
 		sealed class Scheduler {
 			static Scheduler instance;
-			SortedList list;
-			ManualResetEvent changed;
+			Dictionary<long, Timer> timers;
+			AutoResetEvent changed;
+			IntPtr queue;
+			long last_id;
 
 			static Scheduler ()
 			{
@@ -201,8 +193,9 @@ namespace System.Threading
 
 			private Scheduler ()
 			{
-				changed = new ManualResetEvent (false);
-				list = new SortedList (new TimerComparer (), 1024);
+				changed = new AutoResetEvent (false);
+				timers = new Dictionary<long, Timer> ();
+				queue = CreateTimerQueue (changed.Handle);
 				Thread thread = new Thread (SchedulerThread);
 				thread.IsBackground = true;
 				thread.Start ();
@@ -210,105 +203,38 @@ namespace System.Threading
 
 			public void Remove (Timer timer)
 			{
-				// We do not keep brand new items or those with no due time.
-				if (timer.next_run == 0 || timer.next_run == Int64.MaxValue)
-					return;
-
 				lock (this) {
-					// If this is the next item due (index = 0), the scheduler will wake up and find nothing.
-					// No need to Pulse ()
 					InternalRemove (timer);
 				}
 			}
 
-			public void Change (Timer timer, long new_next_run)
+			public void Change (Timer timer, long due_time_ms)
 			{
-				bool wake = false;
 				lock (this) {
 					InternalRemove (timer);
-					if (new_next_run == Int64.MaxValue) {
-						timer.next_run = new_next_run;
-						return;
-					}
-
-					if (!timer.disposed) {
-						// We should only change next_run after removing and before adding
-						timer.next_run = new_next_run;
-						Add (timer);
-						// If this timer is next in line, wake up the scheduler
-						wake = (list.GetByIndex (0) == timer);
-					}
+					if (due_time_ms != Timeout.Infinite && !timer.disposed)
+						Add (timer, due_time_ms);
 				}
-				if (wake)
-					changed.Set ();
 			}
 
 			// lock held by caller
-			int FindByDueTime (long nr)
+			void Add (Timer timer, long due_time_ms)
 			{
-				int min = 0;
-				int max = list.Count - 1;
-				if (max < 0)
-					return -1;
-
-				if (max < 20) {
-					while (min <= max) {
-						Timer t = (Timer) list.GetByIndex (min);
-						if (t.next_run == nr)
-							return min;
-						if (t.next_run > nr)
-							return -1;
-						min++;
-					}
-					return -1;
-				}
-
-				while (min <= max) {
-					int half = min + ((max - min) >> 1);
-					Timer t = (Timer) list.GetByIndex (half);
-					if (nr == t.next_run)
-						return half;
-					if (nr > t.next_run)
-						min = half + 1;
-					else
-						max = half - 1;
-				}
-
-				return -1;
+				timer.timer_id = ++last_id;
+				timers.Add (timer.timer_id, timer);
+				timer.native_timer = AddTimer (queue, due_time_ms, timer.timer_id);
 			}
 
-			// This should be the only caller to list.Add!
-			void Add (Timer timer)
+			// lock held by caller
+			void InternalRemove (Timer timer)
 			{
-				// Make sure there are no collisions (10000 ticks == 1ms, so we should be safe here)
-				// Do not use list.IndexOfKey here. See bug #648130
-				int idx = FindByDueTime (timer.next_run);
-				if (idx != -1) {
-					bool up = (Int64.MaxValue - timer.next_run) > 20000 ? true : false;
-					while (true) {
-						idx++;
-						if (up)
-							timer.next_run++;
-						else
-							timer.next_run--;
-
-						if (idx >= list.Count)
-							break;
-						Timer t2 = (Timer) list.GetByIndex (idx);
-						if (t2.next_run != timer.next_run)
-							break;
-					}
-				}
-				list.Add (timer, timer);
-				//PrintList ();
-			}
+				if (timer.native_timer == IntPtr.Zero)
+					return;
 
-			int InternalRemove (Timer timer)
-			{
-				int idx = list.IndexOfKey (timer);
-				if (idx >= 0)
-					list.RemoveAt (idx);
-				return idx;
+				CancelTimer (timer.native_timer);
+				timers.Remove (timer.timer_id);
+				timer.native_timer = IntPtr.Zero;
+				timer.timer_id = 0;
 			}
 
 			static void TimerCB (object o)
@@ -320,92 +246,42 @@ namespace System.Threading
 			void SchedulerThread ()
 			{
 				Thread.CurrentThread.Name = "Timer-Scheduler";
-				var new_time = new List<Timer> (512);
+				long[] expired = new long [512];
+				List<Timer> fire = new List<Timer> ();
 				while (true) {
-					int ms_wait = -1;
-					long ticks = DateTime.GetTimeMonotonic ();
+					// Set by the runtime when timers expire
+					changed.WaitOne ();
 					lock (this) {
-						changed.Reset ();
-						//PrintList ();
-						int i;
-						int count = list.Count;
-						for (i = 0; i < count; i++) {
-							Timer timer = (Timer) list.GetByIndex (i);
-							if (timer.next_run > ticks)
-								break;
-
-							list.RemoveAt (i);
-							count--;
-							i--;
-							ThreadPool.QueueWorkItem (TimerCB, timer);
-							long period = timer.period_ms;
-							long due_time = timer.due_time_ms;
-							bool no_more = (period == -1 || ((period == 0 || period == Timeout.Infinite) && due_time != Timeout.Infinite));
-							if (no_more) {
-								timer.next_run = Int64.MaxValue;
-							} else {
-								timer.next_run = DateTime.GetTimeMonotonic () + TimeSpan.TicksPerMillisecond * timer.period_ms;
-								new_time.Add (timer);
-							}
-						}
-
-						// Reschedule timers with a new due time
-						count = new_time.Count;
-						for (i = 0; i < count; i++) {
-							Timer timer = new_time [i];
-							Add (timer);
-						}
-						new_time.Clear ();
-						ShrinkIfNeeded (new_time, 512);
-
-						// Shrink the list
-						int capacity = list.Capacity;
-						count = list.Count;
-						if (capacity > 1024 && count > 0 && (capacity / count) > 3)
-							list.Capacity = count * 2;
-
-						long min_next_run = Int64.MaxValue;
-						if (list.Count > 0)
-							min_next_run = ((Timer) list.GetByIndex (0)).next_run;
-
-						//PrintList ();
-						ms_wait = -1;
-						if (min_next_run != Int64.MaxValue) {
-							long diff = (min_next_run - DateTime.GetTimeMonotonic ())  / TimeSpan.TicksPerMillisecond;
-							if (diff > Int32.MaxValue)
-								ms_wait = Int32.MaxValue - 1;
-							else {
-								ms_wait = (int)(diff);
-								if (ms_wait < 0)
-									ms_wait = 0;
+						int count;
+						while ((count = GetExpiredTimers (queue, expired)) > 0) {
+							for (int i = 0; i < count; i++) {
+								Timer timer;
+								if (!timers.TryGetValue (expired [i], out timer))
+									continue;
+
+								// The runtime already freed the native timer
+								timers.Remove (timer.timer_id);
+								timer.native_timer = IntPtr.Zero;
+								timer.timer_id = 0;
+
+								fire.Add (timer);
+								long period = timer.period_ms;
+								long due_time = timer.due_time_ms;
+								bool no_more = (period == -1 || ((period == 0 || period == Timeout.Infinite) && due_time != Timeout.Infinite));
+								if (!no_more)
+									Add (timer, period);
 							}
 						}
 					}
-					// Wait until due time or a timer is changed and moves from/to the first place in the list.
-					changed.WaitOne (ms_wait);
-				}
-			}
-
-			void ShrinkIfNeeded (List<Timer> list, int initial)
-			{
-				int capacity = list.Capacity;
-				int count = list.Count;
-				if (capacity > initial && count > 0 && (capacity / count) > 3)
-					list.Capacity = count * 2;
-			}
 
-			/*
-			void PrintList ()
-			{
-				Console.WriteLine ("BEGIN--");
-				for (int i = 0; i < list.Count; i++) {
-					Timer timer = (Timer) list.GetByIndex (i);
-					Console.WriteLine ("{0}: {1}", i, timer.next_run);
+					// The callbacks run on the threadpool, so a slow one doesn't
+					// delay the other timers, and they are queued outside of the
+					// lock so Change () and Dispose () don't wait for the queueing.
+					for (int i = 0; i < fire.Count; i++)
+						ThreadPool.QueueWorkItem (TimerCB, fire [i]);
+					fire.Clear ();
 				}
-				Console.WriteLine ("END----");
 			}
-			*/
 		}
 	}
 }
-
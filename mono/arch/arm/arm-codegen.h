@@ -557,6 +557,26 @@ typedef struct {
 	ARM_IASM_MLAS_COND(rd, rm, rs, rn, ARMCOND_AL)
 
 
+#define ARM_DEF_MULL_COND(op, rdhi, rdlo, rm, rs, cond) \
+	(rm)             | \
+	((rs) << 8)      | \
+	((rdlo) << 12)   | \
+	((rdhi) << 16)   | \
+	((op & 7) << 21) | \
+	ARM_MUL_TAG      | \
+	ARM_DEF_COND(cond)
+
+/* RdHi:RdLo := Rm * Rs; 32x32 -> 64 */
+#define ARM_SMULL_COND(p, rdhi, rdlo, rm, rs, cond) \
+	ARM_EMIT(p, ARM_DEF_MULL_COND(ARMOP_SMULL, rdhi, rdlo, rm, rs, cond))
+#define ARM_SMULL(p, rdhi, rdlo, rm, rs) \
+	ARM_SMULL_COND(p, rdhi, rdlo, rm, rs, ARMCOND_AL)
+#define ARM_UMULL_COND(p, rdhi, rdlo, rm, rs, cond) \
+	ARM_EMIT(p, ARM_DEF_MULL_COND(ARMOP_UMULL, rdhi, rdlo, rm, rs, cond))
+#define ARM_UMULL(p, rdhi, rdlo, rm, rs) \
+	ARM_UMULL_COND(p, rdhi, rdlo, rm, rs, ARMCOND_AL)
+
+
 
 /*  Word/byte transfer */
 typedef union {
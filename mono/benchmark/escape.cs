@@ -0,0 +1,69 @@
+using System;
+
+//
+// Temporary objects and boxes which don't escape the method they are
+// allocated in, so escape analysis can remove the allocations.
+//
+public class Escape {
+	class Point {
+		public int x, y;
+
+		public Point (int x) {
+			this.x = x;
+		}
+	}
+
+	struct Pair {
+		public int a;
+		public long b;
+	}
+
+	static int temporaries (int n) {
+		int s = 0;
+		for (int i = 0; i < n; i++) {
+			Point p = new Point (i) { y = 2 };
+			s += p.x * p.y;
+		}
+		return s;
+	}
+
+	static int boxes (int n) {
+		int s = 0;
+		for (int i = 0; i < n; i++) {
+			object o = i;
+			s += (int)o;
+		}
+		return s;
+	}
+
+	static long struct_boxes (int n) {
+		long s = 0;
+		Pair p = new Pair ();
+		for (int i = 0; i < n; i++) {
+			p.a = i;
+			object o = p;
+			s += ((Pair)o).a;
+		}
+		return s;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		for (int i = 0; i < repeat * 200; i++) {
+			if (temporaries (100000) != 1409965408)
+				return 1;
+			if (boxes (100000) != 704982704)
+				return 2;
+			if (struct_boxes (100000) != 4999950000)
+				return 3;
+		}
+
+		return 0;
+	}
+}
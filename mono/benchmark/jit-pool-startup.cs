@@ -0,0 +1,71 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Reflection;
+using System.Text;
+using System.Text.RegularExpressions;
+
+//
+// Measures the startup time of a program with --jit-pool, using an
+// increasing number of compile threads. Without arguments, the program is
+// a workload of this file, run with the current runtime.
+// Usage: jit-pool-startup.exe [PROGRAM.exe [RUNTIME]]
+//
+class T {
+	static long Run (string runtime, string args) {
+		ProcessStartInfo info = new ProcessStartInfo (runtime, args);
+		info.UseShellExecute = false;
+		info.RedirectStandardOutput = true;
+
+		Stopwatch watch = Stopwatch.StartNew ();
+		using (Process p = Process.Start (info)) {
+			p.StandardOutput.ReadToEnd ();
+			p.WaitForExit ();
+		}
+		return watch.ElapsedMilliseconds;
+	}
+
+	// Uses enough of the class libraries to compile a few thousand methods
+	static int Workload () {
+		var dict = new Dictionary<string, List<int>> ();
+		var sb = new StringBuilder ();
+
+		for (int i = 0; i < 1000; ++i) {
+			string key = String.Format ("key{0}", i % 37);
+			List<int> l;
+			if (!dict.TryGetValue (key, out l))
+				dict [key] = l = new List<int> ();
+			l.Add (i);
+		}
+		foreach (var pair in dict) {
+			pair.Value.Sort ((a, b) => b.CompareTo (a));
+			sb.Append (pair.Key).Append (':').Append (pair.Value [0]).AppendLine ();
+		}
+		var re = new Regex ("key([0-9]+)");
+		int sum = 0;
+		foreach (Match m in re.Matches (sb.ToString ()))
+			sum += Int32.Parse (m.Groups [1].Value);
+		Console.WriteLine (sum);
+		return 0;
+	}
+
+	static int Main (string[] args) {
+		string program, runtime;
+
+		if (args.Length == 1 && args [0] == "--workload")
+			return Workload ();
+
+		if (args.Length == 0) {
+			program = Assembly.GetEntryAssembly ().Location + " --workload";
+			runtime = Process.GetCurrentProcess ().MainModule.FileName;
+		} else {
+			program = args [0];
+			runtime = args.Length > 1 ? args [1] : "mono";
+		}
+
+		Console.WriteLine ("no precompilation: {0} ms", Run (runtime, program));
+		for (int n = 1; n <= Environment.ProcessorCount; n *= 2)
+			Console.WriteLine ("{0} thread(s): {1} ms", n, Run (runtime, "--jit-pool=threads=" + n + " " + program));
+		return 0;
+	}
+}
@@ -0,0 +1,70 @@
+using System;
+
+//
+// Array loops whose indexes are induction variables bounded by the array
+// length, so their bounds checks can be removed.
+//
+public class LoopBounds {
+	static int forward (int[] a) {
+		int s = 0;
+		for (int i = 0; i < a.Length; i++)
+			s += a [i];
+		return s;
+	}
+
+	static int backward (int[] a) {
+		int s = 0;
+		for (int i = a.Length - 1; i >= 0; i--)
+			s += a [i];
+		return s;
+	}
+
+	static int shifted (int[] a) {
+		int s = 0;
+		for (int i = 0; i < a.Length - 1; i++)
+			s += a [i + 1] - a [i];
+		return s;
+	}
+
+	static int strided (int[] a) {
+		int s = 0;
+		for (int i = 0; i < a.Length; i += 2)
+			s += a [i];
+		return s;
+	}
+
+	static int pairs (int[] a, int[] b) {
+		int s = 0;
+		for (int i = 0; i < a.Length && i < b.Length; i++)
+			s += a [i] * b [i];
+		return s;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		int[] a = new int [1000];
+		for (int i = 0; i < a.Length; i++)
+			a [i] = i;
+
+		for (int i = 0; i < repeat * 20000; i++) {
+			if (forward (a) != 499500)
+				return 1;
+			if (backward (a) != 499500)
+				return 2;
+			if (shifted (a) != 999)
+				return 3;
+			if (strided (a) != 249500)
+				return 4;
+			if (pairs (a, a) != 332833500)
+				return 5;
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,61 @@
+using System;
+
+//
+// Loops reading arrays and scalars through instance and static fields, which
+// are reloaded in every iteration unless they are moved out of the loop.
+//
+public class LoopInvariant {
+	int[] data = new int [1000];
+	int scale = 3;
+
+	static int[] sdata = new int [1000];
+	static int sscale = 3;
+
+	int sum_field () {
+		int s = 0;
+		for (int i = 0; i < data.Length; i++)
+			s += data [i] * scale;
+		return s;
+	}
+
+	static int sum_static () {
+		int s = 0;
+		for (int i = 0; i < sdata.Length; i++)
+			s += sdata [i] * sscale;
+		return s;
+	}
+
+	int sum_field_bound () {
+		int s = 0;
+		int[] a = data;
+		for (int i = 0; i < a.Length - scale; i++)
+			s += a [i + scale] - a [i];
+		return s;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		LoopInvariant t = new LoopInvariant ();
+		for (int i = 0; i < t.data.Length; i++) {
+			t.data [i] = i;
+			sdata [i] = i;
+		}
+
+		for (int i = 0; i < repeat * 20000; i++) {
+			if (t.sum_field () != 1498500)
+				return 1;
+			if (sum_static () != 1498500)
+				return 2;
+			if (t.sum_field_bound () != 2991)
+				return 3;
+		}
+
+		return 0;
+	}
+}
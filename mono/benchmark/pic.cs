@@ -0,0 +1,64 @@
+using System;
+
+//
+// Interface and virtual calls whose receiver is almost always of the same
+// class. With --tiered, the tier 1 code turns them into guarded direct calls
+// which can be inlined, compare with MONO_PIC=disable.
+//
+public class Pic {
+	interface ICounter {
+		int Next (int i);
+	}
+
+	abstract class Counter : ICounter {
+		public abstract int Next (int i);
+	}
+
+	class Step : Counter {
+		public override int Next (int i) {
+			return i + 1;
+		}
+	}
+
+	class Skip : Counter {
+		public override int Next (int i) {
+			return i + 2;
+		}
+	}
+
+	static int interface_calls (ICounter[] counters) {
+		int res = 0;
+		for (int i = 0; i < counters.Length; i++)
+			res = counters [i].Next (res);
+		return res;
+	}
+
+	static int virtual_calls (Counter[] counters) {
+		int res = 0;
+		for (int i = 0; i < counters.Length; i++)
+			res = counters [i].Next (res);
+		return res;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		Counter[] counters = new Counter [1000];
+		for (int i = 0; i < counters.Length; i++)
+			counters [i] = i % 100 == 0 ? (Counter)new Skip () : new Step ();
+
+		for (int i = 0; i < repeat * 50000; i++) {
+			if (interface_calls (counters) != 1010)
+				return 1;
+			if (virtual_calls (counters) != 1010)
+				return 2;
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,56 @@
+using System;
+using System.Collections.Generic;
+
+//
+// Shared generic code which looks up type handles, vtables and static data
+// through the (M)RGCTX on every iteration.
+//
+public class RgctxFetch {
+	class Holder<T> {
+		public static T last;
+		public T[] items = new T [16];
+
+		public int Fill (T item) {
+			int count = 0;
+
+			for (int i = 0; i < items.Length; ++i) {
+				items [i] = item;
+				last = item;
+				count += Counter<T>.count;
+			}
+			return count;
+		}
+	}
+
+	class Counter<T> {
+		public static int count = 1;
+	}
+
+	static int Touch<T> (T item) {
+		T[] arr = new T [1];
+		arr [0] = item;
+		return typeof (List<T>) != null && arr [0] is T ? 1 : 0;
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		Holder<string> hs = new Holder<string> ();
+		Holder<object> ho = new Holder<object> ();
+		int sum = 0;
+
+		for (int i = 0; i < repeat * 1000000; i++) {
+			sum += hs.Fill ("a");
+			sum += ho.Fill (hs);
+			sum += Touch<string> ("b");
+			sum += Touch<Holder<string>> (hs);
+		}
+
+		return sum == repeat * 1000000 * 34 ? 0 : 1;
+	}
+}
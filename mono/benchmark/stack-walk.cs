@@ -0,0 +1,53 @@
+using System;
+using System.Diagnostics;
+
+//
+// Walks the stack repeatedly from a deep call chain, this mostly measures
+// how fast the runtime can unwind managed frames.
+//
+public class StackWalk {
+	static int finallys;
+
+	static int walk (int depth) {
+		if (depth == 0)
+			return new StackTrace (false).FrameCount;
+		return walk (depth - 1);
+	}
+
+	static int throw_catch (int depth) {
+		if (depth == 0)
+			throw new InvalidOperationException ();
+		try {
+			return throw_catch (depth - 1);
+		} finally {
+			finallys ++;
+		}
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		for (int i = 0; i < repeat * 20000; i++) {
+			if (walk (32) < 32)
+				return 1;
+		}
+
+		for (int i = 0; i < repeat * 20000; i++) {
+			try {
+				throw_catch (16);
+				return 2;
+			} catch (InvalidOperationException) {
+			}
+		}
+
+		if (finallys != repeat * 20000 * 16)
+			return 3;
+
+		return 0;
+	}
+}
@@ -0,0 +1,34 @@
+using System;
+
+//
+// Searches, compares and hashes medium sized strings and byte arrays,
+// which the JIT maps to vectorized helpers.
+//
+public class StringSearch {
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		string s = new string ('a', 1000) + "b";
+		string s2 = new string ('a', 1000) + "b";
+		string s3 = new string ('a', 1000) + "c";
+		byte[] bytes = new byte [4096];
+		bytes [bytes.Length - 1] = 1;
+		int res = 0;
+
+		for (int i = 0; i < repeat * 200000; i++) {
+			res += s.IndexOf ('b');
+			if (s.Equals (s2))
+				res ++;
+			res += String.CompareOrdinal (s2, s3);
+			res += s.GetHashCode () & 1;
+			res += Array.IndexOf<byte> (bytes, 1);
+		}
+
+		return res == repeat * 200000 * (1000 + 1 - 1 + 4095 + (s.GetHashCode () & 1)) ? 0 : 1;
+	}
+}
@@ -0,0 +1,80 @@
+using System;
+
+//
+// if/else cascades comparing one value against constants: a character
+// classifier, a dense decoder and a test of sparse enum values.
+//
+public class SwitchChain {
+	enum Token {
+		Ident = 3,
+		Number = 17,
+		Plus = 40,
+		Minus = 41,
+		Star = 90,
+		Slash = 250,
+		Semicolon = 1000,
+		Eof = 4096
+	}
+
+	static int Classify (int c) {
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			return 0;
+		if (c == ',' || c == ';' || c == '.')
+			return 1;
+		return 2;
+	}
+
+	static int Decode (int op) {
+		if (op == 0)
+			return 1;
+		else if (op == 1)
+			return 3;
+		else if (op == 2)
+			return 5;
+		else if (op == 3)
+			return 7;
+		else if (op == 5)
+			return 11;
+		else if (op == 6)
+			return 13;
+		else if (op == 7)
+			return 17;
+		return 0;
+	}
+
+	static int Weight (Token t) {
+		if (t == Token.Ident)
+			return 1;
+		else if (t == Token.Number)
+			return 2;
+		else if (t == Token.Plus)
+			return 3;
+		else if (t == Token.Minus)
+			return 4;
+		else if (t == Token.Star)
+			return 5;
+		else if (t == Token.Slash)
+			return 6;
+		else if (t == Token.Semicolon)
+			return 7;
+		else if (t == Token.Eof)
+			return 8;
+		return 0;
+	}
+
+	public static int Main (string[] args) {
+		int n = args.Length > 0 ? Int32.Parse (args [0]) : 50000000;
+		Token[] tokens = new Token [] { Token.Ident, Token.Plus, Token.Ident, Token.Ident, Token.Semicolon, Token.Number, Token.Ident, Token.Star, Token.Eof, Token.Ident, Token.Minus, Token.Slash, Token.Ident, (Token)5, Token.Ident, Token.Ident };
+		string text = "int x = a, b;\tif (x) { y.z(); }\r\n";
+		int sum = 0;
+
+		for (int i = 0; i < n; ++i) {
+			sum += Classify (text [i & 31]);
+			sum += Decode (i & 7);
+			sum += Weight (tokens [i & 15]);
+		}
+
+		Console.WriteLine (sum);
+		return 0;
+	}
+}
@@ -0,0 +1,53 @@
+using System;
+
+//
+// Simple loops over arrays which the JIT can vectorize.
+//
+public class Vectorize {
+	static int sum (int[] a) {
+		int s = 0;
+		for (int i = 0; i < a.Length; i++)
+			s += a [i];
+		return s;
+	}
+
+	static void add (float[] a, float[] b, float[] c) {
+		for (int i = 0; i < c.Length; i++)
+			c [i] = a [i] + b [i];
+	}
+
+	static void blend (byte[] dst, byte[] src, byte v) {
+		for (int i = 0; i < dst.Length; i++)
+			dst [i] = (byte)((dst [i] & v) | src [i]);
+	}
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		int[] ints = new int [10000];
+		float[] a = new float [10000], b = new float [10000], c = new float [10000];
+		byte[] dst = new byte [10000], src = new byte [10000];
+		for (int i = 0; i < ints.Length; i++) {
+			ints [i] = i;
+			a [i] = i;
+			b [i] = 1;
+			src [i] = (byte)(i & 0xf0);
+		}
+
+		for (int i = 0; i < repeat * 10000; i++) {
+			if (sum (ints) != 49995000)
+				return 1;
+			add (a, b, c);
+			blend (dst, src, 0x0f);
+		}
+		if (c [9999] != 10000 || dst [0x37] != 0x30)
+			return 2;
+
+		return 0;
+	}
+}
@@ -0,0 +1,60 @@
+using System;
+
+//
+// Copies and clears reference free valuetypes of increasing size, both
+// between locals and into arrays.
+//
+public class VTypeCopy {
+	struct S24 { public long a, b, c; }
+	struct S48 { public S24 a, b; }
+	struct S96 { public S48 a, b; }
+	struct S192 { public S96 a, b; }
+	struct S384 { public S192 a, b; }
+
+	static S24[] a24 = new S24 [16];
+	static S48[] a48 = new S48 [16];
+	static S96[] a96 = new S96 [16];
+	static S192[] a192 = new S192 [16];
+	static S384[] a384 = new S384 [16];
+
+	public static int Main (string[] args) {
+		int repeat = 1;
+
+		if (args.Length == 1)
+			repeat = Convert.ToInt32 (args [0]);
+
+		Console.WriteLine ("Repeat = " + repeat);
+
+		S24 v24 = new S24 ();
+		S48 v48 = new S48 ();
+		S96 v96 = new S96 ();
+		S192 v192 = new S192 ();
+		S384 v384 = new S384 ();
+		v24.c = 1;
+		v48.b.c = 1;
+		v96.b.b.c = 1;
+		v192.b.b.b.c = 1;
+		v384.b.b.b.b.c = 1;
+
+		for (int i = 0; i < repeat * 5000000; i++) {
+			int j = i & 15;
+
+			a24 [j] = v24;
+			a48 [j] = v48;
+			a96 [j] = v96;
+			a192 [j] = v192;
+			a384 [j] = v384;
+			v24 = a24 [15 - j];
+			v48 = a48 [15 - j];
+			v96 = a96 [15 - j];
+			v192 = a192 [15 - j];
+			v384 = a384 [15 - j];
+			if ((i & 255) == 0) {
+				a96 [j] = new S96 ();
+				a384 [j] = new S384 ();
+			}
+		}
+
+		return v24.c + v48.b.c + v96.b.b.c + v192.b.b.b.c + v384.b.b.b.b.c >= 0 ? 0 : 1;
+	}
+}
@@ -0,0 +1,56 @@
+using System;
+
+//
+// Reference stores into objects which were just allocated, like the ones done
+// by object initializers, and runs of stores into the fields of an older object.
+//
+public class WriteBarrier {
+	class Node {
+		public Node left, right;
+		public string name;
+		public object tag;
+	}
+
+	class Record {
+		public object a, b, c, d;
+	}
+
+	static Node Build (int depth) {
+		if (depth == 0)
+			return new Node { name = "leaf" };
+
+		Node left = Build (depth - 1);
+		Node right = Build (depth - 1);
+		return new Node { left = left, right = right, name = "node", tag = null };
+	}
+
+	static int Count (Node n) {
+		return n == null ? 0 : 1 + Count (n.left) + Count (n.right);
+	}
+
+	public static int Main (string[] args) {
+		int n = args.Length > 0 ? Int32.Parse (args [0]) : 400;
+		Record[] records = new Record [1024];
+		int sum = 0;
+
+		for (int i = 0; i < records.Length; ++i)
+			records [i] = new Record ();
+		GC.Collect ();
+
+		for (int i = 0; i < n; ++i) {
+			Node root = Build (14);
+			sum += Count (root) & 1;
+
+			for (int j = 0; j < records.Length; ++j) {
+				Record r = records [j];
+				r.a = root;
+				r.b = root.left;
+				r.c = root.right;
+				r.d = root.name;
+			}
+		}
+
+		Console.WriteLine (sum);
+		return 0;
+	}
+}
@@ -29,6 +29,7 @@
 #  include <dirent.h>
 #endif
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include <mono/io-layer/wapi.h>
 #include <mono/io-layer/wapi-private.h>
@@ -40,6 +41,7 @@
 #include <mono/io-layer/critical-section-private.h>
 
 #include <mono/utils/mono-mutex.h>
+#include <mono/utils/mono-timer-wheel.h>
 #undef DEBUG_REFS
 
 #if 0
@@ -176,6 +178,9 @@ pid_t _wapi_getpid (void)
 
 static mono_mutex_t scan_mutex;
 
+/* Whenever timed waits on private handles use the runtime timer wheel */
+static gboolean use_timer_wheel = TRUE;
+
 static void handle_cleanup (void)
 {
 	int i, j, k;
@@ -262,6 +267,9 @@ wapi_init (void)
 	_wapi_io_init ();
 	mono_mutex_init (&scan_mutex);
 
+	if (g_getenv ("MONO_DISABLE_TIMER_WHEEL"))
+		use_timer_wheel = FALSE;
+
 	_wapi_global_signal_handle = _wapi_handle_new (WAPI_HANDLE_EVENT, NULL);
 
 	_wapi_global_signal_cond = &_WAPI_PRIVATE_HANDLES (GPOINTER_TO_UINT (_wapi_global_signal_handle)).signal_cond;
@@ -1495,6 +1503,73 @@ static int timedwait_signal_poll_cond (pthread_cond_t *cond, mono_mutex_t *mutex
 	return(ret);
 }
 
+/*
+ * Timed waits register their deadline with the timer wheel and do an
+ * untimed wait on the condition, the wheel broadcasts it when the deadline
+ * passes. This avoids a kernel timer per waiting thread when there are lots
+ * of them. If the waiter can't cancel the timer because the callback is
+ * already running, it waits for the callback to be done with the mutex and
+ * the condition, since the handle owning them can be closed as soon as the
+ * waiter returns.
+ */
+typedef struct {
+	MonoWheelTimer timer;
+	pthread_cond_t *cond;
+	mono_mutex_t *mutex;
+	/* Set by the callback under MUTEX, it doesn't touch the timer afterwards */
+	gboolean done;
+} WaitTimer;
+
+static void
+wait_timer_expired (MonoWheelTimer *timer)
+{
+	WaitTimer *wt = timer->user_data;
+	mono_mutex_t *mutex = wt->mutex;
+	int thr_ret;
+
+	thr_ret = mono_mutex_lock (mutex);
+	g_assert (thr_ret == 0);
+	mono_cond_broadcast (wt->cond);
+	wt->done = TRUE;
+	thr_ret = mono_mutex_unlock (mutex);
+	g_assert (thr_ret == 0);
+}
+
+static int timedwait_signal_wheel (pthread_cond_t *cond, mono_mutex_t *mutex, struct timespec *timeout)
+{
+	struct timeval now;
+	gint64 remaining_ms;
+	WaitTimer *wt;
+	int ret;
+
+	gettimeofday (&now, NULL);
+	remaining_ms = (gint64)(timeout->tv_sec - now.tv_sec) * 1000 + (timeout->tv_nsec / 1000000) - (now.tv_usec / 1000);
+	if (remaining_ms <= 0)
+		return ETIMEDOUT;
+
+	wt = g_new0 (WaitTimer, 1);
+	mono_wheel_timer_init (&wt->timer, wait_timer_expired, wt);
+	wt->cond = cond;
+	wt->mutex = mutex;
+
+	/* Round up, the wheel has a 1ms resolution */
+	mono_timer_wheel_add (&wt->timer, (guint32)MIN (remaining_ms + 1, G_MAXUINT32 - 1));
+
+	ret = mono_cond_wait (cond, mutex);
+
+	if (mono_timer_wheel_cancel (&wt->timer)) {
+		/* Woken up before the deadline, the callback will never run */
+		g_free (wt);
+		return ret;
+	}
+
+	/* The callback needs the mutex, which is released while waiting */
+	while (!wt->done)
+		mono_cond_wait (cond, mutex);
+	g_free (wt);
+	return ETIMEDOUT;
+}
+
 int _wapi_handle_wait_signal (gboolean poll)
 {
 	return _wapi_handle_timedwait_signal_handle (_wapi_global_signal_handle, NULL, TRUE, poll);
@@ -1561,7 +1636,9 @@ int _wapi_handle_timedwait_signal_handle (gpointer handle,
 			/* This is needed when waiting for process handles */
 			res = timedwait_signal_poll_cond (cond, mutex, timeout, alertable);
 		} else {
-			if (timeout)
+			if (timeout && use_timer_wheel)
+				res = timedwait_signal_wheel (cond, mutex, timeout);
+			else if (timeout)
 				res = mono_cond_timedwait (cond, mutex, timeout);
 			else
 				res = mono_cond_wait (cond, mutex);
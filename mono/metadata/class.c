@@ -68,6 +68,7 @@ static void mono_field_resolve_type (MonoClassField *field, MonoError *error);
 static guint32 mono_field_resolve_flags (MonoClassField *field);
 static void mono_class_setup_vtable_full (MonoClass *class, GList *in_setup);
 static void mono_generic_class_setup_parent (MonoClass *klass, MonoClass *gklass);
+static void mono_class_alloc_field_def_values (MonoClass *klass);
 
 
 void (*mono_debugger_class_init_func) (MonoClass *klass) = NULL;
@@ -2030,23 +2031,19 @@ create_array_method (MonoClass *class, const char *name, MonoMethodSignature *si
  * from 0.
  *
  * On failure this function sets class->exception_type
+ *
+ * LOCKING: The methods are created without holding any locks, and published
+ * under the image lock. Array classes take the loader lock to build their methods.
  */
 void
 mono_class_setup_methods (MonoClass *class)
 {
-	int i;
+	int i, count;
 	MonoMethod **methods;
 
 	if (class->methods)
 		return;
 
-	mono_loader_lock ();
-
-	if (class->methods) {
-		mono_loader_unlock ();
-		return;
-	}
-
 	if (class->generic_class) {
 		MonoError error;
 		MonoClass *gklass = class->generic_class->container_class;
@@ -2057,15 +2054,14 @@ mono_class_setup_methods (MonoClass *class)
 		if (gklass->exception_type) {
 			/*FIXME make exception_data less opaque so it's possible to dup it here*/
 			mono_class_set_failure (class, MONO_EXCEPTION_TYPE_LOAD, g_strdup ("Generic type definition failed to load"));
-			mono_loader_unlock ();
 			return;
 		}
 
 		/* The + 1 makes this always non-NULL to pass the check in mono_class_setup_methods () */
-		class->method.count = gklass->method.count;
-		methods = mono_class_alloc0 (class, sizeof (MonoMethod*) * (class->method.count + 1));
+		count = gklass->method.count;
+		methods = mono_class_alloc0 (class, sizeof (MonoMethod*) * (count + 1));
 
-		for (i = 0; i < class->method.count; i++) {
+		for (i = 0; i < count; i++) {
 			methods [i] = mono_class_inflate_generic_method_full_checked (
 				gklass->methods [i], class, mono_class_get_context (class), &error);
 			if (!mono_error_ok (&error)) {
@@ -2074,7 +2070,6 @@ mono_class_setup_methods (MonoClass *class)
 
 				g_free (method);
 				mono_error_cleanup (&error);
-				mono_loader_unlock ();
 				return;				
 			}
 		}
@@ -2085,18 +2080,26 @@ mono_class_setup_methods (MonoClass *class)
 		int count_generic = 0, first_generic = 0;
 		int method_num = 0;
 
-		class->method.count = 3 + (class->rank > 1? 2: 1);
+		/* generic_array_methods () and the array method wrappers are shared by all array classes */
+		mono_loader_lock ();
+
+		if (class->methods) {
+			mono_loader_unlock ();
+			return;
+		}
+
+		count = 3 + (class->rank > 1? 2: 1);
 
 		mono_class_setup_interfaces (class, &error);
 		g_assert (mono_error_ok (&error)); /*FIXME can this fail for array types?*/
 
 		if (class->interface_count) {
 			count_generic = generic_array_methods (class);
-			first_generic = class->method.count;
-			class->method.count += class->interface_count * count_generic;
+			first_generic = count;
+			count += class->interface_count * count_generic;
 		}
 
-		methods = mono_class_alloc0 (class, sizeof (MonoMethod*) * class->method.count);
+		methods = mono_class_alloc0 (class, sizeof (MonoMethod*) * count);
 
 		sig = mono_metadata_signature_alloc (class->image, class->rank);
 		sig->ret = &mono_defaults.void_class->byval_arg;
@@ -2150,8 +2153,9 @@ mono_class_setup_methods (MonoClass *class)
 		for (i = 0; i < class->interface_count; i++)
 			setup_generic_array_ifaces (class, class->interfaces [i], methods, first_generic + i * count_generic);
 	} else {
-		methods = mono_class_alloc (class, sizeof (MonoMethod*) * class->method.count);
-		for (i = 0; i < class->method.count; ++i) {
+		count = class->method.count;
+		methods = mono_class_alloc (class, sizeof (MonoMethod*) * count);
+		for (i = 0; i < count; ++i) {
 			int idx = mono_metadata_translate_token_index (class->image, MONO_TABLE_METHOD, class->method.first + i + 1);
 			methods [i] = mono_get_method (class->image, MONO_TOKEN_METHOD_DEF | idx, class);
 		}
@@ -2159,19 +2163,30 @@ mono_class_setup_methods (MonoClass *class)
 
 	if (MONO_CLASS_IS_INTERFACE (class)) {
 		int slot = 0;
-		/*Only assign slots to virtual methods as interfaces are allowed to have static methods.*/
-		for (i = 0; i < class->method.count; ++i) {
+		/*
+		 * Only assign slots to virtual methods as interfaces are allowed to have static methods.
+		 * The methods are shared by racing threads, which assign the same slots.
+		 */
+		for (i = 0; i < count; ++i) {
 			if (methods [i]->flags & METHOD_ATTRIBUTE_VIRTUAL)
 				methods [i]->slot = slot++;
 		}
 	}
 
-	/* Needed because of the double-checking locking pattern */
-	mono_memory_barrier ();
+	/* The first thread to get here wins, the methods of the others are left in the mempool */
+	mono_image_lock (class->image);
+	if (!class->methods) {
+		class->method.count = count;
 
-	class->methods = methods;
+		/* Needed because of the double-checking locking pattern */
+		mono_memory_barrier ();
 
-	mono_loader_unlock ();
+		class->methods = methods;
+	}
+	mono_image_unlock (class->image);
+
+	if (class->rank)
+		mono_loader_unlock ();
 }
 
 /*
@@ -2289,7 +2304,11 @@ mono_class_get_vtable_size (MonoClass *klass)
 	return klass->vtable_size;
 }
 
-/*This method can fail the class.*/
+/*
+ * This method can fail the class.
+ * LOCKING: The properties are created without holding any locks, and published
+ * under the image lock.
+ */
 static void
 mono_class_setup_properties (MonoClass *class)
 {
@@ -2298,17 +2317,11 @@ mono_class_setup_properties (MonoClass *class)
 	MonoTableInfo *msemt = &class->image->tables [MONO_TABLE_METHODSEMANTICS];
 	MonoProperty *properties;
 	guint32 last;
+	int first, count;
 
 	if (class->ext && class->ext->properties)
 		return;
 
-	mono_loader_lock ();
-
-	if (class->ext && class->ext->properties) {
-		mono_loader_unlock ();
-		return;
-	}
-
 	mono_class_alloc_ext (class);
 
 	if (class->generic_class) {
@@ -2318,15 +2331,15 @@ mono_class_setup_properties (MonoClass *class)
 		mono_class_setup_properties (gklass);
 		if (gklass->exception_type) {
 			mono_class_set_failure (class, MONO_EXCEPTION_TYPE_LOAD, g_strdup ("Generic type definition failed to load"));
-			mono_loader_unlock ();			
 			return;
 		}
 
-		class->ext->property = gklass->ext->property;
+		first = gklass->ext->property.first;
+		count = gklass->ext->property.count;
 
-		properties = mono_class_new0 (class, MonoProperty, class->ext->property.count + 1);
+		properties = mono_class_new0 (class, MonoProperty, count + 1);
 
-		for (i = 0; i < class->ext->property.count; i++) {
+		for (i = 0; i < count; i++) {
 			MonoProperty *prop = &properties [i];
 
 			*prop = gklass->ext->properties [i];
@@ -2341,19 +2354,15 @@ mono_class_setup_properties (MonoClass *class)
 			prop->parent = class;
 		}
 	} else {
-		int first = mono_metadata_properties_from_typedef (class->image, mono_metadata_token_index (class->type_token) - 1, &last);
-		int count = last - first;
+		first = mono_metadata_properties_from_typedef (class->image, mono_metadata_token_index (class->type_token) - 1, &last);
+		count = last - first;
 
 		if (count) {
 			mono_class_setup_methods (class);
-			if (class->exception_type) {
-				mono_loader_unlock ();
+			if (class->exception_type)
 				return;
-			}
 		}
 
-		class->ext->property.first = first;
-		class->ext->property.count = count;
 		properties = mono_class_alloc0 (class, sizeof (MonoProperty) * count);
 		for (i = first; i < last; ++i) {
 			mono_metadata_decode_table_row (class->image, MONO_TABLE_PROPERTY, i, cols, MONO_PROPERTY_SIZE);
@@ -2386,13 +2395,18 @@ mono_class_setup_properties (MonoClass *class)
 			}
 		}
 	}
-	/*Flush any pending writes as we do double checked locking on class->properties */
-	mono_memory_barrier ();
 
-	/* Leave this assignment as the last op in the function */
-	class->ext->properties = properties;
+	mono_image_lock (class->image);
+	if (!class->ext->properties) {
+		class->ext->property.first = first;
+		class->ext->property.count = count;
+
+		/*Flush any pending writes as we do double checked locking on class->properties */
+		mono_memory_barrier ();
 
-	mono_loader_unlock ();
+		class->ext->properties = properties;
+	}
+	mono_image_unlock (class->image);
 }
 
 static MonoMethod**
@@ -2412,7 +2426,11 @@ inflate_method_listz (MonoMethod **methods, MonoClass *class, MonoGenericContext
 	return retval;
 }
 
-/*This method can fail the class.*/
+/*
+ * This method can fail the class.
+ * LOCKING: The events are created without holding any locks, and published
+ * under the image lock.
+ */
 static void
 mono_class_setup_events (MonoClass *class)
 {
@@ -2426,13 +2444,6 @@ mono_class_setup_events (MonoClass *class)
 	if (class->ext && class->ext->events)
 		return;
 
-	mono_loader_lock ();
-
-	if (class->ext && class->ext->events) {
-		mono_loader_unlock ();
-		return;
-	}
-
 	mono_class_alloc_ext (class);
 
 	if (class->generic_class) {
@@ -2442,18 +2453,18 @@ mono_class_setup_events (MonoClass *class)
 		mono_class_setup_events (gklass);
 		if (gklass->exception_type) {
 			mono_class_set_failure (class, MONO_EXCEPTION_TYPE_LOAD, g_strdup ("Generic type definition failed to load"));
-			mono_loader_unlock ();
 			return;
 		}
 
-		class->ext->event = gklass->ext->event;
-		class->ext->events = mono_class_new0 (class, MonoEvent, class->ext->event.count);
+		first = gklass->ext->event.first;
+		count = gklass->ext->event.count;
+		events = mono_class_new0 (class, MonoEvent, count);
 
-		if (class->ext->event.count)
+		if (count)
 			context = mono_class_get_context (class);
 
-		for (i = 0; i < class->ext->event.count; i++) {
-			MonoEvent *event = &class->ext->events [i];
+		for (i = 0; i < count; i++) {
+			MonoEvent *event = &events [i];
 			MonoEvent *gevent = &gklass->ext->events [i];
 
 			event->parent = class;
@@ -2466,84 +2477,83 @@ mono_class_setup_events (MonoClass *class)
 #endif
 			event->attrs = gevent->attrs;
 		}
+	} else {
+		first = mono_metadata_events_from_typedef (class->image, mono_metadata_token_index (class->type_token) - 1, &last);
+		count = last - first;
 
-		mono_loader_unlock ();
-		return;
-	}
-
-	first = mono_metadata_events_from_typedef (class->image, mono_metadata_token_index (class->type_token) - 1, &last);
-	count = last - first;
-
-	if (count) {
-		mono_class_setup_methods (class);
-		if (class->exception_type) {
-			mono_class_set_failure (class, MONO_EXCEPTION_TYPE_LOAD, g_strdup ("Generic type definition failed to load"));
-			mono_loader_unlock ();
-			return;
+		if (count) {
+			mono_class_setup_methods (class);
+			if (class->exception_type) {
+				mono_class_set_failure (class, MONO_EXCEPTION_TYPE_LOAD, g_strdup ("Generic type definition failed to load"));
+				return;
+			}
 		}
-	}
-	class->ext->event.first = first;
-	class->ext->event.count = count;
-	events = mono_class_alloc0 (class, sizeof (MonoEvent) * class->ext->event.count);
-	for (i = first; i < last; ++i) {
-		MonoEvent *event = &events [i - first];
+		events = mono_class_alloc0 (class, sizeof (MonoEvent) * count);
+		for (i = first; i < last; ++i) {
+			MonoEvent *event = &events [i - first];
 
-		mono_metadata_decode_table_row (class->image, MONO_TABLE_EVENT, i, cols, MONO_EVENT_SIZE);
-		event->parent = class;
-		event->attrs = cols [MONO_EVENT_FLAGS];
-		event->name = mono_metadata_string_heap (class->image, cols [MONO_EVENT_NAME]);
+			mono_metadata_decode_table_row (class->image, MONO_TABLE_EVENT, i, cols, MONO_EVENT_SIZE);
+			event->parent = class;
+			event->attrs = cols [MONO_EVENT_FLAGS];
+			event->name = mono_metadata_string_heap (class->image, cols [MONO_EVENT_NAME]);
 
-		startm = mono_metadata_methods_from_event (class->image, i, &endm);
-		for (j = startm; j < endm; ++j) {
-			MonoMethod *method;
+			startm = mono_metadata_methods_from_event (class->image, i, &endm);
+			for (j = startm; j < endm; ++j) {
+				MonoMethod *method;
 
-			mono_metadata_decode_row (msemt, j, cols, MONO_METHOD_SEMA_SIZE);
+				mono_metadata_decode_row (msemt, j, cols, MONO_METHOD_SEMA_SIZE);
 
-			if (class->image->uncompressed_metadata)
-				/* It seems like the MONO_METHOD_SEMA_METHOD column needs no remapping */
-				method = mono_get_method (class->image, MONO_TOKEN_METHOD_DEF | cols [MONO_METHOD_SEMA_METHOD], class);
-			else
-				method = class->methods [cols [MONO_METHOD_SEMA_METHOD] - 1 - class->method.first];
+				if (class->image->uncompressed_metadata)
+					/* It seems like the MONO_METHOD_SEMA_METHOD column needs no remapping */
+					method = mono_get_method (class->image, MONO_TOKEN_METHOD_DEF | cols [MONO_METHOD_SEMA_METHOD], class);
+				else
+					method = class->methods [cols [MONO_METHOD_SEMA_METHOD] - 1 - class->method.first];
 
-			switch (cols [MONO_METHOD_SEMA_SEMANTICS]) {
-			case METHOD_SEMANTIC_ADD_ON:
-				event->add = method;
-				break;
-			case METHOD_SEMANTIC_REMOVE_ON:
-				event->remove = method;
-				break;
-			case METHOD_SEMANTIC_FIRE:
-				event->raise = method;
-				break;
-			case METHOD_SEMANTIC_OTHER: {
+				switch (cols [MONO_METHOD_SEMA_SEMANTICS]) {
+				case METHOD_SEMANTIC_ADD_ON:
+					event->add = method;
+					break;
+				case METHOD_SEMANTIC_REMOVE_ON:
+					event->remove = method;
+					break;
+				case METHOD_SEMANTIC_FIRE:
+					event->raise = method;
+					break;
+				case METHOD_SEMANTIC_OTHER: {
 #ifndef MONO_SMALL_CONFIG
-				int n = 0;
-
-				if (event->other == NULL) {
-					event->other = g_new0 (MonoMethod*, 2);
-				} else {
-					while (event->other [n])
-						n++;
-					event->other = g_realloc (event->other, (n + 2) * sizeof (MonoMethod*));
-				}
-				event->other [n] = method;
-				/* NULL terminated */
-				event->other [n + 1] = NULL;
+					int n = 0;
+
+					if (event->other == NULL) {
+						event->other = g_new0 (MonoMethod*, 2);
+					} else {
+						while (event->other [n])
+							n++;
+						event->other = g_realloc (event->other, (n + 2) * sizeof (MonoMethod*));
+					}
+					event->other [n] = method;
+					/* NULL terminated */
+					event->other [n + 1] = NULL;
 #endif
-				break;
-			}
-			default:
-				break;
+					break;
+				}
+				default:
+					break;
+				}
 			}
 		}
 	}
-	/*Flush any pending writes as we do double checked locking on class->properties */
-	mono_memory_barrier ();
 
-	/* Leave this assignment as the last op in the function */
-	class->ext->events = events;
+	mono_image_lock (class->image);
+	if (!class->ext->events) {
+		class->ext->event.first = first;
+		class->ext->event.count = count;
 
-	mono_loader_unlock ();
+		/*Flush any pending writes as we do double checked locking on class->events */
+		mono_memory_barrier ();
+
+		class->ext->events = events;
+	}
+	mono_image_unlock (class->image);
 }
 
 /*
@@ -6153,15 +6163,25 @@ mono_ptr_class_get (MonoType *type)
 	el_class = mono_class_from_mono_type (type);
 	image = el_class->image;
 
-	mono_loader_lock ();
-
+	/* Check the cache without taking the loader lock first */
+	EnterCriticalSection (&image->szarray_cache_lock);
 	if (!image->ptr_cache)
 		image->ptr_cache = g_hash_table_new (mono_aligned_addr_hash, NULL);
+	result = g_hash_table_lookup (image->ptr_cache, el_class);
+	LeaveCriticalSection (&image->szarray_cache_lock);
+	if (result)
+		return result;
 
-	if ((result = g_hash_table_lookup (image->ptr_cache, el_class))) {
+	mono_loader_lock ();
+
+	EnterCriticalSection (&image->szarray_cache_lock);
+	result = g_hash_table_lookup (image->ptr_cache, el_class);
+	LeaveCriticalSection (&image->szarray_cache_lock);
+	if (result) {
 		mono_loader_unlock ();
 		return result;
 	}
+
 	result = mono_image_alloc0 (image, sizeof (MonoClass));
 
 	classes_size += sizeof (MonoClass);
@@ -6188,7 +6208,9 @@ mono_ptr_class_get (MonoType *type)
 
 	mono_class_setup_supertypes (result);
 
+	EnterCriticalSection (&image->szarray_cache_lock);
 	g_hash_table_insert (image->ptr_cache, el_class, result);
+	LeaveCriticalSection (&image->szarray_cache_lock);
 
 	mono_loader_unlock ();
 
@@ -6366,6 +6388,21 @@ mono_class_create_from_typespec (MonoImage *image, guint32 type_spec, MonoGeneri
 	return ret;
 }
 
+/*
+ * Return the class in LIST which describes an array of rank RANK.
+ * LOCKING: Assumes the szarray_cache_lock of the image is held.
+ */
+static MonoClass*
+find_array_class (GSList *list, guint32 rank, gboolean bounded)
+{
+	for (; list; list = list->next) {
+		MonoClass *class = list->data;
+		if ((class->rank == rank) && (class->byval_arg.type == (((rank > 1) || bounded) ? MONO_TYPE_ARRAY : MONO_TYPE_SZARRAY)))
+			return class;
+	}
+	return NULL;
+}
+
 /**
  * mono_bounded_array_class_get:
  * @element_class: element class 
@@ -6410,20 +6447,15 @@ mono_bounded_array_class_get (MonoClass *eclass, guint32 rank, gboolean bounded)
 
 		mono_loader_lock ();
 	} else {
-		mono_loader_lock ();
-
+		EnterCriticalSection (&image->szarray_cache_lock);
 		if (!image->array_cache)
 			image->array_cache = g_hash_table_new (mono_aligned_addr_hash, NULL);
+		class = find_array_class (g_hash_table_lookup (image->array_cache, eclass), rank, bounded);
+		LeaveCriticalSection (&image->szarray_cache_lock);
+		if (class)
+			return class;
 
-		if ((rootlist = list = g_hash_table_lookup (image->array_cache, eclass))) {
-			for (; list; list = list->next) {
-				class = list->data;
-				if ((class->rank == rank) && (class->byval_arg.type == (((rank > 1) || bounded) ? MONO_TYPE_ARRAY : MONO_TYPE_SZARRAY))) {
-					mono_loader_unlock ();
-					return class;
-				}
-			}
-		}
+		mono_loader_lock ();
 	}
 
 	/* for the building corlib use System.Array from it */
@@ -6550,8 +6582,19 @@ mono_bounded_array_class_get (MonoClass *eclass, guint32 rank, gboolean bounded)
 			g_hash_table_insert (image->szarray_cache, eclass, class);
 		LeaveCriticalSection (&image->szarray_cache_lock);
 	} else {
-		list = g_slist_append (rootlist, class);
-		g_hash_table_insert (image->array_cache, eclass, list);
+		MonoClass *prev_class;
+
+		EnterCriticalSection (&image->szarray_cache_lock);
+		rootlist = g_hash_table_lookup (image->array_cache, eclass);
+		prev_class = find_array_class (rootlist, rank, bounded);
+		if (prev_class) {
+			/* Someone got in before us */
+			class = prev_class;
+		} else {
+			list = g_slist_append (rootlist, class);
+			g_hash_table_insert (image->array_cache, eclass, list);
+		}
+		LeaveCriticalSection (&image->szarray_cache_lock);
 	}
 
 	mono_loader_unlock ();
@@ -6829,13 +6872,8 @@ mono_class_get_field_default_value (MonoClassField *field, MonoTypeEnum *def_typ
 
 	g_assert (field->type->attrs & FIELD_ATTRIBUTE_HAS_DEFAULT);
 
-	if (!klass->ext || !klass->ext->field_def_values) {
-		mono_loader_lock ();
-		mono_class_alloc_ext (klass);
-		if (!klass->ext->field_def_values)
-			klass->ext->field_def_values = mono_class_alloc0 (klass, sizeof (MonoFieldDefaultValue) * klass->field.count);
-		mono_loader_unlock ();
-	}
+	if (!klass->ext || !klass->ext->field_def_values)
+		mono_class_alloc_field_def_values (klass);
 
 	field_index = mono_field_get_index (field);
 		
@@ -9064,13 +9102,8 @@ mono_field_get_rva (MonoClassField *field)
 
 	g_assert (field->type->attrs & FIELD_ATTRIBUTE_HAS_FIELD_RVA);
 
-	if (!klass->ext || !klass->ext->field_def_values) {
-		mono_loader_lock ();
-		mono_class_alloc_ext (klass);
-		if (!klass->ext->field_def_values)
-			klass->ext->field_def_values = mono_class_alloc0 (klass, sizeof (MonoFieldDefaultValue) * klass->field.count);
-		mono_loader_unlock ();
-	}
+	if (!klass->ext || !klass->ext->field_def_values)
+		mono_class_alloc_field_def_values (klass);
 
 	field_index = mono_field_get_index (field);
 		
@@ -9352,7 +9385,7 @@ mono_class_get_method_from_name_flags (MonoClass *klass, const char *name, int p
  * Keep a detected failure informations in the class for later processing.
  * Note that only the first failure is kept.
  *
- * LOCKING: Acquires the loader lock.
+ * LOCKING: Acquires the image lock.
  */
 gboolean
 mono_class_set_failure (MonoClass *klass, guint32 ex_type, void *ex_data)
@@ -9360,11 +9393,17 @@ mono_class_set_failure (MonoClass *klass, guint32 ex_type, void *ex_data)
 	if (klass->exception_type)
 		return FALSE;
 
-	mono_loader_lock ();
-	klass->exception_type = ex_type;
+	mono_image_lock (klass->image);
+	if (klass->exception_type) {
+		mono_image_unlock (klass->image);
+		return FALSE;
+	}
 	if (ex_data)
-		mono_image_property_insert (klass->image, klass, MONO_CLASS_PROP_EXCEPTION_DATA, ex_data);
-	mono_loader_unlock ();
+		mono_property_hash_insert (klass->image->property_hash, klass, MONO_CLASS_PROP_EXCEPTION_DATA, ex_data);
+	/* The exception data is looked up once exception_type is set */
+	mono_memory_barrier ();
+	klass->exception_type = ex_type;
+	mono_image_unlock (klass->image);
 
 	return TRUE;
 }
@@ -10007,6 +10046,9 @@ mono_generic_class_is_generic_type_definition (MonoGenericClass *gklass)
 void
 mono_class_setup_interface_id (MonoClass *class)
 {
+	if (!MONO_CLASS_IS_INTERFACE (class) || class->interface_id)
+		return;
+
 	mono_loader_lock ();
 	if (MONO_CLASS_IS_INTERFACE (class) && !class->interface_id)
 		class->interface_id = mono_get_unique_iid (class);
@@ -10017,15 +10059,37 @@ mono_class_setup_interface_id (MonoClass *class)
  * mono_class_alloc_ext:
  *
  *   Allocate klass->ext if not already done.
- * LOCKING: Assumes the loader lock is held.
+ * LOCKING: Doesn't need any locks, the structure is published using a CAS.
  */
 void
 mono_class_alloc_ext (MonoClass *klass)
 {
-	if (!klass->ext) {
-		klass->ext = mono_class_alloc0 (klass, sizeof (MonoClassExt));
-		class_ext_size += sizeof (MonoClassExt);
-	}
+	MonoClassExt *ext;
+
+	if (klass->ext)
+		return;
+
+	ext = mono_class_alloc0 (klass, sizeof (MonoClassExt));
+	/* If we lose the race, the memory is wasted, but this is rare */
+	if (InterlockedCompareExchangePointer ((gpointer*)&klass->ext, ext, NULL) == NULL)
+		InterlockedAdd ((gint32*)&class_ext_size, sizeof (MonoClassExt));
+}
+
+/*
+ * Allocate klass->ext->field_def_values if not already done.
+ * LOCKING: Doesn't need any locks.
+ */
+static void
+mono_class_alloc_field_def_values (MonoClass *klass)
+{
+	MonoFieldDefaultValue *def_values;
+
+	mono_class_alloc_ext (klass);
+	if (klass->ext->field_def_values)
+		return;
+
+	def_values = mono_class_alloc0 (klass, sizeof (MonoFieldDefaultValue) * klass->field.count);
+	InterlockedCompareExchangePointer ((gpointer*)&klass->ext->field_def_values, def_values, NULL);
 }
 
 /*
@@ -862,7 +862,7 @@ MonoMethod *
 mono_cominterop_get_native_wrapper (MonoMethod *method)
 {
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethodBuilder *mb;
 	MonoMethodSignature *sig, *csig;
 
@@ -977,7 +977,7 @@ mono_cominterop_get_invoke (MonoMethod *method)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	int i, temp_obj;
-	GHashTable* cache = mono_marshal_get_cache (&method->klass->image->cominterop_invoke_cache, mono_aligned_addr_hash, NULL);
+	MonoConcurrentHashTable* cache = mono_marshal_get_cache (&method->klass->image->cominterop_invoke_cache, mono_aligned_addr_hash, NULL);
 
 	g_assert (method);
 
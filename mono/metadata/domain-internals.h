@@ -218,6 +218,8 @@ struct _MonoJitInfo {
 
 	/* FIXME: Embed this after the structure later*/
 	gpointer    gc_info; /* Currently only used by SGen */
+	/* Pre-decoded unwind table, initialized lazily by the JIT */
+	gpointer    unwind_table;
 	
 	MonoJitExceptionInfo clauses [MONO_ZERO_LEN_ARRAY];
 	/* There is an optional MonoGenericJitInfo after the clauses */
@@ -308,7 +310,7 @@ struct _MonoDomain {
 	MonoGHashTable     *env;
 	MonoGHashTable     *ldstr_table;
 	/* hashtables for Reflection handles */
-	MonoGHashTable     *type_hash;
+	MonoConcurrentHashTable *type_hash;
 	MonoGHashTable     *refobject_hash;
 	/* a GC-tracked array to keep references to the static fields of types */
 	gpointer           *static_data_array;
@@ -494,6 +496,9 @@ mono_domain_code_reserve (MonoDomain *domain, int size) MONO_LLVM_INTERNAL;
 void*
 mono_domain_code_reserve_align (MonoDomain *domain, int size, int alignment) MONO_INTERNAL;
 
+void*
+mono_domain_code_reserve_cold (MonoDomain *domain, int size) MONO_INTERNAL;
+
 void
 mono_domain_code_commit (MonoDomain *domain, void *data, int size, int newsize) MONO_INTERNAL;
 
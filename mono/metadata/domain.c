@@ -1977,7 +1977,7 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 	mono_reflection_cleanup_domain (domain);
 
 	if (domain->type_hash) {
-		mono_g_hash_table_destroy (domain->type_hash);
+		mono_conc_hashtable_destroy (domain->type_hash);
 		domain->type_hash = NULL;
 	}
 	if (domain->type_init_exception_hash) {
@@ -2230,6 +2230,25 @@ mono_domain_code_reserve (MonoDomain *domain, int size)
 	return res;
 }
 
+/*
+ * mono_domain_code_reserve_cold:
+ *
+ *   Same as mono_domain_code_reserve (), but the code is placed away from the
+ * frequently executed code.
+ * LOCKING: Acquires the domain lock.
+ */
+void*
+mono_domain_code_reserve_cold (MonoDomain *domain, int size)
+{
+	gpointer res;
+
+	mono_domain_lock (domain);
+	res = mono_code_manager_reserve_cold (domain->code_mp, size);
+	mono_domain_unlock (domain);
+
+	return res;
+}
+
 /*
  * mono_domain_code_reserve_align:
  *
@@ -919,6 +919,12 @@ ICALL(THREADP_35, "SetMaxThreads", ves_icall_System_Threading_ThreadPool_SetMaxT
 ICALL(THREADP_4, "SetMinThreads", ves_icall_System_Threading_ThreadPool_SetMinThreads)
 ICALL(THREADP_5, "pool_queue", icall_append_job)
 
+ICALL_TYPE(TIMER, "System.Threading.Timer", TIMER_1)
+ICALL(TIMER_1, "AddTimer", ves_icall_System_Threading_Timer_AddTimer)
+ICALL(TIMER_2, "CancelTimer", ves_icall_System_Threading_Timer_CancelTimer)
+ICALL(TIMER_3, "CreateTimerQueue", ves_icall_System_Threading_Timer_CreateTimerQueue)
+ICALL(TIMER_4, "GetExpiredTimers", ves_icall_System_Threading_Timer_GetExpiredTimers)
+
 ICALL_TYPE(VOLATILE, "System.Threading.Volatile", VOLATILE_28)
 ICALL(VOLATILE_28, "Read(T&)", ves_icall_System_Threading_Volatile_Read_T)
 ICALL(VOLATILE_1, "Read(bool&)", ves_icall_System_Threading_Volatile_Read1)
@@ -1475,6 +1475,13 @@ free_hash (GHashTable *hash)
 		g_hash_table_destroy (hash);
 }
 
+static inline void
+free_conc_hash (MonoConcurrentHashTable *hash)
+{
+	if (hash)
+		mono_conc_hashtable_destroy (hash);
+}
+
 /*
  * Returns whether mono_image_close_finish() must be called as well.
  * We must unload images in two steps because clearing the domain in
@@ -1597,10 +1604,8 @@ mono_image_close_except_pools (MonoImage *image)
 		g_free (image->files);
 	}
 
-	if (image->method_cache)
-		g_hash_table_destroy (image->method_cache);
-	if (image->methodref_cache)
-		g_hash_table_destroy (image->methodref_cache);
+	free_conc_hash (image->method_cache);
+	free_conc_hash (image->methodref_cache);
 	mono_internal_hash_table_destroy (&image->class_cache);
 	g_hash_table_destroy (image->field_cache);
 	if (image->array_cache) {
@@ -1616,38 +1621,38 @@ mono_image_close_except_pools (MonoImage *image)
 		g_hash_table_destroy (image->name_cache);
 	}
 
-	free_hash (image->native_wrapper_cache);
-	free_hash (image->managed_wrapper_cache);
-	free_hash (image->delegate_begin_invoke_cache);
-	free_hash (image->delegate_end_invoke_cache);
-	free_hash (image->delegate_invoke_cache);
+	free_conc_hash (image->native_wrapper_cache);
+	free_conc_hash (image->managed_wrapper_cache);
+	free_conc_hash (image->delegate_begin_invoke_cache);
+	free_conc_hash (image->delegate_end_invoke_cache);
+	free_conc_hash (image->delegate_invoke_cache);
 	free_hash (image->delegate_abstract_invoke_cache);
-	free_hash (image->delegate_bound_static_invoke_cache);
-	free_hash (image->delegate_invoke_generic_cache);
-	free_hash (image->delegate_begin_invoke_generic_cache);
-	free_hash (image->delegate_end_invoke_generic_cache);
-	free_hash (image->synchronized_generic_cache);
+	free_conc_hash (image->delegate_bound_static_invoke_cache);
+	free_conc_hash (image->delegate_invoke_generic_cache);
+	free_conc_hash (image->delegate_begin_invoke_generic_cache);
+	free_conc_hash (image->delegate_end_invoke_generic_cache);
+	free_conc_hash (image->synchronized_generic_cache);
 	free_hash (image->remoting_invoke_cache);
-	free_hash (image->runtime_invoke_cache);
-	free_hash (image->runtime_invoke_vtype_cache);
-	free_hash (image->runtime_invoke_direct_cache);
-	free_hash (image->runtime_invoke_vcall_cache);
-	free_hash (image->synchronized_cache);
-	free_hash (image->unbox_wrapper_cache);
-	free_hash (image->cominterop_invoke_cache);
-	free_hash (image->cominterop_wrapper_cache);
+	free_conc_hash (image->runtime_invoke_cache);
+	free_conc_hash (image->runtime_invoke_vtype_cache);
+	free_conc_hash (image->runtime_invoke_direct_cache);
+	free_conc_hash (image->runtime_invoke_vcall_cache);
+	free_conc_hash (image->synchronized_cache);
+	free_conc_hash (image->unbox_wrapper_cache);
+	free_conc_hash (image->cominterop_invoke_cache);
+	free_conc_hash (image->cominterop_wrapper_cache);
 	free_hash (image->typespec_cache);
-	free_hash (image->ldfld_wrapper_cache);
-	free_hash (image->ldflda_wrapper_cache);
-	free_hash (image->stfld_wrapper_cache);
-	free_hash (image->isinst_cache);
-	free_hash (image->castclass_cache);
-	free_hash (image->proxy_isinst_cache);
-	free_hash (image->thunk_invoke_cache);
+	free_conc_hash (image->ldfld_wrapper_cache);
+	free_conc_hash (image->ldflda_wrapper_cache);
+	free_conc_hash (image->stfld_wrapper_cache);
+	free_conc_hash (image->isinst_cache);
+	free_conc_hash (image->castclass_cache);
+	free_conc_hash (image->proxy_isinst_cache);
+	free_conc_hash (image->thunk_invoke_cache);
 	free_hash (image->var_cache_slow);
 	free_hash (image->mvar_cache_slow);
 	free_hash (image->wrapper_param_names);
-	free_hash (image->native_wrapper_aot_cache);
+	free_conc_hash (image->native_wrapper_aot_cache);
 	free_hash (image->pinvoke_scopes);
 	free_hash (image->pinvoke_scope_filenames);
 	free_hash (image->gsharedvt_types);
@@ -42,6 +42,7 @@
 #include <mono/utils/mono-logger-internal.h>
 #include <mono/utils/mono-dl.h>
 #include <mono/utils/mono-membar.h>
+#include <mono/utils/atomic.h>
 #include <mono/utils/mono-counters.h>
 #include <mono/utils/mono-error-internals.h>
 #include <mono/utils/mono-tls.h>
@@ -63,6 +64,8 @@ static guint32 inflated_signatures_size;
 static guint32 memberref_sig_cache_size;
 static guint32 methods_size;
 static guint32 signatures_size;
+static gint32 loader_lock_acquisitions;
+static gint32 loader_lock_contentions;
 
 /*
  * This TLS variable contains the last type load error encountered by the loader.
@@ -97,6 +100,10 @@ mono_loader_init ()
 								MONO_COUNTER_METADATA | MONO_COUNTER_INT, &methods_size);
 		mono_counters_register ("MonoMethodSignature size",
 								MONO_COUNTER_METADATA | MONO_COUNTER_INT, &signatures_size);
+		mono_counters_register ("Loader lock acquisitions",
+								MONO_COUNTER_METADATA | MONO_COUNTER_INT, &loader_lock_acquisitions);
+		mono_counters_register ("Loader lock contentions",
+								MONO_COUNTER_METADATA | MONO_COUNTER_INT, &loader_lock_contentions);
 
 		inited = TRUE;
 	}
@@ -1808,58 +1815,58 @@ mono_get_method (MonoImage *image, guint32 token, MonoClass *klass)
 	return mono_get_method_full (image, token, klass, NULL);
 }
 
+/*
+ * Return the cache pointed to by VAR, lazily creating it.
+ */
+static MonoConcurrentHashTable*
+get_method_cache (MonoImage *image, MonoConcurrentHashTable **var)
+{
+	if (!*var) {
+		mono_image_lock (image);
+		if (!*var) {
+			MonoConcurrentHashTable *cache = mono_conc_hashtable_new (NULL, NULL);
+			mono_memory_barrier ();
+			*var = cache;
+		}
+		mono_image_unlock (image);
+	}
+	return *var;
+}
+
 MonoMethod *
 mono_get_method_full (MonoImage *image, guint32 token, MonoClass *klass,
 		      MonoGenericContext *context)
 {
 	MonoMethod *result = NULL;
+	MonoConcurrentHashTable *cache = NULL;
+	gpointer key = NULL;
 	gboolean used_context = FALSE;
 
-	/* We do everything inside the lock to prevent creation races */
-
-	mono_image_lock (image);
+	/* The method caches don't need the image lock */
 
 	if (mono_metadata_token_table (token) == MONO_TABLE_METHOD) {
-		if (!image->method_cache)
-			image->method_cache = g_hash_table_new (NULL, NULL);
-		result = g_hash_table_lookup (image->method_cache, GINT_TO_POINTER (mono_metadata_token_index (token)));
+		cache = get_method_cache (image, &image->method_cache);
+		key = GINT_TO_POINTER (mono_metadata_token_index (token));
 	} else if (!image->dynamic) {
-		if (!image->methodref_cache)
-			image->methodref_cache = g_hash_table_new (NULL, NULL);
-		result = g_hash_table_lookup (image->methodref_cache, GINT_TO_POINTER (token));
+		cache = get_method_cache (image, &image->methodref_cache);
+		key = GINT_TO_POINTER (token);
 	}
-	mono_image_unlock (image);
 
-	if (result)
+	if (cache && (result = mono_conc_hashtable_lookup (cache, key)))
 		return result;
 
-
 	result = mono_get_method_from_token (image, token, klass, context, &used_context);
 	if (!result)
 		return NULL;
 
-	mono_image_lock (image);
-	if (!used_context && !result->is_inflated) {
-		MonoMethod *result2 = NULL;
+	if (cache && !used_context && !result->is_inflated) {
+		/* Another thread might have created it first */
+		MonoMethod *result2 = mono_conc_hashtable_insert (cache, key, result);
 
-		if (mono_metadata_token_table (token) == MONO_TABLE_METHOD)
-			result2 = g_hash_table_lookup (image->method_cache, GINT_TO_POINTER (mono_metadata_token_index (token)));
-		else if (!image->dynamic)
-			result2 = g_hash_table_lookup (image->methodref_cache, GINT_TO_POINTER (token));
-
-		if (result2) {
-			mono_image_unlock (image);
+		if (result2)
 			return result2;
-		}
-
-		if (mono_metadata_token_table (token) == MONO_TABLE_METHOD)
-			g_hash_table_insert (image->method_cache, GINT_TO_POINTER (mono_metadata_token_index (token)), result);
-		else if (!image->dynamic)
-			g_hash_table_insert (image->methodref_cache, GINT_TO_POINTER (token), result);
 	}
 
-	mono_image_unlock (image);
-
 	return result;
 }
 
@@ -2305,7 +2312,13 @@ static gboolean loader_lock_track_ownership = FALSE;
 void
 mono_loader_lock (void)
 {
-	mono_locks_acquire (&loader_mutex, LoaderLock);
+	if (G_UNLIKELY (!TryEnterCriticalSection (&loader_mutex))) {
+		InterlockedIncrement (&loader_lock_contentions);
+		EnterCriticalSection (&loader_mutex);
+	}
+	mono_locks_lock_acquired (LoaderLock, &loader_mutex);
+	/* Protected by the lock itself */
+	loader_lock_acquisitions++;
 	if (G_UNLIKELY (loader_lock_track_ownership)) {
 		mono_native_tls_set_value (loader_lock_nest_id, GUINT_TO_POINTER (GPOINTER_TO_UINT (mono_native_tls_get_value (loader_lock_nest_id)) + 1));
 	}
@@ -2424,15 +2424,16 @@ mono_marshal_need_free (MonoType *t, MonoMethodPInvoke *piinfo, MonoMarshalSpec
 
 /*
  * Return the hash table pointed to by VAR, lazily creating it if neccesary.
+ * Lookups in the returned table don't need the marshal lock.
  */
-static GHashTable*
-get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
+static MonoConcurrentHashTable*
+get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
 {
 	if (!(*var)) {
 		mono_marshal_lock ();
 		if (!(*var)) {
-			GHashTable *cache = 
-				g_hash_table_new (hash_func, equal_func);
+			MonoConcurrentHashTable *cache = 
+				mono_conc_hashtable_new (hash_func, equal_func);
 			mono_memory_barrier ();
 			*var = cache;
 		}
@@ -2457,48 +2458,49 @@ get_cache_full (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func,
 	return *var;
 }
 
-GHashTable*
-mono_marshal_get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
+MonoConcurrentHashTable*
+mono_marshal_get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GCompareFunc equal_func)
 {
 	return get_cache (var, hash_func, equal_func);
 }
 
 MonoMethod*
-mono_marshal_find_in_cache (GHashTable *cache, gpointer key)
+mono_marshal_find_in_cache (MonoConcurrentHashTable *cache, gpointer key)
+{
+	return mono_conc_hashtable_lookup (cache, key);
+}
+
+/*
+ * Add METHOD to CACHE unless another thread added a method for KEY first.
+ * Return the method which ended up in the cache.
+ */
+static MonoMethod*
+add_to_cache (MonoConcurrentHashTable *cache, gpointer key, MonoMethod *method)
 {
 	MonoMethod *res;
 
-	mono_marshal_lock ();
-	res = g_hash_table_lookup (cache, key);
-	mono_marshal_unlock ();
-	return res;
+	/* The method has to be fully initialized before lock-free readers can see it */
+	mono_memory_barrier ();
+	res = mono_conc_hashtable_insert (cache, key, method);
+	return res ? res : method;
 }
 
 /* Create the method from the builder and place it in the cache */
 MonoMethod*
-mono_mb_create_and_cache (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache (MonoConcurrentHashTable *cache, gpointer key,
 							   MonoMethodBuilder *mb, MonoMethodSignature *sig,
 							   int max_stack)
 {
 	MonoMethod *res;
 
-	mono_marshal_lock ();
-	res = g_hash_table_lookup (cache, key);
-	mono_marshal_unlock ();
+	res = mono_conc_hashtable_lookup (cache, key);
 	if (!res) {
 		MonoMethod *newm;
 		newm = mono_mb_create_method (mb, sig, max_stack);
-		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, key);
-		if (!res) {
-			res = newm;
-			g_hash_table_insert (cache, key, res);
-			mono_marshal_set_wrapper_info (res, key);
-			mono_marshal_unlock ();
-		} else {
-			mono_marshal_unlock ();
+		mono_marshal_set_wrapper_info (newm, key);
+		res = add_to_cache (cache, key, newm);
+		if (res != newm)
 			mono_free_method (newm);
-		}
 	}
 
 	return res;
@@ -2710,7 +2712,7 @@ get_wrapper_target_class (MonoImage *image)
  * generic method definition.
  */
 static MonoMethod*
-check_generic_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, gpointer key, gpointer def_key)
+check_generic_wrapper_cache (MonoConcurrentHashTable *cache, MonoMethod *orig_method, gpointer key, gpointer def_key)
 {
 	MonoMethod *res;
 	MonoMethod *inst, *def;
@@ -2735,41 +2737,25 @@ check_generic_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, gpointe
 	if (def) {
 		inst = mono_class_inflate_generic_method (def, ctx);
 		/* Cache it */
-		mono_memory_barrier ();
-		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, key);
-		if (!res) {
-			g_hash_table_insert (cache, key, inst);
-			res = inst;
-		}
-		mono_marshal_unlock ();
-		return res;
+		return add_to_cache (cache, key, inst);
 	}
 	return NULL;
 }
 
 static MonoMethod*
-cache_generic_wrapper (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx, gpointer key)
+cache_generic_wrapper (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx, gpointer key)
 {
-	MonoMethod *inst, *res;
+	MonoMethod *inst;
 
 	/*
 	 * We use the same cache for the generic definition and the instances.
 	 */
 	inst = mono_class_inflate_generic_method (def, ctx);
-	mono_memory_barrier ();
-	mono_marshal_lock ();
-	res = g_hash_table_lookup (cache, key);
-	if (!res) {
-		g_hash_table_insert (cache, key, inst);
-		res = inst;
-	}
-	mono_marshal_unlock ();
-	return res;
+	return add_to_cache (cache, key, inst);
 }
 
 static MonoMethod*
-check_generic_delegate_wrapper_cache (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def_method, MonoGenericContext *ctx)
+check_generic_delegate_wrapper_cache (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def_method, MonoGenericContext *ctx)
 {
 	MonoMethod *res;
 	MonoMethod *inst, *def;
@@ -2788,37 +2774,21 @@ check_generic_delegate_wrapper_cache (GHashTable *cache, MonoMethod *orig_method
 	if (def) {
 		inst = mono_class_inflate_generic_method (def, ctx);
 		/* Cache it */
-		mono_memory_barrier ();
-		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, orig_method->klass);
-		if (!res) {
-			g_hash_table_insert (cache, orig_method->klass, inst);
-			res = inst;
-		}
-		mono_marshal_unlock ();
-		return res;
+		return add_to_cache (cache, orig_method->klass, inst);
 	}
 	return NULL;
 }
 
 static MonoMethod*
-cache_generic_delegate_wrapper (GHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx)
+cache_generic_delegate_wrapper (MonoConcurrentHashTable *cache, MonoMethod *orig_method, MonoMethod *def, MonoGenericContext *ctx)
 {
-	MonoMethod *inst, *res;
+	MonoMethod *inst;
 
 	/*
 	 * We use the same cache for the generic definition and the instances.
 	 */
 	inst = mono_class_inflate_generic_method (def, ctx);
-	mono_memory_barrier ();
-	mono_marshal_lock ();
-	res = g_hash_table_lookup (cache, orig_method->klass);
-	if (!res) {
-		g_hash_table_insert (cache, orig_method->klass, inst);
-		res = inst;
-	}
-	mono_marshal_unlock ();
-	return res;
+	return add_to_cache (cache, orig_method->klass, inst);
 }
 
 MonoMethod *
@@ -2827,7 +2797,7 @@ mono_marshal_get_delegate_begin_invoke (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int params_var;
 	char *name;
 	MonoGenericContext *ctx = NULL;
@@ -3037,7 +3007,7 @@ mono_marshal_get_delegate_end_invoke (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int params_var;
 	char *name;
 	MonoGenericContext *ctx = NULL;
@@ -4181,7 +4151,9 @@ mono_marshal_get_delegate_invoke (MonoMethod *method, MonoDelegate *del)
 	int i;
 	MonoMethodBuilder *mb;
 	MonoMethod *res, *newm;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
+	/* delegate_abstract_invoke_cache, its keys are freed on removal so it is protected by the marshal lock */
+	GHashTable *abstract_cache;
 	SignatureMethodPair key;
 	SignatureMethodPair *new_key;
 	int local_prev, local_target;
@@ -4275,10 +4247,10 @@ mono_marshal_get_delegate_invoke (MonoMethod *method, MonoDelegate *del)
 		mono_marshal_lock ();
 		if (!*cache_ptr)
 			*cache_ptr = g_hash_table_new_full (signature_method_pair_hash, (GEqualFunc)signature_method_pair_equal, (GDestroyNotify)free_signature_method_pair, NULL);
-		cache = *cache_ptr;
+		abstract_cache = *cache_ptr;
 		key.sig = invoke_sig;
 		key.method = target_method;
-		res = g_hash_table_lookup (cache, &key);
+		res = g_hash_table_lookup (abstract_cache, &key);
 		mono_marshal_unlock ();
 		if (res)
 			return res;
@@ -4430,14 +4402,14 @@ mono_marshal_get_delegate_invoke (MonoMethod *method, MonoDelegate *del)
 		/*We perform double checked locking, so must fence before publishing*/
 		mono_memory_barrier ();
 		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, &key);
+		res = g_hash_table_lookup (abstract_cache, &key);
 		if (!res) {
 			res = newm;
 			new_key = g_new0 (SignatureMethodPair, 1);
 			*new_key = key;
 			if (static_method_with_first_arg_bound)
 				new_key->sig = signature_dup (del->method->klass->image, key.sig);
-			g_hash_table_insert (cache, new_key, res);
+			g_hash_table_insert (abstract_cache, new_key, res);
 
 			info = mono_wrapper_info_create (res, WRAPPER_SUBTYPE_DELEGATE_INVOKE_VIRTUAL);
 			mono_marshal_set_wrapper_info (res, info);
@@ -4919,7 +4891,7 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual)
 {
 	MonoMethodSignature *sig, *csig, *callsig;
 	MonoMethodBuilder *mb;
-	GHashTable *cache = NULL;
+	MonoConcurrentHashTable *cache = NULL;
 	MonoClass *target_klass;
 	MonoMethod *res = NULL;
 	static MonoMethodSignature *cctor_signature = NULL;
@@ -5006,11 +4978,7 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual)
 							   (GHashFunc)mono_signature_hash,
 							   (GCompareFunc)runtime_invoke_signature_equal);
 
-		/* from mono_marshal_find_in_cache */
-		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, callsig);
-		mono_marshal_unlock ();
-
+		res = mono_marshal_find_in_cache (cache, callsig);
 		if (res) {
 			g_free (callsig);
 			return res;
@@ -5064,29 +5032,22 @@ mono_marshal_get_runtime_invoke (MonoMethod *method, gboolean virtual)
 		mono_marshal_set_wrapper_info (res, info);
 	} else {
 		/* taken from mono_mb_create_and_cache */
-		mono_marshal_lock ();
-		res = g_hash_table_lookup (cache, callsig);
-		mono_marshal_unlock ();
+		res = mono_conc_hashtable_lookup (cache, callsig);
 
 		/* Somebody may have created it before us */
 		if (!res) {
 			MonoMethod *newm;
 			newm = mono_mb_create_method (mb, csig, sig->param_count + 16);
+			info = mono_wrapper_info_create (newm, WRAPPER_SUBTYPE_RUNTIME_INVOKE_NORMAL);
+			info->d.runtime_invoke.sig = callsig;
+			mono_marshal_set_wrapper_info (newm, info);
 
-			mono_marshal_lock ();
-			res = g_hash_table_lookup (cache, callsig);
-			if (!res) {
-				res = newm;
-				g_hash_table_insert (cache, callsig, res);
+			res = add_to_cache (cache, callsig, newm);
+			if (res == newm)
 				/* Can't insert it into wrapper_hash since the key is a signature */
-				g_hash_table_insert (method->klass->image->runtime_invoke_direct_cache, method, res);
-				info = mono_wrapper_info_create (res, WRAPPER_SUBTYPE_RUNTIME_INVOKE_NORMAL);
-				info->d.runtime_invoke.sig = callsig;
-				mono_marshal_set_wrapper_info (res, info);
-			} else {
+				mono_conc_hashtable_insert (method->klass->image->runtime_invoke_direct_cache, method, res);
+			else
 				mono_free_method (newm);
-			}
-			mono_marshal_unlock ();
 		}
 
 		/* end mono_mb_create_and_cache */
@@ -5325,7 +5286,7 @@ mono_marshal_get_ldfld_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 	int t, pos0, pos1 = 0;
 
@@ -5480,7 +5441,7 @@ mono_marshal_get_ldflda_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 	int t, pos0, pos1, pos2, pos3;
 
@@ -5680,7 +5641,7 @@ mono_marshal_get_stfld_wrapper (MonoType *type)
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 	int t, pos;
 
@@ -8848,7 +8809,7 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 	MonoMethodBuilder *mb;
 	MonoMarshalSpec **mspecs;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	gboolean pinvoke = FALSE;
 	gpointer iter;
 	int i;
@@ -9073,7 +9034,7 @@ mono_marshal_get_native_func_wrapper (MonoImage *image, MonoMethodSignature *sig
 
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 
 	cache = get_cache (&image->native_wrapper_cache, mono_aligned_addr_hash, NULL);
@@ -9109,7 +9070,7 @@ mono_marshal_get_native_func_wrapper_aot (MonoClass *klass)
 	MonoMethodSignature *sig, *csig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	char *name;
 	WrapperInfo *info;
 	MonoMethodPInvoke mpiinfo;
@@ -9443,7 +9404,7 @@ mono_marshal_get_managed_wrapper (MonoMethod *method, MonoClass *delegate_klass,
 	MonoMethod *res, *invoke;
 	MonoMarshalSpec **mspecs;
 	MonoMethodPInvoke piinfo;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int i;
 	EmitMarshalContext m;
 
@@ -9914,7 +9875,7 @@ MonoMethod *
 mono_marshal_get_isinst (MonoClass *klass)
 {
 	static MonoMethodSignature *isint_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	int pos_was_ok, pos_end;
 #ifndef DISABLE_REMOTING
@@ -10020,7 +9981,7 @@ MonoMethod *
 mono_marshal_get_castclass (MonoClass *klass)
 {
 	static MonoMethodSignature *castclass_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 #ifndef DISABLE_REMOTING
 	int pos_was_ok, pos_was_ok2;
@@ -10097,7 +10058,7 @@ MonoMethod *
 mono_marshal_get_proxy_cancast (MonoClass *klass)
 {
 	static MonoMethodSignature *isint_sig = NULL;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	int pos_failed, pos_end;
 	char *name, *klass_name;
@@ -10388,7 +10349,7 @@ mono_marshal_get_synchronized_wrapper (MonoMethod *method)
 	MonoExceptionClause *clause;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int i, pos, this_local, ret_local = 0;
 	MonoGenericContext *ctx = NULL;
 	MonoMethod *orig_method = NULL;
@@ -10565,7 +10526,7 @@ mono_marshal_get_unbox_wrapper (MonoMethod *method)
 	int i;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 
 	cache = get_cache (&method->klass->image->unbox_wrapper_cache, mono_aligned_addr_hash, NULL);
 	if ((res = mono_marshal_find_in_cache (cache, method)))
@@ -11517,7 +11478,7 @@ mono_marshal_get_array_accessor_wrapper (MonoMethod *method)
 	MonoMethodSignature *sig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	int i;
 	MonoGenericContext *ctx = NULL;
 	MonoMethod *orig_method = NULL;
@@ -12789,7 +12750,7 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	MonoExceptionClause *clause;
 	MonoImage *image;
 	MonoClass *klass;
-	GHashTable *cache;
+	MonoConcurrentHashTable *cache;
 	MonoMethod *res;
 	int i, param_count, sig_size, pos_leave;
 
@@ -12946,7 +12907,7 @@ mono_marshal_free_dynamic_wrappers (MonoMethod *method)
 	 * they could be shared with other methods ?
 	 */
 	if (image->runtime_invoke_direct_cache)
-		g_hash_table_remove (image->runtime_invoke_direct_cache, method);
+		mono_conc_hashtable_remove (image->runtime_invoke_direct_cache, method);
 	if (image->delegate_abstract_invoke_cache)
 		g_hash_table_foreach_remove (image->delegate_abstract_invoke_cache, signature_method_pair_matches_method, method);
 
@@ -12990,15 +12951,15 @@ mono_marshal_free_inflated_wrappers (MonoMethod *method)
          */
 	   /* FIXME: This could remove unrelated wrappers as well */
        if (sig && method->klass->image->delegate_begin_invoke_cache)
-               g_hash_table_remove (method->klass->image->delegate_begin_invoke_cache, sig);
+               mono_conc_hashtable_remove (method->klass->image->delegate_begin_invoke_cache, sig);
        if (sig && method->klass->image->delegate_end_invoke_cache)
-               g_hash_table_remove (method->klass->image->delegate_end_invoke_cache, sig);
+               mono_conc_hashtable_remove (method->klass->image->delegate_end_invoke_cache, sig);
        if (sig && method->klass->image->delegate_invoke_cache)
-               g_hash_table_remove (method->klass->image->delegate_invoke_cache, sig);
+               mono_conc_hashtable_remove (method->klass->image->delegate_invoke_cache, sig);
        if (sig && method->klass->image->runtime_invoke_cache)
-               g_hash_table_remove (method->klass->image->runtime_invoke_cache, sig);
+               mono_conc_hashtable_remove (method->klass->image->runtime_invoke_cache, sig);
        if (sig && method->klass->image->runtime_invoke_vtype_cache)
-               g_hash_table_remove (method->klass->image->runtime_invoke_vtype_cache, sig);
+               mono_conc_hashtable_remove (method->klass->image->runtime_invoke_vtype_cache, sig);
 
         /*
          * indexed by SignatureMethodPair
@@ -13011,25 +12972,25 @@ mono_marshal_free_inflated_wrappers (MonoMethod *method)
          * indexed by MonoMethod pointers
          */
        if (method->klass->image->runtime_invoke_direct_cache)
-               g_hash_table_remove (method->klass->image->runtime_invoke_direct_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->runtime_invoke_direct_cache, method);
        if (method->klass->image->managed_wrapper_cache)
-               g_hash_table_remove (method->klass->image->managed_wrapper_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->managed_wrapper_cache, method);
        if (method->klass->image->native_wrapper_cache)
-               g_hash_table_remove (method->klass->image->native_wrapper_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->native_wrapper_cache, method);
        if (method->klass->image->remoting_invoke_cache)
                g_hash_table_remove (method->klass->image->remoting_invoke_cache, method);
        if (method->klass->image->synchronized_cache)
-               g_hash_table_remove (method->klass->image->synchronized_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->synchronized_cache, method);
        if (method->klass->image->unbox_wrapper_cache)
-               g_hash_table_remove (method->klass->image->unbox_wrapper_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->unbox_wrapper_cache, method);
        if (method->klass->image->cominterop_invoke_cache)
-               g_hash_table_remove (method->klass->image->cominterop_invoke_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->cominterop_invoke_cache, method);
        if (method->klass->image->cominterop_wrapper_cache)
-               g_hash_table_remove (method->klass->image->cominterop_wrapper_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->cominterop_wrapper_cache, method);
        if (method->klass->image->thunk_invoke_cache)
-               g_hash_table_remove (method->klass->image->thunk_invoke_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->thunk_invoke_cache, method);
        if (method->klass->image->native_func_wrapper_aot_cache)
-               g_hash_table_remove (method->klass->image->native_func_wrapper_aot_cache, method);
+               mono_conc_hashtable_remove (method->klass->image->native_func_wrapper_aot_cache, method);
 
        mono_marshal_unlock ();
 }
@@ -553,14 +553,14 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 void
 mono_marshal_emit_managed_wrapper (MonoMethodBuilder *mb, MonoMethodSignature *invoke_sig, MonoMarshalSpec **mspecs, EmitMarshalContext* m, MonoMethod *method, uint32_t target_handle) MONO_INTERNAL;
 
-GHashTable*
-mono_marshal_get_cache (GHashTable **var, GHashFunc hash_func, GCompareFunc equal_func) MONO_INTERNAL;
+MonoConcurrentHashTable*
+mono_marshal_get_cache (MonoConcurrentHashTable **var, GHashFunc hash_func, GCompareFunc equal_func) MONO_INTERNAL;
 
 MonoMethod*
-mono_marshal_find_in_cache (GHashTable *cache, gpointer key) MONO_INTERNAL;
+mono_marshal_find_in_cache (MonoConcurrentHashTable *cache, gpointer key) MONO_INTERNAL;
 
 MonoMethod*
-mono_mb_create_and_cache (GHashTable *cache, gpointer key,
+mono_mb_create_and_cache (MonoConcurrentHashTable *cache, gpointer key,
 						  MonoMethodBuilder *mb, MonoMethodSignature *sig,
 						  int max_stack) MONO_INTERNAL;
 void
@@ -26,6 +26,8 @@
 #include <mono/metadata/marshal.h>
 #include <mono/metadata/profiler-private.h>
 #include <mono/utils/mono-time.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-tls.h>
 #include <mono/utils/atomic.h>
 
 /*
@@ -94,13 +96,59 @@ struct _MonitorArray {
 	MonoThreadsSync monitors [MONO_ZERO_LEN_ARRAY];
 };
 
-#define mono_monitor_allocator_lock() EnterCriticalSection (&monitor_mutex)
-#define mono_monitor_allocator_unlock() LeaveCriticalSection (&monitor_mutex)
+/*
+ * Sync blocks are handed out from per-thread caches which are refilled from
+ * and flushed to the global free list in batches, so monitor_mutex is only
+ * taken once every MONITOR_CACHE_BATCH inflations instead of on each of them.
+ * A thread's cache never holds more than MONITOR_CACHE_MAX records.
+ */
+#define MONITOR_CACHE_BATCH 16
+#define MONITOR_CACHE_MAX (MONITOR_CACHE_BATCH * 2)
+
+/*
+ * The data field of a sync block is NULL only once the GC cleared the weak
+ * link to its dead object, which is what the reclaim scan in mon_global_fill ()
+ * looks for. Free list chains are therefore terminated by this marker instead
+ * of NULL, and sync blocks which were just allocated keep it until their weak
+ * link is registered.
+ */
+#define MONITOR_DATA_RESERVED ((gpointer)(gssize)-1)
+
+typedef struct {
+	MonoThreadsSync *free;
+	int num_free;
+} MonitorThreadCache;
+
 static CRITICAL_SECTION monitor_mutex;
 static MonoThreadsSync *monitor_freelist;
 static MonitorArray *monitor_allocated;
 static int array_size = 16;
 
+/* Statistics */
+static gint32 monitor_allocations;
+static gint32 monitor_frees;
+static gint32 monitor_cache_refills;
+static gint32 monitor_cache_flushes;
+static gint32 monitor_reclaimed;
+static gint32 monitor_lock_contentions;
+
+#ifdef HAVE_KW_THREAD
+static __thread MonitorThreadCache monitor_thread_cache MONO_TLS_FAST;
+#else
+static MonoNativeTlsKey monitor_thread_cache_key;
+#endif
+
+static inline void
+mono_monitor_allocator_lock (void)
+{
+	if (!TryEnterCriticalSection (&monitor_mutex)) {
+		InterlockedIncrement (&monitor_lock_contentions);
+		EnterCriticalSection (&monitor_mutex);
+	}
+}
+
+#define mono_monitor_allocator_unlock() LeaveCriticalSection (&monitor_mutex)
+
 #ifdef HAVE_KW_THREAD
 static __thread gsize tls_pthread_self MONO_TLS_FAST;
 #endif
@@ -121,6 +169,16 @@ void
 mono_monitor_init (void)
 {
 	InitializeCriticalSection (&monitor_mutex);
+#ifndef HAVE_KW_THREAD
+	mono_native_tls_alloc (&monitor_thread_cache_key, NULL);
+#endif
+
+	mono_counters_register ("Monitor sync blocks allocated", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_allocations);
+	mono_counters_register ("Monitor sync blocks freed", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_frees);
+	mono_counters_register ("Monitor sync blocks reclaimed", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_reclaimed);
+	mono_counters_register ("Monitor cache refills", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_cache_refills);
+	mono_counters_register ("Monitor cache flushes", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_cache_flushes);
+	mono_counters_register ("Monitor allocator lock contentions", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &monitor_lock_contentions);
 }
  
 void
@@ -132,7 +190,7 @@ mono_monitor_cleanup (void)
 	/*DeleteCriticalSection (&monitor_mutex);*/
 
 	/* The monitors on the freelist don't have weak links - mark them */
-	for (mon = monitor_freelist; mon; mon = mon->data)
+	for (mon = monitor_freelist; mon; mon = mon->data == MONITOR_DATA_RESERVED ? NULL : mon->data)
 		mon->wait_list = (gpointer)-1;
 
 	/* FIXME: This still crashes with sgen (async_read.exe) */
@@ -165,10 +223,91 @@ mono_monitor_init_tls (void)
 #endif
 }
 
+static inline MonitorThreadCache*
+monitor_get_thread_cache (void)
+{
+#ifdef HAVE_KW_THREAD
+	return &monitor_thread_cache;
+#else
+	MonitorThreadCache *cache = mono_native_tls_get_value (monitor_thread_cache_key);
+
+	if (G_UNLIKELY (!cache)) {
+		cache = g_new0 (MonitorThreadCache, 1);
+		mono_native_tls_set_value (monitor_thread_cache_key, cache);
+	}
+	return cache;
+#endif
+}
+
+static inline void
+mon_list_push (MonoThreadsSync **list, MonoThreadsSync *mon)
+{
+	mon->data = *list ? (gpointer)*list : MONITOR_DATA_RESERVED;
+	*list = mon;
+}
+
+static inline MonoThreadsSync*
+mon_list_pop (MonoThreadsSync **list)
+{
+	MonoThreadsSync *mon = *list;
+
+	*list = mon->data == MONITOR_DATA_RESERVED ? NULL : mon->data;
+	mon->data = MONITOR_DATA_RESERVED;
+	return mon;
+}
+
+/*
+ * Move up to @count sync blocks from @cache to the global free list.
+ * LOCKING: this is called with monitor_mutex held
+ */
+static void
+mon_cache_flush_locked (MonitorThreadCache *cache, int count)
+{
+	while (cache->free && count-- > 0) {
+		mon_list_push (&monitor_freelist, mon_list_pop (&cache->free));
+		cache->num_free--;
+	}
+	++monitor_cache_flushes;
+}
+
+/*
+ * mono_monitor_cleanup_tls:
+ *
+ *   Return the sync blocks cached by the current thread to the global free list.
+ * This must be called by threads which locked objects before they exit,
+ * otherwise their cached sync blocks are lost.
+ */
+void
+mono_monitor_cleanup_tls (void)
+{
+	MonitorThreadCache *cache;
+
+#ifdef HAVE_KW_THREAD
+	cache = &monitor_thread_cache;
+#else
+	cache = mono_native_tls_get_value (monitor_thread_cache_key);
+	if (!cache)
+		return;
+#endif
+
+	if (cache->free) {
+		mono_monitor_allocator_lock ();
+		mon_cache_flush_locked (cache, cache->num_free);
+		mono_monitor_allocator_unlock ();
+	}
+
+#ifndef HAVE_KW_THREAD
+	mono_native_tls_set_value (monitor_thread_cache_key, NULL);
+	g_free (cache);
+#endif
+}
+
 static int
 monitor_is_on_freelist (MonoThreadsSync *mon)
 {
 	MonitorArray *marray;
+	if (mon == MONITOR_DATA_RESERVED)
+		return TRUE;
 	for (marray = monitor_allocated; marray; marray = marray->next) {
 		if (mon >= marray->monitors && mon < &marray->monitors [marray->num_monitors])
 			return TRUE;
@@ -192,7 +331,7 @@ mono_locks_dump (gboolean include_untaken)
 	int used = 0, on_freelist = 0, to_recycle = 0, total = 0, num_arrays = 0;
 	MonoThreadsSync *mon;
 	MonitorArray *marray;
-	for (mon = monitor_freelist; mon; mon = mon->data)
+	for (mon = monitor_freelist; mon; mon = mon->data == MONITOR_DATA_RESERVED ? NULL : mon->data)
 		on_freelist++;
 	for (marray = monitor_allocated; marray; marray = marray->next) {
 		total += marray->num_monitors;
@@ -200,8 +339,7 @@ mono_locks_dump (gboolean include_untaken)
 		for (i = 0; i < marray->num_monitors; ++i) {
 			mon = &marray->monitors [i];
 			if (mon->data == NULL) {
-				if (i < marray->num_monitors - 1)
-					to_recycle++;
+				to_recycle++;
 			} else {
 				if (!monitor_is_on_freelist (mon->data)) {
 					MonoObject *holder = mono_gc_weak_link_get (&mon->data);
@@ -218,14 +356,97 @@ mono_locks_dump (gboolean include_untaken)
 			}
 		}
 	}
-	g_print ("Total locks (in %d array(s)): %d, used: %d, on freelist: %d, to recycle: %d\n",
-		num_arrays, total, used, on_freelist, to_recycle);
+	g_print ("Total locks (in %d array(s)): %d, used: %d, on freelist: %d, in thread caches: %d, to recycle: %d\n",
+		num_arrays, total, used, on_freelist, total - used - on_freelist - to_recycle, to_recycle);
+	g_print ("Allocated: %d, freed: %d, reclaimed: %d, cache refills: %d, cache flushes: %d, lock contentions: %d\n",
+		monitor_allocations, monitor_frees, monitor_reclaimed, monitor_cache_refills, monitor_cache_flushes, monitor_lock_contentions);
+}
+
+/*
+ * Make sure the global free list is not empty, by recycling the sync blocks
+ * whose objects were collected or by allocating a new array of them.
+ * LOCKING: this is called with monitor_mutex held
+ */
+static void
+mon_global_fill (void)
+{
+	MonitorArray *marray;
+	MonoThreadsSync *mon;
+	int i;
+
+	if (monitor_freelist)
+		return;
+
+	/* see if any sync block has been collected */
+	for (marray = monitor_allocated; marray; marray = marray->next) {
+		for (i = 0; i < marray->num_monitors; ++i) {
+			mon = &marray->monitors [i];
+			if (mon->data != NULL)
+				continue;
+			if (mon->wait_list) {
+				/* Orphaned events left by aborted threads */
+				while (mon->wait_list) {
+					LOCK_DEBUG (g_message (G_GNUC_PRETTY_FUNCTION ": (%d): Closing orphaned event %d", GetCurrentThreadId (), mon->wait_list->data));
+					CloseHandle (mon->wait_list->data);
+					mon->wait_list = g_slist_remove (mon->wait_list, mon->wait_list->data);
+				}
+			}
+			mono_gc_weak_link_remove (&mon->data, FALSE);
+			mon_list_push (&monitor_freelist, mon);
+			++monitor_reclaimed;
+		}
+		/* small perf tweak to avoid scanning all the blocks */
+		if (monitor_freelist)
+			return;
+	}
+
+	/* need to allocate a new array of monitors */
+	LOCK_DEBUG (g_message ("%s: allocating more monitors: %d", __func__, array_size));
+	marray = g_malloc0 (sizeof (MonoArray) + array_size * sizeof (MonoThreadsSync));
+	marray->num_monitors = array_size;
+	array_size *= 2;
+	/* link into the freelist */
+	for (i = marray->num_monitors - 1; i >= 0; --i)
+		mon_list_push (&monitor_freelist, &marray->monitors [i]);
+	/* we happend the marray instead of prepending so that
+	 * the collecting loop above will need to scan smaller arrays first
+	 */
+	if (!monitor_allocated) {
+		monitor_allocated = marray;
+	} else {
+		MonitorArray *last = monitor_allocated;
+		while (last->next)
+			last = last->next;
+		last->next = marray;
+	}
+}
+
+/* Grab a batch of sync blocks from the global free list */
+static void
+mon_cache_refill (MonitorThreadCache *cache)
+{
+	int i;
+
+	mono_monitor_allocator_lock ();
+	for (i = 0; i < MONITOR_CACHE_BATCH; ++i) {
+		if (!monitor_freelist) {
+			/* don't trigger a scan just to fill the whole batch */
+			if (i > 0)
+				break;
+			mon_global_fill ();
+		}
+		mon_list_push (&cache->free, mon_list_pop (&monitor_freelist));
+		cache->num_free++;
+	}
+	++monitor_cache_refills;
+	mono_monitor_allocator_unlock ();
 }
 
-/* LOCKING: this is called with monitor_mutex held */
 static void 
 mon_finalize (MonoThreadsSync *mon)
 {
+	MonitorThreadCache *cache;
+
 	LOCK_DEBUG (g_message ("%s: Finalizing sync %p", __func__, mon));
 
 	if (mon->entry_sem != NULL) {
@@ -241,81 +462,43 @@ mon_finalize (MonoThreadsSync *mon)
 	mon->entry_count = 0;
 	/* owner and nest are set in mon_new, no need to zero them out */
 
-	mon->data = monitor_freelist;
-	monitor_freelist = mon;
+	cache = monitor_get_thread_cache ();
+	mon_list_push (&cache->free, mon);
+	if (++cache->num_free > MONITOR_CACHE_MAX) {
+		mono_monitor_allocator_lock ();
+		mon_cache_flush_locked (cache, MONITOR_CACHE_BATCH);
+		mono_monitor_allocator_unlock ();
+	}
+
+	InterlockedIncrement (&monitor_frees);
 #ifndef DISABLE_PERFCOUNTERS
-	mono_perfcounters->gc_sync_blocks--;
+	InterlockedDecrement ((gint32*)&mono_perfcounters->gc_sync_blocks);
 #endif
 }
 
-/* LOCKING: this is called with monitor_mutex held */
+/*
+ * Returns a sync block owned by @id. Its data field holds MONITOR_DATA_RESERVED
+ * until the caller registers the weak link to the object or passes it back to
+ * mon_finalize ().
+ */
 static MonoThreadsSync *
 mon_new (gsize id)
 {
+	MonitorThreadCache *cache = monitor_get_thread_cache ();
 	MonoThreadsSync *new;
 
-	if (!monitor_freelist) {
-		MonitorArray *marray;
-		int i;
-		/* see if any sync block has been collected */
-		new = NULL;
-		for (marray = monitor_allocated; marray; marray = marray->next) {
-			for (i = 0; i < marray->num_monitors; ++i) {
-				if (marray->monitors [i].data == NULL) {
-					new = &marray->monitors [i];
-					if (new->wait_list) {
-						/* Orphaned events left by aborted threads */
-						while (new->wait_list) {
-							LOCK_DEBUG (g_message (G_GNUC_PRETTY_FUNCTION ": (%d): Closing orphaned event %d", GetCurrentThreadId (), new->wait_list->data));
-							CloseHandle (new->wait_list->data);
-							new->wait_list = g_slist_remove (new->wait_list, new->wait_list->data);
-						}
-					}
-					mono_gc_weak_link_remove (&new->data, FALSE);
-					new->data = monitor_freelist;
-					monitor_freelist = new;
-				}
-			}
-			/* small perf tweak to avoid scanning all the blocks */
-			if (new)
-				break;
-		}
-		/* need to allocate a new array of monitors */
-		if (!monitor_freelist) {
-			MonitorArray *last;
-			LOCK_DEBUG (g_message ("%s: allocating more monitors: %d", __func__, array_size));
-			marray = g_malloc0 (sizeof (MonoArray) + array_size * sizeof (MonoThreadsSync));
-			marray->num_monitors = array_size;
-			array_size *= 2;
-			/* link into the freelist */
-			for (i = 0; i < marray->num_monitors - 1; ++i) {
-				marray->monitors [i].data = &marray->monitors [i + 1];
-			}
-			marray->monitors [i].data = NULL; /* the last one */
-			monitor_freelist = &marray->monitors [0];
-			/* we happend the marray instead of prepending so that
-			 * the collecting loop above will need to scan smaller arrays first
-			 */
-			if (!monitor_allocated) {
-				monitor_allocated = marray;
-			} else {
-				last = monitor_allocated;
-				while (last->next)
-					last = last->next;
-				last->next = marray;
-			}
-		}
-	}
+	if (G_UNLIKELY (!cache->free))
+		mon_cache_refill (cache);
 
-	new = monitor_freelist;
-	monitor_freelist = new->data;
+	new = mon_list_pop (&cache->free);
+	cache->num_free--;
 
 	new->owner = id;
 	new->nest = 1;
-	new->data = NULL;
-	
+
+	InterlockedIncrement (&monitor_allocations);
 #ifndef DISABLE_PERFCOUNTERS
-	mono_perfcounters->gc_sync_blocks++;
+	InterlockedIncrement ((gint32*)&mono_perfcounters->gc_sync_blocks);
 #endif
 	return new;
 }
@@ -436,11 +619,9 @@ retry:
 
 	/* If the object has never been locked... */
 	if (G_UNLIKELY (mon == NULL)) {
-		mono_monitor_allocator_lock ();
 		mon = mon_new (id);
 		if (InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, mon, NULL) == NULL) {
 			mono_gc_weak_link_add (&mon->data, obj, FALSE);
-			mono_monitor_allocator_unlock ();
 			/* Successfully locked */
 			return 1;
 		} else {
@@ -455,28 +636,23 @@ retry:
 				lw.lock_word |= LOCK_WORD_FAT_HASH;
 				if (InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, lw.sync, oldlw) == oldlw) {
 					mono_gc_weak_link_add (&mon->data, obj, FALSE);
-					mono_monitor_allocator_unlock ();
 					/* Successfully locked */
 					return 1;
 				} else {
 					mon_finalize (mon);
-					mono_monitor_allocator_unlock ();
 					goto retry;
 				}
 			} else if (lw.lock_word & LOCK_WORD_FAT_HASH) {
 				mon_finalize (mon);
-				mono_monitor_allocator_unlock ();
 				/* get the old lock without the fat hash bit */
 				lw.lock_word &= ~LOCK_WORD_BITS_MASK;
 				mon = lw.sync;
 			} else {
 				mon_finalize (mon);
-				mono_monitor_allocator_unlock ();
 				mon = obj->synchronisation;
 			}
 #else
 			mon_finalize (mon);
-			mono_monitor_allocator_unlock ();
 			mon = obj->synchronisation;
 #endif
 		}
@@ -486,7 +662,6 @@ retry:
 		lw.sync = mon;
 		if (lw.lock_word & LOCK_WORD_THIN_HASH) {
 			MonoThreadsSync *oldlw = lw.sync;
-			mono_monitor_allocator_lock ();
 			mon = mon_new (id);
 			/* move the already calculated hash */
 			mon->hash_code = lw.lock_word >> LOCK_WORD_HASH_SHIFT;
@@ -494,12 +669,10 @@ retry:
 			lw.lock_word |= LOCK_WORD_FAT_HASH;
 			if (InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, lw.sync, oldlw) == oldlw) {
 				mono_gc_weak_link_add (&mon->data, obj, TRUE);
-				mono_monitor_allocator_unlock ();
 				/* Successfully locked */
 				return 1;
 			} else {
 				mon_finalize (mon);
-				mono_monitor_allocator_unlock ();
 				goto retry;
 			}
 		}
@@ -780,7 +953,7 @@ mono_monitor_get_object_monitor_weak_link (MonoObject *object)
 		sync = lw.sync;
 	}
 
-	if (sync && sync->data)
+	if (sync && sync->data && sync->data != MONITOR_DATA_RESERVED)
 		return &sync->data;
 	return NULL;
 }
@@ -1492,7 +1665,7 @@ ves_icall_System_Threading_Monitor_Monitor_wait (MonoObject *obj, guint32 ms)
 	if (mono_thread_interruption_requested ()) {
 		/* 
 		 * Can't remove the event from wait_list, since the monitor is not locked by
-		 * us. So leave it there, mon_new () will delete it when the mon structure
+		 * us. So leave it there, mon_global_fill () will delete it when the mon structure
 		 * is placed on the free list.
 		 * FIXME: The caller expects to hold the lock after the wait returns, but it
 		 * doesn't happen in this case:
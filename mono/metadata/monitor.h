@@ -25,6 +25,8 @@ void** mono_monitor_get_object_monitor_weak_link (MonoObject *object) MONO_INTER
 
 void mono_monitor_init_tls (void) MONO_INTERNAL;
 
+void mono_monitor_cleanup_tls (void) MONO_INTERNAL;
+
 MonoMethod* mono_monitor_get_fast_path (MonoMethod *enter_or_exit) MONO_INTERNAL;
 
 void mono_monitor_threads_sync_members_offset (int *owner_offset, int *nest_offset, int *entry_count_offset) MONO_INTERNAL;
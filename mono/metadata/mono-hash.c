@@ -522,3 +522,87 @@ mono_g_hash_mark (void *addr, MonoGCMarkFunc mark_func)
 }
 	
 #endif
+
+#ifdef HAVE_SGEN_GC
+static void *conc_table_descr [MONO_HASH_KEY_VALUE_GC + 1];
+
+static void
+mono_conc_g_hash_mark_keys (void *addr, MonoGCMarkFunc mark_func)
+{
+	MonoConcHashTableStorage *table = (MonoConcHashTableStorage*)addr;
+	int i;
+
+	for (i = 0; i < table->table_size; i++) {
+		if (MONO_CONC_HASHTABLE_KEY_IS_LIVE (table->slots [i].key))
+			mark_func (&table->slots [i].key);
+	}
+}
+
+static void
+mono_conc_g_hash_mark_values (void *addr, MonoGCMarkFunc mark_func)
+{
+	MonoConcHashTableStorage *table = (MonoConcHashTableStorage*)addr;
+	int i;
+
+	/* Slots being filled or emptied can have a value without a live key */
+	for (i = 0; i < table->table_size; i++) {
+		if (table->slots [i].value)
+			mark_func (&table->slots [i].value);
+	}
+}
+
+static void
+mono_conc_g_hash_mark_keys_values (void *addr, MonoGCMarkFunc mark_func)
+{
+	mono_conc_g_hash_mark_keys (addr, mark_func);
+	mono_conc_g_hash_mark_values (addr, mark_func);
+}
+#endif
+
+/*
+ * The storage is malloc-ed instead of using mono_gc_alloc_fixed () since Boehm
+ * would collect it: the table itself is not GC visible.
+ */
+static gpointer
+conc_table_alloc (size_t size, gpointer descr)
+{
+	gpointer storage = g_malloc0 (size);
+
+	mono_gc_register_root ((char*)storage, size, descr);
+	return storage;
+}
+
+static void
+conc_table_free (gpointer storage)
+{
+	mono_gc_deregister_root ((char*)storage);
+	g_free (storage);
+}
+
+/*
+ * mono_conc_g_hash_table_new_type:
+ *
+ *   Create a MonoConcurrentHashTable whose keys and/or values (depending on TYPE)
+ * are managed objects. The storage of the table is registered as a GC root, so
+ * the keys/values are kept alive and updated when they move.
+ */
+MonoConcurrentHashTable *
+mono_conc_g_hash_table_new_type (GHashFunc hash_func, GEqualFunc key_equal_func, MonoGHashGCType type)
+{
+	void *descr = NULL;
+
+#ifdef HAVE_SGEN_GC
+	if (type > MONO_HASH_KEY_VALUE_GC)
+		g_error ("wrong type for gc hashtable");
+
+	if (type != MONO_HASH_CONSERVATIVE_GC && !conc_table_descr [type]) {
+		MonoGCRootMarkFunc mark = type == MONO_HASH_KEY_GC ? mono_conc_g_hash_mark_keys :
+			type == MONO_HASH_VALUE_GC ? mono_conc_g_hash_mark_values : mono_conc_g_hash_mark_keys_values;
+
+		conc_table_descr [type] = mono_gc_make_root_descr_user (mark);
+	}
+	descr = conc_table_descr [type];
+#endif
+
+	return mono_conc_hashtable_new_with_storage (hash_func, key_equal_func, conc_table_alloc, conc_table_free, descr);
+}
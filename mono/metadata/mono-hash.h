@@ -8,6 +8,7 @@
  */
 #include <glib.h>
 #include <mono/utils/mono-publib.h>
+#include <mono/utils/mono-conc-hashtable.h>
 #ifndef __MONO_G_HASH_H__
 #define __MONO_G_HASH_H__
 
@@ -38,5 +39,7 @@ MONO_API void     mono_g_hash_table_insert          (MonoGHashTable *h, gpointer
 MONO_API void     mono_g_hash_table_replace         (MonoGHashTable *h, gpointer k, gpointer v);
 MONO_API void     mono_g_hash_table_print_stats     (MonoGHashTable *table);
 
+MonoConcurrentHashTable *mono_conc_g_hash_table_new_type (GHashFunc hash_func, GEqualFunc key_equal_func, MonoGHashGCType type) MONO_INTERNAL;
+
 MONO_END_DECLS
 #endif /* __MONO_G_HASH_H__ */
@@ -5148,6 +5148,11 @@ mono_value_box (MonoDomain *domain, MonoClass *class, gpointer value)
 void
 mono_value_copy (gpointer dest, gpointer src, MonoClass *klass)
 {
+	/* Without references there is nothing for the GC to track */
+	if (!klass->has_references) {
+		mono_gc_memmove_atomic (dest, src, mono_class_value_size (klass, NULL));
+		return;
+	}
 	mono_gc_wbarrier_value_copy (dest, src, 1, klass);
 }
 
@@ -5168,6 +5173,10 @@ mono_value_copy_array (MonoArray *dest, int dest_idx, gpointer src, int count)
 	int size = mono_array_element_size (dest->obj.vtable->klass);
 	char *d = mono_array_addr_with_size_fast (dest, size, dest_idx);
 	g_assert (size == mono_class_value_size (mono_object_class (dest)->element_class, NULL));
+	if (!mono_object_class (dest)->element_class->has_references) {
+		mono_gc_memmove_atomic (d, src, size * count);
+		return;
+	}
 	mono_gc_wbarrier_value_copy (d, src, count, mono_object_class (dest)->element_class);
 }
 
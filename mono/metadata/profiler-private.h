@@ -29,6 +29,9 @@ void mono_profiler_method_enter    (MonoMethod *method) MONO_INTERNAL;
 void mono_profiler_method_leave    (MonoMethod *method) MONO_INTERNAL;
 void mono_profiler_method_jit      (MonoMethod *method) MONO_INTERNAL;
 void mono_profiler_method_end_jit  (MonoMethod *method, MonoJitInfo* jinfo, int result) MONO_INTERNAL;
+void mono_profiler_jit_phase       (MonoMethod *method, const char *phase, guint64 nsecs) MONO_INTERNAL;
+void mono_profiler_method_inline   (MonoMethod *parent, MonoMethod *child, int result) MONO_INTERNAL;
+gboolean mono_profiler_has_jit_phase_callback (void) MONO_INTERNAL;
 void mono_profiler_method_free     (MonoMethod *method) MONO_INTERNAL;
 void mono_profiler_method_start_invoke (MonoMethod *method) MONO_INTERNAL;
 void mono_profiler_method_end_invoke   (MonoMethod *method) MONO_INTERNAL;
@@ -61,6 +61,8 @@ struct _ProfilerDesc {
 	MonoProfileMethodFunc   jit_start;
 	MonoProfileMethodResult jit_end;
 	MonoProfileJitResult    jit_end2;
+	MonoProfileJitPhaseFunc jit_phase;
+	MonoProfileInlineResult method_inline;
 	MonoProfileMethodFunc   method_free;
 	MonoProfileMethodFunc   method_start_invoke;
 	MonoProfileMethodFunc   method_end_invoke;
@@ -215,6 +217,38 @@ mono_profiler_install_jit_end (MonoProfileJitResult end)
 	prof_list->jit_end2 = end;
 }
 
+/**
+ * mono_profiler_install_jit_phase:
+ * @callback: the routine to be called for each phase of a JIT compilation
+ *
+ * The callback receives the time spent in each phase of the compilation of a
+ * method (IR construction, the optimization passes, register allocation, code
+ * emission etc.) once the compilation finishes. It requires the
+ * MONO_PROFILE_JIT_COMPILATION flag.
+ */
+void 
+mono_profiler_install_jit_phase (MonoProfileJitPhaseFunc callback)
+{
+	if (!prof_list)
+		return;
+	prof_list->jit_phase = callback;
+}
+
+/**
+ * mono_profiler_install_inline:
+ * @callback: the routine to be called when the JIT tries to inline a method
+ *
+ * @result is MONO_PROFILE_OK if the callee was inlined and MONO_PROFILE_FAILED
+ * if the inlining was aborted. It requires the MONO_PROFILE_INLINING flag.
+ */
+void 
+mono_profiler_install_inline (MonoProfileInlineResult callback)
+{
+	if (!prof_list)
+		return;
+	prof_list->method_inline = callback;
+}
+
 void 
 mono_profiler_install_method_free (MonoProfileMethodFunc callback)
 {
@@ -424,6 +458,37 @@ mono_profiler_method_end_jit (MonoMethod *method, MonoJitInfo* jinfo, int result
 	}
 }
 
+gboolean
+mono_profiler_has_jit_phase_callback (void)
+{
+	ProfilerDesc *prof;
+	for (prof = prof_list; prof; prof = prof->next) {
+		if ((prof->events & MONO_PROFILE_JIT_COMPILATION) && prof->jit_phase)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+void 
+mono_profiler_jit_phase (MonoMethod *method, const char *phase, guint64 nsecs)
+{
+	ProfilerDesc *prof;
+	for (prof = prof_list; prof; prof = prof->next) {
+		if ((prof->events & MONO_PROFILE_JIT_COMPILATION) && prof->jit_phase)
+			prof->jit_phase (prof->profiler, method, phase, nsecs);
+	}
+}
+
+void 
+mono_profiler_method_inline (MonoMethod *parent, MonoMethod *child, int result)
+{
+	ProfilerDesc *prof;
+	for (prof = prof_list; prof; prof = prof->next) {
+		if ((prof->events & MONO_PROFILE_INLINING) && prof->method_inline)
+			prof->method_inline (prof->profiler, parent, child, result);
+	}
+}
+
 void 
 mono_profiler_method_free (MonoMethod *method)
 {
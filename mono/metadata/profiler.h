@@ -126,6 +126,8 @@ typedef void (*MonoProfileModuleResult)   (MonoProfiler *prof, MonoImage    *mod
 typedef void (*MonoProfileAssemblyResult) (MonoProfiler *prof, MonoAssembly *assembly, int result);
 
 typedef void (*MonoProfileMethodInline)   (MonoProfiler *prof, MonoMethod   *parent, MonoMethod *child, int *ok);
+typedef void (*MonoProfileInlineResult)   (MonoProfiler *prof, MonoMethod   *parent, MonoMethod *child, int result);
+typedef void (*MonoProfileJitPhaseFunc)   (MonoProfiler *prof, MonoMethod   *method, const char *phase, uint64_t nsecs);
 
 typedef void (*MonoProfileThreadFunc)     (MonoProfiler *prof, uintptr_t tid);
 typedef void (*MonoProfileThreadNameFunc) (MonoProfiler *prof, uintptr_t tid, const char *name);
@@ -167,6 +169,8 @@ MONO_API void mono_profiler_install_class       (MonoProfileClassFunc start_load
 
 MONO_API void mono_profiler_install_jit_compile (MonoProfileMethodFunc start, MonoProfileMethodResult end);
 MONO_API void mono_profiler_install_jit_end (MonoProfileJitResult end);
+MONO_API void mono_profiler_install_jit_phase (MonoProfileJitPhaseFunc callback);
+MONO_API void mono_profiler_install_inline (MonoProfileInlineResult callback);
 MONO_API void mono_profiler_install_method_free (MonoProfileMethodFunc callback);
 MONO_API void mono_profiler_install_method_invoke (MonoProfileMethodFunc start, MonoProfileMethodFunc end);
 MONO_API void mono_profiler_install_enter_leave (MonoProfileMethodFunc enter, MonoProfileMethodFunc fleave);
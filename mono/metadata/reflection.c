@@ -6420,6 +6420,23 @@ mono_type_normalize (MonoType *type)
 
 	return type;
 }
+/*
+ * create_type_hash:
+ *
+ *   Create DOMAIN->type_hash. Lookups in it are done without holding the domain
+ * lock, so it has to be fully initialized before it is published.
+ * LOCKING: Assumes the domain lock is held.
+ */
+static void
+create_type_hash (MonoDomain *domain)
+{
+	MonoConcurrentHashTable *type_hash = mono_conc_g_hash_table_new_type ((GHashFunc)mono_metadata_type_hash,
+			(GCompareFunc)mono_metadata_type_equal, MONO_HASH_VALUE_GC);
+
+	mono_memory_barrier ();
+	domain->type_hash = type_hash;
+}
+
 /*
  * mono_type_get_object:
  * @domain: an app domain
@@ -6458,12 +6475,15 @@ mono_type_get_object (MonoDomain *domain, MonoType *type)
 			return vtable->type;
 	}
 
+	/* Lookups in the type hash don't need any locks */
+	if (domain->type_hash && (res = mono_conc_hashtable_lookup (domain->type_hash, type)))
+		return res;
+
 	mono_loader_lock (); /*FIXME mono_class_init and mono_class_vtable acquire it*/
 	mono_domain_lock (domain);
 	if (!domain->type_hash)
-		domain->type_hash = mono_g_hash_table_new_type ((GHashFunc)mono_metadata_type_hash, 
-				(GCompareFunc)mono_metadata_type_equal, MONO_HASH_VALUE_GC);
-	if ((res = mono_g_hash_table_lookup (domain->type_hash, type))) {
+		create_type_hash (domain);
+	if ((res = mono_conc_hashtable_lookup (domain->type_hash, type))) {
 		mono_domain_unlock (domain);
 		mono_loader_unlock ();
 		return res;
@@ -6479,7 +6499,7 @@ mono_type_get_object (MonoDomain *domain, MonoType *type)
 	norm_type = mono_type_normalize (type);
 	if (norm_type != type) {
 		res = mono_type_get_object (domain, norm_type);
-		mono_g_hash_table_insert (domain->type_hash, type, res);
+		mono_conc_hashtable_insert (domain->type_hash, type, res);
 		mono_domain_unlock (domain);
 		mono_loader_unlock ();
 		return res;
@@ -6526,7 +6546,7 @@ mono_type_get_object (MonoDomain *domain, MonoType *type)
 	/* This is stored in vtables/JITted code so it has to be pinned */
 	res = (MonoReflectionType *)mono_object_new_pinned (domain, mono_defaults.monotype_class);
 	res->type = type;
-	mono_g_hash_table_insert (domain->type_hash, type, res);
+	mono_conc_hashtable_insert (domain->type_hash, type, res);
 
 	if (type->type == MONO_TYPE_VOID)
 		domain->typeof_void = (MonoObject*)res;
@@ -9207,9 +9227,10 @@ mono_reflection_register_with_runtime (MonoReflectionType *type)
 		mono_class_setup_supertypes (class);
 	} else {
 		if (!domain->type_hash)
-			domain->type_hash = mono_g_hash_table_new_type ((GHashFunc)mono_metadata_type_hash, 
-					(GCompareFunc)mono_metadata_type_equal, MONO_HASH_VALUE_GC);
-		mono_g_hash_table_insert (domain->type_hash, res, type);
+			create_type_hash (domain);
+		/* Entries can't be replaced in place */
+		mono_conc_hashtable_remove (domain->type_hash, res);
+		mono_conc_hashtable_insert (domain->type_hash, res, type);
 	}
 	mono_domain_unlock (domain);
 	mono_loader_unlock ();
@@ -11212,19 +11233,19 @@ typebuilder_setup_events (MonoClass *klass, MonoError *error)
 	}
 }
 
-static gboolean
-remove_instantiations_of_and_ensure_contents (gpointer key,
-						  gpointer value,
-						  gpointer user_data)
+typedef struct {
+	MonoClass *klass;
+	GSList *instantiations;
+} CollectInstantiationsData;
+
+static void
+collect_instantiations_of (gpointer key, gpointer value, gpointer user_data)
 {
 	MonoType *type = (MonoType*)key;
-	MonoClass *klass = (MonoClass*)user_data;
+	CollectInstantiationsData *data = (CollectInstantiationsData*)user_data;
 
-	if ((type->type == MONO_TYPE_GENERICINST) && (type->data.generic_class->container_class == klass)) {
-		fix_partial_generic_class (mono_class_from_mono_type (type)); //Ensure it's safe to use it.
-		return TRUE;
-	} else
-		return FALSE;
+	if ((type->type == MONO_TYPE_GENERICINST) && (type->data.generic_class->container_class == data->klass))
+		data->instantiations = g_slist_prepend (data->instantiations, type);
 }
 
 static void
@@ -11392,8 +11413,22 @@ mono_reflection_create_runtime_class (MonoReflectionTypeBuilder *tb)
 	 *
 	 * Together with this we must ensure the contents of all instances to match the created type.
 	 */
-	if (domain->type_hash && klass->generic_container)
-		mono_g_hash_table_foreach_remove (domain->type_hash, remove_instantiations_of_and_ensure_contents, klass);
+	if (domain->type_hash && klass->generic_container) {
+		CollectInstantiationsData data;
+		GSList *l;
+
+		/* Collect them first, fixing them up can recurse into mono_type_get_object () */
+		data.klass = klass;
+		data.instantiations = NULL;
+		mono_conc_hashtable_foreach (domain->type_hash, collect_instantiations_of, &data);
+		for (l = data.instantiations; l; l = l->next) {
+			MonoType *type = l->data;
+
+			fix_partial_generic_class (mono_class_from_mono_type (type)); //Ensure it's safe to use it.
+			mono_conc_hashtable_remove (domain->type_hash, type);
+		}
+		g_slist_free (data.instantiations);
+	}
 
 	mono_domain_unlock (domain);
 	mono_loader_unlock ();
@@ -30,6 +30,7 @@
 #include <mono/utils/mono-time.h>
 #include <mono/utils/mono-proclib.h>
 #include <mono/utils/mono-semaphore.h>
+#include <mono/utils/mono-timer-wheel.h>
 #include <mono/utils/atomic.h>
 #include <errno.h>
 #ifdef HAVE_SYS_TIME_H
@@ -1683,6 +1684,121 @@ ves_icall_System_Threading_ThreadPool_SetMaxThreads (gint workerThreads, gint co
 	return TRUE;
 }
 
+/*
+ * System.Threading.Timer keeps its timers in the runtime timer wheel. The
+ * wheel callbacks run on a native thread, so they only record the id of the
+ * expired timer in the queue of its appdomain and set the event the managed
+ * scheduler thread waits on. That thread collects the ids with
+ * GetExpiredTimers () and dispatches the callbacks to the threadpool.
+ *
+ * A ManagedTimer is freed either by CancelTimer () if it didn't expire yet,
+ * or once it expired, by whoever sees it last between the wheel callback
+ * and GetExpiredTimers ().
+ */
+typedef struct {
+	mono_mutex_t lock;
+	HANDLE event;
+	GPtrArray *expired;
+} TimerQueue;
+
+typedef struct {
+	MonoWheelTimer timer;
+	TimerQueue *queue;
+	gint64 id;
+	gboolean cancelled;
+} ManagedTimer;
+
+static void
+managed_timer_expired (MonoWheelTimer *timer)
+{
+	ManagedTimer *mt = timer->user_data;
+	TimerQueue *queue = mt->queue;
+
+	mono_mutex_lock (&queue->lock);
+	if (mt->cancelled) {
+		mono_mutex_unlock (&queue->lock);
+		g_free (mt);
+		return;
+	}
+	g_ptr_array_add (queue->expired, mt);
+	mono_mutex_unlock (&queue->lock);
+
+	SetEvent (queue->event);
+}
+
+gpointer
+ves_icall_System_Threading_Timer_CreateTimerQueue (HANDLE wait_handle)
+{
+	TimerQueue *queue = g_new0 (TimerQueue, 1);
+
+	/*
+	 * Timers can still expire after the domain is unloaded, so the queue and
+	 * its own reference to the event are never freed.
+	 */
+	if (!DuplicateHandle (GetCurrentProcess (), wait_handle, GetCurrentProcess (), &queue->event, THREAD_ALL_ACCESS, FALSE, 0))
+		g_error ("Could not duplicate the timer queue event");
+	mono_mutex_init (&queue->lock);
+	queue->expired = g_ptr_array_new ();
+
+	return queue;
+}
+
+gpointer
+ves_icall_System_Threading_Timer_AddTimer (gpointer queue, gint64 due_time_ms, gint64 id)
+{
+	ManagedTimer *mt = g_new0 (ManagedTimer, 1);
+
+	mono_wheel_timer_init (&mt->timer, managed_timer_expired, mt);
+	mt->queue = queue;
+	mt->id = id;
+	mono_timer_wheel_add (&mt->timer, (guint32)due_time_ms);
+
+	return mt;
+}
+
+void
+ves_icall_System_Threading_Timer_CancelTimer (gpointer timer)
+{
+	ManagedTimer *mt = timer;
+	TimerQueue *queue = mt->queue;
+	gboolean removed;
+
+	mono_mutex_lock (&queue->lock);
+	removed = mono_timer_wheel_cancel (&mt->timer);
+	if (!removed)
+		mt->cancelled = TRUE;
+	mono_mutex_unlock (&queue->lock);
+
+	if (removed)
+		g_free (mt);
+}
+
+gint32
+ves_icall_System_Threading_Timer_GetExpiredTimers (gpointer queue_ptr, MonoArray *ids)
+{
+	TimerQueue *queue = queue_ptr;
+	int i, count = 0, kept = 0;
+	int max = mono_array_length (ids);
+
+	mono_mutex_lock (&queue->lock);
+	for (i = 0; i < queue->expired->len; ++i) {
+		ManagedTimer *mt = g_ptr_array_index (queue->expired, i);
+
+		if (mt->cancelled) {
+			g_free (mt);
+		} else if (count < max) {
+			mono_array_set (ids, gint64, count++, mt->id);
+			g_free (mt);
+		} else {
+			g_ptr_array_index (queue->expired, kept++) = mt;
+		}
+	}
+	g_ptr_array_set_size (queue->expired, kept);
+	mono_mutex_unlock (&queue->lock);
+
+	return count;
+}
+
 /**
  * mono_install_threadpool_thread_hooks
  * @start_func: the function to be called right after a new threadpool thread is created. Can be NULL.
@@ -46,6 +46,18 @@ MonoBoolean
 ves_icall_System_Threading_ThreadPool_SetMaxThreads (gint workerThreads, 
 								gint completionPortThreads) MONO_INTERNAL;
 
+gpointer
+ves_icall_System_Threading_Timer_CreateTimerQueue (HANDLE wait_handle) MONO_INTERNAL;
+
+gpointer
+ves_icall_System_Threading_Timer_AddTimer (gpointer queue, gint64 due_time_ms, gint64 id) MONO_INTERNAL;
+
+void
+ves_icall_System_Threading_Timer_CancelTimer (gpointer timer) MONO_INTERNAL;
+
+gint32
+ves_icall_System_Threading_Timer_GetExpiredTimers (gpointer queue, MonoArray *ids) MONO_INTERNAL;
+
 typedef void  (*MonoThreadPoolFunc) (gpointer user_data);
 MONO_API void mono_install_threadpool_thread_hooks (MonoThreadPoolFunc start_func, MonoThreadPoolFunc finish_func, gpointer user_data);
 
@@ -409,6 +409,9 @@ static void thread_cleanup (MonoInternalThread *thread)
 	if (InterlockedExchange (&thread->interruption_requested, 0))
 		InterlockedDecrement (&thread_interruption_requested);
 
+	if (thread == mono_thread_internal_current ())
+		mono_monitor_cleanup_tls ();
+
 	/* if the thread is not in the hash it has been removed already */
 	if (!handle_remove (thread)) {
 		if (thread == mono_thread_internal_current ()) {
@@ -265,16 +265,16 @@ typedef struct MonoRelationsEvaluationContext {
  */
 #define MONO_ADD_DELTA_SAFELY(v,d) do{\
 		if (((d) > 0) && ((v) != INT_MIN)) {\
-			(v) = (((v)+(d))>(v))?((v)+(d)):INT_MAX;\
+			(v) = ((v) <= INT_MAX - (d))?((v)+(d)):INT_MAX;\
 		} else if (((d) < 0) && ((v) != INT_MAX)) {\
-			(v) = (((v)+(d))<(v))?((v)+(d)):INT_MIN;\
+			(v) = ((v) >= INT_MIN - (d))?((v)+(d)):INT_MIN;\
 		}\
 	} while (0)
 #define MONO_SUB_DELTA_SAFELY(v,d) do{\
 		if (((d) < 0) && ((v) != INT_MIN)) {\
-			(v) = (((v)-(d))>(v))?((v)-(d)):INT_MAX;\
+			(v) = ((v) <= INT_MAX + (d))?((v)-(d)):INT_MAX;\
 		} else if (((d) > 0) && ((v) != INT_MAX)) {\
-			(v) = (((v)-(d))<(v))?((v)-(d)):INT_MIN;\
+			(v) = ((v) >= INT_MIN + (d))?((v)-(d)):INT_MIN;\
 		}\
 	} while (0)
 #define MONO_ADD_DELTA_SAFELY_TO_RANGE(r,d) do{\
@@ -288,19 +288,619 @@ recompute_aliased_variables (MonoCompile *cfg)
 	return FALSE;
 }
 
+/*
+Scalar replacement of valuetypes.
+
+Small valuetypes whose fields are all primitive are split into one variable per field
+when every use of the valuetype is one of:
+	vzero/vmove/loadv_membase/storev_membase/outarg_vt of the whole value
+	ldaddr followed by loads and stores which exactly match one of its fields
+The field variables can then be allocated to registers and seen by SSA like any other local.
+Copies to and from memory become field by field loads and stores, values passed to calls
+are materialized into a temporary.
+Valuetype arguments are promoted the same way, their fields are loaded from the incoming
+argument at the start of the method. Vararg methods are skipped.
+*/
+
+#define MAX_PROMOTED_FIELDS 4
+
+typedef struct {
+	int offset;
+	MonoType *type;
+	int load_op, store_op;
+} PromotedField;
+
+typedef struct {
+	MonoClass *klass;
+	int nfields;
+	PromotedField fields [MAX_PROMOTED_FIELDS];
+} PromotedLayout;
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	GHashTable *layouts;
+	/* Indexed by vreg */
+	PromotedLayout **layout;
+	guint8 *rejected;
+	int **field_regs;
+	/* Maps the dreg of an ldaddr to the vreg of the valuetype */
+	int *addr_owner;
+	gboolean promote_args;
+} PromoteCtx;
+
+static PromotedLayout*
+compute_promoted_layout (MonoCompile *cfg, MonoClass *klass)
+{
+	PromotedLayout *layout;
+	MonoClassField *field;
+	gpointer iter = NULL;
+
+	if (!klass->valuetype || klass->enumtype || klass->simd_type || klass->has_references || klass->generic_container)
+		return NULL;
+	/* Fields might overlap */
+	if ((klass->flags & TYPE_ATTRIBUTE_LAYOUT_MASK) == TYPE_ATTRIBUTE_EXPLICIT_LAYOUT)
+		return NULL;
+	if (mini_is_gsharedvt_klass (cfg, klass))
+		return NULL;
+
+	layout = mono_mempool_alloc0 (cfg->mempool, sizeof (PromotedLayout));
+	layout->klass = klass;
+
+	while ((field = mono_class_get_fields (klass, &iter))) {
+		MonoType *t;
+		PromotedField *f;
+
+		if (field->type->attrs & FIELD_ATTRIBUTE_STATIC)
+			continue;
+		if (mono_field_is_deleted (field) || layout->nfields == MAX_PROMOTED_FIELDS)
+			return NULL;
+
+		t = mono_type_get_underlying_type (field->type);
+		if (t->byref)
+			return NULL;
+		switch (t->type) {
+		case MONO_TYPE_BOOLEAN:
+		case MONO_TYPE_CHAR:
+		case MONO_TYPE_I1:
+		case MONO_TYPE_U1:
+		case MONO_TYPE_I2:
+		case MONO_TYPE_U2:
+		case MONO_TYPE_I4:
+		case MONO_TYPE_U4:
+		case MONO_TYPE_I:
+		case MONO_TYPE_U:
+		case MONO_TYPE_PTR:
+			break;
+#if SIZEOF_REGISTER == 8
+		/* Longs are already decomposed at this point on 32 bit targets */
+		case MONO_TYPE_I8:
+		case MONO_TYPE_U8:
+			break;
+#endif
+		case MONO_TYPE_R8:
+			/* R4 is not handled since the value would lose the rounding done by the store */
+			if (mono_arch_is_soft_float ())
+				return NULL;
+			break;
+		default:
+			return NULL;
+		}
+
+		f = &layout->fields [layout->nfields ++];
+		f->offset = field->offset - sizeof (MonoObject);
+		f->type = t;
+		f->load_op = mono_type_to_load_membase (cfg, t);
+		f->store_op = mono_type_to_store_membase (cfg, t);
+	}
+
+	if (!layout->nfields)
+		return NULL;
+	return layout;
+}
+
+static void
+reject_vtype_vreg (PromoteCtx *ctx, int vreg)
+{
+	if (vreg < ctx->num_vregs && !ctx->rejected [vreg]) {
+		if (ctx->cfg->verbose_level > 2 && ctx->layout [vreg])
+			printf ("Not promoting R%d\n", vreg);
+		ctx->rejected [vreg] = TRUE;
+	}
+}
+
+static void
+note_vtype_vreg (PromoteCtx *ctx, int vreg, MonoClass *klass)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoInst *var;
+	PromotedLayout *layout;
+
+	if (vreg < 0 || vreg >= ctx->num_vregs || ctx->rejected [vreg])
+		return;
+
+	var = get_vreg_to_inst (cfg, vreg);
+	if (!klass || (var && ((var->opcode != OP_LOCAL && !(var->opcode == OP_ARG && ctx->promote_args)) || var == cfg->ret || (var->flags & MONO_INST_VOLATILE) || var->backend.is_pinvoke || var->klass != klass))) {
+		reject_vtype_vreg (ctx, vreg);
+		return;
+	}
+
+	if (ctx->layout [vreg]) {
+		if (ctx->layout [vreg]->klass != klass)
+			reject_vtype_vreg (ctx, vreg);
+		return;
+	}
+
+	if (!g_hash_table_lookup_extended (ctx->layouts, klass, NULL, (gpointer*)&layout)) {
+		layout = compute_promoted_layout (cfg, klass);
+		g_hash_table_insert (ctx->layouts, klass, layout);
+	}
+	if (layout)
+		ctx->layout [vreg] = layout;
+	else
+		reject_vtype_vreg (ctx, vreg);
+}
+
+static inline gboolean
+is_promoted (PromoteCtx *ctx, int vreg)
+{
+	return vreg >= 0 && vreg < ctx->num_vregs && ctx->field_regs [vreg];
+}
+
+static inline int
+get_addr_owner (PromoteCtx *ctx, int vreg)
+{
+	return (vreg >= 0 && vreg < ctx->num_vregs) ? ctx->addr_owner [vreg] : 0;
+}
+
+static int
+find_promoted_field (PromotedLayout *layout, int offset)
+{
+	int i;
+
+	for (i = 0; i < layout->nfields; ++i)
+		if (layout->fields [i].offset == offset)
+			return i;
+	return -1;
+}
+
+static gboolean
+is_load_membase (int opcode)
+{
+	switch (opcode) {
+	case OP_LOAD_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADI8_MEMBASE:
+	case OP_LOADR8_MEMBASE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * Return the field of the valuetype accessed by INS through the address in ADDR_REG,
+ * or NULL if INS does something else with the address.
+ */
+static PromotedField*
+get_accessed_field (PromoteCtx *ctx, MonoInst *ins, int addr_reg)
+{
+	PromotedLayout *layout = ctx->layout [ctx->addr_owner [addr_reg]];
+	PromotedField *f;
+	int idx;
+
+	if (!layout)
+		return NULL;
+	idx = find_promoted_field (layout, ins->inst_offset);
+	if (idx == -1)
+		return NULL;
+	f = &layout->fields [idx];
+
+	if (is_load_membase (ins->opcode))
+		return (ins->sreg1 == addr_reg && ins->dreg != addr_reg && ins->opcode == f->load_op) ? f : NULL;
+	if (MONO_IS_STORE_MEMBASE (ins) && ins->dreg == addr_reg && ins->sreg1 != addr_reg) {
+		if (ins->opcode == f->store_op || ins->opcode == mono_op_to_op_imm (f->store_op))
+			return f;
+	}
+	return NULL;
+}
+
+/*
+ * Find the valuetype vregs which can be promoted, and the ldaddr opcodes taking their address.
+ */
+static void
+collect_promotion_candidates (PromoteCtx *ctx)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int sregs [MONO_MAX_SRC_REGS];
+	int i, num_sregs, owner;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			switch (ins->opcode) {
+			case OP_LDADDR: {
+				MonoInst *var = ins->inst_p0;
+
+				if (var->type != STACK_VTYPE)
+					break;
+				note_vtype_vreg (ctx, var->dreg, var->klass);
+				if (ins->dreg >= ctx->num_vregs || ctx->addr_owner [ins->dreg] || get_vreg_to_inst (cfg, ins->dreg))
+					reject_vtype_vreg (ctx, var->dreg);
+				else
+					ctx->addr_owner [ins->dreg] = var->dreg;
+				break;
+			}
+			case OP_VZERO:
+			case OP_LOADV_MEMBASE:
+				note_vtype_vreg (ctx, ins->dreg, ins->klass);
+				break;
+			case OP_VMOVE:
+				note_vtype_vreg (ctx, ins->dreg, ins->klass);
+				note_vtype_vreg (ctx, ins->sreg1, ins->klass);
+				break;
+			case OP_STOREV_MEMBASE:
+			case OP_OUTARG_VT:
+				note_vtype_vreg (ctx, ins->sreg1, ins->klass);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	/* Reject the vregs used by anything else */
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			switch (ins->opcode) {
+			case OP_LOADV_MEMBASE:
+				/* Whole-value accesses through the address */
+				if ((owner = get_addr_owner (ctx, ins->sreg1)))
+					reject_vtype_vreg (ctx, owner);
+				continue;
+			case OP_STOREV_MEMBASE:
+				if ((owner = get_addr_owner (ctx, ins->dreg)))
+					reject_vtype_vreg (ctx, owner);
+				continue;
+			case OP_VZERO:
+			case OP_VMOVE:
+			case OP_OUTARG_VT:
+				continue;
+			case OP_LDADDR:
+				if (get_addr_owner (ctx, ins->dreg))
+					continue;
+				break;
+			default:
+				break;
+			}
+
+			if (MONO_IS_CALL (ins)) {
+				MonoCallInst *call = (MonoCallInst*)ins;
+				GSList *l;
+
+				/* Arguments passed in registers are implicit uses */
+				for (l = call->out_ireg_args; l; l = l->next) {
+					int reg = (guint32)(gssize)(l->data) & 0xffffff;
+
+					if ((owner = get_addr_owner (ctx, reg)))
+						reject_vtype_vreg (ctx, owner);
+				}
+			}
+
+			if (spec [MONO_INST_DEST] != ' ' && ins->dreg >= 0 && ins->dreg < ctx->num_vregs) {
+				reject_vtype_vreg (ctx, ins->dreg);
+				if ((owner = get_addr_owner (ctx, ins->dreg)) && !(MONO_IS_STORE_MEMBASE (ins) && get_accessed_field (ctx, ins, ins->dreg)))
+					reject_vtype_vreg (ctx, owner);
+			}
+			num_sregs = mono_inst_get_src_registers (ins, sregs);
+			for (i = 0; i < num_sregs; ++i) {
+				if (sregs [i] < 0 || sregs [i] >= ctx->num_vregs)
+					continue;
+				reject_vtype_vreg (ctx, sregs [i]);
+				if ((owner = get_addr_owner (ctx, sregs [i])) && !get_accessed_field (ctx, ins, sregs [i]))
+					reject_vtype_vreg (ctx, owner);
+			}
+		}
+	}
+}
+
+static void
+emit_field_loads (MonoCompile *cfg, PromotedLayout *layout, int *field_regs, int basereg, int offset)
+{
+	int i;
+
+	for (i = 0; i < layout->nfields; ++i)
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, layout->fields [i].load_op, field_regs [i], basereg, offset + layout->fields [i].offset);
+}
+
+static void
+emit_field_stores (MonoCompile *cfg, PromotedLayout *layout, int *field_regs, int basereg, int offset)
+{
+	int i;
+
+	for (i = 0; i < layout->nfields; ++i)
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, layout->fields [i].store_op, basereg, offset + layout->fields [i].offset, field_regs [i]);
+}
+
+/* Move the code emitted into CODE_BB in front of INS */
+static void
+insert_code_before (MonoBasicBlock *bb, MonoInst *ins, MonoBasicBlock *code_bb)
+{
+	MonoInst *tmp, *next;
+
+	for (tmp = code_bb->code; tmp; tmp = next) {
+		next = tmp->next;
+		mono_bblock_insert_before_ins (bb, ins, tmp);
+	}
+	code_bb->code = code_bb->last_ins = NULL;
+}
+
+/* Turn a store to field F through the address of a promoted valuetype into a def of FIELD_REG */
+static void
+lower_field_store (MonoCompile *cfg, MonoInst *store, PromotedField *f, int field_reg)
+{
+	gboolean is_imm = store->opcode != f->store_op;
+	int op;
+
+	if (is_imm) {
+		if (f->store_op == OP_STOREI8_MEMBASE_REG || (SIZEOF_REGISTER == 8 && f->store_op == OP_STORE_MEMBASE_REG)) {
+			store->opcode = OP_I8CONST;
+			store->type = STACK_I8;
+			store->inst_l = store->inst_imm;
+		} else {
+			gint32 val = store->inst_imm;
+
+			switch (f->type->type) {
+			case MONO_TYPE_I1:
+				val = (gint8)val;
+				break;
+			case MONO_TYPE_U1:
+			case MONO_TYPE_BOOLEAN:
+				val = (guint8)val;
+				break;
+			case MONO_TYPE_I2:
+				val = (gint16)val;
+				break;
+			case MONO_TYPE_U2:
+			case MONO_TYPE_CHAR:
+				val = (guint16)val;
+				break;
+			default:
+				break;
+			}
+			store->opcode = OP_ICONST;
+			store->type = STACK_I4;
+			store->inst_c0 = val;
+		}
+		store->dreg = field_reg;
+		mono_jit_stats.stores_eliminated++;
+		return;
+	}
+
+	/* The store used to truncate small values */
+	switch (f->type->type) {
+	case MONO_TYPE_I1:
+		op = OP_ICONV_TO_I1;
+		break;
+	case MONO_TYPE_U1:
+	case MONO_TYPE_BOOLEAN:
+		op = OP_ICONV_TO_U1;
+		break;
+	case MONO_TYPE_I2:
+		op = OP_ICONV_TO_I2;
+		break;
+	case MONO_TYPE_U2:
+	case MONO_TYPE_CHAR:
+		op = OP_ICONV_TO_U2;
+		break;
+	default:
+		op = mono_type_to_regmove (cfg, f->type);
+		break;
+	}
+	store->opcode = op;
+	type_to_eval_stack_type (cfg, f->type, store);
+	store->dreg = field_reg;
+	mono_jit_stats.stores_eliminated++;
+}
+
+static void
+rewrite_promoted_vtypes (PromoteCtx *ctx)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *bb, *code_bb;
+	MonoInst *ins, *addr;
+	PromotedLayout *layout;
+	int i, owner;
+
+	code_bb = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock));
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		cfg->cbb = code_bb;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			switch (ins->opcode) {
+			case OP_LDADDR:
+				if (is_promoted (ctx, ((MonoInst*)ins->inst_p0)->dreg))
+					NULLIFY_INS (ins);
+				break;
+			case OP_VZERO:
+				if (!is_promoted (ctx, ins->dreg))
+					break;
+				layout = ctx->layout [ins->dreg];
+				for (i = 0; i < layout->nfields; ++i)
+					mini_emit_init_rvar (cfg, ctx->field_regs [ins->dreg][i], layout->fields [i].type);
+				insert_code_before (bb, ins, code_bb);
+				NULLIFY_INS (ins);
+				break;
+			case OP_VMOVE: {
+				gboolean dest_promoted = is_promoted (ctx, ins->dreg);
+				gboolean src_promoted = is_promoted (ctx, ins->sreg1);
+
+				if (!dest_promoted && !src_promoted)
+					break;
+				if (ins->dreg == ins->sreg1) {
+					NULLIFY_INS (ins);
+					break;
+				}
+				if (dest_promoted && src_promoted) {
+					layout = ctx->layout [ins->dreg];
+					for (i = 0; i < layout->nfields; ++i)
+						MONO_EMIT_NEW_UNALU (cfg, mono_type_to_regmove (cfg, layout->fields [i].type), ctx->field_regs [ins->dreg][i], ctx->field_regs [ins->sreg1][i]);
+				} else if (dest_promoted) {
+					layout = ctx->layout [ins->dreg];
+					EMIT_NEW_VARLOADA_VREG (cfg, addr, ins->sreg1, &ins->klass->byval_arg);
+					emit_field_loads (cfg, layout, ctx->field_regs [ins->dreg], addr->dreg, 0);
+				} else {
+					layout = ctx->layout [ins->sreg1];
+					EMIT_NEW_VARLOADA_VREG (cfg, addr, ins->dreg, &ins->klass->byval_arg);
+					emit_field_stores (cfg, layout, ctx->field_regs [ins->sreg1], addr->dreg, 0);
+				}
+				insert_code_before (bb, ins, code_bb);
+				NULLIFY_INS (ins);
+				break;
+			}
+			case OP_LOADV_MEMBASE:
+				if (!is_promoted (ctx, ins->dreg))
+					break;
+				emit_field_loads (cfg, ctx->layout [ins->dreg], ctx->field_regs [ins->dreg], ins->inst_basereg, ins->inst_offset);
+				insert_code_before (bb, ins, code_bb);
+				NULLIFY_INS (ins);
+				break;
+			case OP_STOREV_MEMBASE:
+				if (!is_promoted (ctx, ins->sreg1))
+					break;
+				emit_field_stores (cfg, ctx->layout [ins->sreg1], ctx->field_regs [ins->sreg1], ins->inst_destbasereg, ins->inst_offset);
+				insert_code_before (bb, ins, code_bb);
+				NULLIFY_INS (ins);
+				break;
+			case OP_OUTARG_VT: {
+				MonoInst *tmp;
+
+				if (!is_promoted (ctx, ins->sreg1))
+					break;
+				/* The call needs the value in memory */
+				tmp = mono_compile_create_var (cfg, &ins->klass->byval_arg, OP_LOCAL);
+				EMIT_NEW_VARLOADA (cfg, addr, tmp, tmp->inst_vtype);
+				emit_field_stores (cfg, ctx->layout [ins->sreg1], ctx->field_regs [ins->sreg1], addr->dreg, 0);
+				insert_code_before (bb, ins, code_bb);
+				ins->sreg1 = tmp->dreg;
+				break;
+			}
+			default:
+				if (is_load_membase (ins->opcode) && (owner = get_addr_owner (ctx, ins->sreg1)) && is_promoted (ctx, owner)) {
+					PromotedField *f = get_accessed_field (ctx, ins, ins->sreg1);
+
+					g_assert (f);
+					ins->opcode = mono_type_to_regmove (cfg, f->type);
+					type_to_eval_stack_type (cfg, f->type, ins);
+					ins->sreg1 = ctx->field_regs [owner][f - ctx->layout [owner]->fields];
+					mono_jit_stats.loads_eliminated++;
+				} else if (MONO_IS_STORE_MEMBASE (ins) && (owner = get_addr_owner (ctx, ins->dreg)) && is_promoted (ctx, owner)) {
+					PromotedField *f = get_accessed_field (ctx, ins, ins->dreg);
+
+					g_assert (f);
+					lower_field_store (cfg, ins, f, ctx->field_regs [owner][f - ctx->layout [owner]->fields]);
+				}
+				break;
+			}
+		}
+	}
+
+	/* Load the fields of the promoted arguments at the start of the method */
+	cfg->cbb = code_bb;
+	for (i = 0; i < cfg->num_varinfo; ++i) {
+		MonoInst *var = cfg->varinfo [i];
+
+		if (var->opcode != OP_ARG || !is_promoted (ctx, var->dreg))
+			continue;
+		EMIT_NEW_VARLOADA (cfg, addr, var, var->inst_vtype);
+		emit_field_loads (cfg, ctx->layout [var->dreg], ctx->field_regs [var->dreg], addr->dreg, 0);
+	}
+	if (code_bb->code) {
+		if (cfg->bb_entry->code) {
+			insert_code_before (cfg->bb_entry, cfg->bb_entry->code, code_bb);
+		} else {
+			cfg->bb_entry->code = code_bb->code;
+			cfg->bb_entry->last_ins = code_bb->last_ins;
+		}
+	}
+}
+
+/*
+ * promote_vtype_vars:
+ *
+ *   Split the valuetype variables which are only accessed as a whole or through their
+ * fields into one variable per field. Returns whenever anything was promoted.
+ */
+static gboolean
+promote_vtype_vars (MonoCompile *cfg)
+{
+	PromoteCtx ctx;
+	int vreg, i, npromoted = 0;
+
+	/* The debugger needs the locals to stay on the stack, LLVM handles vtypes itself */
+	if (cfg->disable_vreg_to_lvreg || COMPILE_LLVM (cfg) || cfg->gsharedvt || cfg->method->wrapper_type != MONO_WRAPPER_NONE)
+		return FALSE;
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.cfg = cfg;
+	ctx.num_vregs = cfg->next_vreg;
+	ctx.layouts = g_hash_table_new (NULL, NULL);
+	ctx.layout = g_new0 (PromotedLayout*, ctx.num_vregs);
+	ctx.rejected = g_new0 (guint8, ctx.num_vregs);
+	ctx.field_regs = g_new0 (int*, ctx.num_vregs);
+	ctx.addr_owner = g_new0 (int, ctx.num_vregs);
+	ctx.promote_args = mono_method_signature (cfg->method)->call_convention != MONO_CALL_VARARG;
+
+	collect_promotion_candidates (&ctx);
+
+	for (vreg = 0; vreg < ctx.num_vregs; ++vreg) {
+		PromotedLayout *layout = ctx.layout [vreg];
+
+		if (!layout || ctx.rejected [vreg])
+			continue;
+
+		ctx.field_regs [vreg] = mono_mempool_alloc (cfg->mempool, sizeof (int) * layout->nfields);
+		for (i = 0; i < layout->nfields; ++i)
+			ctx.field_regs [vreg][i] = mono_compile_create_var (cfg, layout->fields [i].type, OP_LOCAL)->dreg;
+		if (cfg->verbose_level > 2)
+			printf ("Promoting R%d (%s) into %d fields\n", vreg, layout->klass->name, layout->nfields);
+		npromoted ++;
+	}
+
+	if (npromoted) {
+		rewrite_promoted_vtypes (&ctx);
+		mono_jit_stats.vtypes_promoted += npromoted;
+	}
+
+	g_hash_table_destroy (ctx.layouts);
+	g_free (ctx.layout);
+	g_free (ctx.rejected);
+	g_free (ctx.field_regs);
+	g_free (ctx.addr_owner);
+
+	return npromoted > 0;
+}
+
 /*
 FIXME:
 	Don't DCE on the whole CFG, only the BBs that have changed.
 
 TODO:
-	SRVT of small types can fix cases of mismatch for fields of a different type than the component.
 	Handle aliasing of byrefs in call conventions.
 */
 void
 mono_local_alias_analysis (MonoCompile *cfg)
 {
-	if (!cfg->has_indirection)
-		return;
+	gboolean lowered = FALSE, promoted;
 
 	if (cfg->verbose_level > 2)
 		mono_print_code (cfg, "BEFORE ALIAS_ANALYSIS");
@@ -308,7 +908,15 @@ mono_local_alias_analysis (MonoCompile *cfg)
 	/*
 	Remove indirection and memory access of known variables.
 	*/
-	if (!lower_memory_access (cfg))
+	if (cfg->has_indirection)
+		lowered = lower_memory_access (cfg);
+
+	/*
+	Split small valuetypes into their fields, this removes most of the remaining LDADDR ops.
+	*/
+	promoted = promote_vtype_vars (cfg);
+
+	if (!lowered && !promoted)
 		goto done;
 
 	/*
@@ -319,8 +927,9 @@ mono_local_alias_analysis (MonoCompile *cfg)
 
 	/*
 	Some variables no longer need to be flagged as indirect, find them.
+	The promoted valuetypes also need new local vregs.
 	*/
-	if (!recompute_aliased_variables (cfg))
+	if (!recompute_aliased_variables (cfg) && !promoted)
 		goto done;
 
 	/*
@@ -3385,11 +3385,6 @@ add_wrappers (MonoAotCompile *acfg)
 			g_free (wrappers);
 		}
 
-		/* castclass_with_check wrapper */
-		add_method (acfg, mono_marshal_get_castclass_with_cache ());
-		/* isinst_with_check wrapper */
-		add_method (acfg, mono_marshal_get_isinst_with_cache ());
-
 #if defined(MONO_ARCH_ENABLE_MONITOR_IL_FASTPATH)
 		{
 			MonoMethodDesc *desc;
@@ -806,6 +806,160 @@ class Tests
 			arr [i] = 1;
 		return llvm_ldlen_licm (arr);
 	}
+
+	static int[] licm_arr;
+
+	static int licm_field_written_in_loop () {
+		int sum = 0;
+		// The loads of licm_arr can't be moved out of the loop, since it writes it
+		for (int i = 0; i < licm_arr.Length; ++i) {
+			sum += licm_arr [i];
+			if (i == 1)
+				licm_arr = new int [] { 1, 2, 3, 4, 5 };
+		}
+		return sum;
+	}
+
+	public static int test_14_licm_field_written_in_loop () {
+		licm_arr = new int [] { 1, 1, 1 };
+		return licm_field_written_in_loop ();
+	}
+
+	static int abcrem_shifted_index (int[] arr, int n) {
+		int sum = 0;
+		for (int i = 0; i < arr.Length - n; ++i)
+			sum += arr [i + n];
+		return sum;
+	}
+
+	public static int test_0_abcrem_shifted_index () {
+		int[] arr = new int [] { 1, 2, 3, 4 };
+		if (abcrem_shifted_index (arr, 1) != 9)
+			return 1;
+		try {
+			abcrem_shifted_index (arr, -1);
+			return 2;
+		} catch (IndexOutOfRangeException) {
+		}
+		return 0;
+	}
+
+	static int gvn_repeated_elem (int[] arr, int i) {
+		arr [i] += 1;
+		arr [i] += 2;
+		return arr [i];
+	}
+
+	public static int test_0_gvn_repeated_bounds_check () {
+		int[] arr = new int [4];
+		if (gvn_repeated_elem (arr, 3) != 3)
+			return 1;
+		try {
+			gvn_repeated_elem (arr, 4);
+			return 2;
+		} catch (IndexOutOfRangeException) {
+		}
+		return arr [3] == 3 ? 0 : 3;
+	}
+
+	static int vectorize_sum (int[] arr, int start) {
+		int sum = 0;
+		for (int i = start; i < arr.Length; ++i)
+			sum += arr [i];
+		return sum;
+	}
+
+	public static int test_0_vectorize_sum () {
+		for (int len = 0; len < 70; ++len) {
+			int[] arr = new int [len];
+			int expected = 0;
+			for (int i = 0; i < len; ++i) {
+				arr [i] = i * 0x1234567;
+				expected += arr [i];
+			}
+			if (vectorize_sum (arr, 0) != expected)
+				return len + 1;
+			if (len > 3 && vectorize_sum (arr, 3) != expected - arr [0] - arr [1] - arr [2])
+				return len + 100;
+		}
+		try {
+			vectorize_sum (null, 0);
+			return 200;
+		} catch (NullReferenceException) {
+		}
+		try {
+			vectorize_sum (new int [40], -1);
+			return 201;
+		} catch (IndexOutOfRangeException) {
+		}
+		return 0;
+	}
+
+	static void vectorize_add (float[] a, float[] b, float[] c) {
+		for (int i = 0; i < c.Length; ++i)
+			c [i] = a [i] + b [i];
+	}
+
+	public static int test_0_vectorize_float_add () {
+		float[] a = new float [37], b = new float [37], c = new float [37];
+		for (int i = 0; i < a.Length; ++i) {
+			a [i] = i / 3.0f;
+			b [i] = 1.0f / (i + 1);
+		}
+		vectorize_add (a, b, c);
+		for (int i = 0; i < c.Length; ++i) {
+			if (c [i] != (float)(a [i] + b [i]))
+				return i + 1;
+		}
+		return 0;
+	}
+
+	static void vectorize_byte_ops (byte[] a, byte[] b, byte v) {
+		for (int i = 0; i < a.Length; ++i)
+			a [i] = (byte)(a [i] + b [i] + v);
+	}
+
+	public static int test_0_vectorize_byte_wraparound () {
+		byte[] a = new byte [100], b = new byte [100];
+		for (int i = 0; i < a.Length; ++i) {
+			a [i] = (byte)(i * 7);
+			b [i] = (byte)(255 - i);
+		}
+		vectorize_byte_ops (a, b, 200);
+		for (int i = 0; i < a.Length; ++i) {
+			if (a [i] != (byte)(i * 7 + 255 - i + 200))
+				return i + 1;
+		}
+		return 0;
+	}
+
+	static void vectorize_copy (int[] src, int[] dst, int n) {
+		for (int i = 0; i < n; ++i)
+			dst [i] = src [i] + 1;
+	}
+
+	public static int test_0_vectorize_exceptions () {
+		int[] src = new int [100], dst = new int [50];
+		// The elements before the faulting index need to be stored
+		try {
+			vectorize_copy (src, dst, 80);
+			return 1;
+		} catch (IndexOutOfRangeException) {
+		}
+		for (int i = 0; i < dst.Length; ++i) {
+			if (dst [i] != 1)
+				return 2;
+		}
+		try {
+			vectorize_copy (src, null, 80);
+			return 3;
+		} catch (NullReferenceException) {
+		}
+		vectorize_copy (src, dst, -10);
+		// Overlapping arrays
+		vectorize_copy (dst, dst, dst.Length);
+		return dst [49] == 2 ? 0 : 4;
+	}
 }
 
 
@@ -317,5 +317,18 @@ class Tests
 			return 2;
 		return 0;
 	}
+
+	static int call_twice (int d) {
+		if (d == 0)
+			return 1;
+		/* Both calls compute d - 1 into their argument vreg */
+		int a = call_twice (d - 1);
+		int b = call_twice (d - 1);
+		return a + b;
+	}
+
+	public static int test_1024_gvn_call_args () {
+		return call_twice (10);
+	}
 }
 
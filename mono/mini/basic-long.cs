@@ -1,5 +1,6 @@
 using System;
 using System.Reflection;
+using System.Runtime.CompilerServices;
 
 /*
  * Regression tests for the mono JIT.
@@ -879,6 +880,173 @@ class Tests
 		}
 	}
 
+	/* See test_0_div_by_const () in basic.cs */
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long long_div (long a, long b) {
+		return a / b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long long_rem (long a, long b) {
+		return a % b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static ulong ulong_div (ulong a, ulong b) {
+		return a / b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static ulong ulong_rem (ulong a, ulong b) {
+		return a % b;
+	}
+
+	static int check_long_div_by_const (long x) {
+		if (x / 1 != long_div (x, 1) || x % 1 != long_rem (x, 1))
+			return 1;
+		if (x / 2 != long_div (x, 2) || x % 2 != long_rem (x, 2))
+			return 2;
+		if (x / 3 != long_div (x, 3) || x % 3 != long_rem (x, 3))
+			return 3;
+		if (x / 5 != long_div (x, 5) || x % 5 != long_rem (x, 5))
+			return 4;
+		if (x / 7 != long_div (x, 7) || x % 7 != long_rem (x, 7))
+			return 5;
+		if (x / 10 != long_div (x, 10) || x % 10 != long_rem (x, 10))
+			return 6;
+		if (x / 13 != long_div (x, 13) || x % 13 != long_rem (x, 13))
+			return 7;
+		if (x / 100 != long_div (x, 100) || x % 100 != long_rem (x, 100))
+			return 8;
+		if (x / 641 != long_div (x, 641) || x % 641 != long_rem (x, 641))
+			return 9;
+		if (x / 1000 != long_div (x, 1000) || x % 1000 != long_rem (x, 1000))
+			return 10;
+		if (x / 1000000007 != long_div (x, 1000000007) || x % 1000000007 != long_rem (x, 1000000007))
+			return 11;
+		if (x / 0x100000000 != long_div (x, 0x100000000) || x % 0x100000000 != long_rem (x, 0x100000000))
+			return 12;
+		if (x / 0x100000001 != long_div (x, 0x100000001) || x % 0x100000001 != long_rem (x, 0x100000001))
+			return 13;
+		if (x / (6700417L * 641) != long_div (x, (6700417L * 641)) || x % (6700417L * 641) != long_rem (x, (6700417L * 641)))
+			return 14;
+		if (x / 0x7fffffffffffffff != long_div (x, 0x7fffffffffffffff) || x % 0x7fffffffffffffff != long_rem (x, 0x7fffffffffffffff))
+			return 15;
+		if (x / long.MinValue != long_div (x, long.MinValue) || x % long.MinValue != long_rem (x, long.MinValue))
+			return 16;
+		if (x / (-2) != long_div (x, (-2)) || x % (-2) != long_rem (x, (-2)))
+			return 17;
+		if (x / (-3) != long_div (x, (-3)) || x % (-3) != long_rem (x, (-3)))
+			return 18;
+		if (x / (-7) != long_div (x, (-7)) || x % (-7) != long_rem (x, (-7)))
+			return 19;
+		if (x / (-10) != long_div (x, (-10)) || x % (-10) != long_rem (x, (-10)))
+			return 20;
+		if (x / (-1000000007) != long_div (x, (-1000000007)) || x % (-1000000007) != long_rem (x, (-1000000007)))
+			return 21;
+		if (x / (-0x100000001) != long_div (x, (-0x100000001)) || x % (-0x100000001) != long_rem (x, (-0x100000001)))
+			return 22;
+		if (x / (-0x7fffffffffffffff) != long_div (x, (-0x7fffffffffffffff)) || x % (-0x7fffffffffffffff) != long_rem (x, (-0x7fffffffffffffff)))
+			return 23;
+		return 0;
+	}
+
+	static int check_ulong_div_by_const (ulong x) {
+		if (x / (ulong)1 != ulong_div (x, (ulong)1) || x % (ulong)1 != ulong_rem (x, (ulong)1))
+			return 1;
+		if (x / (ulong)2 != ulong_div (x, (ulong)2) || x % (ulong)2 != ulong_rem (x, (ulong)2))
+			return 2;
+		if (x / (ulong)3 != ulong_div (x, (ulong)3) || x % (ulong)3 != ulong_rem (x, (ulong)3))
+			return 3;
+		if (x / (ulong)5 != ulong_div (x, (ulong)5) || x % (ulong)5 != ulong_rem (x, (ulong)5))
+			return 4;
+		if (x / (ulong)7 != ulong_div (x, (ulong)7) || x % (ulong)7 != ulong_rem (x, (ulong)7))
+			return 5;
+		if (x / (ulong)10 != ulong_div (x, (ulong)10) || x % (ulong)10 != ulong_rem (x, (ulong)10))
+			return 6;
+		if (x / (ulong)13 != ulong_div (x, (ulong)13) || x % (ulong)13 != ulong_rem (x, (ulong)13))
+			return 7;
+		if (x / (ulong)100 != ulong_div (x, (ulong)100) || x % (ulong)100 != ulong_rem (x, (ulong)100))
+			return 8;
+		if (x / (ulong)641 != ulong_div (x, (ulong)641) || x % (ulong)641 != ulong_rem (x, (ulong)641))
+			return 9;
+		if (x / (ulong)1000 != ulong_div (x, (ulong)1000) || x % (ulong)1000 != ulong_rem (x, (ulong)1000))
+			return 10;
+		if (x / (ulong)1000000007 != ulong_div (x, (ulong)1000000007) || x % (ulong)1000000007 != ulong_rem (x, (ulong)1000000007))
+			return 11;
+		if (x / 0x100000000 != ulong_div (x, 0x100000000) || x % 0x100000000 != ulong_rem (x, 0x100000000))
+			return 12;
+		if (x / 0x100000001 != ulong_div (x, 0x100000001) || x % 0x100000001 != ulong_rem (x, 0x100000001))
+			return 13;
+		if (x / 0x7fffffffffffffff != ulong_div (x, 0x7fffffffffffffff) || x % 0x7fffffffffffffff != ulong_rem (x, 0x7fffffffffffffff))
+			return 14;
+		if (x / 0x8000000000000000 != ulong_div (x, 0x8000000000000000) || x % 0x8000000000000000 != ulong_rem (x, 0x8000000000000000))
+			return 15;
+		if (x / 0x8000000000000001 != ulong_div (x, 0x8000000000000001) || x % 0x8000000000000001 != ulong_rem (x, 0x8000000000000001))
+			return 16;
+		if (x / 0xfffffffffffffffe != ulong_div (x, 0xfffffffffffffffe) || x % 0xfffffffffffffffe != ulong_rem (x, 0xfffffffffffffffe))
+			return 17;
+		if (x / 0xffffffffffffffff != ulong_div (x, 0xffffffffffffffff) || x % 0xffffffffffffffff != ulong_rem (x, 0xffffffffffffffff))
+			return 18;
+		return 0;
+	}
+
+	static long[] long_dividends = new long [] { 0, 1, -1, 2, -2, 3, -3, 7, -7, 100, -100, 641, 1000000007, -1000000007, int.MaxValue, int.MinValue, 0xffffffffL, 0x100000000L, -0x100000000L, 1234567890123456789, -1234567890123456789, 0x7ffffffffffffffe, long.MaxValue, -long.MaxValue, long.MinValue };
+
+	static ulong[] ulong_dividends = new ulong [] { 0, 1, 2, 3, 7, 100, 641, 1000000007, 0xffffffff, 0x100000000, 1234567890123456789, 0x7fffffffffffffff, 0x8000000000000000, 0x8000000000000001, 0xaaaaaaaaaaaaaaab, 0xfffffffffffffffe, 0xffffffffffffffff };
+
+	public static int test_0_ldiv_by_const () {
+		int res;
+
+		foreach (long x in long_dividends) {
+			res = check_long_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		for (long x = -2000; x <= 2000; ++x) {
+			res = check_long_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		ulong seed = 1;
+		for (int i = 0; i < 2000; ++i) {
+			seed = seed * 6364136223846793005 + 1442695040888963407;
+			res = check_long_div_by_const ((long)seed);
+			if (res != 0)
+				return res;
+			res = check_long_div_by_const ((long)seed >> (i % 63));
+			if (res != 0)
+				return res;
+		}
+		return 0;
+	}
+
+	public static int test_0_ldiv_un_by_const () {
+		int res;
+
+		foreach (ulong x in ulong_dividends) {
+			res = check_ulong_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		for (ulong x = 0; x <= 4000; ++x) {
+			res = check_ulong_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		ulong seed = 1;
+		for (int i = 0; i < 2000; ++i) {
+			seed = seed * 6364136223846793005 + 1442695040888963407;
+			res = check_ulong_div_by_const (seed);
+			if (res != 0)
+				return res;
+			res = check_ulong_div_by_const (seed >> (i % 64));
+			if (res != 0)
+				return res;
+		}
+		return 0;
+	}
+
 	public static int test_0_ceq () {
 		long a = 2;
 		long b = 2;
@@ -1,5 +1,6 @@
 using System;
 using System.Reflection;
+using System.Runtime.CompilerServices;
 
 /*
  * Regression tests for the mono JIT.
@@ -913,6 +914,160 @@ class Tests
 		return 3;
 	}
 
+	static int chain_dense (int x) {
+		if (x == 1)
+			return 10;
+		else if (x == 2)
+			return 20;
+		else if (x == 3)
+			return 30;
+		else if (x == 5)
+			return 50;
+		else if (x == 4)
+			return 40;
+		else if (x == 8)
+			return 80;
+		return 0;
+	}
+
+	public static int test_0_compare_chain_dense () {
+		if (chain_dense (1) != 10 || chain_dense (2) != 20 || chain_dense (3) != 30)
+			return 1;
+		if (chain_dense (4) != 40 || chain_dense (5) != 50 || chain_dense (8) != 80)
+			return 2;
+		if (chain_dense (0) != 0 || chain_dense (6) != 0 || chain_dense (7) != 0 || chain_dense (9) != 0)
+			return 3;
+		if (chain_dense (-1) != 0 || chain_dense (int.MinValue) != 0 || chain_dense (int.MaxValue) != 0)
+			return 4;
+		return 0;
+	}
+
+	static int chain_bits (int c) {
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			return 1;
+		if (c == ',' || c == ';')
+			return 2;
+		return 0;
+	}
+
+	public static int test_0_compare_chain_bit_test () {
+		if (chain_bits (' ') != 1 || chain_bits ('\t') != 1 || chain_bits ('\n') != 1 || chain_bits ('\r') != 1)
+			return 1;
+		if (chain_bits (',') != 2 || chain_bits (';') != 2)
+			return 2;
+		if (chain_bits ('a') != 0 || chain_bits (0) != 0 || chain_bits (11) != 0 || chain_bits (';' + 64) != 0 || chain_bits (' ' - 64) != 0)
+			return 3;
+		if (chain_bits (int.MinValue + 9) != 0 || chain_bits (int.MaxValue) != 0)
+			return 4;
+		return 0;
+	}
+
+	static int chain_sparse (int x) {
+		if (x == 1)
+			return 1;
+		if (x == 100)
+			return 2;
+		if (x == -5)
+			return 3;
+		if (x == 1000)
+			return 4;
+		if (x == 77777)
+			return 5;
+		if (x == int.MinValue)
+			return 6;
+		if (x == int.MaxValue)
+			return 7;
+		if (x == 42)
+			return 8;
+		if (x == -100000)
+			return 9;
+		return 0;
+	}
+
+	public static int test_0_compare_chain_tree () {
+		int[] values = new int [] { 1, 100, -5, 1000, 77777, int.MinValue, int.MaxValue, 42, -100000 };
+
+		for (int i = 0; i < values.Length; ++i) {
+			if (chain_sparse (values [i]) != i + 1)
+				return i + 1;
+			if (chain_sparse (values [i] + 1) != 0 && values [i] != int.MaxValue)
+				return 20 + i;
+			if (chain_sparse (values [i] - 1) != 0 && values [i] != int.MinValue)
+				return 40 + i;
+		}
+		if (chain_sparse (0) != 0 || chain_sparse (43) != 0)
+			return 60;
+		return 0;
+	}
+
+	static int chain_duplicates (int x) {
+		if (x == 5)
+			return 1;
+		if (x == 6)
+			return 0;
+		if (x == 7)
+			return 2;
+		if (x == 5)
+			return 3;
+		if (x == 9)
+			return 4;
+		if (x == 6)
+			return 5;
+		if (x == 12)
+			return 6;
+		if (x == 2000)
+			return 7;
+		return 0;
+	}
+
+	public static int test_0_compare_chain_duplicates () {
+		if (chain_duplicates (5) != 1 || chain_duplicates (6) != 0 || chain_duplicates (7) != 2)
+			return 1;
+		if (chain_duplicates (9) != 4 || chain_duplicates (12) != 6 || chain_duplicates (2000) != 7)
+			return 2;
+		if (chain_duplicates (8) != 0 || chain_duplicates (-6) != 0)
+			return 3;
+		return 0;
+	}
+
+	enum ChainColor {
+		Red = 1,
+		Green = 4,
+		Blue = 9,
+		Cyan = 16,
+		Black = 100,
+		White = 1000
+	}
+
+	static int chain_enum (ChainColor c) {
+		switch (c) {
+		case ChainColor.Red:
+			return 1;
+		case ChainColor.Green:
+			return 2;
+		case ChainColor.Blue:
+			return 3;
+		case ChainColor.Cyan:
+			return 4;
+		case ChainColor.Black:
+			return 5;
+		case ChainColor.White:
+			return 6;
+		default:
+			return 0;
+		}
+	}
+
+	public static int test_0_compare_chain_enum () {
+		if (chain_enum (ChainColor.Red) != 1 || chain_enum (ChainColor.Green) != 2 || chain_enum (ChainColor.Blue) != 3)
+			return 1;
+		if (chain_enum (ChainColor.Cyan) != 4 || chain_enum (ChainColor.Black) != 5 || chain_enum (ChainColor.White) != 6)
+			return 2;
+		if (chain_enum ((ChainColor)0) != 0 || chain_enum ((ChainColor)5) != 0 || chain_enum ((ChainColor)(-1)) != 0)
+			return 3;
+		return 0;
+	}
+
 	public static int test_0_while_loop_1 () {
 
 		int value = 255;
@@ -1308,6 +1463,207 @@ class Tests
 		return 0;
 	}
 
+	/*
+	 * Divisions and remainders by constants are strength reduced by the JIT, so
+	 * compare them with the same operations done by a non-constant divisor.
+	 */
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int int_div (int a, int b) {
+		return a / b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int int_rem (int a, int b) {
+		return a % b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static uint uint_div (uint a, uint b) {
+		return a / b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static uint uint_rem (uint a, uint b) {
+		return a % b;
+	}
+
+	static int check_int_div_by_const (int x) {
+		if (x / 1 != int_div (x, 1) || x % 1 != int_rem (x, 1))
+			return 1;
+		if (x / 2 != int_div (x, 2) || x % 2 != int_rem (x, 2))
+			return 2;
+		if (x / 3 != int_div (x, 3) || x % 3 != int_rem (x, 3))
+			return 3;
+		if (x / 5 != int_div (x, 5) || x % 5 != int_rem (x, 5))
+			return 4;
+		if (x / 6 != int_div (x, 6) || x % 6 != int_rem (x, 6))
+			return 5;
+		if (x / 7 != int_div (x, 7) || x % 7 != int_rem (x, 7))
+			return 6;
+		if (x / 9 != int_div (x, 9) || x % 9 != int_rem (x, 9))
+			return 7;
+		if (x / 10 != int_div (x, 10) || x % 10 != int_rem (x, 10))
+			return 8;
+		if (x / 11 != int_div (x, 11) || x % 11 != int_rem (x, 11))
+			return 9;
+		if (x / 12 != int_div (x, 12) || x % 12 != int_rem (x, 12))
+			return 10;
+		if (x / 13 != int_div (x, 13) || x % 13 != int_rem (x, 13))
+			return 11;
+		if (x / 25 != int_div (x, 25) || x % 25 != int_rem (x, 25))
+			return 12;
+		if (x / 60 != int_div (x, 60) || x % 60 != int_rem (x, 60))
+			return 13;
+		if (x / 100 != int_div (x, 100) || x % 100 != int_rem (x, 100))
+			return 14;
+		if (x / 125 != int_div (x, 125) || x % 125 != int_rem (x, 125))
+			return 15;
+		if (x / 641 != int_div (x, 641) || x % 641 != int_rem (x, 641))
+			return 16;
+		if (x / 1000 != int_div (x, 1000) || x % 1000 != int_rem (x, 1000))
+			return 17;
+		if (x / 3600 != int_div (x, 3600) || x % 3600 != int_rem (x, 3600))
+			return 18;
+		if (x / 6700417 != int_div (x, 6700417) || x % 6700417 != int_rem (x, 6700417))
+			return 19;
+		if (x / 1000000007 != int_div (x, 1000000007) || x % 1000000007 != int_rem (x, 1000000007))
+			return 20;
+		if (x / 0x40000000 != int_div (x, 0x40000000) || x % 0x40000000 != int_rem (x, 0x40000000))
+			return 21;
+		if (x / 0x7fffffff != int_div (x, 0x7fffffff) || x % 0x7fffffff != int_rem (x, 0x7fffffff))
+			return 22;
+		if (x / int.MinValue != int_div (x, int.MinValue) || x % int.MinValue != int_rem (x, int.MinValue))
+			return 23;
+		if (x / (-2) != int_div (x, (-2)) || x % (-2) != int_rem (x, (-2)))
+			return 24;
+		if (x / (-3) != int_div (x, (-3)) || x % (-3) != int_rem (x, (-3)))
+			return 25;
+		if (x / (-5) != int_div (x, (-5)) || x % (-5) != int_rem (x, (-5)))
+			return 26;
+		if (x / (-7) != int_div (x, (-7)) || x % (-7) != int_rem (x, (-7)))
+			return 27;
+		if (x / (-10) != int_div (x, (-10)) || x % (-10) != int_rem (x, (-10)))
+			return 28;
+		if (x / (-100) != int_div (x, (-100)) || x % (-100) != int_rem (x, (-100)))
+			return 29;
+		if (x / (-641) != int_div (x, (-641)) || x % (-641) != int_rem (x, (-641)))
+			return 30;
+		if (x / (-1000000007) != int_div (x, (-1000000007)) || x % (-1000000007) != int_rem (x, (-1000000007)))
+			return 31;
+		if (x / (-0x7fffffff) != int_div (x, (-0x7fffffff)) || x % (-0x7fffffff) != int_rem (x, (-0x7fffffff)))
+			return 32;
+		return 0;
+	}
+
+	static int check_uint_div_by_const (uint x) {
+		if (x / (uint)1 != uint_div (x, (uint)1) || x % (uint)1 != uint_rem (x, (uint)1))
+			return 1;
+		if (x / (uint)2 != uint_div (x, (uint)2) || x % (uint)2 != uint_rem (x, (uint)2))
+			return 2;
+		if (x / (uint)3 != uint_div (x, (uint)3) || x % (uint)3 != uint_rem (x, (uint)3))
+			return 3;
+		if (x / (uint)5 != uint_div (x, (uint)5) || x % (uint)5 != uint_rem (x, (uint)5))
+			return 4;
+		if (x / (uint)7 != uint_div (x, (uint)7) || x % (uint)7 != uint_rem (x, (uint)7))
+			return 5;
+		if (x / (uint)10 != uint_div (x, (uint)10) || x % (uint)10 != uint_rem (x, (uint)10))
+			return 6;
+		if (x / (uint)11 != uint_div (x, (uint)11) || x % (uint)11 != uint_rem (x, (uint)11))
+			return 7;
+		if (x / (uint)13 != uint_div (x, (uint)13) || x % (uint)13 != uint_rem (x, (uint)13))
+			return 8;
+		if (x / (uint)25 != uint_div (x, (uint)25) || x % (uint)25 != uint_rem (x, (uint)25))
+			return 9;
+		if (x / (uint)100 != uint_div (x, (uint)100) || x % (uint)100 != uint_rem (x, (uint)100))
+			return 10;
+		if (x / (uint)641 != uint_div (x, (uint)641) || x % (uint)641 != uint_rem (x, (uint)641))
+			return 11;
+		if (x / (uint)1000 != uint_div (x, (uint)1000) || x % (uint)1000 != uint_rem (x, (uint)1000))
+			return 12;
+		if (x / (uint)6700417 != uint_div (x, (uint)6700417) || x % (uint)6700417 != uint_rem (x, (uint)6700417))
+			return 13;
+		if (x / 0x7fffffff != uint_div (x, 0x7fffffff) || x % 0x7fffffff != uint_rem (x, 0x7fffffff))
+			return 14;
+		if (x / 0x80000000 != uint_div (x, 0x80000000) || x % 0x80000000 != uint_rem (x, 0x80000000))
+			return 15;
+		if (x / 0x80000001 != uint_div (x, 0x80000001) || x % 0x80000001 != uint_rem (x, 0x80000001))
+			return 16;
+		if (x / 0xaaaaaaab != uint_div (x, 0xaaaaaaab) || x % 0xaaaaaaab != uint_rem (x, 0xaaaaaaab))
+			return 17;
+		if (x / 0xfffffffe != uint_div (x, 0xfffffffe) || x % 0xfffffffe != uint_rem (x, 0xfffffffe))
+			return 18;
+		if (x / 0xffffffff != uint_div (x, 0xffffffff) || x % 0xffffffff != uint_rem (x, 0xffffffff))
+			return 19;
+		return 0;
+	}
+
+	static int[] int_dividends = new int [] { 0, 1, -1, 2, -2, 3, -3, 6, 7, -7, 100, -100, 641, 12345, -12345, 123456789, -987654321, 0x40000000, -0x40000000, 0x7ffffffe, 0x7fffffff, -0x7fffffff, int.MinValue };
+
+	static uint[] uint_dividends = new uint [] { 0, 1, 2, 3, 6, 7, 100, 641, 12345, 123456789, 0x7ffffffe, 0x7fffffff, 0x80000000, 0x80000001, 0xaaaaaaab, 4000000000, 0xfffffffe, 0xffffffff };
+
+	public static int test_0_div_by_const () {
+		int res;
+
+		foreach (int x in int_dividends) {
+			res = check_int_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		for (int x = -2000; x <= 2000; ++x) {
+			res = check_int_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		uint seed = 1;
+		for (int i = 0; i < 2000; ++i) {
+			seed = seed * 1103515245 + 12345;
+			res = check_int_div_by_const ((int)seed);
+			if (res != 0)
+				return res;
+			res = check_int_div_by_const ((int)seed >> (i % 31));
+			if (res != 0)
+				return res;
+		}
+		return 0;
+	}
+
+	public static int test_0_div_un_by_const () {
+		int res;
+
+		foreach (uint x in uint_dividends) {
+			res = check_uint_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		for (uint x = 0; x <= 4000; ++x) {
+			res = check_uint_div_by_const (x);
+			if (res != 0)
+				return res;
+		}
+		uint seed = 1;
+		for (int i = 0; i < 2000; ++i) {
+			seed = seed * 1103515245 + 12345;
+			res = check_uint_div_by_const (seed);
+			if (res != 0)
+				return res;
+			res = check_uint_div_by_const (seed >> (i % 32));
+			if (res != 0)
+				return res;
+		}
+		return 0;
+	}
+
+	public static int test_12_div_by_const_destreg () {
+		int x = int.MaxValue;
+		int n = 0;
+
+		while (x != 0) {
+			x = x / 7;
+			n ++;
+		}
+		return n;
+	}
+
 	public static int cmov (int i) {
 		int j = 0;
 
@@ -8,6 +8,7 @@
  * Copyright 2011 Xamarin Inc.  http://www.xamarin.com
  */
  #include "mini.h"
+#include "ir-emit.h"
 
 #ifndef DISABLE_JIT
  
@@ -1465,4 +1466,750 @@ mono_optimize_branches (MonoCompile *cfg)
 	} while (changed && (niterations > 0));
 }
 
+static gboolean
+ranges_overlap (guint32 start1, guint32 end1, guint32 start2, guint32 end2)
+{
+	return start1 < end2 && start2 < end1;
+}
+
+/*
+ * is_cold_handler_region:
+ *
+ *   Return whenever REGION is part of the handler of a catch or filter clause.
+ * These only run when an exception is thrown, unlike finally clauses.
+ */
+static gboolean
+is_cold_handler_region (int region)
+{
+	int type = region & (0xf << 4);
+
+	if (region == -1)
+		return FALSE;
+	if (type == MONO_REGION_FILTER)
+		return TRUE;
+	return type == MONO_REGION_CATCH && (MONO_REGION_FLAGS (region) == MONO_EXCEPTION_CLAUSE_NONE || MONO_REGION_FLAGS (region) == MONO_EXCEPTION_CLAUSE_FILTER);
+}
+
+/*
+ * can_move_handler:
+ *
+ *   Return whenever the handler of clause I can be moved away from its try
+ * block. This is only done if it's not nested inside another clause and contains
+ * no other clauses, so the code surrounding it is not protected by any other
+ * clause either.
+ */
+static gboolean
+can_move_handler (MonoCompile *cfg, int i)
+{
+	MonoMethodHeader *header = cfg->header;
+	MonoExceptionClause *ec = &header->clauses [i];
+	guint32 start, end;
+	int j;
+
+	start = ec->flags == MONO_EXCEPTION_CLAUSE_FILTER ? ec->data.filter_offset : ec->handler_offset;
+	end = ec->handler_offset + ec->handler_len;
+	for (j = 0; j < header->num_clauses; ++j) {
+		MonoExceptionClause *clause = &header->clauses [j];
+
+		if (j == i)
+			continue;
+		if (ranges_overlap (start, end, clause->try_offset, clause->try_offset + clause->try_len))
+			return FALSE;
+		if (ranges_overlap (start, end, clause->handler_offset, clause->handler_offset + clause->handler_len))
+			return FALSE;
+		if (clause->flags == MONO_EXCEPTION_CLAUSE_FILTER && ranges_overlap (start, end, clause->data.filter_offset, clause->handler_offset))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * mono_move_cold_bblocks:
+ *
+ *   Move the bblocks which are unlikely to be executed to the end of the method,
+ * so the frequently executed code is packed together, instead of being
+ * interleaved with the cold code. The cold bblocks are the out-of-line bblocks
+ * outside of clauses, i.e. the ones ending with a throw, and the handlers of
+ * catch and filter clauses. The exception throwing sequences of the OP_..._EXC
+ * opcodes are already emitted after the bblocks by mono_arch_emit_exceptions ().
+ * Since the try ranges of the clauses end at the native offset of the bblock
+ * following them in the IL, the bblock which ends a try block after that bblock
+ * is moved is recorded in cfg->cold_try_end_bbs.
+ * This has to be done after all the passes which can change the order of the
+ * bblocks.
+ */
+void
+mono_move_cold_bblocks (MonoCompile *cfg)
+{
+	MonoMethodHeader *header = cfg->header;
+	MonoBasicBlock *bb, *prev, *next, *last, *cold_first, *cold_last;
+	MonoBasicBlock **try_prev = NULL;
+	int *handler_bblocks = NULL;
+	int i;
+
+	if (cfg->disable_out_of_line_bblocks)
+		return;
+
+	if (header->num_clauses) {
+		/* Count the bblocks of each handler so it's possible to check they are consecutive */
+		handler_bblocks = mono_mempool_alloc0 (cfg->mempool, sizeof (int) * header->num_clauses);
+		try_prev = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * header->num_clauses);
+		for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+			if (is_cold_handler_region (bb->region))
+				handler_bblocks [MONO_REGION_CLAUSE_INDEX (bb->region)] ++;
+		}
+	}
+
+	cold_first = cold_last = NULL;
+	prev = cfg->bb_entry;
+	for (bb = prev->next_bb; bb; bb = next) {
+		next = bb->next_bb;
+		last = NULL;
+		if (bb->out_of_line && bb->region == -1 && bb != cfg->bb_exit) {
+			last = bb;
+		} else if (is_cold_handler_region (bb->region)) {
+			int clause = MONO_REGION_CLAUSE_INDEX (bb->region);
+			int n = 1;
+
+			if (can_move_handler (cfg, clause)) {
+				for (last = bb; last->next_bb && last->next_bb->region != -1 && MONO_REGION_CLAUSE_INDEX (last->next_bb->region) == clause && is_cold_handler_region (last->next_bb->region); last = last->next_bb)
+					n ++;
+				if (n != handler_bblocks [clause])
+					last = NULL;
+			}
+		}
+		if (!last || !last->next_bb) {
+			prev = bb;
+			continue;
+		}
+		next = last->next_bb;
+
+		if (cfg->verbose_level > 2)
+			printf ("Moving cold bblocks BB%d-BB%d to the end.\n", bb->block_num, last->block_num);
+
+		/* Replace the fall throughs by branches */
+		if ((!prev->last_ins || !MONO_IS_BRANCH_OP (prev->last_ins)) && mono_bblocks_linked (prev, bb)) {
+			MonoInst *ins;
+
+			MONO_INST_NEW (cfg, ins, OP_BR);
+			ins->inst_target_bb = bb;
+			MONO_ADD_INS (prev, ins);
+		}
+		if ((!last->last_ins || !MONO_IS_BRANCH_OP (last->last_ins)) && mono_bblocks_linked (last, next)) {
+			MonoInst *ins;
+
+			MONO_INST_NEW (cfg, ins, OP_BR);
+			ins->inst_target_bb = next;
+			MONO_ADD_INS (last, ins);
+		}
+
+		prev->next_bb = next;
+		last->next_bb = NULL;
+		if (cold_last)
+			cold_last->next_bb = bb;
+		else
+			cold_first = bb;
+		cold_last = last;
+
+		for (i = 0; i < header->num_clauses; ++i) {
+			MonoExceptionClause *ec = &header->clauses [i];
+
+			if (cfg->cil_offset_to_bb [ec->try_offset + ec->try_len] == bb)
+				try_prev [i] = prev;
+		}
+	}
+
+	if (!cold_first)
+		return;
+
+	for (bb = cfg->bb_entry; bb->next_bb; bb = bb->next_bb)
+		;
+	bb->next_bb = cold_first;
+	cfg->cold_bb = cold_first;
+
+	/* The try blocks now end where the bblock preceding the moved bblocks ends */
+	for (i = 0; i < header->num_clauses; ++i) {
+		if (try_prev [i]) {
+			if (!cfg->cold_try_end_bbs)
+				cfg->cold_try_end_bbs = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * header->num_clauses);
+			cfg->cold_try_end_bbs [i] = try_prev [i]->next_bb;
+		}
+	}
+}
+
+/*
+ * Compare chains
+ *
+ *   The C# compiler emits a switch on a sparse set of values, like an enum
+ * with holes, and if/else cascades testing one value as a chain of compares
+ * and conditional branches:
+ *
+ *     H:  compare v, c1; beq T1 ; else L2
+ *     L2: compare v, c2; beq T2 ; else L3
+ *     ...
+ *     Ln: compare v, cn; beq Tn ; else D
+ *
+ * The code below recognizes these chains and lowers them into a jump table if
+ * the constants are dense, into a few bit tests if they branch to at most
+ * MAX_BIT_TEST_TARGETS different targets, and into a balanced compare tree
+ * otherwise. If the method is instrumented for the inliner, the chain also
+ * counts how often each case is taken, and these counts are used to balance
+ * the tree by weight, and to test a dominant case first.
+ */
+
+/* The minimum number of compares in a chain */
+#define MIN_CHAIN_LENGTH 4
+#define MAX_CHAIN_LENGTH 256
+/* The jump table has at least this percentage of its entries used */
+#define MIN_JUMP_TABLE_DENSITY 40
+#define MAX_JUMP_TABLE_SIZE 1024
+#define MAX_BIT_TEST_TARGETS 3
+/* Trees with this many cases or less are emitted as linear compares */
+#define MAX_LINEAR_CASES 3
+
+/*
+ * The profile keys of the cases, which are counted like call sites, see
+ * inliner.c. The IL offset of a case is the offset of its compare, the
+ * default is keyed by the offset of the first compare of the chain.
+ */
+#define CHAIN_CASE_KEY(offset) ((offset) | 0x80000000)
+#define CHAIN_DEFAULT_KEY(offset) ((offset) | 0xc0000000)
+
+typedef struct {
+	gint32 value;
+	MonoBasicBlock *target;
+	/* The profile key, or -1 */
+	gint32 key;
+	gint32 weight;
+} ChainCase;
+
+/*
+ * find_def:
+ *
+ *   Return the last instruction before INS in its bblock which defines VREG,
+ * or NULL.
+ */
+static MonoInst*
+find_def (MonoInst *ins, int vreg)
+{
+	for (ins = ins->prev; ins; ins = ins->prev) {
+		if (ins->dreg == vreg)
+			return ins;
+	}
+	return NULL;
+}
+
+/*
+ * get_chain_test:
+ *
+ *   Return whenever BB ends with an equality test of an int32 variable against
+ * a constant. Set VAR, VALUE, TARGET to the block branched to if the test
+ * succeeds, NEXT to the block branched to otherwise, and COMPARE to the compare
+ * instruction.
+ */
+static gboolean
+get_chain_test (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst **var, gint32 *value, MonoBasicBlock **target, MonoBasicBlock **next, MonoInst **compare)
+{
+	MonoInst *branch, *cmp, *def, *ins;
+	int vreg;
+
+	branch = bb->last_ins;
+	if (!branch || (branch->opcode != OP_IBEQ && branch->opcode != OP_IBNE_UN))
+		return FALSE;
+	cmp = branch->prev;
+	if (!cmp)
+		return FALSE;
+
+	if (cmp->opcode == OP_ICOMPARE_IMM) {
+		*value = cmp->inst_imm;
+	} else if (cmp->opcode == OP_ICOMPARE) {
+		/* Tier 0 code doesn't run cprop */
+		def = find_def (cmp, cmp->sreg2);
+		if (!def || def->opcode != OP_ICONST)
+			return FALSE;
+		*value = def->inst_c0;
+	} else {
+		return FALSE;
+	}
+
+	vreg = cmp->sreg1;
+	*var = get_vreg_to_inst (cfg, vreg);
+	if (!*var) {
+		def = find_def (cmp, vreg);
+		if (!def || def->opcode != OP_MOVE)
+			return FALSE;
+		*var = get_vreg_to_inst (cfg, def->sreg1);
+		if (!*var)
+			return FALSE;
+		/* The variable must still have the value of the copy */
+		for (ins = def->next; ins != cmp; ins = ins->next) {
+			if (ins->dreg == def->sreg1)
+				return FALSE;
+		}
+	}
+	if (((*var)->opcode != OP_LOCAL && (*var)->opcode != OP_ARG) || (*var)->type != STACK_I4)
+		return FALSE;
+	if ((*var)->flags & (MONO_INST_VOLATILE | MONO_INST_INDIRECT))
+		return FALSE;
+
+	if (branch->opcode == OP_IBEQ) {
+		*target = branch->inst_true_bb;
+		*next = branch->inst_false_bb;
+	} else {
+		*target = branch->inst_false_bb;
+		*next = branch->inst_true_bb;
+	}
+	*compare = cmp;
+	return *target && *next;
+}
+
+/*
+ * is_chain_link:
+ *
+ *   Return whenever BB can be merged into the chain starting at HEAD: it has no
+ * other predecessor and it only computes the operands of its test.
+ */
+static gboolean
+is_chain_link (MonoCompile *cfg, MonoBasicBlock *bb, MonoBasicBlock *head)
+{
+	MonoMethodHeader *header = cfg->header;
+	MonoBasicBlock *prev;
+	MonoInst *ins;
+	int i;
+
+	if (bb == head || bb == cfg->bb_exit || bb->in_count != 1 || bb->region != head->region)
+		return FALSE;
+	if (bb->flags & BB_INDIRECT_JUMP_TARGET)
+		return FALSE;
+
+	for (ins = bb->code; ins && ins->next != bb->last_ins; ins = ins->next) {
+		switch (ins->opcode) {
+		case OP_NOP:
+			break;
+		case OP_MOVE:
+		case OP_ICONST:
+			if (get_vreg_to_inst (cfg, ins->dreg))
+				return FALSE;
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	/* Removing the bblock would change the length of the clauses, see remove_block_if_useless () */
+	for (prev = cfg->bb_entry; prev && prev->next_bb != bb; prev = prev->next_bb)
+		;
+	if (!prev || MONO_BBLOCK_IS_IN_REGION (prev, MONO_REGION_TRY))
+		return FALSE;
+	for (i = 0; i < header->num_clauses; ++i) {
+		MonoExceptionClause *ec = &header->clauses [i];
+
+		if (ec->try_offset + ec->try_len < cfg->cil_offset_to_bb_len && cfg->cil_offset_to_bb [ec->try_offset + ec->try_len] == bb)
+			return FALSE;
+		if (ec->handler_offset + ec->handler_len < cfg->cil_offset_to_bb_len && cfg->cil_offset_to_bb [ec->handler_offset + ec->handler_len] == bb)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+compare_chain_cases (const void *a, const void *b)
+{
+	const ChainCase *c1 = a;
+	const ChainCase *c2 = b;
+
+	if (c1->value == c2->value)
+		return 0;
+	return c1->value < c2->value ? -1 : 1;
+}
+
+static void
+emit_br (MonoCompile *cfg, MonoBasicBlock *target)
+{
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = target;
+	MONO_ADD_INS (cfg->cbb, ins);
+	mono_link_bblock (cfg, cfg->cbb, target);
+}
+
+/*
+ * emit_case_test:
+ *
+ *   Emit a branch to TARGET if SREG == VALUE, and continue in a new bblock.
+ */
+static void
+emit_case_test (MonoCompile *cfg, int sreg, gint32 value, MonoBasicBlock *target)
+{
+	MonoBasicBlock *next_bb;
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, sreg, value);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBEQ, target);
+	NEW_BBLOCK (cfg, next_bb);
+	MONO_START_BB (cfg, next_bb);
+}
+
+/*
+ * emit_compare_tree:
+ *
+ *   Emit a binary search for SREG among CASES [LO, HI), branching to DEFAULT_BB
+ * if it is not found. The pivots split the cases by weight if PROFILED.
+ */
+static void
+emit_compare_tree (MonoCompile *cfg, int sreg, ChainCase *cases, int lo, int hi, MonoBasicBlock *default_bb, gboolean profiled)
+{
+	MonoBasicBlock *left_bb, *right_bb;
+	int i, pivot;
+
+	if (hi - lo <= MAX_LINEAR_CASES) {
+		for (i = lo; i < hi; ++i)
+			emit_case_test (cfg, sreg, cases [i].value, cases [i].target);
+		emit_br (cfg, default_bb);
+		return;
+	}
+
+	pivot = (lo + hi) / 2;
+	if (profiled) {
+		gint64 total = 0, sum = 0;
+
+		for (i = lo; i < hi; ++i)
+			total += cases [i].weight;
+		for (i = lo; i < hi - 1; ++i) {
+			sum += cases [i].weight;
+			if (sum * 2 >= total)
+				break;
+		}
+		/* Keep both subtrees non empty */
+		pivot = MAX (lo + 1, MIN (i, hi - 2));
+	}
+
+	NEW_BBLOCK (cfg, left_bb);
+	NEW_BBLOCK (cfg, right_bb);
+	emit_case_test (cfg, sreg, cases [pivot].value, cases [pivot].target);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, sreg, cases [pivot].value);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBLT, left_bb);
+	MONO_START_BB (cfg, right_bb);
+	emit_compare_tree (cfg, sreg, cases, pivot + 1, hi, default_bb, profiled);
+	MONO_START_BB (cfg, left_bb);
+	emit_compare_tree (cfg, sreg, cases, lo, pivot, default_bb, profiled);
+}
+
+/*
+ * emit_bit_tests:
+ *
+ *   Emit a test of the bit OFFSET_REG in the mask of the values branching to
+ * each target. OFFSET_REG is at most the register size in bits.
+ */
+static void
+emit_bit_tests (MonoCompile *cfg, int offset_reg, ChainCase *cases, int ncases, gint32 min, MonoBasicBlock *default_bb)
+{
+	MonoBasicBlock *next_bb;
+	int i, j, one_reg, bit_reg;
+	gboolean *done;
+
+	one_reg = alloc_preg (cfg);
+	bit_reg = alloc_preg (cfg);
+#if SIZEOF_REGISTER == 8
+	MONO_EMIT_NEW_I8CONST (cfg, one_reg, 1);
+	MONO_EMIT_NEW_BIALU (cfg, OP_LSHL, bit_reg, one_reg, offset_reg);
+#else
+	MONO_EMIT_NEW_ICONST (cfg, one_reg, 1);
+	MONO_EMIT_NEW_BIALU (cfg, OP_ISHL, bit_reg, one_reg, offset_reg);
+#endif
+
+	done = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * ncases);
+	for (i = 0; i < ncases; ++i) {
+		guint64 mask = 0;
+		int mask_reg;
+
+		if (done [i])
+			continue;
+		for (j = i; j < ncases; ++j) {
+			if (cases [j].target == cases [i].target) {
+				mask |= (guint64)1 << (guint32)(cases [j].value - min);
+				done [j] = TRUE;
+			}
+		}
+
+		mask_reg = alloc_preg (cfg);
+#if SIZEOF_REGISTER == 8
+		{
+			int tmp_reg = alloc_preg (cfg);
+
+			MONO_EMIT_NEW_I8CONST (cfg, tmp_reg, mask);
+			MONO_EMIT_NEW_BIALU (cfg, OP_LAND, mask_reg, bit_reg, tmp_reg);
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_LCOMPARE_IMM, -1, mask_reg, 0);
+			MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_LBNE_UN, cases [i].target);
+		}
+#else
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IAND_IMM, mask_reg, bit_reg, (gint32)mask);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, mask_reg, 0);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBNE_UN, cases [i].target);
+#endif
+		NEW_BBLOCK (cfg, next_bb);
+		MONO_START_BB (cfg, next_bb);
+	}
+	emit_br (cfg, default_bb);
+}
+
+/*
+ * emit_case_counter:
+ *
+ *   Start BB, which counts the executions of the case with profile key KEY
+ * before branching to TARGET.
+ */
+static void
+emit_case_counter (MonoCompile *cfg, MonoBasicBlock *bb, guint32 key, MonoBasicBlock *target)
+{
+	gint32 *counter = mini_inliner_get_call_counter (cfg->method, key);
+	int addr_reg = alloc_preg (cfg);
+	int count_reg = alloc_ireg (cfg);
+	int inc_reg = alloc_ireg (cfg);
+
+	MONO_START_BB (cfg, bb);
+	/* This is racy, but the counts only need to be approximate */
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, counter);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, inc_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, inc_reg);
+	emit_br (cfg, target);
+}
+
+/*
+ * get_profile_key:
+ *
+ *   Return the IL offset of COMPARE if it comes from the IL of the method being
+ * compiled, and not from an inlined method, or -1.
+ */
+static gint32
+get_profile_key (MonoCompile *cfg, MonoInst *compare)
+{
+	if (!compare->cil_code || compare->cil_code < cfg->cil_start || compare->cil_code >= cfg->cil_start + cfg->header->code_size)
+		return -1;
+	return compare->cil_code - cfg->cil_start;
+}
+
+/*
+ * lower_compare_chain:
+ *
+ *   Replace the compare chain of VAR starting at HEAD, whose other bblocks are
+ * LINKS, with a dispatch to the NCASES CASES, which are sorted by value, or to
+ * DEFAULT_BB. DEFAULT_KEY is the profile key of the chain, or -1. Return the
+ * last bblock of the dispatch code.
+ */
+static MonoBasicBlock*
+lower_compare_chain (MonoCompile *cfg, MonoBasicBlock *head, GSList *links, MonoInst *var, ChainCase *cases, int ncases, MonoBasicBlock *default_bb, gint32 default_key)
+{
+	MonoBasicBlock *next, *bb, *last_bb;
+	MonoBasicBlock **counter_bbs = NULL, **real_targets = NULL;
+	MonoBasicBlock *real_default_bb = NULL;
+	MonoInst *ins, *next_ins;
+	GSList *l;
+	gint64 range, total_weight = 0;
+	gboolean profiled = FALSE;
+	int i, j, ntargets, hot = -1, offset_reg;
+
+	if (default_key != -1) {
+		if (mini_inliner_instrument (cfg)) {
+			/* Branch to bblocks counting the cases instead of the targets */
+			counter_bbs = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * (ncases + 1));
+			real_targets = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * ncases);
+			for (i = 0; i < ncases + 1; ++i)
+				NEW_BBLOCK (cfg, counter_bbs [i]);
+			for (i = 0; i < ncases; ++i) {
+				real_targets [i] = cases [i].target;
+				cases [i].target = counter_bbs [i];
+			}
+			real_default_bb = default_bb;
+			default_bb = counter_bbs [ncases];
+		} else if (mini_inliner_get_site_count (cfg->method, CHAIN_DEFAULT_KEY (default_key)) != -1) {
+			profiled = TRUE;
+			total_weight = mini_inliner_get_site_count (cfg->method, CHAIN_DEFAULT_KEY (default_key));
+			for (i = 0; i < ncases; ++i) {
+				/* Avoid zero weights, so the cold parts of the tree stay balanced */
+				cases [i].weight = MIN (mini_inliner_get_site_count (cfg->method, CHAIN_CASE_KEY (cases [i].key)), G_MAXINT32 - 1) + 1;
+				total_weight += cases [i].weight;
+			}
+			for (i = 0; i < ncases; ++i) {
+				if (cases [i].weight * 2 > total_weight)
+					hot = i;
+			}
+		}
+	}
+
+	/* Remove the chain, keeping the computation of the operands of the tests */
+	for (i = 0; i < 2; ++i) {
+		ins = head->last_ins;
+		MONO_DELETE_INS (head, ins);
+	}
+	while (head->out_count)
+		mono_unlink_bblock (cfg, head, head->out_bb [0]);
+	for (l = links; l; l = l->next) {
+		bb = l->data;
+
+		while (bb->out_count)
+			mono_unlink_bblock (cfg, bb, bb->out_bb [0]);
+		for (ins = bb->code; ins && ins->next != bb->last_ins; ins = next_ins) {
+			next_ins = ins->next;
+			ins->prev = ins->next = NULL;
+			MONO_ADD_INS (head, ins);
+		}
+		mono_remove_bblock (cfg, bb);
+		mono_nullify_basic_block (bb);
+	}
+
+	next = head->next_bb;
+	cfg->cbb = head;
+
+	if (hot != -1)
+		emit_case_test (cfg, var->dreg, cases [hot].value, cases [hot].target);
+
+	ntargets = 0;
+	for (i = 0; i < ncases; ++i) {
+		for (j = 0; j < i; ++j) {
+			if (cases [j].target == cases [i].target)
+				break;
+		}
+		if (j == i)
+			ntargets ++;
+	}
+
+	range = (gint64)cases [ncases - 1].value - (gint64)cases [0].value + 1;
+	offset_reg = alloc_ireg (cfg);
+	if (range <= SIZEOF_REGISTER * 8 && ntargets <= MAX_BIT_TEST_TARGETS) {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, offset_reg, var->dreg, cases [0].value);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, offset_reg, (gint32)range);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE_UN, default_bb);
+		NEW_BBLOCK (cfg, bb);
+		MONO_START_BB (cfg, bb);
+		emit_bit_tests (cfg, offset_reg, cases, ncases, cases [0].value, default_bb);
+		mono_jit_stats.chains_to_bit_tests ++;
+	} else if (range <= MAX_JUMP_TABLE_SIZE && range * MIN_JUMP_TABLE_DENSITY <= (gint64)ncases * 100) {
+		MonoBasicBlock **targets = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * range);
+
+		for (i = 0; i < range; ++i)
+			targets [i] = default_bb;
+		for (i = 0; i < ncases; ++i)
+			targets [cases [i].value - cases [0].value] = cases [i].target;
+
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, offset_reg, var->dreg, cases [0].value);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, offset_reg, (gint32)range);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE_UN, default_bb);
+		NEW_BBLOCK (cfg, bb);
+		MONO_START_BB (cfg, bb);
+		mini_emit_jump_table (cfg, offset_reg, targets, range);
+		mono_jit_stats.chains_to_jump_tables ++;
+	} else {
+		emit_compare_tree (cfg, var->dreg, cases, 0, ncases, default_bb, profiled);
+		mono_jit_stats.chains_to_trees ++;
+	}
+
+	if (counter_bbs) {
+		for (i = 0; i < ncases; ++i)
+			emit_case_counter (cfg, counter_bbs [i], CHAIN_CASE_KEY (cases [i].key), real_targets [i]);
+		emit_case_counter (cfg, counter_bbs [ncases], CHAIN_DEFAULT_KEY (default_key), real_default_bb);
+	}
+
+	last_bb = cfg->cbb;
+	for (bb = head->next_bb; bb != last_bb; bb = bb->next_bb)
+		bb->region = head->region;
+	last_bb->region = head->region;
+	last_bb->next_bb = next;
+	return last_bb;
+}
+
+/*
+ * mono_lower_compare_chains:
+ *
+ *   Lower the chains of equality tests of a variable against constants, see
+ * the comment at the top of this section.
+ */
+void
+mono_lower_compare_chains (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	ChainCase *cases;
+
+	cases = mono_mempool_alloc (cfg->mempool, sizeof (ChainCase) * MAX_CHAIN_LENGTH);
+
+	for (bb = cfg->bb_entry->next_bb; bb; bb = bb->next_bb) {
+		MonoBasicBlock *target, *next, *link, *pred_target, *pred_next;
+		MonoInst *var, *pred_var, *compare, *pred_compare;
+		GSList *links = NULL;
+		gint32 value, pred_value, key, default_key;
+		gboolean valid;
+		int i, j, ntests, ncases;
+
+		/* Same as in mono_optimize_branches () */
+		if (bb->region != -1 || bb == cfg->bb_exit)
+			continue;
+		if (!get_chain_test (cfg, bb, &var, &value, &target, &next, &compare))
+			continue;
+		/* Start at the head of the chain */
+		if (bb->in_count == 1 && get_chain_test (cfg, bb->in_bb [0], &pred_var, &pred_value, &pred_target, &pred_next, &pred_compare) &&
+			pred_var == var && pred_next == bb && bb->in_bb [0]->region == bb->region)
+			continue;
+
+		ntests = 0;
+		default_key = get_profile_key (cfg, compare);
+		while (TRUE) {
+			key = get_profile_key (cfg, compare);
+			if (key == -1)
+				default_key = -1;
+			cases [ntests].value = value;
+			cases [ntests].target = target;
+			cases [ntests].key = key;
+			cases [ntests].weight = 0;
+			ntests ++;
+
+			if (ntests == MAX_CHAIN_LENGTH || !is_chain_link (cfg, next, bb) || g_slist_find (links, next))
+				break;
+			if (!get_chain_test (cfg, next, &pred_var, &value, &target, &link, &compare) || pred_var != var)
+				break;
+			links = g_slist_prepend (links, next);
+			next = link;
+		}
+
+		if (ntests < MIN_CHAIN_LENGTH) {
+			g_slist_free (links);
+			continue;
+		}
+
+		/* The chain must not branch into itself */
+		valid = next != bb && !g_slist_find (links, next);
+		for (i = 0; i < ntests; ++i) {
+			if (cases [i].target == bb || g_slist_find (links, cases [i].target))
+				valid = FALSE;
+		}
+		if (!valid) {
+			g_slist_free (links);
+			continue;
+		}
+
+		/* Only the first test of a value can succeed, and tests branching to the default are useless */
+		ncases = 0;
+		for (i = 0; i < ntests; ++i) {
+			for (j = 0; j < i; ++j) {
+				if (cases [j].value == cases [i].value)
+					break;
+			}
+			if (j == i && cases [i].target != next)
+				cases [ncases ++] = cases [i];
+		}
+		if (ncases < MIN_CHAIN_LENGTH) {
+			g_slist_free (links);
+			continue;
+		}
+		qsort (cases, ncases, sizeof (ChainCase), compare_chain_cases);
+
+		if (cfg->verbose_level > 2)
+			printf ("COMPARE CHAIN BB%d: %d tests, %d cases, default BB%d\n", bb->block_num, ntests, ncases, next->block_num);
+
+		/* Continue after the dispatch code */
+		bb = lower_compare_chain (cfg, bb, links, var, cases, ncases, next, default_key);
+		g_slist_free (links);
+	}
+}
+
 #endif /* DISABLE_JIT */
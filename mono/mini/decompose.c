@@ -1542,6 +1542,480 @@ mono_decompose_array_access_opts (MonoCompile *cfg)
 	}
 }
 
+#ifdef MONO_ARCH_HAVE_IMULH
+
+/*
+ * compute_signed_magic:
+ *
+ *   Compute the magic number and the shift amount used to divide a BITS wide signed
+ * integer by D, which should not be 0, 1, -1 or a power of two, see Hacker's Delight,
+ * 10-4. The computations are done modulo 2^BITS.
+ */
+static void
+compute_signed_magic (gint64 d, int bits, gint64 *magic, int *shift)
+{
+	guint64 mask = bits == 64 ? G_MAXUINT64 : ((guint64)1 << bits) - 1;
+	guint64 two_w1 = (guint64)1 << (bits - 1);
+	guint64 ad, anc, delta, q1, r1, q2, r2, t;
+	int p;
+
+	ad = d < 0 ? (- (guint64)d) & mask : (guint64)d;
+	t = two_w1 + (d < 0 ? 1 : 0);
+	anc = t - 1 - t % ad;
+	p = bits - 1;
+	q1 = two_w1 / anc;
+	r1 = two_w1 - q1 * anc;
+	q2 = two_w1 / ad;
+	r2 = two_w1 - q2 * ad;
+	do {
+		p ++;
+		q1 = (2 * q1) & mask;
+		r1 = (2 * r1) & mask;
+		if (r1 >= anc) {
+			q1 ++;
+			r1 -= anc;
+		}
+		q2 = (2 * q2) & mask;
+		r2 = (2 * r2) & mask;
+		if (r2 >= ad) {
+			q2 ++;
+			r2 -= ad;
+		}
+		delta = ad - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+
+	t = (q2 + 1) & mask;
+	if (d < 0)
+		t = (- t) & mask;
+	if (bits == 32)
+		*magic = (gint32)(guint32)t;
+	else
+		*magic = (gint64)t;
+	*shift = p - bits;
+}
+
+/*
+ * compute_unsigned_magic:
+ *
+ *   Same for unsigned division by D, which should not be 0 or a power of two, see
+ * Hacker's Delight, 10-10. If ADD is set, the magic number doesn't fit into BITS
+ * bits, and the division needs an additional add.
+ */
+static void
+compute_unsigned_magic (guint64 d, int bits, guint64 *magic, int *shift, gboolean *add)
+{
+	guint64 mask = bits == 64 ? G_MAXUINT64 : ((guint64)1 << bits) - 1;
+	guint64 two_w1 = (guint64)1 << (bits - 1);
+	guint64 nc, delta, q1, r1, q2, r2;
+	int p;
+
+	*add = FALSE;
+	nc = (mask - ((- d) & mask) % d) & mask;
+	p = bits - 1;
+	q1 = two_w1 / nc;
+	r1 = two_w1 - q1 * nc;
+	q2 = (two_w1 - 1) / d;
+	r2 = (two_w1 - 1) - q2 * d;
+	do {
+		p ++;
+		if (r1 >= nc - r1) {
+			q1 = (2 * q1 + 1) & mask;
+			r1 = (2 * r1 - nc) & mask;
+		} else {
+			q1 = (2 * q1) & mask;
+			r1 = (2 * r1) & mask;
+		}
+		if (r2 + 1 >= d - r2) {
+			if (q2 >= two_w1 - 1)
+				*add = TRUE;
+			q2 = (2 * q2 + 1) & mask;
+			r2 = (2 * r2 + 1 - d) & mask;
+		} else {
+			if (q2 >= two_w1)
+				*add = TRUE;
+			q2 = (2 * q2) & mask;
+			r2 = (2 * r2 + 1) & mask;
+		}
+		delta = d - 1 - r2;
+	} while (p < 2 * bits && (q1 < delta || (q1 == delta && r1 == 0)));
+
+	*magic = (q2 + 1) & mask;
+	*shift = p - bits;
+}
+
+/*
+ * get_const_divisor:
+ *
+ *   Return whenever the divisor of the division INS is a constant, and store it into
+ * DIVISOR. For the non-imm opcodes, only constants defined earlier in the same bblock
+ * are found.
+ */
+static gboolean
+get_const_divisor (MonoInst *ins, gboolean is_long, gint64 *divisor)
+{
+	MonoInst *def;
+
+	if (ins->sreg2 == -1) {
+		*divisor = is_long ? (gint64)ins->inst_imm : (gint32)ins->inst_imm;
+		return TRUE;
+	}
+
+	for (def = ins->prev; def; def = def->prev) {
+		const char *spec = INS_INFO (def->opcode);
+
+		if (def->dreg != ins->sreg2 || spec [MONO_INST_DEST] == ' ' || MONO_IS_STORE_MEMBASE (def))
+			continue;
+		if (!is_long && def->opcode == OP_ICONST) {
+			*divisor = (gint32)def->inst_c0;
+			return TRUE;
+		}
+#if SIZEOF_REGISTER == 8
+		if (is_long && def->opcode == OP_I8CONST) {
+			*divisor = def->inst_l;
+			return TRUE;
+		}
+#endif
+		return FALSE;
+	}
+	return FALSE;
+}
+
+static int
+emit_const (MonoCompile *cfg, gboolean is_long, gint64 value)
+{
+	int dreg;
+
+	if (is_long) {
+		dreg = alloc_lreg (cfg);
+		MONO_EMIT_NEW_I8CONST (cfg, dreg, value);
+	} else {
+		dreg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_ICONST (cfg, dreg, (gint32)value);
+	}
+	return dreg;
+}
+
+/*
+ * emit_div_by_const:
+ *
+ *   Emit a sequence of multiplications and shifts computing INS, a division or
+ * remainder by the constant D into cfg->cbb. Only the last instruction of the
+ * sequence writes to ins->dreg, since it might be the same as ins->sreg1.
+ */
+static void
+emit_div_by_const (MonoCompile *cfg, MonoInst *ins, gboolean is_long, gboolean is_signed, gboolean is_rem, gint64 d)
+{
+	int bits = is_long ? 64 : 32;
+	int alloc_type = is_long ? STACK_I8 : STACK_I4;
+	int sreg = ins->sreg1;
+	int qreg, treg, reg;
+	guint64 ad;
+	int power;
+
+	/* The remainder is computed as sreg - (q * d) */
+	qreg = is_rem ? alloc_dreg (cfg, alloc_type) : ins->dreg;
+
+	if (is_signed)
+		ad = d < 0 ? - (guint64)d : (guint64)d;
+	else
+		ad = is_long ? (guint64)d : (guint32)d;
+
+	power = -1;
+	if (!(ad & (ad - 1))) {
+		for (power = 0; ((guint64)1 << power) != ad; ++power)
+			;
+	}
+
+	if (!is_signed && power >= 0) {
+		if (is_rem) {
+			/* No need for the quotient */
+			reg = emit_const (cfg, is_long, ad - 1);
+			MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LAND : OP_IAND, ins->dreg, sreg, reg);
+			return;
+		}
+		if (power == 0)
+			MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, qreg, sreg);
+		else
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, qreg, sreg, power);
+	} else if (!is_signed) {
+		guint64 magic;
+		int shift;
+		gboolean add;
+
+		compute_unsigned_magic (ad, bits, &magic, &shift, &add);
+
+		reg = emit_const (cfg, is_long, (gint64)magic);
+		treg = alloc_dreg (cfg, alloc_type);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LMULH_UN : OP_IMULH_UN, treg, sreg, reg);
+		if (add) {
+			/* q = (((x - t) >> 1) + t) >> (shift - 1) */
+			reg = alloc_dreg (cfg, alloc_type);
+			MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LSUB : OP_ISUB, reg, sreg, treg);
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, reg, reg, 1);
+			MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LADD : OP_IADD, reg, reg, treg);
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, qreg, reg, shift - 1);
+		} else if (shift) {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, qreg, treg, shift);
+		} else {
+			MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, qreg, treg);
+		}
+	} else if (power == 0) {
+		/* d == 1 */
+		MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, qreg, sreg);
+	} else if (power > 0) {
+		/* Round towards zero by adding d - 1 to negative dividends */
+		treg = alloc_dreg (cfg, alloc_type);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_IMM : OP_ISHR_IMM, treg, sreg, bits - 1);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, treg, treg, bits - power);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LADD : OP_IADD, treg, treg, sreg);
+		if (d < 0) {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_IMM : OP_ISHR_IMM, treg, treg, power);
+			MONO_EMIT_NEW_UNALU (cfg, is_long ? OP_LNEG : OP_INEG, qreg, treg);
+		} else {
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_IMM : OP_ISHR_IMM, qreg, treg, power);
+		}
+	} else {
+		gint64 magic;
+		int shift;
+
+		compute_signed_magic (d, bits, &magic, &shift);
+
+		reg = emit_const (cfg, is_long, magic);
+		treg = alloc_dreg (cfg, alloc_type);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LMULH : OP_IMULH, treg, sreg, reg);
+		if (d > 0 && magic < 0)
+			MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LADD : OP_IADD, treg, treg, sreg);
+		else if (d < 0 && magic > 0)
+			MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LSUB : OP_ISUB, treg, treg, sreg);
+		if (shift)
+			MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_IMM : OP_ISHR_IMM, treg, treg, shift);
+		/* Add 1 if the result is negative */
+		reg = alloc_dreg (cfg, alloc_type);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, is_long ? OP_LSHR_UN_IMM : OP_ISHR_UN_IMM, reg, treg, bits - 1);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LADD : OP_IADD, qreg, treg, reg);
+	}
+
+	if (is_rem) {
+		reg = emit_const (cfg, is_long, d);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LMUL : OP_IMUL, reg, qreg, reg);
+		MONO_EMIT_NEW_BIALU (cfg, is_long ? OP_LSUB : OP_ISUB, ins->dreg, sreg, reg);
+	}
+}
+
+/**
+ * mono_decompose_div_by_const:
+ *
+ *  Strength reduce integer divisions and remainders by constants into multiplications
+ * by magic numbers and shifts, using the OP_IMULH/OP_LMULH family of opcodes. The
+ * division by -1 is kept, since it can overflow.
+ */
+void
+mono_decompose_div_by_const (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb, *first_bb;
+
+	cfg->cbb = mono_mempool_alloc0 ((cfg)->mempool, sizeof (MonoBasicBlock));
+	first_bb = cfg->cbb;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MonoInst *ins;
+		MonoInst *prev = NULL;
+		gboolean is_long, is_signed, is_rem;
+		gint64 d;
+
+		if (cfg->verbose_level > 3) mono_print_bb (bb, "BEFORE DECOMPOSE-DIV-BY-CONST ");
+
+		cfg->cbb->code = cfg->cbb->last_ins = NULL;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			is_long = FALSE;
+			is_signed = TRUE;
+			is_rem = FALSE;
+
+			switch (ins->opcode) {
+			case OP_IDIV:
+			case OP_IDIV_IMM:
+				break;
+			case OP_IDIV_UN:
+			case OP_IDIV_UN_IMM:
+				is_signed = FALSE;
+				break;
+			case OP_IREM:
+			case OP_IREM_IMM:
+				is_rem = TRUE;
+				break;
+			case OP_IREM_UN:
+			case OP_IREM_UN_IMM:
+				is_signed = FALSE;
+				is_rem = TRUE;
+				break;
+#if defined(MONO_ARCH_HAVE_LMULH) && SIZEOF_REGISTER == 8
+			case OP_LDIV:
+			case OP_LDIV_IMM:
+				is_long = TRUE;
+				break;
+			case OP_LDIV_UN:
+			case OP_LDIV_UN_IMM:
+				is_long = TRUE;
+				is_signed = FALSE;
+				break;
+			case OP_LREM:
+			case OP_LREM_IMM:
+				is_long = TRUE;
+				is_rem = TRUE;
+				break;
+			case OP_LREM_UN:
+			case OP_LREM_UN_IMM:
+				is_long = TRUE;
+				is_signed = FALSE;
+				is_rem = TRUE;
+				break;
+#endif
+			default:
+				prev = ins;
+				continue;
+			}
+
+			if (!get_const_divisor (ins, is_long, &d) || d == 0 || (is_signed && d == -1)) {
+				prev = ins;
+				continue;
+			}
+
+			emit_div_by_const (cfg, ins, is_long, is_signed, is_rem, d);
+
+			g_assert (cfg->cbb == first_bb);
+
+			/* Replace the original instruction with the new code sequence */
+			mono_replace_ins (cfg, bb, ins, &prev, first_bb, cfg->cbb);
+			first_bb->code = first_bb->last_ins = NULL;
+			first_bb->in_count = first_bb->out_count = 0;
+			cfg->cbb = first_bb;
+		}
+
+		if (cfg->verbose_level > 3) mono_print_bb (bb, "AFTER DECOMPOSE-DIV-BY-CONST ");
+	}
+}
+
+#endif /* MONO_ARCH_HAVE_IMULH */
+
+/*
+ * emit_rgctx_fetch_inline:
+ *
+ *   Emit the lookup done by the rgctx lazy fetch trampolines inline: walk the
+ * (M)RGCTX arrays down to the slot of FETCH, and only call into the runtime if
+ * one of them, or the slot itself, is not yet filled in.
+ */
+static void
+emit_rgctx_fetch_inline (MonoCompile *cfg, MonoInst *fetch)
+{
+	MonoJumpInfoRgctxEntry *entry = fetch->inst_p0;
+	MonoBasicBlock *slowpath_bb, *end_bb;
+	MonoInst *iargs [2];
+	MonoInst *call;
+	guint32 slot;
+	int i, depth, index, array_reg, val_reg;
+	gboolean mrgctx;
+
+	slot = mini_get_rgctx_entry_slot (entry);
+	mrgctx = MONO_RGCTX_SLOT_IS_MRGCTX (slot);
+	index = MONO_RGCTX_SLOT_INDEX (slot);
+	if (mrgctx)
+		index += MONO_SIZEOF_METHOD_RUNTIME_GENERIC_CONTEXT / sizeof (gpointer);
+	for (depth = 0; ; ++depth) {
+		int size = mono_class_rgctx_get_array_size (depth, mrgctx);
+
+		if (index < size - 1)
+			break;
+		index -= size - 1;
+	}
+
+	NEW_BBLOCK (cfg, slowpath_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	if (mrgctx) {
+		/* The first array is the mrgctx itself */
+		array_reg = fetch->sreg1;
+	} else {
+		array_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, array_reg, fetch->sreg1, G_STRUCT_OFFSET (MonoVTable, runtime_generic_context));
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, array_reg, 0);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, slowpath_bb);
+	}
+
+	for (i = 0; i < depth; ++i) {
+		int next_reg = alloc_preg (cfg);
+
+		/* Load the link to the next array */
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, next_reg, array_reg, (mrgctx && i == 0) ? MONO_SIZEOF_METHOD_RUNTIME_GENERIC_CONTEXT : 0);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, next_reg, 0);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, slowpath_bb);
+		array_reg = next_reg;
+	}
+
+	val_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, val_reg, array_reg, (index + 1) * sizeof (gpointer));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, val_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, end_bb);
+
+	MONO_START_BB (cfg, slowpath_bb);
+	MONO_INST_NEW (cfg, iargs [0], OP_MOVE);
+	iargs [0]->dreg = fetch->sreg1;
+	iargs [0]->type = STACK_PTR;
+	EMIT_NEW_ICONST (cfg, iargs [1], MONO_RGCTX_SLOT_INDEX (slot));
+	if (mrgctx)
+		call = mono_emit_jit_icall (cfg, mono_fill_method_rgctx, iargs);
+	else
+		call = mono_emit_jit_icall (cfg, mono_fill_class_rgctx, iargs);
+	MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, val_reg, call->dreg);
+
+	/*
+	 * Define the result in the same bblock as its uses, since it can be passed in
+	 * call->out_ireg_args, which only works for local vregs.
+	 */
+	MONO_START_BB (cfg, end_bb);
+	MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, fetch->dreg, val_reg);
+}
+
+/**
+ * mono_decompose_rgctx_fetch:
+ *
+ *  Decompose the OP_RGCTX_FETCH opcodes emitted by method_to_ir into an inline
+ * lookup of the (M)RGCTX slot, so slots which are already instantiated don't
+ * have to go through the lazy fetch trampolines.
+ */
+void
+mono_decompose_rgctx_fetch (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb, *first_bb;
+
+	cfg->cbb = mono_mempool_alloc0 ((cfg)->mempool, sizeof (MonoBasicBlock));
+	first_bb = cfg->cbb;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MonoInst *ins;
+		MonoInst *prev = NULL;
+
+		cfg->cbb->code = cfg->cbb->last_ins = NULL;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			if (ins->opcode != OP_RGCTX_FETCH) {
+				prev = ins;
+				continue;
+			}
+
+			if (cfg->verbose_level > 3) mono_print_bb (bb, "BEFORE DECOMPOSE-RGCTX-FETCH ");
+
+			emit_rgctx_fetch_inline (cfg, ins);
+
+			/* Replace the original instruction with the new code sequence, this splits BB */
+			mono_replace_ins (cfg, bb, ins, &prev, first_bb, cfg->cbb);
+			first_bb->code = first_bb->last_ins = NULL;
+			first_bb->in_count = first_bb->out_count = 0;
+			cfg->cbb = first_bb;
+		}
+	}
+}
+
 typedef union {
 	guint32 vali [2];
 	gint64 vall;
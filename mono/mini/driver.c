@@ -315,6 +315,8 @@ opt_sets [] = {
        MONO_OPT_SIMD,
        MONO_OPT_SSE2,
        MONO_OPT_SIMD | MONO_OPT_SSE2,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_VECTORIZE,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SSA | MONO_OPT_ABCREM | MONO_OPT_GVN | MONO_OPT_VECTORIZE,
 #endif
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_INTRINS,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_INTRINS | MONO_OPT_ALIAS_ANALYSIS,
@@ -326,6 +328,8 @@ opt_sets [] = {
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_TAILC,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SSA,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SSA | MONO_OPT_ESCAPE,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_ABCREM | MONO_OPT_GVN,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_CMOV,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_ABCREM,
@@ -370,6 +374,8 @@ mini_regression_step (MonoImage *image, int verbose, int *total_run, int *total,
 		domain_jit_info (domain)->jit_trampoline_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
 		mono_internal_hash_table_destroy (&(domain->jit_code_hash));
 		mono_jit_code_hash_init (&(domain->jit_code_hash));
+		mono_conc_hashtable_destroy (domain_jit_info (domain)->jit_code_cache);
+		domain_jit_info (domain)->jit_code_cache = mono_conc_hashtable_new (NULL, NULL);
 	}
 
 	g_timer_start (timer);
@@ -1059,7 +1065,7 @@ static void main_thread_handler (gpointer user_data)
 		 * This must be done in a thread managed by mono since it can invoke
 		 * managed code.
 		 */
-		if (main_args->opts & MONO_OPT_PRECOMP)
+		if ((main_args->opts & MONO_OPT_PRECOMP) || mini_jit_pool_enabled ())
 			mono_precompile_assemblies ();
 
 		mono_jit_exec (main_args->domain, assembly, main_args->argc, main_args->argv);
@@ -1207,6 +1213,12 @@ mini_usage (void)
 		"    --attach=OPTIONS       Pass OPTIONS to the attach agent in the runtime.\n"
 		"                           Currently the only supported option is 'disable'.\n"
 		"    --llvm, --nollvm       Controls whenever the runtime uses LLVM to compile code.\n"
+		"    --tiered               Compile methods quickly first, and recompile the frequently\n"
+		"                           called ones with all the optimizations in the background\n"
+		"    --jit-pool[=OPTIONS]   Precompile methods on multiple threads at startup\n"
+		"                           OPTIONS: threads=N,list=FILE,record=FILE,background\n"
+		"    --jit-profile=FILE     Write the cost of each JIT compilation to FILE, use\n"
+		"                           mprof-jit-report to summarize it\n"
 	        "    --gc=[sgen,boehm]      Select SGen or Boehm GC (runs mono or mono-sgen)\n"
 #ifdef HOST_WIN32
 	        "    --mixed-mode           Enable mixed-mode image support.\n"
@@ -1808,6 +1820,15 @@ mono_main (int argc, char* argv[])
 #endif
 		} else if (strcmp (argv [i], "--nollvm") == 0){
 			mono_use_llvm = FALSE;
+		} else if (strcmp (argv [i], "--tiered") == 0) {
+			mono_tiered_jit = TRUE;
+		} else if (strcmp (argv [i], "--jit-pool") == 0 || strncmp (argv [i], "--jit-pool=", 11) == 0) {
+			if (!mini_jit_pool_parse_options (argv [i][10] == '=' ? &argv [i][11] : NULL)) {
+				fprintf (stderr, "Invalid --jit-pool option: '%s'\n", argv [i]);
+				return 1;
+			}
+		} else if (strncmp (argv [i], "--jit-profile=", 14) == 0) {
+			mono_jit_prof_file = &argv [i][14];
 #ifdef __native_client_codegen__
 		} else if (strcmp (argv [i], "--nacl-align-mask-off") == 0){
 			nacl_align_byte = -1; /* 0xff */
@@ -0,0 +1,778 @@
+/*
+ * escape.c: Escape analysis and elimination of allocations
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * The allocations of objects of a known class made by handle_alloc () are
+ * recorded in cfg->alloc_sites. An object doesn't escape the method if its
+ * reference is only copied to other vregs, used to access its fields, and
+ * null checked. Such objects are not allocated at all:
+ * - if all the accesses are to fields which fit into a register, each field
+ *   is replaced by a local variable (scalar replacement). This covers small
+ *   temporary objects whose constructor was inlined and the boxing of
+ *   primitive types and enums, so box/unbox pairs become moves.
+ * - otherwise, if the object is a boxed valuetype, the boxed value is
+ *   stored in a local variable of the valuetype. The variable is zeroed and
+ *   included in the GC maps like any other local.
+ * Loads of the vtable, done by unbox and castclass, are replaced by the vtable
+ * constant.
+ * The pass runs before the SSA form is computed, so the SSA renaming takes
+ * care of the new variables. Since the vregs are not in SSA form yet, all the
+ * vregs holding the reference must have a single definition which dominates
+ * all its uses. This ensures the uses always see the last object allocated by
+ * the allocation site, so one set of variables is enough even if it is inside
+ * a loop.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#ifndef DISABLE_JIT
+
+/* Larger objects are left on the heap */
+#define MAX_OBJECT_SIZE 128
+
+#define IS_STORE_MEMBASE_IMM(ins) ((ins)->opcode >= OP_STORE_MEMBASE_IMM && (ins)->opcode <= OP_STOREI8_MEMBASE_IMM)
+
+typedef struct {
+	MonoInst *ins;
+	MonoBasicBlock *bb;
+	/* Position of INS in BB */
+	int pos;
+} UseSite;
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	/* The number of definitions of each vreg, and its last definition */
+	int *num_defs;
+	UseSite *defs;
+	/* The list of UseSites using each vreg */
+	GSList **uses;
+	/* Whenever a reference stored in the vreg escapes regardless of its uses */
+	gboolean *escapes;
+	/*
+	 * The offset inside the object of the address stored in each vreg, while
+	 * processing an allocation site, or -1.
+	 */
+	int *offsets;
+	GSList *aliases;
+} EscapeContext;
+
+static double r8_0 = 0.0;
+
+static gboolean
+is_null_const (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_ICONST:
+		return ins->inst_c0 == 0;
+#if SIZEOF_REGISTER == 8
+	case OP_I8CONST:
+		return ins->inst_l == 0;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+static void
+add_use (EscapeContext *ctx, int vreg, MonoInst *ins, MonoBasicBlock *bb, int pos)
+{
+	MonoCompile *cfg = ctx->cfg;
+	UseSite *use;
+
+	if (vreg == -1 || vreg >= ctx->num_vregs)
+		return;
+	use = mono_mempool_alloc (cfg->mempool, sizeof (UseSite));
+	use->ins = ins;
+	use->bb = bb;
+	use->pos = pos;
+	ctx->uses [vreg] = g_slist_prepend_mempool (cfg->mempool, ctx->uses [vreg], use);
+}
+
+/*
+ * collect_defs_uses:
+ *
+ *   Compute the definitions and the uses of all the vregs. Definitions of a
+ * vreg to NULL are not counted if they are followed by another definition in
+ * the same bblock without a use in between, or if they are done by initlocals
+ * before any other definition. These are generated for every local holding a
+ * reference.
+ */
+static void
+collect_defs_uses (EscapeContext *ctx)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *bb, *init_bb;
+	MonoInst *ins;
+	MonoInst **null_defs;
+	GSList *pending, *l;
+	int i;
+
+	null_defs = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * ctx->num_vregs);
+
+	/* The bblock containing the initlocals code, it runs once, before anything else */
+	init_bb = NULL;
+	if (cfg->bb_entry->out_count == 1 && cfg->bb_entry->out_bb [0]->in_count == 1 && !cfg->bb_entry->code)
+		init_bb = cfg->bb_entry->out_bb [0];
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		int pos = 0;
+
+		pending = NULL;
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+			int sregs [MONO_MAX_SRC_REGS];
+			int num_sregs, dreg;
+
+			pos ++;
+
+			if (MONO_IS_CALL (ins)) {
+				MonoCallInst *call = (MonoCallInst*)ins;
+
+				for (l = call->out_ireg_args; l; l = l->next) {
+					dreg = (guint32)(gssize)(l->data) & 0xffffff;
+					if (dreg < ctx->num_vregs)
+						ctx->escapes [dreg] = TRUE;
+				}
+				for (l = call->out_freg_args; l; l = l->next) {
+					dreg = (guint32)(gssize)(l->data) & 0xffffff;
+					if (dreg < ctx->num_vregs)
+						ctx->escapes [dreg] = TRUE;
+				}
+			}
+
+			num_sregs = mono_inst_get_src_registers (ins, sregs);
+			for (i = 0; i < num_sregs; ++i) {
+				if (sregs [i] == -1 || sregs [i] >= ctx->num_vregs)
+					continue;
+				add_use (ctx, sregs [i], ins, bb, pos);
+				null_defs [sregs [i]] = NULL;
+			}
+
+			dreg = ins->dreg;
+			if (dreg == -1 || dreg >= ctx->num_vregs || spec [MONO_INST_DEST] == ' ')
+				continue;
+			if (MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins)) {
+				add_use (ctx, dreg, ins, bb, pos);
+				null_defs [dreg] = NULL;
+				continue;
+			}
+
+			if (bb == init_bb && !ctx->num_defs [dreg] && is_null_const (ins))
+				continue;
+			if (null_defs [dreg])
+				/* The previous definition is dead */
+				ctx->num_defs [dreg] --;
+			ctx->num_defs [dreg] ++;
+			ctx->defs [dreg].ins = ins;
+			ctx->defs [dreg].bb = bb;
+			ctx->defs [dreg].pos = pos;
+			if (is_null_const (ins)) {
+				null_defs [dreg] = ins;
+				pending = g_slist_prepend (pending, GINT_TO_POINTER (dreg));
+			} else {
+				null_defs [dreg] = NULL;
+			}
+#if SIZEOF_REGISTER == 4
+			if (spec [MONO_INST_DEST] == 'l' && dreg + 2 < ctx->num_vregs) {
+				ctx->escapes [dreg + 1] = TRUE;
+				ctx->escapes [dreg + 2] = TRUE;
+			}
+#endif
+		}
+
+		for (l = pending; l; l = l->next)
+			null_defs [GPOINTER_TO_INT (l->data)] = NULL;
+		g_slist_free (pending);
+	}
+
+	for (i = 0; i < cfg->num_varinfo; ++i) {
+		MonoInst *var = cfg->varinfo [i];
+
+		if ((var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) && var->dreg < ctx->num_vregs)
+			ctx->escapes [var->dreg] = TRUE;
+	}
+	if (cfg->ret && cfg->ret->dreg < ctx->num_vregs)
+		ctx->escapes [cfg->ret->dreg] = TRUE;
+}
+
+/*
+ * dominates_uses:
+ *
+ *   Return whenever the single definition of VREG dominates all of its uses.
+ */
+static gboolean
+dominates_uses (EscapeContext *ctx, int vreg)
+{
+	UseSite *def = &ctx->defs [vreg];
+	GSList *l;
+
+	for (l = ctx->uses [vreg]; l; l = l->next) {
+		UseSite *use = l->data;
+
+		if (use->bb == def->bb) {
+			if (use->pos <= def->pos)
+				return FALSE;
+		} else {
+			if (!use->bb->dominators || !mono_bitset_test_fast (use->bb->dominators, def->bb->dfn))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static int
+get_access_size (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+		return 1;
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_IMM:
+		return 2;
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADR4_MEMBASE:
+	case OP_STOREI4_MEMBASE_REG:
+	case OP_STOREI4_MEMBASE_IMM:
+	case OP_STORER4_MEMBASE_REG:
+		return 4;
+	case OP_LOADI8_MEMBASE:
+	case OP_LOADR8_MEMBASE:
+	case OP_STOREI8_MEMBASE_REG:
+	case OP_STOREI8_MEMBASE_IMM:
+	case OP_STORER8_MEMBASE_REG:
+		return 8;
+	case OP_LOAD_MEMBASE:
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		return SIZEOF_VOID_P;
+	case OP_LOADV_MEMBASE:
+	case OP_STOREV_MEMBASE:
+		return mono_class_value_size (ins->klass, NULL);
+	default:
+		return 0;
+	}
+}
+
+/* Map the opcodes which access the same kind of value to the same opcode */
+static int
+normalize_access_op (int opcode)
+{
+	switch (opcode) {
+	case OP_LOADU4_MEMBASE:
+		return OP_LOADI4_MEMBASE;
+	case OP_STOREI1_MEMBASE_IMM:
+		return OP_STOREI1_MEMBASE_REG;
+	case OP_STOREI2_MEMBASE_IMM:
+		return OP_STOREI2_MEMBASE_REG;
+	case OP_STOREI4_MEMBASE_IMM:
+		return OP_STOREI4_MEMBASE_REG;
+	case OP_STOREI8_MEMBASE_IMM:
+		return OP_STOREI8_MEMBASE_REG;
+#if SIZEOF_REGISTER == 8
+	case OP_LOAD_MEMBASE:
+		return OP_LOADI8_MEMBASE;
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		return OP_STOREI8_MEMBASE_REG;
+#else
+	case OP_LOAD_MEMBASE:
+		return OP_LOADI4_MEMBASE;
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		return OP_STOREI4_MEMBASE_REG;
+#endif
+	default:
+		return opcode;
+	}
+}
+
+/*
+ * Return whenever values of type T can be kept in a register. R4 is excluded
+ * since loading it converts it to a double.
+ */
+static gboolean
+is_scalar_type (MonoType *t)
+{
+	if (t->byref)
+		return FALSE;
+	switch (t->type) {
+	case MONO_TYPE_I1:
+	case MONO_TYPE_U1:
+	case MONO_TYPE_BOOLEAN:
+	case MONO_TYPE_I2:
+	case MONO_TYPE_U2:
+	case MONO_TYPE_CHAR:
+	case MONO_TYPE_I4:
+	case MONO_TYPE_U4:
+	case MONO_TYPE_I:
+	case MONO_TYPE_U:
+	case MONO_TYPE_PTR:
+	case MONO_TYPE_FNPTR:
+	case MONO_TYPE_R8:
+	case MONO_TYPE_STRING:
+	case MONO_TYPE_CLASS:
+	case MONO_TYPE_OBJECT:
+	case MONO_TYPE_SZARRAY:
+	case MONO_TYPE_ARRAY:
+		return TRUE;
+	case MONO_TYPE_I8:
+	case MONO_TYPE_U8:
+		return SIZEOF_REGISTER == 8;
+	case MONO_TYPE_GENERICINST:
+		return !mono_type_generic_inst_is_valuetype (t);
+	default:
+		return FALSE;
+	}
+}
+
+static MonoClassField*
+find_field (MonoClass *klass, int offset)
+{
+	int i;
+
+	for (i = 0; i < klass->field.count; ++i) {
+		MonoClassField *field = &klass->fields [i];
+
+		if (field->type->attrs & FIELD_ATTRIBUTE_STATIC)
+			continue;
+		if (field->offset == offset)
+			return field;
+	}
+	return NULL;
+}
+
+/*
+ * Return whenever INS, which accesses the field of KLASS at OFFSET, can be
+ * replaced by an access to a variable.
+ */
+static gboolean
+is_scalar_access (MonoCompile *cfg, MonoClass *klass, MonoInst *ins, int offset)
+{
+	MonoClassField *field;
+	MonoType *t;
+	int expected;
+
+	if (klass->flags & TYPE_ATTRIBUTE_EXPLICIT_LAYOUT)
+		return FALSE;
+	field = find_field (klass, offset);
+	if (!field)
+		return FALSE;
+	t = mono_type_get_underlying_type (field->type);
+	if (!is_scalar_type (t))
+		return FALSE;
+
+	if (MONO_IS_STORE_MEMBASE (ins))
+		expected = mono_type_to_store_membase (cfg, t);
+	else
+		expected = mono_type_to_load_membase (cfg, t);
+	return normalize_access_op (ins->opcode) == normalize_access_op (expected);
+}
+
+static void
+add_alias (EscapeContext *ctx, int vreg, int offset)
+{
+	ctx->offsets [vreg] = offset;
+	ctx->aliases = g_slist_prepend_mempool (ctx->cfg->mempool, ctx->aliases, GINT_TO_POINTER (vreg));
+}
+
+/*
+ * analyze_site:
+ *
+ *   Compute the vregs holding the reference to the object allocated by SITE,
+ * or an address inside it, into ctx->aliases. Return FALSE if the object
+ * escapes. Set SCALAR to TRUE if all the accesses to the object can be scalar
+ * replaced.
+ */
+static gboolean
+analyze_site (EscapeContext *ctx, MonoAllocSite *site, gboolean *scalar)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoClass *klass = site->klass;
+	GSList *worklist, *l;
+	int size = klass->instance_size;
+
+	*scalar = TRUE;
+
+	add_alias (ctx, site->ins->dreg, 0);
+	worklist = g_slist_prepend (NULL, GINT_TO_POINTER (site->ins->dreg));
+	while (worklist) {
+		int vreg = GPOINTER_TO_INT (worklist->data);
+		int base_offset = ctx->offsets [vreg];
+
+		worklist = g_slist_delete_link (worklist, worklist);
+
+		if (ctx->escapes [vreg])
+			goto escapes;
+		/* A dead copy, made for a local variable in unoptimized IL */
+		if (!ctx->uses [vreg])
+			continue;
+		if (ctx->num_defs [vreg] != 1 || !dominates_uses (ctx, vreg))
+			goto escapes;
+
+		for (l = ctx->uses [vreg]; l; l = l->next) {
+			MonoInst *ins = ((UseSite*)l->data)->ins;
+			int offset, access_size;
+
+			switch (ins->opcode) {
+			case OP_MOVE:
+				if (ctx->offsets [ins->dreg] != -1)
+					goto escapes;
+				add_alias (ctx, ins->dreg, base_offset);
+				worklist = g_slist_prepend (worklist, GINT_TO_POINTER (ins->dreg));
+				continue;
+			case OP_ADD_IMM:
+#if SIZEOF_REGISTER == 8
+			case OP_LADD_IMM:
+#else
+			case OP_IADD_IMM:
+#endif
+				offset = base_offset + ins->inst_imm;
+				if (ctx->offsets [ins->dreg] != -1 || offset < 0 || offset > size)
+					goto escapes;
+				add_alias (ctx, ins->dreg, offset);
+				worklist = g_slist_prepend (worklist, GINT_TO_POINTER (ins->dreg));
+				continue;
+			case OP_NOT_NULL:
+			case OP_CHECK_THIS:
+			case OP_DUMMY_USE:
+				continue;
+			case OP_WBARRIER:
+			case OP_CARD_TABLE_WBARRIER:
+				/* The address of a field */
+				if (ins->sreg2 == vreg)
+					goto escapes;
+				continue;
+			default:
+				break;
+			}
+
+			access_size = get_access_size (ins);
+			if (!access_size)
+				goto escapes;
+			if (MONO_IS_STORE_MEMBASE (ins)) {
+				/* Storing the reference itself */
+				if (ins->inst_destbasereg != vreg || ins->sreg1 == vreg)
+					goto escapes;
+			} else if (MONO_IS_LOAD_MEMBASE (ins)) {
+				if (ins->inst_basereg != vreg)
+					goto escapes;
+			} else {
+				goto escapes;
+			}
+
+			offset = base_offset + ins->inst_offset;
+			if (offset == 0 && ins->opcode == OP_LOAD_MEMBASE && !cfg->compile_aot)
+				/* Vtable load */
+				continue;
+			if (offset < sizeof (MonoObject) || offset + access_size > size)
+				goto escapes;
+			if (!is_scalar_access (cfg, klass, ins, offset))
+				*scalar = FALSE;
+		}
+	}
+
+	return TRUE;
+
+ escapes:
+	g_slist_free (worklist);
+	return FALSE;
+}
+
+static MonoInst*
+get_field_var (MonoCompile *cfg, MonoClass *klass, MonoInst **field_vars, int offset)
+{
+	MonoClassField *field = find_field (klass, offset);
+	int index = field - klass->fields;
+
+	if (!field_vars [index])
+		field_vars [index] = mono_compile_create_var (cfg, mono_type_get_underlying_type (field->type), OP_LOCAL);
+	return field_vars [index];
+}
+
+/*
+ * Turn INS into the definition of VAR to the constant VALUE.
+ */
+static void
+set_const (MonoInst *ins, MonoInst *var, gint64 value)
+{
+	MonoType *t = var->inst_vtype;
+
+	ins->dreg = var->dreg;
+	ins->sreg1 = ins->sreg2 = -1;
+	switch (t->type) {
+	case MONO_TYPE_I1:
+		ins->opcode = OP_ICONST;
+		ins->inst_c0 = (gint8)value;
+		break;
+	case MONO_TYPE_U1:
+	case MONO_TYPE_BOOLEAN:
+		ins->opcode = OP_ICONST;
+		ins->inst_c0 = (guint8)value;
+		break;
+	case MONO_TYPE_I2:
+		ins->opcode = OP_ICONST;
+		ins->inst_c0 = (gint16)value;
+		break;
+	case MONO_TYPE_U2:
+	case MONO_TYPE_CHAR:
+		ins->opcode = OP_ICONST;
+		ins->inst_c0 = (guint16)value;
+		break;
+	case MONO_TYPE_I4:
+	case MONO_TYPE_U4:
+		ins->opcode = OP_ICONST;
+		ins->inst_c0 = (gint32)value;
+		break;
+	case MONO_TYPE_R8:
+		g_assert (value == 0);
+		ins->opcode = OP_R8CONST;
+		ins->inst_p0 = (void*)&r8_0;
+		break;
+#if SIZEOF_REGISTER == 8
+	case MONO_TYPE_I8:
+	case MONO_TYPE_U8:
+		ins->opcode = OP_I8CONST;
+		ins->inst_l = value;
+		break;
+#endif
+	default:
+		ins->opcode = OP_PCONST;
+		ins->inst_p0 = (gpointer)(gssize)value;
+		break;
+	}
+}
+
+static int
+get_store_op (MonoType *t)
+{
+	switch (t->type) {
+	case MONO_TYPE_I1:
+		return OP_ICONV_TO_I1;
+	case MONO_TYPE_U1:
+	case MONO_TYPE_BOOLEAN:
+		return OP_ICONV_TO_U1;
+	case MONO_TYPE_I2:
+		return OP_ICONV_TO_I2;
+	case MONO_TYPE_U2:
+	case MONO_TYPE_CHAR:
+		return OP_ICONV_TO_U2;
+	case MONO_TYPE_R8:
+		return OP_FMOVE;
+	default:
+		return OP_MOVE;
+	}
+}
+
+static MonoInst*
+emit_var_address (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst *ins, MonoInst *var)
+{
+	MonoInst *addr;
+
+	MONO_INST_NEW (cfg, addr, OP_LDADDR);
+	addr->inst_p0 = var;
+	addr->type = STACK_MP;
+	addr->klass = var->klass;
+	addr->dreg = mono_alloc_preg (cfg);
+	var->flags |= MONO_INST_INDIRECT;
+	cfg->has_indirection = TRUE;
+	mono_bblock_insert_before_ins (bb, ins, addr);
+	return addr;
+}
+
+/*
+ * rewrite_site:
+ *
+ *   Remove the allocation made by SITE, replacing the accesses to the object
+ * with accesses to variables.
+ */
+static void
+rewrite_site (EscapeContext *ctx, MonoAllocSite *site, gboolean scalar)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoClass *klass = site->klass;
+	MonoBasicBlock *alloc_bb = ctx->defs [site->ins->dreg].bb;
+	MonoInst **field_vars = NULL;
+	MonoInst *value_var = NULL;
+	MonoInst *ins, *init;
+	GSList *l, *l2;
+	int i;
+
+	if (scalar)
+		field_vars = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * klass->field.count);
+	else
+		value_var = mono_compile_create_var (cfg, &klass->byval_arg, OP_LOCAL);
+
+	for (l = ctx->aliases; l; l = l->next) {
+		int vreg = GPOINTER_TO_INT (l->data);
+		int base_offset = ctx->offsets [vreg];
+
+		for (l2 = ctx->uses [vreg]; l2; l2 = l2->next) {
+			UseSite *use = l2->data;
+			MonoInst *var, *c;
+			int offset;
+
+			ins = use->ins;
+			if (ins->opcode == OP_NOP)
+				continue;
+
+			if (!MONO_IS_LOAD_MEMBASE (ins) && !MONO_IS_STORE_MEMBASE (ins)) {
+				/* Copies of the reference, null checks and write barriers */
+				NULLIFY_INS (ins);
+				continue;
+			}
+
+			offset = base_offset + ins->inst_offset;
+			if (offset == 0) {
+				NEW_VTABLECONST (cfg, c, site->vtable);
+				c->dreg = ins->dreg;
+				mono_bblock_insert_before_ins (use->bb, ins, c);
+				NULLIFY_INS (ins);
+				continue;
+			}
+
+			if (!scalar) {
+				if ((ins->opcode == OP_STOREV_MEMBASE || ins->opcode == OP_LOADV_MEMBASE) && offset == sizeof (MonoObject) && ins->klass == klass) {
+					/* Copy of the whole value */
+					if (ins->opcode == OP_STOREV_MEMBASE)
+						ins->dreg = value_var->dreg;
+					else
+						ins->sreg1 = value_var->dreg;
+					ins->opcode = OP_VMOVE;
+				} else {
+					MonoInst *addr = emit_var_address (cfg, use->bb, ins, value_var);
+
+					if (MONO_IS_STORE_MEMBASE (ins))
+						ins->inst_destbasereg = addr->dreg;
+					else
+						ins->inst_basereg = addr->dreg;
+					ins->inst_offset = offset - sizeof (MonoObject);
+				}
+				continue;
+			}
+
+			var = get_field_var (cfg, klass, field_vars, offset);
+			if (IS_STORE_MEMBASE_IMM (ins)) {
+				set_const (ins, var, ins->inst_imm);
+			} else if (MONO_IS_STORE_MEMBASE (ins)) {
+				ins->opcode = get_store_op (var->inst_vtype);
+				ins->dreg = var->dreg;
+			} else {
+				ins->opcode = var->inst_vtype->type == MONO_TYPE_R8 ? OP_FMOVE : OP_MOVE;
+				ins->sreg1 = var->dreg;
+			}
+		}
+	}
+
+	/* The object is zeroed by the allocation */
+	ins = site->ins;
+	if (scalar) {
+		for (i = 0; i < klass->field.count; ++i) {
+			if (!field_vars [i])
+				continue;
+			MONO_INST_NEW (cfg, init, OP_ICONST);
+			set_const (init, field_vars [i], 0);
+			mono_bblock_insert_after_ins (alloc_bb, ins, init);
+		}
+	} else {
+		MONO_INST_NEW (cfg, init, OP_VZERO);
+		init->dreg = value_var->dreg;
+		init->klass = klass;
+		mono_bblock_insert_after_ins (alloc_bb, ins, init);
+	}
+	NULLIFY_INS (ins);
+}
+
+static gboolean
+is_candidate_class (MonoClass *klass)
+{
+	if (klass->instance_size > MAX_OBJECT_SIZE || klass->rank || klass == mono_defaults.string_class)
+		return FALSE;
+	if (mono_class_is_marshalbyref (klass) || mono_class_is_contextbound (klass) || mono_class_has_finalizer (klass))
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * mono_escape_analysis:
+ *
+ *   Remove the allocations of objects which don't escape the method. The
+ * dominator info needs to be computed.
+ */
+void
+mono_escape_analysis (MonoCompile *cfg)
+{
+	EscapeContext ctx;
+	GSList *l, *l2;
+	gboolean changed = FALSE;
+
+	if (!cfg->alloc_sites || cfg->gen_seq_points)
+		return;
+	g_assert (cfg->comp_done & MONO_COMP_DOM);
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.cfg = cfg;
+	ctx.num_vregs = cfg->next_vreg;
+	ctx.num_defs = mono_mempool_alloc0 (cfg->mempool, sizeof (int) * ctx.num_vregs);
+	ctx.defs = mono_mempool_alloc0 (cfg->mempool, sizeof (UseSite) * ctx.num_vregs);
+	ctx.uses = mono_mempool_alloc0 (cfg->mempool, sizeof (GSList*) * ctx.num_vregs);
+	ctx.escapes = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * ctx.num_vregs);
+	ctx.offsets = mono_mempool_alloc (cfg->mempool, sizeof (int) * ctx.num_vregs);
+	memset (ctx.offsets, 0xff, sizeof (int) * ctx.num_vregs);
+
+	collect_defs_uses (&ctx);
+
+	for (l = cfg->alloc_sites; l; l = l->next) {
+		MonoAllocSite *site = l->data;
+		MonoInst *ins = site->ins;
+		gboolean scalar, res;
+
+		/* The allocation is in unreachable code */
+		if (ins->dreg == -1 || ins->dreg >= ctx.num_vregs || ctx.defs [ins->dreg].ins != ins)
+			continue;
+		if (!is_candidate_class (site->klass))
+			continue;
+
+		ctx.aliases = NULL;
+		res = analyze_site (&ctx, site, &scalar);
+		if (res && (scalar || site->klass->valuetype)) {
+			if (cfg->verbose_level > 1)
+				printf ("ESCAPE: %s %s in BB%d.\n", scalar ? "Scalar replaced" : "Stack allocated", mono_type_full_name (&site->klass->byval_arg), ctx.defs [ins->dreg].bb->block_num);
+
+			rewrite_site (&ctx, site, scalar);
+			changed = TRUE;
+			if (scalar)
+				mono_jit_stats.allocs_scalar_replaced ++;
+			else
+				mono_jit_stats.allocs_stack_allocated ++;
+			if (site->klass->valuetype)
+				mono_jit_stats.boxes_eliminated ++;
+		}
+
+		for (l2 = ctx.aliases; l2; l2 = l2->next)
+			ctx.offsets [GPOINTER_TO_INT (l2->data)] = -1;
+	}
+
+	/* Remove the computation of the arguments of the allocations */
+	if (changed && (cfg->opt & MONO_OPT_DEADCE))
+		mono_local_deadce (cfg);
+}
+
+#else /* !DISABLE_JIT */
+
+MONO_EMPTY_SOURCE_FILE (escape);
+
+#endif /* !DISABLE_JIT */
@@ -617,8 +617,7 @@ mono_arch_find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls,
 		regs [AMD64_R14] = new_ctx->r14;
 		regs [AMD64_R15] = new_ctx->r15;
 
-		mono_unwind_frame (unwind_info, unwind_info_len, ji->code_start, 
-						   (guint8*)ji->code_start + ji->code_size,
+		mono_unwind_frame_jinfo (ji, unwind_info, unwind_info_len,
 						   ip, regs, MONO_MAX_IREGS + 1, 
 						   save_locations, MONO_MAX_IREGS, &cfa);
 
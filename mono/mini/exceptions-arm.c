@@ -416,8 +416,7 @@ mono_arch_find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls,
 			regs [MONO_MAX_IREGS + i] = new_ctx->fregs [8 + i];
 #endif
 
-		mono_unwind_frame (unwind_info, unwind_info_len, ji->code_start, 
-						   (guint8*)ji->code_start + ji->code_size,
+		mono_unwind_frame_jinfo (ji, unwind_info, unwind_info_len,
 						   ip, regs, MONO_MAX_IREGS + 8,
 						   save_locations, MONO_MAX_IREGS, &cfa);
 
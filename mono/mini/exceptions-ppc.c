@@ -548,8 +548,7 @@ mono_arch_find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls,
 			for (i = 0; i < MONO_SAVED_GREGS; ++i)
 				regs [ppc_r13 + i] = ctx->regs [i];
 
-			mono_unwind_frame (unwind_info, unwind_info_len, ji->code_start, 
-							   (guint8*)ji->code_start + ji->code_size,
+			mono_unwind_frame_jinfo (ji, unwind_info, unwind_info_len,
 							   ip, regs, ppc_lr + 1,
 							   save_locations, MONO_MAX_IREGS, &cfa);
 
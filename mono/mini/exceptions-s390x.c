@@ -483,8 +483,7 @@ mono_arch_find_jit_info (MonoDomain *domain, MonoJitTlsData *jit_tls,
 		address = (char *)ip - (char *)ji->code_start;
 
 		memcpy(&regs, &ctx->uc_mcontext.gregs, sizeof(regs));
-		mono_unwind_frame (unwind_info, unwind_info_len, ji->code_start,
-				(guint8 *) ji->code_start + ji->code_size,
+		mono_unwind_frame_jinfo (ji, unwind_info, unwind_info_len,
 				ip, regs, 16, save_locations, 
 				MONO_MAX_IREGS, &cfa);
 		memcpy (&new_ctx->uc_mcontext.gregs, &regs, sizeof(regs));
@@ -2731,6 +2731,201 @@ class Tests
 		}
 		return 1;
 	}
+
+	/*
+	 * The jit info and the protecting clauses of an ip are cached, so the following
+	 * tests throw through the same frames and clauses many times.
+	 */
+	static int eh_repeat_finally_count;
+
+	[MethodImpl(MethodImplOptions.NoInlining)]
+	static void eh_repeat_throw (int i) {
+		if (i % 3 == 0)
+			throw new ArgumentException ();
+		if (i % 3 == 1)
+			throw new InvalidOperationException ();
+		throw new OverflowException ();
+	}
+
+	[MethodImpl(MethodImplOptions.NoInlining)]
+	static int eh_repeat_inner (int i) {
+		try {
+			eh_repeat_throw (i);
+		} catch (ArgumentException) {
+			return 1;
+		} finally {
+			eh_repeat_finally_count ++;
+		}
+		return 0;
+	}
+
+	[MethodImpl(MethodImplOptions.NoInlining)]
+	static int eh_repeat_outer (int i) {
+		try {
+			return eh_repeat_inner (i);
+		} catch (InvalidOperationException) {
+			return 2;
+		}
+	}
+
+	public static int test_0_throw_through_same_frames_repeatedly () {
+		eh_repeat_finally_count = 0;
+		for (int i = 0; i < 1000; ++i) {
+			int res;
+
+			try {
+				res = eh_repeat_outer (i);
+			} catch (OverflowException) {
+				res = 3;
+			}
+			if (res != (i % 3) + 1)
+				return 1;
+		}
+		return eh_repeat_finally_count == 1000 ? 0 : 2;
+	}
+
+	[MethodImpl(MethodImplOptions.NoInlining)]
+	static int eh_repeat_nested (int i) {
+		int res = 0;
+
+		try {
+			try {
+				try {
+					eh_repeat_throw (i);
+				} catch (ArgumentException) {
+					res += 1;
+					if (i % 2 == 0)
+						throw new OverflowException ();
+				} finally {
+					res += 10;
+				}
+			} catch (InvalidOperationException) {
+				res += 100;
+			} finally {
+				res += 1000;
+			}
+		} catch (OverflowException) {
+			res += 10000;
+		}
+		return res;
+	}
+
+	public static int test_0_nested_clauses_repeatedly () {
+		for (int i = 0; i < 1000; ++i) {
+			int expected;
+
+			if (i % 3 == 0)
+				expected = i % 2 == 0 ? 11011 : 1011;
+			else if (i % 3 == 1)
+				expected = 1110;
+			else
+				expected = 11010;
+			if (eh_repeat_nested (i) != expected)
+				return 1;
+		}
+		return 0;
+	}
+
+	/* The clause bitmask only covers 32 clauses, the rest take the slow path */
+	static int eh_32_clauses (int throw_at) {
+		int caught = 0;
+
+		try { if (throw_at == 0) throw new Exception (); } catch { caught += 1; }
+		try { if (throw_at == 1) throw new Exception (); } catch { caught += 2; }
+		try { if (throw_at == 2) throw new Exception (); } catch { caught += 3; }
+		try { if (throw_at == 3) throw new Exception (); } catch { caught += 4; }
+		try { if (throw_at == 4) throw new Exception (); } catch { caught += 5; }
+		try { if (throw_at == 5) throw new Exception (); } catch { caught += 6; }
+		try { if (throw_at == 6) throw new Exception (); } catch { caught += 7; }
+		try { if (throw_at == 7) throw new Exception (); } catch { caught += 8; }
+		try { if (throw_at == 8) throw new Exception (); } catch { caught += 9; }
+		try { if (throw_at == 9) throw new Exception (); } catch { caught += 10; }
+		try { if (throw_at == 10) throw new Exception (); } catch { caught += 11; }
+		try { if (throw_at == 11) throw new Exception (); } catch { caught += 12; }
+		try { if (throw_at == 12) throw new Exception (); } catch { caught += 13; }
+		try { if (throw_at == 13) throw new Exception (); } catch { caught += 14; }
+		try { if (throw_at == 14) throw new Exception (); } catch { caught += 15; }
+		try { if (throw_at == 15) throw new Exception (); } catch { caught += 16; }
+		try { if (throw_at == 16) throw new Exception (); } catch { caught += 17; }
+		try { if (throw_at == 17) throw new Exception (); } catch { caught += 18; }
+		try { if (throw_at == 18) throw new Exception (); } catch { caught += 19; }
+		try { if (throw_at == 19) throw new Exception (); } catch { caught += 20; }
+		try { if (throw_at == 20) throw new Exception (); } catch { caught += 21; }
+		try { if (throw_at == 21) throw new Exception (); } catch { caught += 22; }
+		try { if (throw_at == 22) throw new Exception (); } catch { caught += 23; }
+		try { if (throw_at == 23) throw new Exception (); } catch { caught += 24; }
+		try { if (throw_at == 24) throw new Exception (); } catch { caught += 25; }
+		try { if (throw_at == 25) throw new Exception (); } catch { caught += 26; }
+		try { if (throw_at == 26) throw new Exception (); } catch { caught += 27; }
+		try { if (throw_at == 27) throw new Exception (); } catch { caught += 28; }
+		try { if (throw_at == 28) throw new Exception (); } catch { caught += 29; }
+		try { if (throw_at == 29) throw new Exception (); } catch { caught += 30; }
+		try { if (throw_at == 30) throw new Exception (); } catch { caught += 31; }
+		try { if (throw_at == 31) throw new Exception (); } catch { caught += 32; }
+		return caught;
+	}
+
+	static int eh_40_clauses (int throw_at) {
+		int caught = 0;
+
+		try { if (throw_at == 0) throw new Exception (); } catch { caught += 1; }
+		try { if (throw_at == 1) throw new Exception (); } catch { caught += 2; }
+		try { if (throw_at == 2) throw new Exception (); } catch { caught += 3; }
+		try { if (throw_at == 3) throw new Exception (); } catch { caught += 4; }
+		try { if (throw_at == 4) throw new Exception (); } catch { caught += 5; }
+		try { if (throw_at == 5) throw new Exception (); } catch { caught += 6; }
+		try { if (throw_at == 6) throw new Exception (); } catch { caught += 7; }
+		try { if (throw_at == 7) throw new Exception (); } catch { caught += 8; }
+		try { if (throw_at == 8) throw new Exception (); } catch { caught += 9; }
+		try { if (throw_at == 9) throw new Exception (); } catch { caught += 10; }
+		try { if (throw_at == 10) throw new Exception (); } catch { caught += 11; }
+		try { if (throw_at == 11) throw new Exception (); } catch { caught += 12; }
+		try { if (throw_at == 12) throw new Exception (); } catch { caught += 13; }
+		try { if (throw_at == 13) throw new Exception (); } catch { caught += 14; }
+		try { if (throw_at == 14) throw new Exception (); } catch { caught += 15; }
+		try { if (throw_at == 15) throw new Exception (); } catch { caught += 16; }
+		try { if (throw_at == 16) throw new Exception (); } catch { caught += 17; }
+		try { if (throw_at == 17) throw new Exception (); } catch { caught += 18; }
+		try { if (throw_at == 18) throw new Exception (); } catch { caught += 19; }
+		try { if (throw_at == 19) throw new Exception (); } catch { caught += 20; }
+		try { if (throw_at == 20) throw new Exception (); } catch { caught += 21; }
+		try { if (throw_at == 21) throw new Exception (); } catch { caught += 22; }
+		try { if (throw_at == 22) throw new Exception (); } catch { caught += 23; }
+		try { if (throw_at == 23) throw new Exception (); } catch { caught += 24; }
+		try { if (throw_at == 24) throw new Exception (); } catch { caught += 25; }
+		try { if (throw_at == 25) throw new Exception (); } catch { caught += 26; }
+		try { if (throw_at == 26) throw new Exception (); } catch { caught += 27; }
+		try { if (throw_at == 27) throw new Exception (); } catch { caught += 28; }
+		try { if (throw_at == 28) throw new Exception (); } catch { caught += 29; }
+		try { if (throw_at == 29) throw new Exception (); } catch { caught += 30; }
+		try { if (throw_at == 30) throw new Exception (); } catch { caught += 31; }
+		try { if (throw_at == 31) throw new Exception (); } catch { caught += 32; }
+		try { if (throw_at == 32) throw new Exception (); } catch { caught += 33; }
+		try { if (throw_at == 33) throw new Exception (); } catch { caught += 34; }
+		try { if (throw_at == 34) throw new Exception (); } catch { caught += 35; }
+		try { if (throw_at == 35) throw new Exception (); } catch { caught += 36; }
+		try { if (throw_at == 36) throw new Exception (); } catch { caught += 37; }
+		try { if (throw_at == 37) throw new Exception (); } catch { caught += 38; }
+		try { if (throw_at == 38) throw new Exception (); } catch { caught += 39; }
+		try { if (throw_at == 39) throw new Exception (); } catch { caught += 40; }
+		return caught;
+	}
+
+	public static int test_0_many_clauses_repeatedly () {
+		for (int iter = 0; iter < 100; ++iter) {
+			for (int i = 0; i < 32; ++i) {
+				if (eh_32_clauses (i) != i + 1)
+					return 1;
+			}
+			for (int i = 0; i < 40; ++i) {
+				if (eh_40_clauses (i) != i + 1)
+					return 2;
+			}
+			if (eh_40_clauses (-1) != 0)
+				return 3;
+		}
+		return 0;
+	}
 }
 
 #if !MOBILE
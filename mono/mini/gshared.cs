@@ -35,6 +35,19 @@ class GFoo3<T> {
 	}
 }
 
+// More RGCTX slots than fit in the first RGCTX array
+class ManySlots<T> {
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	public static Type[] get_types () {
+		return new Type [] {
+			typeof (T[]), typeof (T[,]), typeof (T[,,]), typeof (T[,,,]), typeof (T[,,,,]),
+			typeof (T[,,,,,]), typeof (T[,,,,,,]), typeof (T[,,,,,,,]), typeof (T[,,,,,,,,]), typeof (T[,,,,,,,,,]),
+			typeof (T[][]), typeof (T[][,]), typeof (T[][,,]), typeof (T[][,,,]), typeof (T[][,,,,]),
+			typeof (T[][,,,,,]), typeof (T[][,,,,,,]), typeof (T[][,,,,,,,]), typeof (T[][,,,,,,,,]), typeof (T[][,,,,,,,,,])
+		};
+	}
+}
+
 //
 // Tests for generic sharing of vtypes.
 // The tests use arrays to pass/receive values to keep the calling convention of the methods stable, which is a current limitation of the runtime support for gsharedvt.
@@ -1439,6 +1452,47 @@ public class Tests
 		return 0;
 	}
 
+	// More MRGCTX slots than fit in the first MRGCTX array
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static Type[] many_method_slots<T> () {
+		return new Type [] {
+			typeof (T[]), typeof (T[,]), typeof (T[,,]), typeof (T[,,,]), typeof (T[,,,,]),
+			typeof (T[][]), typeof (T[][,]), typeof (T[][,,]), typeof (T[][,,,]), typeof (T[][,,,,]),
+			typeof (List<T>), typeof (List<T[]>)
+		};
+	}
+
+	static bool check_slot_types (Type[] types, Type t) {
+		for (int i = 0; i < types.Length; ++i) {
+			Type elem = types [i];
+			while (elem.IsArray || elem.IsGenericType)
+				elem = elem.IsArray ? elem.GetElementType () : elem.GetGenericArguments () [0];
+			if (elem != t)
+				return false;
+		}
+		return true;
+	}
+
+	// The first calls fill the slots, the later ones take the inline fast path, including the slots past the first array
+	public static int test_0_rgctx_many_slots () {
+		for (int i = 0; i < 3; ++i) {
+			Type[] s = ManySlots<string>.get_types ();
+			Type[] o = ManySlots<object>.get_types ();
+			if (s [19] != typeof (string[][,,,,,,,,,]) || o [19] != typeof (object[][,,,,,,,,,]))
+				return 1;
+			if (!check_slot_types (s, typeof (string)) || !check_slot_types (o, typeof (object)))
+				return 2;
+
+			s = many_method_slots<string> ();
+			o = many_method_slots<object> ();
+			if (s [11] != typeof (List<string[]>) || o [11] != typeof (List<object[]>))
+				return 3;
+			if (!check_slot_types (s, typeof (string)) || !check_slot_types (o, typeof (object)))
+				return 4;
+		}
+		return 0;
+	}
+
 	public static int test_0_array_helper_gsharedvt () {
 		var arr = new AnEnum [16];
 		var c = new ReadOnlyCollection<AnEnum> (arr);
@@ -0,0 +1,664 @@
+/*
+ * gvn.c: Global value numbering on the SSA form
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * The bblocks are visited in dominator tree order, keeping a scoped table of
+ * the expressions computed by the dominators of the current bblock. Each vreg
+ * is given a value number, the vreg holding the first computation of its value,
+ * and an instruction whose opcode and operand value numbers are already in the
+ * table is redundant:
+ * - arithmetic which can't fault is replaced by a move from the dominating
+ *   result.
+ * - loads are replaced the same way, if memory can't have been written since
+ *   the dominating load. Memory is assumed to be written by stores, calls and
+ *   any other instruction not known to be side effect free, so this is done
+ *   inside a bblock, and from a dominator if no bblock on the paths in between
+ *   writes memory. Loads of invariant locations like array lengths don't depend
+ *   on memory. Locals whose address is only used to access them were turned
+ *   into vregs by the alias analysis, so only the remaining memory accesses
+ *   are affected, while the accesses of locals whose address escapes are
+ *   treated as memory accesses.
+ * - null checks on a value which was already dereferenced, bounds checks
+ *   repeated on the same array and index, and compare/cond_exc pairs like
+ *   explicit null checks and type checks which were already done are removed.
+ * - class init calls for a class which was already initialized are removed.
+ * Only the results of instructions in the same exception region are reused,
+ * since the dominator tree doesn't take exception edges into account.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mini.h"
+
+#ifndef DISABLE_JIT
+
+/* The number of bblocks scanned to find out whenever memory is preserved along the paths from a dominator */
+#define MAX_SCANNED_BBLOCKS 32
+
+typedef struct {
+	int opcode;
+	int vn1, vn2;
+	gint64 c0, c1;
+	/* The memory version for loads, 0 for instructions which don't read memory */
+	int mem;
+} GvnKey;
+
+typedef struct _GvnEntry GvnEntry;
+struct _GvnEntry {
+	GvnKey key;
+	MonoInst *ins;
+	MonoBasicBlock *bb;
+	/* The entry with the same key in the dominators, restored when leaving the scope */
+	GvnEntry *shadowed;
+};
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	/* Whenever the vreg has multiple definitions or lives in memory */
+	gboolean *variant;
+	MonoInst **def_ins;
+	/*
+	 * Whenever the vreg is passed to a call in a register. The local register
+	 * allocator requires these to die at the call, so they are not reused.
+	 */
+	gboolean *call_arg;
+	/* The value number of each vreg */
+	int *vn;
+	/* Indexed by block_num */
+	gboolean *writes_memory;
+	int *exit_mem;
+	/* The current memory version, and the last allocated one */
+	int mem, last_mem;
+	GHashTable *table;
+	/* The entries added to the table, most recent first */
+	GSList *scope;
+} GvnContext;
+
+enum {
+	KIND_NONE,
+	KIND_CONST,
+	KIND_PURE,
+	KIND_LOAD
+};
+
+static guint
+gvn_key_hash (gconstpointer data)
+{
+	const GvnKey *key = data;
+
+	return (guint)key->opcode ^ ((guint)key->vn1 << 8) ^ ((guint)key->vn2 << 16) ^ (guint)key->c0 ^ (guint)(key->c1 >> 3) ^ ((guint)key->mem << 24);
+}
+
+static gboolean
+gvn_key_equal (gconstpointer a, gconstpointer b)
+{
+	const GvnKey *key1 = a;
+	const GvnKey *key2 = b;
+
+	return key1->opcode == key2->opcode && key1->vn1 == key2->vn1 && key1->vn2 == key2->vn2 &&
+		key1->c0 == key2->c0 && key1->c1 == key2->c1 && key1->mem == key2->mem;
+}
+
+/*
+ * get_vn:
+ *
+ *   Set VN to the value number of VREG. Return FALSE if VREG has no value
+ * number. A missing source register has the value number -1.
+ */
+static gboolean
+get_vn (GvnContext *ctx, int vreg, int *vn)
+{
+	if (vreg == -1) {
+		*vn = -1;
+		return TRUE;
+	}
+	/* Hard registers like the frame pointer */
+	if (vreg < MONO_MAX_IREGS || vreg >= ctx->num_vregs || ctx->variant [vreg])
+		return FALSE;
+	*vn = ctx->vn [vreg];
+	return TRUE;
+}
+
+static gboolean
+is_commutative (int opcode)
+{
+	switch (opcode) {
+	case OP_IADD:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_LADD:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+	case OP_IMULH:
+	case OP_IMULH_UN:
+	case OP_LMULH:
+	case OP_LMULH_UN:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+is_cse_load (MonoInst *ins)
+{
+	if (ins->flags & MONO_INST_VOLATILE)
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_LOAD_MEMBASE:
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+#if SIZEOF_REGISTER == 8
+	case OP_LOADI8_MEMBASE:
+#endif
+	case OP_LDLEN:
+	case OP_STRLEN:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static int
+get_value_kind (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_ICONST:
+	case OP_I8CONST:
+		return KIND_CONST;
+	default:
+		break;
+	}
+
+	if (mini_ins_is_pure (ins))
+		return KIND_PURE;
+	if (is_cse_load (ins))
+		return KIND_LOAD;
+	return KIND_NONE;
+}
+
+static GvnEntry*
+lookup (GvnContext *ctx, MonoBasicBlock *bb, GvnKey *key)
+{
+	GvnEntry *entry = g_hash_table_lookup (ctx->table, key);
+
+	if (entry && entry->bb->region != bb->region)
+		return NULL;
+	return entry;
+}
+
+static void
+add_entry (GvnContext *ctx, MonoBasicBlock *bb, GvnKey *key, MonoInst *ins)
+{
+	GvnEntry *entry = mono_mempool_alloc0 (ctx->cfg->mempool, sizeof (GvnEntry));
+
+	entry->key = *key;
+	entry->ins = ins;
+	entry->bb = bb;
+	entry->shadowed = g_hash_table_lookup (ctx->table, key);
+	g_hash_table_replace (ctx->table, &entry->key, entry);
+	ctx->scope = g_slist_prepend_mempool (ctx->cfg->mempool, ctx->scope, entry);
+}
+
+static void
+remove_check (GvnContext *ctx, MonoBasicBlock *bb, MonoInst *ins)
+{
+	if (ctx->cfg->verbose_level > 2) {
+		printf ("GVN: removing redundant check in BB%d: ", bb->block_num);
+		mono_print_ins (ins);
+	}
+	NULLIFY_INS (ins);
+	mono_jit_stats.gvn_checks_removed++;
+}
+
+static void
+number_value (GvnContext *ctx, MonoBasicBlock *bb, MonoInst *ins)
+{
+	const char *spec = INS_INFO (ins->opcode);
+	GvnEntry *entry;
+	GvnKey key;
+	int kind, dreg = ins->dreg;
+
+	if (dreg < MONO_MAX_IREGS || dreg >= ctx->num_vregs || ctx->variant [dreg] || ctx->def_ins [dreg] != ins)
+		return;
+	if (spec [MONO_INST_DEST] != 'i')
+		return;
+
+	if (ins->opcode == OP_MOVE) {
+		int vn;
+
+		if (get_vn (ctx, ins->sreg1, &vn) && vn != -1)
+			ctx->vn [dreg] = vn;
+		return;
+	}
+
+	kind = get_value_kind (ins);
+	if (kind == KIND_NONE)
+		return;
+
+	memset (&key, 0, sizeof (key));
+	key.opcode = ins->opcode;
+	if (!get_vn (ctx, ins->sreg1, &key.vn1) || !get_vn (ctx, ins->sreg2, &key.vn2))
+		return;
+	if (is_commutative (ins->opcode) && key.vn1 > key.vn2) {
+		int tmp = key.vn1;
+		key.vn1 = key.vn2;
+		key.vn2 = tmp;
+	}
+	key.c0 = ins->data.op [0].const_val;
+	key.c1 = ins->data.op [1].const_val;
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+	if (ins->opcode == OP_X86_LEA)
+		key.c0 = ins->backend.shift_amount;
+#endif
+	if (kind == KIND_LOAD && !(ins->flags & MONO_INST_INVARIANT_LOAD) && ins->opcode != OP_LDLEN && ins->opcode != OP_STRLEN)
+		key.mem = ctx->mem;
+
+	entry = lookup (ctx, bb, &key);
+	if (!entry) {
+		if (!ctx->call_arg [dreg])
+			add_entry (ctx, bb, &key, ins);
+		return;
+	}
+
+	ctx->vn [dreg] = entry->ins->dreg;
+	/* Constants are cheaper to recompute than to keep in a register */
+	if (kind == KIND_CONST)
+		return;
+
+	if (ctx->cfg->verbose_level > 2) {
+		printf ("GVN: replacing in BB%d with R%d: ", bb->block_num, entry->ins->dreg);
+		mono_print_ins (ins);
+	}
+	ins->opcode = OP_MOVE;
+	ins->sreg1 = entry->ins->dreg;
+	ins->sreg2 = -1;
+	ins->flags = 0;
+	if (kind == KIND_LOAD)
+		mono_jit_stats.gvn_loads_removed++;
+	else
+		mono_jit_stats.gvn_removed++;
+}
+
+static void
+add_non_null (GvnContext *ctx, MonoBasicBlock *bb, MonoInst *ins, int vreg)
+{
+	GvnKey key;
+
+	memset (&key, 0, sizeof (key));
+	key.opcode = OP_CHECK_THIS;
+	if (!get_vn (ctx, vreg, &key.vn1) || key.vn1 == -1 || lookup (ctx, bb, &key))
+		return;
+	add_entry (ctx, bb, &key, ins);
+}
+
+/*
+ * is_compare_membase:
+ *
+ *   Return whenever INS compares a memory location with a register. Before the
+ * global vregs are spilled, these only come from the bounds checks emitted by
+ * MONO_ARCH_EMIT_BOUNDS_CHECK, so they read the length of an array or a string.
+ */
+static gboolean
+is_compare_membase (MonoInst *ins)
+{
+	switch (ins->opcode) {
+#if defined(TARGET_X86)
+	case OP_X86_COMPARE_MEMBASE_REG:
+		return TRUE;
+#elif defined(TARGET_AMD64)
+	case OP_AMD64_COMPARE_MEMBASE_REG:
+	case OP_AMD64_ICOMPARE_MEMBASE_REG:
+		return TRUE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * record_non_null:
+ *
+ *   Record the vreg which is known to be non-null after INS executed without
+ * faulting.
+ */
+static void
+record_non_null (GvnContext *ctx, MonoBasicBlock *bb, MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_CHECK_THIS:
+	case OP_NOT_NULL:
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_BOUNDS_CHECK:
+		add_non_null (ctx, bb, ins, ins->sreg1);
+		break;
+	default:
+		if (is_compare_membase (ins)) {
+			add_non_null (ctx, bb, ins, ins->inst_basereg);
+			break;
+		}
+		if (!(ins->flags & MONO_INST_FAULT))
+			break;
+		if (MONO_IS_LOAD_MEMBASE (ins))
+			add_non_null (ctx, bb, ins, ins->inst_basereg);
+		else if (MONO_IS_STORE_MEMBASE (ins))
+			add_non_null (ctx, bb, ins, ins->inst_destbasereg);
+		break;
+	}
+}
+
+/*
+ * remove_redundant_check:
+ *
+ *   Remove INS if it is a check done by a dominating instruction. Return
+ * whenever INS was handled.
+ */
+static gboolean
+remove_redundant_check (GvnContext *ctx, MonoBasicBlock *bb, MonoInst *ins)
+{
+	GvnKey key;
+
+	memset (&key, 0, sizeof (key));
+	key.opcode = ins->opcode;
+
+	if (ins->opcode == OP_CHECK_THIS) {
+		if (get_vn (ctx, ins->sreg1, &key.vn1) && lookup (ctx, bb, &key))
+			remove_check (ctx, bb, ins);
+		return TRUE;
+	}
+
+	if (ins->opcode == OP_BOUNDS_CHECK) {
+		if (!get_vn (ctx, ins->sreg1, &key.vn1) || !get_vn (ctx, ins->sreg2, &key.vn2))
+			return TRUE;
+		key.c1 = ins->inst_imm;
+		if (lookup (ctx, bb, &key))
+			remove_check (ctx, bb, ins);
+		else
+			add_entry (ctx, bb, &key, ins);
+		return TRUE;
+	}
+
+	if (MONO_IS_COND_EXC (ins)) {
+		MonoInst *cmp = ins->prev;
+
+		/* Explicit null checks, type checks etc. */
+		if (!cmp)
+			return TRUE;
+		switch (cmp->opcode) {
+		case OP_COMPARE:
+		case OP_ICOMPARE:
+		case OP_LCOMPARE:
+			break;
+		case OP_COMPARE_IMM:
+		case OP_ICOMPARE_IMM:
+		case OP_LCOMPARE_IMM:
+			key.c1 = cmp->inst_imm;
+			break;
+		default:
+			if (!is_compare_membase (cmp))
+				return TRUE;
+			key.c1 = cmp->inst_offset;
+			break;
+		}
+		key.c0 = cmp->opcode;
+		if (!get_vn (ctx, cmp->sreg1, &key.vn1) || !get_vn (ctx, cmp->sreg2, &key.vn2))
+			return TRUE;
+		if (lookup (ctx, bb, &key)) {
+			NULLIFY_INS (cmp);
+			remove_check (ctx, bb, ins);
+		} else {
+			add_entry (ctx, bb, &key, ins);
+		}
+		return TRUE;
+	}
+
+	if (MONO_IS_CALL (ins) && ((MonoCallInst*)ins)->fptr_is_patch) {
+		MonoCallInst *call = (MonoCallInst*)ins;
+		MonoJumpInfo *ji = (MonoJumpInfo*)call->fptr;
+
+		/* Class init calls */
+		if (ji->type == MONO_PATCH_INFO_CLASS_INIT) {
+			key.c0 = ji->type;
+			key.c1 = (gssize)ji->data.klass;
+		} else if (ji->type == MONO_PATCH_INFO_GENERIC_CLASS_INIT) {
+#ifdef MONO_ARCH_VTABLE_REG
+			GSList *l;
+			int vtable_reg = -1;
+
+			for (l = call->out_ireg_args; l; l = l->next) {
+				guint32 regpair = (guint32)(gssize)(l->data);
+
+				if ((regpair >> 24) == MONO_ARCH_VTABLE_REG)
+					vtable_reg = regpair & 0xffffff;
+			}
+			key.c0 = ji->type;
+			if (vtable_reg == -1 || !get_vn (ctx, vtable_reg, &key.vn1))
+				return TRUE;
+#else
+			return TRUE;
+#endif
+		} else {
+			return TRUE;
+		}
+		if (lookup (ctx, bb, &key))
+			remove_check (ctx, bb, ins);
+		else
+			add_entry (ctx, bb, &key, ins);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * memory_preserved:
+ *
+ *   Return whenever memory can't be written on the paths from the end of the
+ * immediate dominator of BB to the start of BB.
+ */
+static gboolean
+memory_preserved (GvnContext *ctx, MonoBasicBlock *bb)
+{
+	MonoBasicBlock *scanned [MAX_SCANNED_BBLOCKS];
+	MonoBasicBlock *idom = bb->idom;
+	int i, j, k, num_scanned = 0;
+
+	if (!idom)
+		return FALSE;
+
+	/* Collect the bblocks between IDOM and BB, breadth first */
+	for (i = -1; i < num_scanned; ++i) {
+		MonoBasicBlock *cur = i == -1 ? bb : scanned [i];
+
+		if (i != -1) {
+			/* Loops, exception handlers and code not reached from IDOM */
+			if (cur == bb || cur->in_count == 0 || (cur->flags & BB_EXCEPTION_HANDLER))
+				return FALSE;
+			if (ctx->writes_memory [cur->block_num])
+				return FALSE;
+		}
+
+		for (j = 0; j < cur->in_count; ++j) {
+			MonoBasicBlock *pred = cur->in_bb [j];
+
+			if (pred == idom)
+				continue;
+			for (k = 0; k < num_scanned; ++k) {
+				if (scanned [k] == pred)
+					break;
+			}
+			if (k < num_scanned)
+				continue;
+			if (num_scanned == MAX_SCANNED_BBLOCKS)
+				return FALSE;
+			scanned [num_scanned ++] = pred;
+		}
+	}
+	return TRUE;
+}
+
+static void
+gvn_bb (GvnContext *ctx, MonoBasicBlock *bb)
+{
+	GSList *l, *saved_scope = ctx->scope;
+	MonoInst *ins;
+
+	if (memory_preserved (ctx, bb))
+		ctx->mem = ctx->exit_mem [bb->idom->block_num];
+	else
+		ctx->mem = ++ctx->last_mem;
+
+	MONO_BB_FOR_EACH_INS (bb, ins) {
+		if (ins->opcode == OP_NOP || ins->opcode == OP_PHI)
+			continue;
+
+		if (!remove_redundant_check (ctx, bb, ins))
+			number_value (ctx, bb, ins);
+
+		if (ins->opcode == OP_NOP)
+			continue;
+		/* Direct stores to locals whose address was taken change memory too */
+		if (mini_ins_may_write_memory (ins) || (ins->dreg != -1 && vreg_is_volatile (ctx->cfg, ins->dreg) && !MONO_IS_STORE_MEMBASE (ins)))
+			ctx->mem = ++ctx->last_mem;
+		record_non_null (ctx, bb, ins);
+	}
+	ctx->exit_mem [bb->block_num] = ctx->mem;
+
+	for (l = bb->dominated; l; l = l->next)
+		gvn_bb (ctx, l->data);
+
+	/* Leave the scope of BB */
+	while (ctx->scope != saved_scope) {
+		GvnEntry *entry = ctx->scope->data;
+
+		if (entry->shadowed)
+			g_hash_table_replace (ctx->table, &entry->shadowed->key, entry->shadowed);
+		else
+			g_hash_table_remove (ctx->table, &entry->key);
+		ctx->scope = ctx->scope->next;
+	}
+}
+
+static void
+mark_variant (GvnContext *ctx, int vreg)
+{
+	if (vreg < ctx->num_vregs)
+		ctx->variant [vreg] = TRUE;
+}
+
+/*
+ * mono_perform_gvn:
+ *
+ *   Remove redundant computations, loads and checks. This needs the SSA form and
+ * the dominator tree.
+ */
+void
+mono_perform_gvn (MonoCompile *cfg)
+{
+	GvnContext ctx;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int i;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+	if (cfg->gen_seq_points)
+		return;
+	if (!(cfg->comp_done & MONO_COMP_IDOM))
+		mono_compile_dominator_info (cfg, MONO_COMP_DOM | MONO_COMP_IDOM);
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.cfg = cfg;
+	ctx.num_vregs = cfg->next_vreg;
+	ctx.def_ins = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * ctx.num_vregs);
+	ctx.variant = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * ctx.num_vregs);
+	ctx.call_arg = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * ctx.num_vregs);
+	ctx.vn = mono_mempool_alloc (cfg->mempool, sizeof (int) * ctx.num_vregs);
+	ctx.writes_memory = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * cfg->max_block_num);
+	ctx.exit_mem = mono_mempool_alloc0 (cfg->mempool, sizeof (int) * cfg->max_block_num);
+	for (i = 0; i < ctx.num_vregs; ++i)
+		ctx.vn [i] = i;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (mini_ins_may_write_memory (ins) || (ins->dreg != -1 && vreg_is_volatile (cfg, ins->dreg) && !MONO_IS_STORE_MEMBASE (ins)))
+				ctx.writes_memory [bb->block_num] = TRUE;
+
+			if (MONO_IS_CALL (ins)) {
+				MonoCallInst *call = (MonoCallInst*)ins;
+				GSList *l;
+
+				for (l = call->out_ireg_args; l; l = l->next) {
+					int vreg = (guint32)(gssize)(l->data) & 0xffffff;
+
+					if (vreg < ctx.num_vregs)
+						ctx.call_arg [vreg] = TRUE;
+				}
+				for (l = call->out_freg_args; l; l = l->next) {
+					int vreg = (guint32)(gssize)(l->data) & 0xffffff;
+
+					if (vreg < ctx.num_vregs)
+						ctx.call_arg [vreg] = TRUE;
+				}
+			}
+
+			if (spec [MONO_INST_DEST] == ' ' || MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins))
+				continue;
+			if (ins->dreg == -1 || ins->dreg >= ctx.num_vregs)
+				continue;
+			if (ctx.def_ins [ins->dreg])
+				ctx.variant [ins->dreg] = TRUE;
+			ctx.def_ins [ins->dreg] = ins;
+#if SIZEOF_REGISTER == 4
+			if (spec [MONO_INST_DEST] == 'l' && ins->dreg + 2 < ctx.num_vregs) {
+				ctx.variant [ins->dreg + 1] = TRUE;
+				ctx.variant [ins->dreg + 2] = TRUE;
+			}
+#endif
+		}
+	}
+
+	for (i = 0; i < cfg->num_varinfo; ++i) {
+		MonoInst *var = cfg->varinfo [i];
+
+		if (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) {
+			mark_variant (&ctx, var->dreg);
+#if SIZEOF_REGISTER == 4
+			mark_variant (&ctx, var->dreg + 1);
+			mark_variant (&ctx, var->dreg + 2);
+#endif
+		}
+	}
+
+	ctx.table = g_hash_table_new (gvn_key_hash, gvn_key_equal);
+	gvn_bb (&ctx, cfg->bb_entry);
+	g_hash_table_destroy (ctx.table);
+
+	/* The def-use information of replaced instructions is out of date */
+	if (cfg->comp_done & MONO_COMP_SSA_DEF_USE) {
+		cfg->comp_done &= ~MONO_COMP_SSA_DEF_USE;
+		for (i = 0; i < cfg->num_varinfo; i++) {
+			MonoMethodVar *info = MONO_VARINFO (cfg, i);
+			info->def = NULL;
+			info->uses = NULL;
+		}
+	}
+}
+
+#endif /* DISABLE_JIT */
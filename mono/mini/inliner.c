@@ -0,0 +1,462 @@
+/*
+ * inliner.c: Profile guided inlining decisions
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * Without profile data, the inliner only inlines methods whose IL is smaller
+ * than a fixed limit. Profile data consists of execution counts of the call
+ * sites of a method, keyed by their IL offset. It is collected by emitting a
+ * counter increment before the calls which are inlining candidates, in tier 0
+ * code (see tiered.c), or in all the code when the profile is being saved. It
+ * can also be loaded from a file written by a previous run.
+ * Other optimizations can count the executions of parts of a method the same
+ * way, using keys with the upper bits set so they don't clash with the IL
+ * offsets of the call sites, like the cases of the compare chains lowered in
+ * branch-opts.c.
+ * With profile data, hot call sites can inline larger methods, especially
+ * when some of the arguments are constants or the call was devirtualized,
+ * while cold call sites only inline tiny methods. Inlining beyond the default
+ * limit is charged to a per method budget, so code size doesn't explode.
+ *
+ * The inliner is configured using the MONO_INLINER environment variable, a
+ * comma separated list of:
+ * - profile=FILE: load the call counts from FILE.
+ * - save=FILE: collect the call counts and write them to FILE at shutdown.
+ * - trace=FILE: log the inlining decisions made for call sites to FILE.
+ * - hot=N: the call count from which a call site is hot.
+ * - max=N: the IL size limit for hot call sites.
+ * - budget=N: the amount of IL beyond the default limit which can be inlined
+ *   into one method.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mini.h"
+
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-mutex.h>
+
+/* The IL size limit for call sites without profile data */
+#define INLINE_LENGTH_LIMIT 20
+#define DEFAULT_HOT_COUNT 30
+#define DEFAULT_HOT_LIMIT 120
+#define DEFAULT_BUDGET 240
+/* The limit on the IR costs of an inlined method, see inline_method () */
+#define DEFAULT_COST_LIMIT 60
+/* How much larger a method can be for each constant argument */
+#define CONST_ARG_BONUS 10
+/* How much larger a method can be if the call was devirtualized */
+#define DEVIRT_BONUS 20
+
+typedef struct _CallSiteCount CallSiteCount;
+
+struct _CallSiteCount {
+	CallSiteCount *next;
+	guint32 il_offset;
+	gint32 count;
+};
+
+typedef struct {
+	CallSiteCount *sites;
+	/* The method name used in profile files */
+	char *desc;
+} MethodProfile;
+
+static int inline_limit;
+static int hot_count = DEFAULT_HOT_COUNT;
+static int hot_limit = DEFAULT_HOT_LIMIT;
+static int budget = DEFAULT_BUDGET;
+
+/* Maps MonoMethod -> MethodProfile */
+static GHashTable *profiles;
+/* Maps method names -> MethodProfile for the methods in the profile file */
+static GHashTable *loaded_profiles;
+/* All the MethodProfiles, for saving them */
+static GSList *all_profiles;
+/* Marks methods which were looked up in loaded_profiles without success */
+static MethodProfile no_profile;
+static mono_mutex_t profiles_mutex;
+
+static char *save_file;
+static FILE *trace_out;
+static mono_mutex_t trace_mutex;
+
+/* Statistics */
+static gint32 profiled_call_sites, hot_inlines, cold_rejects, budget_rejects;
+
+static MethodProfile*
+method_profile_new (char *desc)
+{
+	MethodProfile *mp = g_new0 (MethodProfile, 1);
+
+	mp->desc = desc;
+	all_profiles = g_slist_prepend (all_profiles, mp);
+	return mp;
+}
+
+static void
+add_site (MethodProfile *mp, guint32 il_offset, gint32 count)
+{
+	CallSiteCount *site = g_new0 (CallSiteCount, 1);
+
+	site->il_offset = il_offset;
+	site->count = count;
+	site->next = mp->sites;
+	mp->sites = site;
+}
+
+/*
+ * Load the call counts written by save_profile (). Each line has the format:
+ * COUNT IL_OFFSET METHOD.
+ */
+static void
+load_profile (const char *filename)
+{
+	FILE *f;
+	char line [4096];
+
+	f = fopen (filename, "r");
+	if (!f) {
+		fprintf (stderr, "Unable to open inliner profile '%s'.\n", filename);
+		return;
+	}
+
+	while (fgets (line, sizeof (line), f)) {
+		MethodProfile *mp;
+		char *p, *end;
+		gint32 count;
+		guint32 il_offset;
+
+		g_strchomp (line);
+		count = strtol (line, &end, 10);
+		if (end == line || strncmp (end, " IL_", 4) != 0)
+			continue;
+		p = end + 4;
+		il_offset = strtoul (p, &end, 16);
+		if (end == p || *end != ' ')
+			continue;
+		p = end + 1;
+
+		mp = g_hash_table_lookup (loaded_profiles, p);
+		if (!mp) {
+			mp = method_profile_new (g_strdup (p));
+			g_hash_table_insert (loaded_profiles, mp->desc, mp);
+		}
+		add_site (mp, il_offset, count);
+	}
+	fclose (f);
+}
+
+static void
+save_profile (void)
+{
+	FILE *f;
+	GSList *l;
+
+	f = fopen (save_file, "w");
+	if (!f) {
+		fprintf (stderr, "Unable to open '%s' for writing.\n", save_file);
+		return;
+	}
+
+	mono_mutex_lock (&profiles_mutex);
+	for (l = all_profiles; l; l = l->next) {
+		MethodProfile *mp = l->data;
+		CallSiteCount *site;
+
+		if (!mp->desc)
+			continue;
+		/* Sites which were never executed are saved too, so they are known to be cold */
+		for (site = mp->sites; site; site = site->next)
+			fprintf (f, "%d IL_%04x %s\n", site->count, site->il_offset, mp->desc);
+	}
+	mono_mutex_unlock (&profiles_mutex);
+
+	fclose (f);
+}
+
+void
+mini_inliner_init (void)
+{
+	const char *env;
+
+	if (g_getenv ("MONO_INLINELIMIT"))
+		inline_limit = atoi (g_getenv ("MONO_INLINELIMIT"));
+	else
+		inline_limit = INLINE_LENGTH_LIMIT;
+
+	mono_mutex_init (&profiles_mutex);
+	profiles = g_hash_table_new (NULL, NULL);
+
+	env = g_getenv ("MONO_INLINER");
+	if (env) {
+		gchar **args, **ptr;
+
+		args = g_strsplit (env, ",", -1);
+		for (ptr = args; ptr && *ptr; ptr++) {
+			const char *arg = *ptr;
+
+			if (strncmp (arg, "profile=", 8) == 0) {
+				if (!loaded_profiles)
+					loaded_profiles = g_hash_table_new (g_str_hash, g_str_equal);
+				load_profile (arg + 8);
+			} else if (strncmp (arg, "save=", 5) == 0) {
+				g_free (save_file);
+				save_file = g_strdup (arg + 5);
+			} else if (strncmp (arg, "trace=", 6) == 0) {
+				if (!trace_out) {
+					trace_out = fopen (arg + 6, "w");
+					if (!trace_out)
+						fprintf (stderr, "Unable to open '%s' for writing.\n", arg + 6);
+					mono_mutex_init (&trace_mutex);
+				}
+			} else if (strncmp (arg, "hot=", 4) == 0) {
+				hot_count = MAX (1, atoi (arg + 4));
+			} else if (strncmp (arg, "max=", 4) == 0) {
+				hot_limit = atoi (arg + 4);
+			} else if (strncmp (arg, "budget=", 7) == 0) {
+				budget = atoi (arg + 7);
+			} else {
+				fprintf (stderr, "MONO_INLINER: unknown option '%s'.\n", arg);
+			}
+		}
+		g_strfreev (args);
+	}
+
+	mono_counters_register ("Inliner profiled call sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &profiled_call_sites);
+	mono_counters_register ("Inliner hot inlines", MONO_COUNTER_JIT | MONO_COUNTER_INT, &hot_inlines);
+	mono_counters_register ("Inliner cold call sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &cold_rejects);
+	mono_counters_register ("Inliner over budget", MONO_COUNTER_JIT | MONO_COUNTER_INT, &budget_rejects);
+}
+
+void
+mini_inliner_cleanup (void)
+{
+	if (save_file)
+		save_profile ();
+	/* Other threads could still be compiling, so the trace file is not closed */
+	if (trace_out)
+		fflush (trace_out);
+}
+
+/*
+ * Return the profile of METHOD, or NULL if there is none. If CREATE is TRUE,
+ * create it if needed.
+ */
+static MethodProfile*
+get_method_profile (MonoMethod *method, gboolean create)
+{
+	MethodProfile *mp;
+	char *desc = NULL;
+
+	mono_mutex_lock (&profiles_mutex);
+	mp = g_hash_table_lookup (profiles, method);
+	mono_mutex_unlock (&profiles_mutex);
+
+	if (mp == &no_profile && !create)
+		return NULL;
+	if (mp && mp != &no_profile)
+		return mp;
+
+	/* This can take the loader lock, so do it outside profiles_mutex */
+	if (loaded_profiles || (create && save_file))
+		desc = mono_method_full_name (method, TRUE);
+
+	mono_mutex_lock (&profiles_mutex);
+	mp = g_hash_table_lookup (profiles, method);
+	if (!mp || mp == &no_profile) {
+		mp = loaded_profiles ? g_hash_table_lookup (loaded_profiles, desc) : NULL;
+		if (!mp && create) {
+			mp = method_profile_new (save_file ? desc : NULL);
+			if (save_file)
+				desc = NULL;
+		}
+		g_hash_table_insert (profiles, method, mp ? mp : &no_profile);
+	}
+	mono_mutex_unlock (&profiles_mutex);
+
+	g_free (desc);
+	return mp;
+}
+
+/*
+ * mini_inliner_instrument:
+ *
+ *   Return whenever the call sites of the method compiled by CFG should count
+ * their executions.
+ */
+gboolean
+mini_inliner_instrument (MonoCompile *cfg)
+{
+	if (!cfg->tier_info && !save_file)
+		return FALSE;
+	/* The counters are referenced by address */
+	if (cfg->compile_aot)
+		return FALSE;
+	return cfg->method->wrapper_type == MONO_WRAPPER_NONE;
+}
+
+/*
+ * mini_inliner_get_call_counter:
+ *
+ *   Return the address of the execution counter of the call site at IL_OFFSET
+ * in METHOD. The counter is never freed.
+ */
+gint32*
+mini_inliner_get_call_counter (MonoMethod *method, guint32 il_offset)
+{
+	MethodProfile *mp = get_method_profile (method, TRUE);
+	CallSiteCount *site;
+
+	mono_mutex_lock (&profiles_mutex);
+	for (site = mp->sites; site; site = site->next) {
+		if (site->il_offset == il_offset)
+			break;
+	}
+	if (!site) {
+		add_site (mp, il_offset, 0);
+		site = mp->sites;
+		++profiled_call_sites;
+	}
+	mono_mutex_unlock (&profiles_mutex);
+
+	return &site->count;
+}
+
+/*
+ * Return the number of times the call site at IL_OFFSET in METHOD was
+ * executed, or -1 if there is no profile data for it. A count of 0 means the
+ * site was profiled but never executed.
+ */
+static gint32
+get_call_count (MonoMethod *method, guint32 il_offset)
+{
+	MethodProfile *mp;
+	CallSiteCount *site;
+	gint32 count = 0;
+
+	/* No profile data at all */
+	if (!all_profiles)
+		return -1;
+
+	mp = get_method_profile (method, FALSE);
+	if (!mp || !mp->sites)
+		return -1;
+
+	mono_mutex_lock (&profiles_mutex);
+	for (site = mp->sites; site; site = site->next) {
+		if (site->il_offset == il_offset) {
+			count = site->count;
+			break;
+		}
+	}
+	mono_mutex_unlock (&profiles_mutex);
+
+	if (!site)
+		return -1;
+	/* The counters are incremented without synchronization, so they can wrap around */
+	return count < 0 ? G_MAXINT32 : count;
+}
+
+/*
+ * mini_inliner_get_site_count:
+ *
+ *   Return the execution count of the site with key IL_OFFSET in METHOD, or -1
+ * if there is no profile data for it. This is used by other optimizations
+ * which count the executions of parts of a method, like
+ * mono_lower_compare_chains ().
+ */
+gint32
+mini_inliner_get_site_count (MonoMethod *method, guint32 il_offset)
+{
+	return get_call_count (method, il_offset);
+}
+
+/*
+ * mini_inliner_check_call_site:
+ *
+ *   Return whenever CALLEE, whose IL is CODE_SIZE bytes long, should be inlined
+ * at the call site at IL_OFFSET in CALLER. CONST_ARGS is the number of constant
+ * arguments, and DEVIRT is TRUE if the call is a devirtualized virtual call.
+ * Sets COST_LIMIT to the limit on the IR costs of the inlined method.
+ */
+gboolean
+mini_inliner_check_call_site (MonoCompile *cfg, MonoMethod *caller, guint32 il_offset, MonoMethod *callee,
+							  int code_size, int const_args, gboolean devirt, int *cost_limit)
+{
+	const char *reason;
+	gboolean res;
+	gint32 count;
+	int limit;
+
+	*cost_limit = DEFAULT_COST_LIMIT;
+
+	if (callee->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING)
+		return TRUE;
+
+	/* The counts of a method which is being profiled are not meaningful yet */
+	count = mini_inliner_instrument (cfg) ? -1 : get_call_count (caller, il_offset);
+	if (count == -1) {
+		/* No profile data, so the same as before */
+		limit = inline_limit;
+		reason = "no profile";
+	} else if (count == 0) {
+		/* Only inline methods which are not larger than the call itself */
+		limit = inline_limit / 2;
+		reason = "cold";
+	} else {
+		if (count >= hot_count) {
+			limit = MAX (hot_limit, inline_limit);
+			reason = "hot";
+		} else {
+			limit = inline_limit;
+			reason = "warm";
+		}
+		limit += const_args * CONST_ARG_BONUS;
+		if (devirt)
+			limit += DEVIRT_BONUS;
+	}
+
+	res = code_size < limit;
+	if (!res && count == 0 && code_size < inline_limit)
+		++cold_rejects;
+
+	if (res && code_size >= inline_limit) {
+		if (cfg->inline_budget_used + code_size > budget) {
+			res = FALSE;
+			reason = "over budget";
+			++budget_rejects;
+		} else {
+			cfg->inline_budget_used += code_size;
+			/* The IR of larger methods is larger too */
+			*cost_limit = DEFAULT_COST_LIMIT * limit / MAX (inline_limit, 1);
+			++hot_inlines;
+		}
+	}
+
+	if (trace_out || cfg->verbose_level > 2) {
+		char *caller_name = mono_method_full_name (caller, TRUE);
+		char *callee_name = mono_method_full_name (callee, TRUE);
+		char *msg = g_strdup_printf ("%s IL_%04x -> %s: size %d, count %d, const args %d%s, limit %d: %s (%s)\n",
+									 caller_name, il_offset, callee_name, code_size, count, const_args,
+									 devirt ? ", devirtualized" : "", limit, res ? "inline" : "don't inline", reason);
+
+		if (cfg->verbose_level > 2)
+			printf ("INLINER: %s", msg);
+		if (trace_out) {
+			mono_mutex_lock (&trace_mutex);
+			fputs (msg, trace_out);
+			mono_mutex_unlock (&trace_mutex);
+		}
+		g_free (msg);
+		g_free (caller_name);
+		g_free (callee_name);
+	}
+
+	return res;
+}
@@ -1086,11 +1086,62 @@ mono_object_castclass_unbox (MonoObject *obj, MonoClass *klass)
 	return NULL;
 }
 
+/*
+ * cast_cache_lookup:
+ *
+ *   Look up OBJ_VTABLE in the secondary entries of CACHE. If found, swap the entry
+ * with the first one, so the next lookup hits inline. Return the entry or 0.
+ * Racing updates can lose entries, but every entry is valid on its own.
+ */
+static gsize
+cast_cache_lookup (MonoCastCache *cache, gsize obj_vtable)
+{
+	int i;
+
+	for (i = 0; i < MONO_CAST_CACHE_SECONDARY_ENTRIES; ++i) {
+		gsize entry = (gsize)cache->secondary [i];
+
+		if ((entry & ~0x1) == obj_vtable) {
+			cache->secondary [i] = cache->cached_vtable;
+			cache->cached_vtable = (gpointer)entry;
+			InterlockedIncrement (&mono_jit_stats.cast_cache_secondary_hits);
+			return entry;
+		}
+	}
+	return 0;
+}
+
+/*
+ * cast_cache_add:
+ *
+ *   Make ENTRY the first entry of CACHE, moving the previous one to the secondary
+ * entries and evicting the oldest of those.
+ */
+static void
+cast_cache_add (MonoCastCache *cache, gsize entry)
+{
+	int i;
+
+	if (cache->cached_vtable) {
+		for (i = MONO_CAST_CACHE_SECONDARY_ENTRIES - 1; i > 0; --i)
+			cache->secondary [i] = cache->secondary [i - 1];
+		cache->secondary [0] = cache->cached_vtable;
+	}
+	cache->cached_vtable = (gpointer)entry;
+}
+
+/*
+ * mono_object_castclass_with_cache:
+ *
+ *   The out-of-line part of a castclass using the cast cache CACHE, which is a
+ * MonoCastCache. Called by JITted code when the first cache entry misses.
+ */
 MonoObject*
 mono_object_castclass_with_cache (MonoObject *obj, MonoClass *klass, gpointer *cache)
 {
 	MonoJitTlsData *jit_tls = NULL;
-	gpointer cached_vtable, obj_vtable;
+	MonoCastCache *cast_cache = (MonoCastCache*)cache;
+	gsize entry, obj_vtable;
 
 	if (mini_get_debug_options ()->better_cast_details) {
 		jit_tls = mono_native_tls_get_value (mono_jit_tls_id);
@@ -1100,14 +1151,20 @@ mono_object_castclass_with_cache (MonoObject *obj, MonoClass *klass, gpointer *c
 	if (!obj)
 		return NULL;
 
-	cached_vtable = *cache;
-	obj_vtable = obj->vtable;
+	obj_vtable = (gsize)obj->vtable;
 
-	if (cached_vtable == obj_vtable)
+	if ((gsize)cast_cache->cached_vtable == obj_vtable)
 		return obj;
 
-	if (mono_object_isinst (obj, klass)) {
-		*cache = obj_vtable;
+	InterlockedIncrement (&mono_jit_stats.cast_cache_inline_misses);
+
+	entry = cast_cache_lookup (cast_cache, obj_vtable);
+	if (entry == obj_vtable)
+		return obj;
+
+	/* A negative entry left by an isinst sharing the cache means the cast fails */
+	if (!entry && mono_object_isinst (obj, klass)) {
+		cast_cache_add (cast_cache, obj_vtable);
 		return obj;
 	}
 
@@ -1122,27 +1179,39 @@ mono_object_castclass_with_cache (MonoObject *obj, MonoClass *klass, gpointer *c
 	return NULL;
 }
 
+/*
+ * mono_object_isinst_with_cache:
+ *
+ *   The out-of-line part of an isinst using the cast cache CACHE, which is a
+ * MonoCastCache. Called by JITted code when the first cache entry misses.
+ */
 MonoObject*
 mono_object_isinst_with_cache (MonoObject *obj, MonoClass *klass, gpointer *cache)
 {
-	size_t cached_vtable, obj_vtable;
+	MonoCastCache *cast_cache = (MonoCastCache*)cache;
+	gsize cached_vtable, entry, obj_vtable;
 
 	if (!obj)
 		return NULL;
 
-	cached_vtable = (size_t)*cache;
-	obj_vtable = (size_t)obj->vtable;
+	cached_vtable = (gsize)cast_cache->cached_vtable;
+	obj_vtable = (gsize)obj->vtable;
 
-	if ((cached_vtable & ~0x1) == obj_vtable) {
+	if ((cached_vtable & ~0x1) == obj_vtable)
 		return (cached_vtable & 0x1) ? NULL : obj;
-	}
+
+	InterlockedIncrement (&mono_jit_stats.cast_cache_inline_misses);
+
+	entry = cast_cache_lookup (cast_cache, obj_vtable);
+	if (entry)
+		return (entry & 0x1) ? NULL : obj;
 
 	if (mono_object_isinst (obj, klass)) {
-		*cache = (gpointer)obj_vtable;
+		cast_cache_add (cast_cache, obj_vtable);
 		return obj;
 	} else {
 		/*negative cache*/
-		*cache = (gpointer)(obj_vtable | 0x1);
+		cast_cache_add (cast_cache, obj_vtable | 0x1);
 		return NULL;
 	}
 }
@@ -1241,3 +1310,127 @@ mono_gsharedvt_value_copy (gpointer dest, gpointer src, MonoClass *klass)
 	else
         mono_gc_wbarrier_generic_store (dest, *(MonoObject**)src);
 }
+
+/* Copied through memcpy with a constant size, which compilers turn into a single unaligned move */
+typedef struct {
+	guint64 lo, hi;
+} JitChunk16;
+
+/*
+ * mono_jit_memcpy:
+ *
+ *   Used for cpblk, array initialization and copies of valuetypes without
+ * references which are too large to unroll. Sizes up to 64 bytes are copied
+ * with a few possibly overlapping moves after loading all of the data, larger
+ * ones go to the C library. Overlapping regions are handled.
+ */
+void
+mono_jit_memcpy (guint8 *dest, const guint8 *src, int size)
+{
+	if (size <= 16) {
+		if (size >= 8) {
+			guint64 head, tail;
+
+			memcpy (&head, src, 8);
+			memcpy (&tail, src + size - 8, 8);
+			memcpy (dest, &head, 8);
+			memcpy (dest + size - 8, &tail, 8);
+		} else if (size >= 4) {
+			guint32 head, tail;
+
+			memcpy (&head, src, 4);
+			memcpy (&tail, src + size - 4, 4);
+			memcpy (dest, &head, 4);
+			memcpy (dest + size - 4, &tail, 4);
+		} else if (size > 0) {
+			guint8 first = src [0], mid = src [size / 2], last = src [size - 1];
+
+			dest [0] = first;
+			dest [size / 2] = mid;
+			dest [size - 1] = last;
+		}
+	} else if (size <= 32) {
+		JitChunk16 head, tail;
+
+		memcpy (&head, src, 16);
+		memcpy (&tail, src + size - 16, 16);
+		memcpy (dest, &head, 16);
+		memcpy (dest + size - 16, &tail, 16);
+	} else if (size <= 64) {
+		JitChunk16 c [4];
+
+		memcpy (&c [0], src, 16);
+		memcpy (&c [1], src + 16, 16);
+		memcpy (&c [2], src + size - 32, 16);
+		memcpy (&c [3], src + size - 16, 16);
+		memcpy (dest, &c [0], 16);
+		memcpy (dest + 16, &c [1], 16);
+		memcpy (dest + size - 32, &c [2], 16);
+		memcpy (dest + size - 16, &c [3], 16);
+	} else {
+		memmove (dest, src, size);
+	}
+}
+
+/*
+ * mono_jit_memset:
+ *
+ *   Used for initblk and for clearing large valuetypes, with the same size
+ * classes as mono_jit_memcpy.
+ */
+void
+mono_jit_memset (guint8 *dest, int val, int size)
+{
+	guint64 v = (guint8)val * 0x0101010101010101ULL;
+
+	if (size <= 16) {
+		if (size >= 8) {
+			memcpy (dest, &v, 8);
+			memcpy (dest + size - 8, &v, 8);
+		} else if (size >= 4) {
+			memcpy (dest, &v, 4);
+			memcpy (dest + size - 4, &v, 4);
+		} else if (size > 0) {
+			dest [0] = val;
+			dest [size / 2] = val;
+			dest [size - 1] = val;
+		}
+	} else if (size <= 64) {
+		JitChunk16 c;
+		int i;
+
+		c.lo = c.hi = v;
+		for (i = 0; i + 16 < size; i += 16)
+			memcpy (dest + i, &c, 16);
+		memcpy (dest + size - 16, &c, 16);
+	} else {
+		memset (dest, val, size);
+	}
+}
+
+/*
+ * mono_fill_class_rgctx:
+ *
+ *   The slow path of an inlined RGCTX fetch, called by JITted code when slot
+ * SLOT of the RGCTX of VTABLE has not been instantiated yet.
+ */
+gpointer
+mono_fill_class_rgctx (MonoVTable *vtable, int slot)
+{
+	InterlockedIncrement (&mono_jit_stats.rgctx_inline_misses);
+
+	return mono_class_fill_runtime_generic_context (vtable, NULL, slot);
+}
+
+/*
+ * mono_fill_method_rgctx:
+ *
+ *   Same as mono_fill_class_rgctx, but for slot SLOT of the MRGCTX MRGCTX.
+ */
+gpointer
+mono_fill_method_rgctx (MonoMethodRuntimeGenericContext *mrgctx, int slot)
+{
+	InterlockedIncrement (&mono_jit_stats.rgctx_inline_misses);
+
+	return mono_method_fill_runtime_generic_context (mrgctx, NULL, slot);
+}
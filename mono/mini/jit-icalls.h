@@ -180,5 +180,13 @@ mono_gsharedvt_constrained_call (gpointer mp, MonoMethod *cmethod, MonoClass *kl
 
 void mono_gsharedvt_value_copy (gpointer dest, gpointer src, MonoClass *klass) MONO_INTERNAL;
 
+void mono_jit_memcpy (guint8 *dest, const guint8 *src, int size) MONO_INTERNAL;
+
+void mono_jit_memset (guint8 *dest, int val, int size) MONO_INTERNAL;
+
+gpointer mono_fill_class_rgctx (MonoVTable *vtable, int slot) MONO_INTERNAL;
+
+gpointer mono_fill_method_rgctx (MonoMethodRuntimeGenericContext *mrgctx, int slot) MONO_INTERNAL;
+
 #endif /* __MONO_JIT_ICALLS_H__ */
 
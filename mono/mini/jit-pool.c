@@ -0,0 +1,356 @@
+/*
+ * jit-pool.c: Parallel precompilation of methods at startup
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * The methods to precompile come either from a list recorded by a previous
+ * run, or from scanning the loaded assemblies (see mono_precompile_assemblies ()).
+ * They are stored in an array which is consumed by a set of compile threads,
+ * each of them claiming the next method with an atomic increment. The
+ * compiled code is published through the normal JIT path, which makes it
+ * visible to the lock-free lookups done by lookup_method () and to the jit
+ * info table, so other threads calling these methods find them already
+ * compiled.
+ * In background mode, the startup thread doesn't wait for the pool, so it
+ * runs concurrently with Main.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mini.h"
+
+#include <mono/metadata/assembly.h>
+#include <mono/metadata/threads-types.h>
+#include <mono/metadata/runtime.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-proclib.h>
+#include <mono/utils/mono-mutex.h>
+#include <mono/utils/atomic.h>
+
+typedef struct {
+	GPtrArray *methods;
+	/* Index of the next method to compile */
+	gint32 next;
+	/* Number of references to the pool, held by the running threads */
+	gint32 active;
+	HANDLE done_event;
+	gboolean background;
+} JitPool;
+
+static int pool_threads;
+static gboolean pool_background;
+static gboolean pool_enabled;
+static char *method_list_file;
+static int verbose_level;
+
+static char *record_file;
+static FILE *record_out;
+static mono_mutex_t record_mutex;
+
+/* Statistics */
+static gint32 precompiled_methods, precompile_failures;
+
+/*
+ * mini_jit_pool_parse_options:
+ *
+ *   Parse the options passed to --jit-pool, a comma separated list of:
+ * - threads=N: the number of compile threads, defaults to the number of cpus.
+ * - list=FILE: precompile the methods recorded in FILE instead of all the
+ *   methods in the loaded assemblies.
+ * - background: don't wait for the precompilation to finish before running Main.
+ * - record=FILE: write the methods compiled during this run to FILE, for use
+ *   with list=FILE.
+ * Return FALSE if OPTIONS is invalid.
+ */
+gboolean
+mini_jit_pool_parse_options (const char *options)
+{
+	gchar **args, **ptr;
+	gboolean res = TRUE, only_record = TRUE;
+
+	pool_enabled = TRUE;
+	if (!options)
+		return TRUE;
+
+	args = g_strsplit (options, ",", -1);
+	for (ptr = args; ptr && *ptr; ptr++) {
+		const char *arg = *ptr;
+
+		if (strncmp (arg, "record=", 7) == 0) {
+			g_free (record_file);
+			record_file = g_strdup (arg + 7);
+			continue;
+		}
+
+		only_record = FALSE;
+		if (strncmp (arg, "threads=", 8) == 0) {
+			pool_threads = atoi (arg + 8);
+			if (pool_threads <= 0)
+				res = FALSE;
+		} else if (strncmp (arg, "list=", 5) == 0) {
+			g_free (method_list_file);
+			method_list_file = g_strdup (arg + 5);
+		} else if (strcmp (arg, "background") == 0) {
+			pool_background = TRUE;
+		} else {
+			res = FALSE;
+		}
+	}
+	g_strfreev (args);
+
+	/* Recording alone doesn't precompile anything */
+	if (record_file && only_record)
+		pool_enabled = FALSE;
+
+	if (record_file) {
+		record_out = fopen (record_file, "w");
+		if (!record_out) {
+			fprintf (stderr, "Unable to open '%s' for writing.\n", record_file);
+			res = FALSE;
+		}
+		mono_mutex_init (&record_mutex);
+	}
+
+	return res;
+}
+
+gboolean
+mini_jit_pool_enabled (void)
+{
+	return pool_enabled;
+}
+
+/*
+ * mini_jit_pool_record_method:
+ *
+ *   Called after METHOD has been compiled. If recording is enabled, append it
+ * to the method list as a "TOKEN ASSEMBLY-NAME" line.
+ */
+void
+mini_jit_pool_record_method (MonoMethod *method)
+{
+	char *aname;
+
+	if (G_LIKELY (!record_out))
+		return;
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->is_inflated || method->dynamic || !method->token)
+		return;
+	if (method->klass->image->dynamic || !method->klass->image->assembly)
+		return;
+
+	aname = mono_stringify_assembly_name (&method->klass->image->assembly->aname);
+	mono_mutex_lock (&record_mutex);
+	fprintf (record_out, "0x%08x %s\n", method->token, aname);
+	fflush (record_out);
+	mono_mutex_unlock (&record_mutex);
+	g_free (aname);
+}
+
+/*
+ * mini_jit_pool_load_method_list:
+ *
+ *   Load the methods recorded in the file passed to --jit-pool=list=FILE.
+ * Return NULL if there is no method list.
+ */
+GPtrArray*
+mini_jit_pool_load_method_list (void)
+{
+	GPtrArray *methods;
+	GHashTable *images;
+	FILE *f;
+	char line [1024];
+
+	if (!method_list_file)
+		return NULL;
+
+	f = fopen (method_list_file, "r");
+	if (!f) {
+		fprintf (stderr, "Unable to open method list '%s', precompiling all methods.\n", method_list_file);
+		return NULL;
+	}
+
+	methods = g_ptr_array_new ();
+	images = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	while (fgets (line, sizeof (line), f)) {
+		MonoImage *image;
+		MonoMethod *method;
+		char *name, *end;
+		guint32 token;
+
+		g_strchomp (line);
+		token = strtoul (line, &end, 16);
+		if (end == line || *end != ' ' || mono_metadata_token_table (token) != MONO_TABLE_METHOD)
+			continue;
+		name = end + 1;
+
+		if (!g_hash_table_lookup_extended (images, name, NULL, (gpointer*)&image)) {
+			MonoAssemblyName aname;
+			MonoAssembly *assembly = NULL;
+			MonoImageOpenStatus status;
+
+			if (mono_assembly_name_parse (name, &aname)) {
+				assembly = mono_assembly_load (&aname, NULL, &status);
+				mono_assembly_name_free (&aname);
+			}
+			image = assembly ? mono_assembly_get_image (assembly) : NULL;
+			g_hash_table_insert (images, g_strdup (name), image);
+		}
+		if (!image || mono_metadata_token_index (token) > mono_image_get_table_rows (image, MONO_TABLE_METHOD))
+			continue;
+
+		method = mono_get_method (image, token, NULL);
+		if (!method) {
+			mono_loader_clear_error ();
+			continue;
+		}
+		if (method->is_generic || method->klass->generic_container)
+			continue;
+		g_ptr_array_add (methods, method);
+	}
+	fclose (f);
+
+	g_hash_table_destroy (images);
+
+	return methods;
+}
+
+static void
+compile_method (MonoMethod *method)
+{
+	MonoException *ex = NULL;
+
+	if (verbose_level > 1) {
+		char *desc = mono_method_full_name (method, TRUE);
+		g_print ("Compiling %s\n", desc);
+		g_free (desc);
+	}
+
+	if (mono_jit_compile_method_jit_only (method, &ex)) {
+		InterlockedIncrement (&precompiled_methods);
+	} else {
+		/* The method will fail again when it is called, so throw the exception then */
+		mono_loader_clear_error ();
+		InterlockedIncrement (&precompile_failures);
+	}
+}
+
+static void
+jit_pool_free (JitPool *pool)
+{
+	g_ptr_array_free (pool->methods, TRUE);
+	CloseHandle (pool->done_event);
+	g_free (pool);
+}
+
+/*
+ * Drop a reference to POOL. The last reference frees it in background mode,
+ * otherwise it wakes up the startup thread.
+ */
+static void
+jit_pool_release (JitPool *pool)
+{
+	if (InterlockedDecrement (&pool->active) == 0) {
+		if (pool->background)
+			jit_pool_free (pool);
+		else
+			SetEvent (pool->done_event);
+	}
+}
+
+static void
+compile_methods (JitPool *pool)
+{
+	MonoInternalThread *thread = mono_thread_internal_current ();
+
+	for (;;) {
+		gint32 index;
+
+		/*
+		 * Exit without going through the abort requested by the shutdown code,
+		 * but let the runtime suspend this thread.
+		 */
+		if (mono_runtime_is_shutting_down ())
+			break;
+		if (thread && (thread->state & (ThreadState_StopRequested | ThreadState_SuspendRequested)))
+			mono_thread_interruption_checkpoint ();
+
+		index = InterlockedIncrement (&pool->next) - 1;
+		if (index >= pool->methods->len)
+			break;
+
+		compile_method (g_ptr_array_index (pool->methods, index));
+	}
+}
+
+static void
+compile_thread (gpointer data)
+{
+	JitPool *pool = data;
+
+	compile_methods (pool);
+	jit_pool_release (pool);
+}
+
+/*
+ * mini_jit_pool_compile:
+ *
+ *   Compile METHODS using the compile threads, and free the array. Unless the
+ * pool runs in the background, the calling thread takes part in the
+ * compilation, and this returns when all the methods have been compiled.
+ */
+void
+mini_jit_pool_compile (GPtrArray *methods, int verbose)
+{
+	JitPool *pool;
+	int i, nthreads;
+
+	mono_counters_register ("Precompiled methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &precompiled_methods);
+	mono_counters_register ("Precompile failures", MONO_COUNTER_JIT | MONO_COUNTER_INT, &precompile_failures);
+
+	verbose_level = verbose;
+	nthreads = pool_threads ? pool_threads : mono_cpu_count ();
+	nthreads = MAX (1, MIN (nthreads, methods->len));
+
+	if (verbose_level > 0)
+		printf ("PRECOMPILE: %d methods using %d thread(s)%s.\n", methods->len, nthreads, pool_background ? " in the background" : "");
+
+	if (nthreads == 1 && !pool_background) {
+		for (i = 0; i < methods->len; ++i)
+			compile_method (g_ptr_array_index (methods, i));
+		g_ptr_array_free (methods, TRUE);
+		return;
+	}
+
+	pool = g_new0 (JitPool, 1);
+	pool->methods = methods;
+	pool->background = pool_background;
+	pool->done_event = CreateEvent (NULL, TRUE, FALSE, NULL);
+	/* The reference held by this thread */
+	pool->active = 1;
+
+	/* In the foreground, this thread is one of the compile threads */
+	if (!pool->background)
+		nthreads--;
+	for (i = 0; i < nthreads; ++i) {
+		InterlockedIncrement (&pool->active);
+		if (!mono_thread_create_internal (mono_domain_get (), compile_thread, pool, TRUE, 0))
+			jit_pool_release (pool);
+	}
+
+	if (pool->background) {
+		jit_pool_release (pool);
+		return;
+	}
+
+	compile_methods (pool);
+	jit_pool_release (pool);
+
+	while (WaitForSingleObjectEx (pool->done_event, INFINITE, TRUE) != WAIT_OBJECT_0)
+		;
+	jit_pool_free (pool);
+}
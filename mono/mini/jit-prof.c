@@ -0,0 +1,360 @@
+/*
+ * jit-prof.c: JIT compilation profiler
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * The JIT profiler records the cost of each JIT compilation: the IL and native
+ * code size, the time spent in each phase of mini_method_compile (), the inlining
+ * decisions made while compiling it, and the trampolines which were patched to
+ * point to its code. It is enabled with --jit-profile=FILE or the MONO_JIT_PROFILE
+ * environment variable, and writes a compact binary file described in jit-prof.h,
+ * which can be summarized with the mprof-jit-report tool.
+ * The phase times and the inlining decisions are also available to embedders
+ * through the profiler API, see mono_profiler_install_jit_phase ().
+ */
+
+#include <config.h>
+#include <stdio.h>
+
+#include "mini.h"
+#include "jit-prof.h"
+
+#include <mono/utils/mono-time.h>
+#include <mono/utils/mono-mutex.h>
+
+#define BUFFER_SIZE (64 * 1024)
+/* The largest record, not counting method names */
+#define MAX_RECORD_SIZE (10 * (8 + MONO_JIT_PHASE_NUM))
+
+gboolean mono_jit_prof_enabled;
+const char *mono_jit_prof_file;
+
+static const char *phase_names [MONO_JIT_PHASE_NUM] = {
+	"ir",
+	"decompose",
+	"cprop",
+	"branch",
+	"deadce",
+	"alias",
+	"if-conv",
+	"vectorize",
+	"loop",
+	"escape",
+	"ssa",
+	"ssa-cprop",
+	"gvn",
+	"licm",
+	"abcrem",
+	"regalloc",
+	"emit",
+	"jit-info"
+};
+
+typedef struct {
+	MonoMethod *callee;
+	int callee_id;
+	gboolean inlined;
+	int cost;
+} JitProfInline;
+
+/* Protects the fields below */
+static mono_mutex_t prof_mutex;
+static FILE *prof_file;
+static guint8 *buffer;
+static int buffer_pos;
+/* Maps MonoMethods to their ids in the file */
+static GHashTable *method_ids;
+static int next_method_id;
+static gint64 start_time;
+
+static void
+flush_buffer (void)
+{
+	if (buffer_pos) {
+		fwrite (buffer, 1, buffer_pos, prof_file);
+		buffer_pos = 0;
+	}
+}
+
+static void
+ensure_space (int size)
+{
+	if (buffer_pos + size > BUFFER_SIZE)
+		flush_buffer ();
+}
+
+static void
+emit_byte (guint8 value)
+{
+	buffer [buffer_pos ++] = value;
+}
+
+static void
+emit_uleb128 (guint64 value)
+{
+	do {
+		guint8 b = value & 0x7f;
+		value >>= 7;
+		if (value != 0)
+			b |= 0x80;
+		buffer [buffer_pos ++] = b;
+	} while (value);
+}
+
+static void
+emit_string (const char *s)
+{
+	int len = strlen (s);
+
+	if (len + 10 > BUFFER_SIZE)
+		len = BUFFER_SIZE - 10;
+	ensure_space (len + 10);
+	emit_uleb128 (len);
+	memcpy (buffer + buffer_pos, s, len);
+	buffer_pos += len;
+}
+
+/*
+ * get_method_id:
+ *
+ *   Return the id of METHOD in the file, emitting a JIT_PROF_METHOD record if
+ * it has none yet. The name of the method is computed outside of prof_mutex,
+ * since it might need to take other runtime locks.
+ */
+static int
+get_method_id (MonoMethod *method)
+{
+	char *name;
+	int id;
+
+	mono_mutex_lock (&prof_mutex);
+	id = GPOINTER_TO_INT (g_hash_table_lookup (method_ids, method));
+	mono_mutex_unlock (&prof_mutex);
+	if (id)
+		return id;
+
+	name = mono_method_full_name (method, TRUE);
+
+	mono_mutex_lock (&prof_mutex);
+	id = GPOINTER_TO_INT (g_hash_table_lookup (method_ids, method));
+	if (!id) {
+		id = ++ next_method_id;
+		/* Dynamic methods can be freed, and their address reused by another method */
+		if (!method->dynamic)
+			g_hash_table_insert (method_ids, method, GINT_TO_POINTER (id));
+		if (mono_jit_prof_enabled) {
+			ensure_space (16);
+			emit_byte (JIT_PROF_METHOD);
+			emit_uleb128 (id);
+			emit_string (name);
+		}
+	}
+	mono_mutex_unlock (&prof_mutex);
+
+	g_free (name);
+	return id;
+}
+
+void
+mini_jit_prof_init (void)
+{
+	const char *fname = mono_jit_prof_file;
+	int i;
+
+	if (!fname)
+		fname = g_getenv ("MONO_JIT_PROFILE");
+	if (!fname || !*fname)
+		return;
+
+	prof_file = fopen (fname, "wb");
+	if (!prof_file) {
+		g_warning ("Unable to open JIT profile file '%s'.", fname);
+		return;
+	}
+
+	mono_mutex_init (&prof_mutex);
+	buffer = g_malloc (BUFFER_SIZE);
+	method_ids = g_hash_table_new (NULL, NULL);
+	start_time = mono_100ns_ticks ();
+
+	ensure_space (8);
+	emit_byte (JIT_PROF_HEADER_ID & 0xff);
+	emit_byte ((JIT_PROF_HEADER_ID >> 8) & 0xff);
+	emit_byte ((JIT_PROF_HEADER_ID >> 16) & 0xff);
+	emit_byte ((JIT_PROF_HEADER_ID >> 24) & 0xff);
+	emit_byte (JIT_PROF_VERSION);
+	emit_uleb128 (MONO_JIT_PHASE_NUM);
+	for (i = 0; i < MONO_JIT_PHASE_NUM; ++i)
+		emit_string (phase_names [i]);
+
+	mono_jit_prof_enabled = TRUE;
+}
+
+void
+mini_jit_prof_cleanup (void)
+{
+	if (!mono_jit_prof_enabled)
+		return;
+
+	mono_mutex_lock (&prof_mutex);
+	mono_jit_prof_enabled = FALSE;
+	flush_buffer ();
+	fclose (prof_file);
+	prof_file = NULL;
+	mono_mutex_unlock (&prof_mutex);
+}
+
+/*
+ * mini_jit_prof_method_begin:
+ *
+ *   Start profiling the compilation described by CFG if either the JIT profiler
+ * or a profiler interested in JIT phases is active.
+ */
+void
+mini_jit_prof_method_begin (MonoCompile *cfg)
+{
+	MonoJitProfInfo *info;
+
+	if (!mono_jit_prof_enabled && !((cfg->prof_options & MONO_PROFILE_JIT_COMPILATION) && mono_profiler_has_jit_phase_callback ()))
+		return;
+
+	info = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoJitProfInfo));
+	info->start = info->last = mono_100ns_ticks ();
+	cfg->jit_prof = info;
+}
+
+void
+mini_jit_prof_phase (MonoCompile *cfg, MonoJitPhase phase)
+{
+	MonoJitProfInfo *info = cfg->jit_prof;
+	gint64 now = mono_100ns_ticks ();
+
+	info->phase_times [phase] += now - info->last;
+	info->last = now;
+}
+
+void
+mini_jit_prof_inline (MonoCompile *cfg, MonoMethod *callee, gboolean inlined, int cost)
+{
+	JitProfInline *entry;
+
+	if (cfg->prof_options & MONO_PROFILE_INLINING)
+		mono_profiler_method_inline (cfg->method, callee, inlined ? MONO_PROFILE_OK : MONO_PROFILE_FAILED);
+
+	if (!cfg->jit_prof || !mono_jit_prof_enabled)
+		return;
+
+	entry = mono_mempool_alloc (cfg->mempool, sizeof (JitProfInline));
+	entry->callee = callee;
+	entry->inlined = inlined;
+	entry->cost = cost;
+	cfg->jit_prof->inlines = g_slist_prepend_mempool (cfg->mempool, cfg->jit_prof->inlines, entry);
+}
+
+/*
+ * mini_jit_prof_method_end:
+ *
+ *   Called after mini_method_compile () returns CFG, whenever it succeeded or not.
+ * Report the collected data to the profiler API and to the profile file.
+ */
+void
+mini_jit_prof_method_end (MonoCompile *cfg)
+{
+	MonoJitProfInfo *info = cfg->jit_prof;
+	GSList *l;
+	int i, id, flags;
+
+	if (!info)
+		return;
+
+	/* Whatever ran after the last phase, like the cleanup of a failed compilation */
+	mini_jit_prof_phase (cfg, MONO_JIT_PHASE_JIT_INFO);
+
+	if ((cfg->prof_options & MONO_PROFILE_JIT_COMPILATION) && mono_profiler_has_jit_phase_callback ()) {
+		for (i = 0; i < MONO_JIT_PHASE_NUM; ++i) {
+			if (info->phase_times [i])
+				mono_profiler_jit_phase (cfg->method, phase_names [i], info->phase_times [i] * 100);
+		}
+	}
+
+	if (!mono_jit_prof_enabled)
+		return;
+
+	flags = 0;
+	if (cfg->exception_type != MONO_EXCEPTION_NONE)
+		flags |= JIT_PROF_COMPILE_FAILED;
+	if (cfg->tier_info)
+		flags |= JIT_PROF_COMPILE_TIER0;
+	if (cfg->generic_sharing_context)
+		flags |= JIT_PROF_COMPILE_GSHARED;
+	if (COMPILE_LLVM (cfg))
+		flags |= JIT_PROF_COMPILE_LLVM;
+
+	id = get_method_id (cfg->method);
+	info->inlines = g_slist_reverse (info->inlines);
+	for (l = info->inlines; l; l = l->next) {
+		JitProfInline *entry = l->data;
+
+		entry->callee_id = get_method_id (entry->callee);
+	}
+
+	mono_mutex_lock (&prof_mutex);
+	if (!mono_jit_prof_enabled) {
+		mono_mutex_unlock (&prof_mutex);
+		return;
+	}
+
+	for (l = info->inlines; l; l = l->next) {
+		JitProfInline *entry = l->data;
+
+		ensure_space (32);
+		emit_byte (JIT_PROF_INLINE);
+		emit_uleb128 (id);
+		emit_uleb128 (entry->callee_id);
+		emit_uleb128 (entry->inlined ? JIT_PROF_INLINE_OK : JIT_PROF_INLINE_ABORTED);
+		emit_uleb128 (MAX (entry->cost, 0));
+	}
+
+	ensure_space (MAX_RECORD_SIZE);
+	emit_byte (JIT_PROF_COMPILE);
+	emit_uleb128 (id);
+	emit_uleb128 (info->start - start_time);
+	emit_uleb128 (flags);
+	emit_uleb128 (cfg->header ? cfg->header->code_size : 0);
+	emit_uleb128 (cfg->code_len);
+	emit_uleb128 (cfg->num_bblocks);
+	emit_uleb128 (cfg->next_vreg);
+	for (i = 0; i < MONO_JIT_PHASE_NUM; ++i)
+		emit_uleb128 (info->phase_times [i]);
+	mono_mutex_unlock (&prof_mutex);
+}
+
+/*
+ * mini_jit_prof_patch:
+ *
+ *   Record that a trampoline patched a call site, vtable slot or PLT entry of
+ * kind KIND to point to the code of METHOD.
+ */
+void
+mini_jit_prof_patch (MonoMethod *method, int kind)
+{
+	int id;
+
+	if (!mono_jit_prof_enabled)
+		return;
+
+	id = get_method_id (method);
+
+	mono_mutex_lock (&prof_mutex);
+	if (!mono_jit_prof_enabled) {
+		mono_mutex_unlock (&prof_mutex);
+		return;
+	}
+	ensure_space (16);
+	emit_byte (JIT_PROF_PATCH);
+	emit_uleb128 (id);
+	emit_uleb128 (kind);
+	mono_mutex_unlock (&prof_mutex);
+}
@@ -0,0 +1,62 @@
+/*
+ * jit-prof.h: Format of the files written by the JIT profiler
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+#ifndef __MONO_MINI_JIT_PROF_H__
+#define __MONO_MINI_JIT_PROF_H__
+
+/*
+ * A JIT profile file starts with a header:
+ * [id: 4 bytes] JIT_PROF_HEADER_ID
+ * [version: 1 byte] JIT_PROF_VERSION
+ * [num_phases: uleb128]
+ * followed by num_phases phase names, each one a [len: uleb128] followed by
+ * len bytes of name (not nul terminated).
+ *
+ * The rest of the file is a sequence of records. All the numbers are uleb128
+ * encoded, times are in 100ns units and methods are referred to by an id
+ * introduced by a JIT_PROF_METHOD record before their first use.
+ *
+ * JIT_PROF_METHOD: [id] [len] [name: len bytes]
+ * JIT_PROF_COMPILE: [method] [time since the start of the profile] [flags]
+ *   [IL size] [native code size] [bblocks] [vregs] [num_phases phase times]
+ * JIT_PROF_INLINE: [caller] [callee] [result] [cost]
+ * JIT_PROF_PATCH: [method] [kind]
+ *
+ * The JIT_PROF_INLINE records of a compilation precede its JIT_PROF_COMPILE record.
+ */
+
+#define JIT_PROF_HEADER_ID 0x4D4A5001
+#define JIT_PROF_VERSION 1
+
+enum {
+	JIT_PROF_METHOD = 1,
+	JIT_PROF_COMPILE = 2,
+	JIT_PROF_INLINE = 3,
+	JIT_PROF_PATCH = 4
+};
+
+/* Flags of JIT_PROF_COMPILE records */
+enum {
+	JIT_PROF_COMPILE_FAILED = 1 << 0,
+	JIT_PROF_COMPILE_TIER0 = 1 << 1,
+	JIT_PROF_COMPILE_GSHARED = 1 << 2,
+	JIT_PROF_COMPILE_LLVM = 1 << 3
+};
+
+/* Results of JIT_PROF_INLINE records */
+enum {
+	JIT_PROF_INLINE_OK = 0,
+	JIT_PROF_INLINE_ABORTED = 1
+};
+
+/* Kinds of JIT_PROF_PATCH records: what was patched to point to the compiled code */
+enum {
+	JIT_PROF_PATCH_CALLSITE = 0,
+	JIT_PROF_PATCH_VTABLE_SLOT = 1,
+	JIT_PROF_PATCH_PLT = 2
+};
+
+#endif /* __MONO_MINI_JIT_PROF_H__ */
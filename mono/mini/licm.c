@@ -0,0 +1,638 @@
+/*
+ * licm.c: Loop invariant code motion on the SSA form
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * Instructions computing the same value in every iteration of a loop are moved
+ * to the end of the bblock preceeding the loop header (the preheader). This is
+ * done for:
+ * - arithmetic which can't fault, from any bblock of the loop.
+ * - OP_LDLEN/OP_STRLEN, since the length of arrays and strings can't change.
+ *   They can fault, so they are only moved out of the loop header, and only if
+ *   no instruction with side effects precedes them.
+ * - loads, if the loop doesn't write memory, with the same restriction as above.
+ *   Loads from constant addresses like static fields, or from objects which were
+ *   already loaded from by a hoisted load, can't fault, so they are moved from
+ *   any bblock of the loop.
+ * Loads in the loop which read the same location as a hoisted load are replaced
+ * by a move from its result, so abcremoval knows they are the same array.
+ * Constants used by hoisted instructions are recomputed in the preheader instead
+ * of being moved, since they are cheaper to rematerialize than to keep in a
+ * register across the loop.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mini.h"
+
+#ifndef DISABLE_JIT
+
+typedef struct {
+	MonoCompile *cfg;
+	int num_vregs;
+	/* The instruction defining each vreg and its bblock, NULL for arguments */
+	MonoInst **def_ins;
+	MonoBasicBlock **def_bb;
+	/* Whenever the vreg has multiple definitions or lives in memory */
+	gboolean *variant;
+	/* Whenever each bblock belongs to the current loop, indexed by block_num */
+	gboolean *in_loop;
+	MonoBasicBlock *preheader;
+	/* Whenever loads can be moved out of the current loop */
+	gboolean hoist_loads;
+	/* The loads moved out of the current loop */
+	GSList *hoisted_loads;
+} LicmContext;
+
+typedef struct {
+	MonoInst *load;
+	/* The base register of the load before it was moved */
+	int base_reg;
+} HoistedLoad;
+
+/*
+ * mini_ins_is_pure:
+ *
+ *   Return whenever INS computes its result from its source registers only,
+ * without side effects and without faulting.
+ */
+gboolean
+mini_ins_is_pure (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_MOVE:
+	case OP_IADD:
+	case OP_ISUB:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_ISHL:
+	case OP_ISHR:
+	case OP_ISHR_UN:
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+	case OP_IMUL_IMM:
+	case OP_IAND_IMM:
+	case OP_IOR_IMM:
+	case OP_IXOR_IMM:
+	case OP_ISHL_IMM:
+	case OP_ISHR_IMM:
+	case OP_ISHR_UN_IMM:
+	case OP_ADD_IMM:
+	case OP_SUB_IMM:
+	case OP_SEXT_I4:
+	case OP_ZEXT_I4:
+	case OP_ICONV_TO_I1:
+	case OP_ICONV_TO_U1:
+	case OP_ICONV_TO_I2:
+	case OP_ICONV_TO_U2:
+#if SIZEOF_REGISTER == 8
+	case OP_LADD:
+	case OP_LSUB:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+	case OP_LSHL:
+	case OP_LSHR:
+	case OP_LSHR_UN:
+	case OP_LADD_IMM:
+	case OP_LSUB_IMM:
+	case OP_LMUL_IMM:
+	case OP_LAND_IMM:
+	case OP_LOR_IMM:
+	case OP_LXOR_IMM:
+	case OP_LSHL_IMM:
+	case OP_LSHR_IMM:
+	case OP_LSHR_UN_IMM:
+#endif
+#if defined(TARGET_X86) || defined(TARGET_AMD64)
+	case OP_X86_LEA:
+	case OP_X86_LEA_MEMBASE:
+#endif
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+is_hoistable_load (MonoInst *ins)
+{
+	if (ins->flags & MONO_INST_VOLATILE)
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_LOAD_MEMBASE:
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+#if SIZEOF_REGISTER == 8
+	case OP_LOADI8_MEMBASE:
+#endif
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * mini_ins_may_write_memory:
+ *
+ *   Return whenever INS might change the value of a memory location read by a
+ * load, or might have other side effects besides throwing an exception.
+ */
+gboolean
+mini_ins_may_write_memory (MonoInst *ins)
+{
+	if (MONO_INS_HAS_NO_SIDE_EFFECT (ins) || mini_ins_is_pure (ins))
+		return FALSE;
+	if (MONO_IS_LOAD_MEMBASE (ins))
+		return (ins->flags & MONO_INST_VOLATILE) != 0;
+	if (MONO_IS_BRANCH_OP (ins) || MONO_IS_COND_EXC (ins))
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_COMPARE:
+	case OP_ICOMPARE:
+	case OP_LCOMPARE:
+	case OP_FCOMPARE:
+	case OP_COMPARE_IMM:
+	case OP_ICOMPARE_IMM:
+	case OP_LCOMPARE_IMM:
+	case OP_CEQ:
+	case OP_CGT:
+	case OP_CGT_UN:
+	case OP_CLT:
+	case OP_CLT_UN:
+	case OP_ICEQ:
+	case OP_ICGT:
+	case OP_ICGT_UN:
+	case OP_ICLT:
+	case OP_ICLT_UN:
+	case OP_LCEQ:
+	case OP_LCGT:
+	case OP_LCGT_UN:
+	case OP_LCLT:
+	case OP_LCLT_UN:
+	case OP_FCEQ:
+	case OP_FCGT:
+	case OP_FCGT_UN:
+	case OP_FCLT:
+	case OP_FCLT_UN:
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_BOUNDS_CHECK:
+	case OP_CHECK_THIS:
+	case OP_SEQ_POINT:
+	case OP_DUMMY_USE:
+	case OP_R4CONST:
+	case OP_IDIV:
+	case OP_IDIV_UN:
+	case OP_IREM:
+	case OP_IREM_UN:
+	case OP_IDIV_IMM:
+	case OP_IREM_IMM:
+	case OP_FADD:
+	case OP_FSUB:
+	case OP_FMUL:
+	case OP_FDIV:
+	case OP_FNEG:
+	case OP_ICONV_TO_R8:
+	case OP_FCONV_TO_I4:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+static gboolean
+is_invariant (LicmContext *ctx, int vreg)
+{
+	MonoBasicBlock *bb;
+
+	if (vreg >= ctx->num_vregs || ctx->variant [vreg])
+		return FALSE;
+	bb = ctx->def_bb [vreg];
+	return !bb || !ctx->in_loop [bb->block_num];
+}
+
+/*
+ * is_loop_constant:
+ *
+ *   Return whenever VREG is set to a constant inside the loop, so its definition
+ * can be repeated in the preheader.
+ */
+static gboolean
+is_loop_constant (LicmContext *ctx, int vreg)
+{
+	MonoInst *def;
+
+	if (vreg >= ctx->num_vregs || ctx->variant [vreg])
+		return FALSE;
+	def = ctx->def_ins [vreg];
+	return def && (def->opcode == OP_ICONST || def->opcode == OP_I8CONST);
+}
+
+static gboolean
+has_invariant_sregs (LicmContext *ctx, MonoInst *ins)
+{
+	int sregs [MONO_MAX_SRC_REGS];
+	int i, num_sregs;
+
+	num_sregs = mono_inst_get_src_registers (ins, sregs);
+	for (i = 0; i < num_sregs; ++i) {
+		if (!is_invariant (ctx, sregs [i]) && !is_loop_constant (ctx, sregs [i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * get_constant_vreg_value:
+ *
+ *   Return whenever VREG is set to a constant anywhere in the method, storing
+ * the constant into VALUE.
+ */
+static gboolean
+get_constant_vreg_value (LicmContext *ctx, int vreg, gint64 *value)
+{
+	MonoInst *def;
+
+	if (vreg >= ctx->num_vregs || ctx->variant [vreg] || !ctx->def_ins [vreg])
+		return FALSE;
+	def = ctx->def_ins [vreg];
+	if (def->opcode == OP_ICONST) {
+		*value = def->inst_c0;
+		return TRUE;
+	} else if (def->opcode == OP_I8CONST) {
+		*value = def->inst_l;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Follow the moves starting from VREG, and return the vreg they copy.
+ */
+static int
+get_copied_vreg (LicmContext *ctx, int vreg)
+{
+	while (vreg < ctx->num_vregs && !ctx->variant [vreg] && ctx->def_ins [vreg] && ctx->def_ins [vreg]->opcode == OP_MOVE)
+		vreg = ctx->def_ins [vreg]->sreg1;
+	return vreg;
+}
+
+static gboolean
+vregs_are_equal (LicmContext *ctx, int vreg1, int vreg2)
+{
+	gint64 c1, c2;
+
+	vreg1 = get_copied_vreg (ctx, vreg1);
+	vreg2 = get_copied_vreg (ctx, vreg2);
+	if (vreg1 == vreg2)
+		return TRUE;
+	return get_constant_vreg_value (ctx, vreg1, &c1) && get_constant_vreg_value (ctx, vreg2, &c2) && c1 == c2;
+}
+
+/*
+ * find_hoisted_load:
+ *
+ *   Return a load moved out of the loop which reads the same location as LOAD.
+ */
+static MonoInst*
+find_hoisted_load (LicmContext *ctx, MonoInst *load)
+{
+	GSList *l;
+
+	for (l = ctx->hoisted_loads; l; l = l->next) {
+		HoistedLoad *hoisted = l->data;
+		MonoInst *ins = hoisted->load;
+
+		if (ins->opcode == load->opcode && ins->inst_offset == load->inst_offset && vregs_are_equal (ctx, hoisted->base_reg, load->sreg1))
+			return ins;
+	}
+	return NULL;
+}
+
+/*
+ * is_dereferenced_base:
+ *
+ *   Return whenever a load from BASE_REG was moved out of the loop, so other loads
+ * from the same object can't fault either.
+ */
+static gboolean
+is_dereferenced_base (LicmContext *ctx, int base_reg)
+{
+	GSList *l;
+
+	for (l = ctx->hoisted_loads; l; l = l->next) {
+		HoistedLoad *hoisted = l->data;
+
+		if (vregs_are_equal (ctx, hoisted->base_reg, base_reg))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+hoist_ins (LicmContext *ctx, MonoBasicBlock *bb, MonoInst *ins)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *preheader = ctx->preheader;
+	int sregs [MONO_MAX_SRC_REGS];
+	int i, num_sregs;
+
+	if (cfg->verbose_level > 2) {
+		printf ("LICM: moving from BB%d to BB%d: ", bb->block_num, preheader->block_num);
+		mono_print_ins (ins);
+	}
+
+	MONO_REMOVE_INS (bb, ins);
+
+	num_sregs = mono_inst_get_src_registers (ins, sregs);
+	for (i = 0; i < num_sregs; ++i) {
+		MonoInst *def, *cins;
+
+		if (is_invariant (ctx, sregs [i]))
+			continue;
+
+		/* Recompute the constant in the preheader */
+		def = ctx->def_ins [sregs [i]];
+		cins = mono_mempool_alloc (cfg->mempool, sizeof (MonoInst));
+		memcpy (cins, def, sizeof (MonoInst));
+		cins->prev = cins->next = NULL;
+		cins->dreg = mono_alloc_ireg_copy (cfg, def->dreg);
+		mono_bblock_insert_before_ins (preheader, preheader->last_ins, cins);
+		sregs [i] = cins->dreg;
+	}
+	mono_inst_set_src_registers (ins, sregs);
+
+	mono_bblock_insert_before_ins (preheader, preheader->last_ins, ins);
+	ctx->def_bb [ins->dreg] = preheader;
+	if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN)
+		preheader->has_array_access = TRUE;
+
+	mono_jit_stats.licm_hoisted++;
+}
+
+/*
+ * try_hoist_ins:
+ *
+ *   Try to move INS out of the loop, or to replace it by a move if it loads the
+ * same value as a hoisted load. CAN_FAULT determines whenever INS can be moved
+ * if it can throw an exception. Return whenever INS was moved or replaced.
+ */
+static gboolean
+try_hoist_ins (LicmContext *ctx, MonoBasicBlock *bb, MonoInst *ins, gboolean can_fault)
+{
+	MonoInst *load;
+	HoistedLoad *hoisted;
+	gint64 addr;
+
+	if (ins->dreg == -1 || ins->dreg >= ctx->num_vregs || ctx->variant [ins->dreg] || ctx->def_ins [ins->dreg] != ins)
+		return FALSE;
+
+	if (mini_ins_is_pure (ins)) {
+		if (!has_invariant_sregs (ctx, ins))
+			return FALSE;
+		hoist_ins (ctx, bb, ins);
+		return TRUE;
+	}
+
+	if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN) {
+		if (!can_fault || !has_invariant_sregs (ctx, ins))
+			return FALSE;
+		hoist_ins (ctx, bb, ins);
+		return TRUE;
+	}
+
+	if (!ctx->hoist_loads || !is_hoistable_load (ins) || !has_invariant_sregs (ctx, ins))
+		return FALSE;
+
+	load = find_hoisted_load (ctx, ins);
+	if (load) {
+		if (ctx->cfg->verbose_level > 2) {
+			printf ("LICM: replacing load in BB%d with R%d: ", bb->block_num, load->dreg);
+			mono_print_ins (ins);
+		}
+		ins->opcode = OP_MOVE;
+		ins->sreg1 = load->dreg;
+		ins->inst_offset = 0;
+		mono_jit_stats.licm_loads_removed++;
+		return TRUE;
+	}
+
+	/* Loads from a constant address like a static field can't fault */
+	if (!can_fault && !(get_constant_vreg_value (ctx, ins->sreg1, &addr) && addr != 0) && !is_dereferenced_base (ctx, ins->sreg1))
+		return FALSE;
+
+	hoisted = mono_mempool_alloc (ctx->cfg->mempool, sizeof (HoistedLoad));
+	hoisted->load = ins;
+	hoisted->base_reg = ins->sreg1;
+	ctx->hoisted_loads = g_slist_prepend_mempool (ctx->cfg->mempool, ctx->hoisted_loads, hoisted);
+	hoist_ins (ctx, bb, ins);
+	return TRUE;
+}
+
+static int
+compare_bb_dfn (const void *a, const void *b)
+{
+	MonoBasicBlock *bb1 = *(MonoBasicBlock**)a;
+	MonoBasicBlock *bb2 = *(MonoBasicBlock**)b;
+
+	return bb1->dfn - bb2->dfn;
+}
+
+static void
+licm_loop (LicmContext *ctx, MonoBasicBlock *h)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *preheader, **blocks;
+	MonoInst *ins, *n;
+	GList *l;
+	gboolean writes_memory = FALSE, has_array_access = FALSE;
+	int i, num_blocks;
+
+	/* The preheader always branches to the loop, so hoisted faulting instructions run only if the loop would run them */
+	preheader = h->idom;
+	if (!(preheader && preheader->last_ins && preheader->last_ins->opcode == OP_BR && preheader->last_ins->inst_target_bb == h))
+		return;
+	/* Moving instructions between exception regions would change which handlers see their exceptions */
+	if (preheader->region != h->region)
+		return;
+
+	num_blocks = g_list_length (h->loop_blocks);
+	blocks = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * num_blocks);
+	for (l = h->loop_blocks, i = 0; l; l = l->next, ++i) {
+		MonoBasicBlock *bb = l->data;
+
+		blocks [i] = bb;
+		if (bb->region != h->region)
+			return;
+		if (bb->has_array_access)
+			has_array_access = TRUE;
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			if (mini_ins_may_write_memory (ins))
+				writes_memory = TRUE;
+		}
+	}
+	/* Definitions dominate their uses, so process the blocks in dominator order */
+	qsort (blocks, num_blocks, sizeof (MonoBasicBlock*), compare_bb_dfn);
+
+	for (i = 0; i < num_blocks; ++i)
+		ctx->in_loop [blocks [i]->block_num] = TRUE;
+	ctx->preheader = preheader;
+	ctx->hoisted_loads = NULL;
+	/*
+	 * Only hoist loads out of loops which work on arrays. Other loops without
+	 * side effects are usually polling a field written by another thread, even
+	 * if it is not marked volatile.
+	 */
+	ctx->hoist_loads = !writes_memory && has_array_access && num_blocks > 1;
+
+	for (i = 0; i < num_blocks; ++i) {
+		MonoBasicBlock *bb = blocks [i];
+		gboolean side_effects = FALSE;
+
+		MONO_BB_FOR_EACH_INS_SAFE (bb, n, ins) {
+			if (try_hoist_ins (ctx, bb, ins, bb == h && !side_effects))
+				continue;
+			if (!MONO_INS_HAS_NO_SIDE_EFFECT (ins) && !mini_ins_is_pure (ins))
+				side_effects = TRUE;
+		}
+	}
+
+	for (i = 0; i < num_blocks; ++i)
+		ctx->in_loop [blocks [i]->block_num] = FALSE;
+}
+
+static void
+mark_variant (LicmContext *ctx, int vreg)
+{
+	if (vreg < ctx->num_vregs)
+		ctx->variant [vreg] = TRUE;
+}
+
+static int
+compare_loop_nesting (const void *a, const void *b)
+{
+	MonoBasicBlock *h1 = *(MonoBasicBlock**)a;
+	MonoBasicBlock *h2 = *(MonoBasicBlock**)b;
+
+	/* Inner loops first, so their invariants can be moved out of the outer loops too */
+	if (h1->nesting != h2->nesting)
+		return h2->nesting - h1->nesting;
+	return h1->dfn - h2->dfn;
+}
+
+/*
+ * mono_perform_licm:
+ *
+ *   Move loop invariant instructions out of loops. This needs the SSA form and
+ * the loop information computed by mono_compute_natural_loops ().
+ */
+void
+mono_perform_licm (MonoCompile *cfg)
+{
+	LicmContext ctx;
+	MonoBasicBlock *bb, **headers;
+	MonoInst *ins;
+	int i, num_headers;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+	if (!(cfg->comp_done & MONO_COMP_LOOPS) || cfg->gen_seq_points)
+		return;
+
+	num_headers = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (bb->loop_blocks && bb->loop_blocks->data == bb)
+			num_headers ++;
+	}
+	if (!num_headers)
+		return;
+	headers = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * num_headers);
+	num_headers = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (bb->loop_blocks && bb->loop_blocks->data == bb)
+			headers [num_headers ++] = bb;
+	}
+	qsort (headers, num_headers, sizeof (MonoBasicBlock*), compare_loop_nesting);
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.cfg = cfg;
+	ctx.num_vregs = cfg->next_vreg;
+	ctx.def_ins = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * ctx.num_vregs);
+	ctx.def_bb = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * ctx.num_vregs);
+	ctx.variant = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * ctx.num_vregs);
+	ctx.in_loop = mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * cfg->max_block_num);
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MONO_BB_FOR_EACH_INS (bb, ins) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (MONO_IS_CALL (ins)) {
+				MonoCallInst *call = (MonoCallInst*)ins;
+				GSList *l;
+
+				/* The argument registers have to be set right before the call */
+				for (l = call->out_ireg_args; l; l = l->next)
+					mark_variant (&ctx, (guint32)(gssize)(l->data) & 0xffffff);
+				for (l = call->out_freg_args; l; l = l->next)
+					mark_variant (&ctx, (guint32)(gssize)(l->data) & 0xffffff);
+			}
+
+			if (spec [MONO_INST_DEST] == ' ' || MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins))
+				continue;
+			if (ins->dreg == -1 || ins->dreg >= ctx.num_vregs)
+				continue;
+			if (ctx.def_ins [ins->dreg])
+				ctx.variant [ins->dreg] = TRUE;
+			ctx.def_ins [ins->dreg] = ins;
+			ctx.def_bb [ins->dreg] = bb;
+#if SIZEOF_REGISTER == 4
+			if (spec [MONO_INST_DEST] == 'l' && ins->dreg + 2 < ctx.num_vregs) {
+				ctx.variant [ins->dreg + 1] = TRUE;
+				ctx.variant [ins->dreg + 2] = TRUE;
+			}
+#endif
+		}
+	}
+
+	for (i = 0; i < cfg->num_varinfo; ++i) {
+		MonoInst *var = cfg->varinfo [i];
+
+		if (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) {
+			ctx.variant [var->dreg] = TRUE;
+#if SIZEOF_REGISTER == 4
+			if (var->dreg + 2 < ctx.num_vregs) {
+				ctx.variant [var->dreg + 1] = TRUE;
+				ctx.variant [var->dreg + 2] = TRUE;
+			}
+#endif
+		}
+	}
+
+	for (i = 0; i < num_headers; ++i)
+		licm_loop (&ctx, headers [i]);
+
+	/* The def-use information of moved instructions is out of date */
+	if (cfg->comp_done & MONO_COMP_SSA_DEF_USE) {
+		cfg->comp_done &= ~MONO_COMP_SSA_DEF_USE;
+		for (i = 0; i < cfg->num_varinfo; i++) {
+			MonoMethodVar *info = MONO_VARINFO (cfg, i);
+			info->def = NULL;
+			info->uses = NULL;
+		}
+	}
+}
+
+#endif /* DISABLE_JIT */
@@ -70,7 +70,6 @@
 #include "debugger-agent.h"
 
 #define BRANCH_COST 10
-#define INLINE_LENGTH_LIMIT 20
 #define INLINE_FAILURE(msg) do {									\
 	if ((cfg->method != method) && (method->wrapper_type == MONO_WRAPPER_NONE)) { \
 		if (cfg->verbose_level >= 2)									\
@@ -1876,6 +1875,84 @@ mini_emit_memcpy (MonoCompile *cfg, int destreg, int doffset, int srcreg, int so
 	}
 }
 
+/*
+ * Copies and clears of up to this many bytes are unrolled into 16 byte vector moves,
+ * larger ones go to mono_jit_memcpy/mono_jit_memset.
+ */
+#define MAX_INLINE_VECTOR_COPY 128
+
+static gboolean
+can_emit_vector_moves (MonoCompile *cfg, int size)
+{
+#if defined(MONO_ARCH_SIMD_INTRINSICS) && (defined(TARGET_X86) || defined(TARGET_AMD64))
+	return (cfg->opt & MONO_OPT_SIMD) && !COMPILE_LLVM (cfg) && size >= 16 && size <= MAX_INLINE_VECTOR_COPY;
+#else
+	return FALSE;
+#endif
+}
+
+/*
+ * emit_vector_memcpy:
+ *
+ *   Same as mini_emit_memcpy, but using unaligned 16 byte moves. The data must not
+ * contain object references: the GC doesn't scan the xmm registers, so an object could
+ * move while its address is held in one.
+ */
+static gboolean
+emit_vector_memcpy (MonoCompile *cfg, int destreg, int doffset, int srcreg, int soffset, int size)
+{
+	int xreg, tail_reg = -1;
+	int tail_offset = size - 16;
+
+	if (!can_emit_vector_moves (cfg, size))
+		return FALSE;
+
+	/*
+	 * A tail of less than 16 bytes is copied by a move which overlaps the previous one.
+	 * Load it first, so it doesn't see the other stores if the source overlaps the destination.
+	 */
+	if (size % 16) {
+		tail_reg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADX_MEMBASE, tail_reg, srcreg, soffset + tail_offset);
+	}
+	while (size >= 16) {
+		xreg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADX_MEMBASE, xreg, srcreg, soffset);
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREX_MEMBASE, destreg, doffset, xreg);
+		doffset += 16;
+		soffset += 16;
+		size -= 16;
+	}
+	if (tail_reg != -1)
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREX_MEMBASE, destreg, doffset + size - 16, tail_reg);
+	return TRUE;
+}
+
+/*
+ * emit_vector_memset:
+ *
+ *   Clear SIZE bytes at DESTREG + OFFSET using 16 byte stores.
+ */
+static gboolean
+emit_vector_memset (MonoCompile *cfg, int destreg, int offset, int size)
+{
+	int xreg;
+
+	if (!can_emit_vector_moves (cfg, size))
+		return FALSE;
+
+	xreg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_UNALU (cfg, OP_XZERO, xreg, -1);
+	while (size >= 16) {
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREX_MEMBASE, destreg, offset, xreg);
+		offset += 16;
+		size -= 16;
+	}
+	if (size)
+		MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREX_MEMBASE, destreg, offset + size - 16, xreg);
+	return TRUE;
+}
+
 static void
 emit_tls_set (MonoCompile *cfg, int sreg1, int tls_key)
 {
@@ -1992,6 +2069,45 @@ emit_pop_lmf (MonoCompile *cfg)
 	}
 }
 
+/*
+ * emit_tier0_call_count:
+ *
+ *   Emit IR to count a call made to tier 0 code, continuing at NEXT_BB:
+ * if (info->count > 0 && --info->count == 0)
+ *     mono_tiered_queue_tier_up (info)
+ * The decrement is not atomic, losing a few counts only delays the tier-up,
+ * and the icall makes sure the method is only queued once. The counter is not
+ * written anymore once it reaches 0, so the code keeps running cheaply until
+ * the callers are patched to the tier 1 code.
+ */
+static void
+emit_tier0_call_count (MonoCompile *cfg, MonoBasicBlock *next_bb)
+{
+	MonoBasicBlock *tier_up_bb;
+	MonoInst *iargs [1];
+	int addr_reg, count_reg, dec_reg;
+
+	NEW_BBLOCK (cfg, tier_up_bb);
+
+	addr_reg = alloc_preg (cfg);
+	count_reg = alloc_ireg (cfg);
+	dec_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, &cfg->tier_info->count);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, count_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBLE, next_bb);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, dec_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, dec_reg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, dec_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBNE_UN, next_bb);
+
+	MONO_START_BB (cfg, tier_up_bb);
+	EMIT_NEW_PCONST (cfg, iargs [0], cfg->tier_info);
+	mono_emit_jit_icall (cfg, mono_tiered_queue_tier_up, iargs);
+
+	MONO_START_BB (cfg, next_bb);
+}
+
 static int
 ret_type_to_call_opcode (MonoType *type, int calli, int virt, MonoGenericSharingContext *gsctx)
 {
@@ -2893,8 +3009,52 @@ create_write_barrier_bitmap (MonoCompile *cfg, MonoClass *klass, unsigned *wb_bi
 	}
 }
 
+/*
+ * mini_emit_card_mark:
+ *
+ *   Emit code to mark the card containing the address in PTR_REG. The card
+ * table must exist.
+ */
+void
+mini_emit_card_mark (MonoCompile *cfg, int ptr_reg)
+{
+	int card_table_shift_bits;
+	gpointer card_table_mask;
+	guint8 *card_table;
+	int offset_reg = alloc_preg (cfg);
+	int card_reg  = alloc_preg (cfg);
+	MonoInst *ins;
+
+	card_table = mono_gc_get_card_table (&card_table_shift_bits, &card_table_mask);
+	g_assert (card_table);
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHR_UN_IMM, offset_reg, ptr_reg, card_table_shift_bits);
+	if (card_table_mask)
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PAND_IMM, offset_reg, offset_reg, card_table_mask);
+
+	/*We can't use PADD_IMM since the cardtable might end up in high addresses and amd64 doesn't support
+	 * IMM's larger than 32bits.
+	 */
+	if (cfg->compile_aot) {
+		MONO_EMIT_NEW_AOTCONST (cfg, card_reg, NULL, MONO_PATCH_INFO_GC_CARD_TABLE_ADDR);
+	} else {
+		MONO_INST_NEW (cfg, ins, OP_PCONST);
+		ins->inst_p0 = card_table;
+		ins->dreg = card_reg;
+		MONO_ADD_INS (cfg->cbb, ins);
+	}
+
+	MONO_EMIT_NEW_BIALU (cfg, OP_PADD, offset_reg, offset_reg, card_reg);
+	MONO_EMIT_NEW_STORE_MEMBASE_IMM (cfg, OP_STOREI1_MEMBASE_IMM, offset_reg, 0, 1);
+}
+
+/*
+ * expand_write_barrier:
+ *
+ *   Emit the write barrier for the store of VALUE to the address PTR.
+ */
 static void
-emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
+expand_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 {
 	int card_table_shift_bits;
 	gpointer card_table_mask;
@@ -2904,9 +3064,6 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 	size_t nursery_size;
 	gboolean has_card_table_wb = FALSE;
 
-	if (!cfg->gen_write_barriers)
-		return;
-
 	card_table = mono_gc_get_card_table (&card_table_shift_bits, &card_table_mask);
 
 	mono_gc_get_nursery (&nursery_shift_bits, &nursery_size);
@@ -2923,28 +3080,7 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 		wbarrier->sreg2 = value->dreg;
 		MONO_ADD_INS (cfg->cbb, wbarrier);
 	} else if (card_table) {
-		int offset_reg = alloc_preg (cfg);
-		int card_reg  = alloc_preg (cfg);
-		MonoInst *ins;
-
-		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHR_UN_IMM, offset_reg, ptr->dreg, card_table_shift_bits);
-		if (card_table_mask)
-			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PAND_IMM, offset_reg, offset_reg, card_table_mask);
-
-		/*We can't use PADD_IMM since the cardtable might end up in high addresses and amd64 doesn't support
-		 * IMM's larger than 32bits.
-		 */
-		if (cfg->compile_aot) {
-			MONO_EMIT_NEW_AOTCONST (cfg, card_reg, NULL, MONO_PATCH_INFO_GC_CARD_TABLE_ADDR);
-		} else {
-			MONO_INST_NEW (cfg, ins, OP_PCONST);
-			ins->inst_p0 = card_table;
-			ins->dreg = card_reg;
-			MONO_ADD_INS (cfg->cbb, ins);
-		}
-
-		MONO_EMIT_NEW_BIALU (cfg, OP_PADD, offset_reg, offset_reg, card_reg);
-		MONO_EMIT_NEW_STORE_MEMBASE_IMM (cfg, OP_STOREI1_MEMBASE_IMM, offset_reg, 0, 1);
+		mini_emit_card_mark (cfg, ptr->dreg);
 	} else {
 		MonoMethod *write_barrier = mono_gc_get_write_barrier ();
 		mono_emit_method_call (cfg, write_barrier, &ptr, NULL);
@@ -2953,6 +3089,27 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 	EMIT_NEW_DUMMY_USE (cfg, dummy_use, value);
 }
 
+static void
+emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
+{
+	MonoInst *wbarrier;
+
+	if (!cfg->gen_write_barriers)
+		return;
+
+	if (cfg->wbarriers_lowered) {
+		expand_write_barrier (cfg, ptr, value);
+		return;
+	}
+
+	/* Expanded by mono_lower_write_barriers () after the redundant ones are removed */
+	MONO_INST_NEW (cfg, wbarrier, OP_WBARRIER);
+	wbarrier->sreg1 = ptr->dreg;
+	wbarrier->sreg2 = value->dreg;
+	MONO_ADD_INS (cfg->cbb, wbarrier);
+	cfg->flags |= MONO_CFG_HAS_WBARRIERS;
+}
+
 static gboolean
 mono_emit_wb_aware_memcpy (MonoCompile *cfg, MonoClass *klass, MonoInst *iargs[4], int size, int align)
 {
@@ -3109,9 +3266,17 @@ mini_emit_stobj (MonoCompile *cfg, MonoInst *dest, MonoInst *src, MonoClass *kla
 		}
 	}
 
-	if (!size_ins && (cfg->opt & MONO_OPT_INTRINS) && n <= sizeof (gpointer) * 5) {
+	if (!size_ins && (cfg->opt & MONO_OPT_INTRINS) && (native || !klass->has_references) &&
+		emit_vector_memcpy (cfg, dest->dreg, 0, src->dreg, 0, n)) {
+		/* Done */
+	} else if (!size_ins && (cfg->opt & MONO_OPT_INTRINS) && n <= sizeof (gpointer) * 5) {
 		/* FIXME: Optimize the case when src/dest is OP_LDADDR */
 		mini_emit_memcpy (cfg, dest->dreg, 0, src->dreg, 0, n, align);
+	} else if (!size_ins && (native || !klass->has_references)) {
+		iargs [0] = dest;
+		iargs [1] = src;
+		EMIT_NEW_ICONST (cfg, iargs [2], n);
+		mono_emit_jit_icall (cfg, mono_jit_memcpy, iargs);
 	} else {
 		iargs [0] = dest;
 		iargs [1] = src;
@@ -3128,25 +3293,12 @@ mini_emit_stobj (MonoCompile *cfg, MonoInst *dest, MonoInst *src, MonoClass *kla
 	}
 }
 
-static MonoMethod*
-get_memset_method (void)
-{
-	static MonoMethod *memset_method = NULL;
-	if (!memset_method) {
-		memset_method = mono_class_get_method_from_name (mono_defaults.string_class, "memset", 3);
-		if (!memset_method)
-			g_error ("Old corlib found. Install a new one");
-	}
-	return memset_method;
-}
-
 void
 mini_emit_initobj (MonoCompile *cfg, MonoInst *dest, const guchar *ip, MonoClass *klass)
 {
 	MonoInst *iargs [3];
 	int n, context_used;
 	guint32 align;
-	MonoMethod *memset_method;
 	MonoInst *size_ins = NULL;
 	MonoInst *bzero_ins = NULL;
 	static MonoMethod *bzero_method;
@@ -3169,15 +3321,16 @@ mini_emit_initobj (MonoCompile *cfg, MonoInst *dest, const guchar *ip, MonoClass
 
 	n = mono_class_value_size (klass, &align);
 
-	if (n <= sizeof (gpointer) * 5) {
+	if (emit_vector_memset (cfg, dest->dreg, 0, n)) {
+		/* Done */
+	} else if (n <= sizeof (gpointer) * 5) {
 		mini_emit_memset (cfg, dest->dreg, 0, n, 0, align);
-	}
-	else {
-		memset_method = get_memset_method ();
+	} else {
+		/* Storing nulls needs no write barriers */
 		iargs [0] = dest;
 		EMIT_NEW_ICONST (cfg, iargs [1], 0);
 		EMIT_NEW_ICONST (cfg, iargs [2], n);
-		mono_emit_method_call (cfg, memset_method, iargs, NULL);
+		mono_emit_jit_icall (cfg, mono_jit_memset, iargs);
 	}
 }
 
@@ -3245,9 +3398,49 @@ mono_patch_info_rgctx_entry_new (MonoMemPool *mp, MonoMethod *method, gboolean i
 	return res;
 }
 
+/*
+ * can_inline_rgctx_fetch:
+ *
+ *   Return whether the lookup of ENTRY can be done inline instead of calling a lazy fetch
+ * trampoline. This requires the slot to be known at JIT time, and the data it holds
+ * to be instantiable without knowing the caller's address.
+ */
+static gboolean
+can_inline_rgctx_fetch (MonoCompile *cfg, MonoJumpInfoRgctxEntry *entry)
+{
+	if (cfg->compile_aot || COMPILE_LLVM (cfg) || cfg->gsharedvt)
+		return FALSE;
+
+	switch (entry->data->type) {
+	case MONO_PATCH_INFO_CLASS:
+	case MONO_PATCH_INFO_METHOD:
+	case MONO_PATCH_INFO_METHODCONST:
+	case MONO_PATCH_INFO_FIELD:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 static inline MonoInst*
 emit_rgctx_fetch (MonoCompile *cfg, MonoInst *rgctx, MonoJumpInfoRgctxEntry *entry)
 {
+	if (can_inline_rgctx_fetch (cfg, entry)) {
+		MonoInst *ins;
+
+		/* Decomposed into the actual lookup by mono_decompose_rgctx_fetch () */
+		MONO_INST_NEW (cfg, ins, OP_RGCTX_FETCH);
+		ins->dreg = alloc_preg (cfg);
+		ins->sreg1 = rgctx->dreg;
+		ins->inst_p0 = entry;
+		ins->type = STACK_PTR;
+		MONO_ADD_INS (cfg->cbb, ins);
+
+		cfg->flags |= MONO_CFG_HAS_RGCTX_FETCH;
+		mono_jit_stats.rgctx_fetches_inlined ++;
+		return ins;
+	}
+
 	return mono_emit_abs_call (cfg, MONO_PATCH_INFO_RGCTX_FETCH, entry, helper_sig_rgctx_lazy_fetch_trampoline, &rgctx);
 }
 
@@ -3780,6 +3973,8 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 	} else {
 		MonoVTable *vtable = mono_class_vtable (cfg->domain, klass);
 		MonoMethod *managed_alloc = NULL;
+		MonoInst *alloc;
+		MonoAllocSite *site;
 		gboolean pass_lw;
 
 		if (!vtable) {
@@ -3794,18 +3989,28 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 
 		if (managed_alloc) {
 			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
-			return mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
-		}
-		alloc_ftn = mono_class_get_allocation_ftn (vtable, for_box, &pass_lw);
-		if (pass_lw) {
-			guint32 lw = vtable->klass->instance_size;
-			lw = ((lw + (sizeof (gpointer) - 1)) & ~(sizeof (gpointer) - 1)) / sizeof (gpointer);
-			EMIT_NEW_ICONST (cfg, iargs [0], lw);
-			EMIT_NEW_VTABLECONST (cfg, iargs [1], vtable);
-		}
-		else {
-			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
+			alloc = mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
+		} else {
+			alloc_ftn = mono_class_get_allocation_ftn (vtable, for_box, &pass_lw);
+			if (pass_lw) {
+				guint32 lw = vtable->klass->instance_size;
+				lw = ((lw + (sizeof (gpointer) - 1)) & ~(sizeof (gpointer) - 1)) / sizeof (gpointer);
+				EMIT_NEW_ICONST (cfg, iargs [0], lw);
+				EMIT_NEW_VTABLECONST (cfg, iargs [1], vtable);
+			}
+			else {
+				EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
+			}
+			alloc = mono_emit_jit_icall (cfg, alloc_ftn, iargs);
 		}
+
+		/* Used by escape analysis and write barrier elimination */
+		site = mono_mempool_alloc0 (cfg->mempool, sizeof (MonoAllocSite));
+		site->ins = alloc;
+		site->klass = klass;
+		site->vtable = vtable;
+		cfg->alloc_sites = g_slist_prepend_mempool (cfg->mempool, cfg->alloc_sites, site);
+		return alloc;
 	}
 
 	return mono_emit_jit_icall (cfg, alloc_ftn, iargs);
@@ -3963,6 +4168,62 @@ mini_class_has_reference_variant_generic_argument (MonoCompile *cfg, MonoClass *
 // FIXME: This doesn't work yet (class libs tests fail?)
 #define is_complex_isinst(klass) (TRUE || (klass->flags & TYPE_ATTRIBUTE_INTERFACE) || klass->rank || mono_class_is_nullable (klass) || mono_class_is_marshalbyref (klass) || (klass->flags & TYPE_ATTRIBUTE_SEALED) || klass->byval_arg.type == MONO_TYPE_VAR || klass->byval_arg.type == MONO_TYPE_MVAR)
 
+/*
+ * emit_cast_with_cache:
+ *
+ *   Emit a castclass/isinst of ARGS [0] to the class ARGS [1] using the cast cache
+ * ARGS [2]. The first entry of the cache is checked inline, the out-of-line icall is
+ * only made when it misses. Returns an instruction holding the result.
+ */
+static MonoInst*
+emit_cast_with_cache (MonoCompile *cfg, MonoClass *klass, MonoInst **args, gboolean isinst)
+{
+	MonoInst *ins, *call;
+	MonoBasicBlock *miss_bb, *end_bb;
+	int obj_reg = args [0]->dreg;
+	int vtable_reg = alloc_preg (cfg);
+	int cached_reg = alloc_preg (cfg);
+	int res_reg = alloc_ireg_ref (cfg);
+
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	/* A null object and an inline hit both return the object */
+	EMIT_NEW_UNALU (cfg, ins, OP_MOVE, res_reg, obj_reg);
+	ins->type = STACK_OBJ;
+	ins->klass = klass;
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, obj_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, end_bb);
+
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, vtable_reg, obj_reg, G_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, cached_reg, args [2]->dreg, G_STRUCT_OFFSET (MonoCastCache, cached_vtable));
+	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, cached_reg, vtable_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, end_bb);
+
+	if (isinst) {
+		/* Negative entries are the vtable with the low bit set */
+		int neg_reg = alloc_preg (cfg);
+
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PADD_IMM, neg_reg, vtable_reg, 1);
+		MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, cached_reg, neg_reg);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, miss_bb);
+		MONO_EMIT_NEW_PCONST (cfg, res_reg, NULL);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+	}
+
+	MONO_START_BB (cfg, miss_bb);
+	if (isinst)
+		call = mono_emit_jit_icall (cfg, mono_object_isinst_with_cache, args);
+	else
+		call = mono_emit_jit_icall (cfg, mono_object_castclass_with_cache, args);
+	MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, res_reg, call->dreg);
+
+	MONO_START_BB (cfg, end_bb);
+
+	return ins;
+}
+
 /*
  * Returns NULL and set the cfg exception on error.
  */
@@ -3978,7 +4239,6 @@ handle_castclass (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context
 		MonoInst *args [3];
 
 		if(mini_class_has_reference_variant_generic_argument (cfg, klass, context_used) || is_complex_isinst (klass)) {
-			MonoMethod *mono_castclass = mono_marshal_get_castclass_with_cache ();
 			MonoInst *cache_ins;
 
 			cache_ins = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_CAST_CACHE);
@@ -3986,13 +4246,13 @@ handle_castclass (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context
 			/* obj */
 			args [0] = src;
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass */
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, G_STRUCT_OFFSET (MonoCastCache, klass));
 
 			/* cache */
 			args [2] = cache_ins;
 
-			return mono_emit_method_call (cfg, mono_castclass, args, NULL);
+			return emit_cast_with_cache (cfg, klass, args, FALSE);
 		}
 
 		klass_inst = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_KLASS);
@@ -4058,7 +4318,6 @@ handle_isinst (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context_us
 		MonoInst *args [3];
 
 		if(mini_class_has_reference_variant_generic_argument (cfg, klass, context_used) || is_complex_isinst (klass)) {
-			MonoMethod *mono_isinst = mono_marshal_get_isinst_with_cache ();
 			MonoInst *cache_ins;
 
 			cache_ins = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_CAST_CACHE);
@@ -4066,13 +4325,13 @@ handle_isinst (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context_us
 			/* obj */
 			args [0] = src;
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass */
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, G_STRUCT_OFFSET (MonoCastCache, klass));
 
 			/* cache */
 			args [2] = cache_ins;
 
-			return mono_emit_method_call (cfg, mono_isinst, args, NULL);
+			return emit_cast_with_cache (cfg, klass, args, TRUE);
 		}
 
 		klass_inst = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_KLASS);
@@ -4522,11 +4781,16 @@ mono_emit_load_got_addr (MonoCompile *cfg)
 	MONO_ADD_INS (cfg->bb_exit, dummy_use);
 }
 
-static int inline_limit;
-static gboolean inline_limit_inited;
-
+/*
+ * mono_method_check_inlining:
+ *
+ *   Return whenever METHOD can be inlined at the call site at IL_OFFSET in
+ * CALLER. CONST_ARGS and DEVIRT describe the call, see
+ * mini_inliner_check_call_site (). COST_LIMIT is set to the IR cost limit to
+ * pass to inline_method ().
+ */
 static gboolean
-mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
+mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method, MonoMethod *caller, guint32 il_offset, int const_args, gboolean devirt, int *cost_limit)
 {
 	MonoMethodHeaderSummary header;
 	MonoVTable *vtable;
@@ -4535,6 +4799,8 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 	int i;
 #endif
 
+	*cost_limit = 0;
+
 	if (cfg->generic_sharing_context)
 		return FALSE;
 
@@ -4561,14 +4827,7 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 
 	/* also consider num_locals? */
 	/* Do the size check early to avoid creating vtables */
-	if (!inline_limit_inited) {
-		if (g_getenv ("MONO_INLINELIMIT"))
-			inline_limit = atoi (g_getenv ("MONO_INLINELIMIT"));
-		else
-			inline_limit = INLINE_LENGTH_LIMIT;
-		inline_limit_inited = TRUE;
-	}
-	if (header.code_size >= inline_limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
+	if (!mini_inliner_check_call_site (cfg, caller, il_offset, method, header.code_size, const_args, devirt, cost_limit))
 		return FALSE;
 
 	/*
@@ -4585,6 +4844,8 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 				return FALSE;
 			if (cfg->compile_aot && mono_class_needs_cctor_run (method->klass, NULL))
 				return FALSE;
+			if (cfg->defer_cctors && !vtable->initialized && mono_class_needs_cctor_run (method->klass, NULL))
+				return FALSE;
 			mono_runtime_class_init (vtable);
 		} else if (method->klass->flags & TYPE_ATTRIBUTE_BEFORE_FIELD_INIT) {
 			if (cfg->run_cctors && method->klass->has_cctor) {
@@ -4643,6 +4904,90 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 	return TRUE;
 }
 
+/*
+ * Return the number of constant arguments among the arguments of a call
+ * with signature FSIG.
+ */
+static int
+count_const_args (MonoMethodSignature *fsig, MonoInst **sp)
+{
+	int i, count = 0;
+
+	for (i = 0; i < fsig->param_count + fsig->hasthis; ++i) {
+		switch (sp [i]->opcode) {
+		case OP_ICONST:
+		case OP_I8CONST:
+		case OP_R4CONST:
+		case OP_R8CONST:
+			count++;
+			break;
+		default:
+			break;
+		}
+	}
+	return count;
+}
+
+/*
+ * Emit code to count the executions of the call site at IL_OFFSET in METHOD,
+ * for use by the inliner.
+ */
+static void
+emit_call_site_counter (MonoCompile *cfg, MonoMethod *method, guint32 il_offset)
+{
+	gint32 *counter = mini_inliner_get_call_counter (method, il_offset);
+	int addr_reg = alloc_preg (cfg);
+	int count_reg = alloc_ireg (cfg);
+	int inc_reg = alloc_ireg (cfg);
+
+	/* This is racy, but the counts only need to be approximate */
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, counter);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, inc_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, inc_reg);
+}
+
+/*
+ * emit_pic_feedback:
+ *
+ *   Emit code to record the class of THIS_INS, the receiver of the virtual call
+ * to CMETHOD at IL_OFFSET, in the inline cache of the call site. See pic.c.
+ */
+static void
+emit_pic_feedback (MonoCompile *cfg, MonoMethod *method, guint32 il_offset, MonoMethod *cmethod, MonoInst *this_ins)
+{
+	MonoPicSite *site = mini_pic_get_site (method, il_offset, cmethod);
+	MonoBasicBlock *miss_bb, *end_bb;
+	MonoInst *iargs [2];
+	int site_reg = alloc_preg (cfg);
+	int vtable_reg = alloc_preg (cfg);
+	int cached_reg = alloc_preg (cfg);
+	int count_reg = alloc_ireg (cfg);
+	int inc_reg = alloc_ireg (cfg);
+
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, this_ins->dreg, G_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_PCONST (cfg, site_reg, site);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, cached_reg, site_reg, G_STRUCT_OFFSET (MonoPicSite, vtables));
+	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, vtable_reg, cached_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, miss_bb);
+
+	/* Hit, this is racy like the call site counters */
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, site_reg, G_STRUCT_OFFSET (MonoPicSite, hits));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, inc_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, site_reg, G_STRUCT_OFFSET (MonoPicSite, hits), inc_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	MONO_START_BB (cfg, miss_bb);
+	EMIT_NEW_UNALU (cfg, iargs [0], OP_MOVE, alloc_preg (cfg), site_reg);
+	EMIT_NEW_UNALU (cfg, iargs [1], OP_MOVE, alloc_preg (cfg), vtable_reg);
+	mono_emit_jit_icall (cfg, mono_pic_record_miss, iargs);
+
+	MONO_START_BB (cfg, end_bb);
+}
+
 static gboolean
 mini_field_access_needs_cctor_run (MonoCompile *cfg, MonoMethod *method, MonoClass *klass, MonoVTable *vtable)
 {
@@ -4653,7 +4998,8 @@ mini_field_access_needs_cctor_run (MonoCompile *cfg, MonoMethod *method, MonoCla
 	}
 
 	if (klass->flags & TYPE_ATTRIBUTE_BEFORE_FIELD_INIT) {
-		if (cfg->method == method)
+		/* The cctor is run while JITting the method, unless it is deferred to the first call */
+		if (cfg->method == method && !cfg->defer_cctors)
 			return FALSE;
 	}
 
@@ -5104,6 +5450,14 @@ mini_emit_inst_for_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 		runtime_helpers_class = mono_class_from_name (mono_defaults.corlib,
 			"System.Runtime.CompilerServices", "RuntimeHelpers");
 
+#ifdef MONO_ARCH_STRING_SIMD
+	if (cfg->opt & MONO_OPT_SIMD) {
+		ins = mono_emit_string_simd_intrinsics (cfg, cmethod, fsig, args);
+		if (ins)
+			return ins;
+	}
+#endif
+
 	if (cmethod->klass == mono_defaults.string_class) {
 		if (strcmp (cmethod->name, "get_Chars") == 0) {
 			int dreg = alloc_ireg (cfg);
@@ -5713,8 +6067,8 @@ check_inline_caller_method_name_limit (MonoMethod *caller_method)
 }
 #endif
 
-static void
-emit_init_rvar (MonoCompile *cfg, int dreg, MonoType *rtype)
+void
+mini_emit_init_rvar (MonoCompile *cfg, int dreg, MonoType *rtype)
 {
 	static double r8_0 = 0.0;
 	MonoInst *ins;
@@ -5752,16 +6106,22 @@ emit_init_local (MonoCompile *cfg, int local, MonoType *type)
 	if (COMPILE_SOFT_FLOAT (cfg)) {
 		MonoInst *store;
 		int reg = alloc_dreg (cfg, var->type);
-		emit_init_rvar (cfg, reg, type);
+		mini_emit_init_rvar (cfg, reg, type);
 		EMIT_NEW_LOCSTORE (cfg, store, local, cfg->cbb->last_ins);
 	} else {
-		emit_init_rvar (cfg, var->dreg, type);
+		mini_emit_init_rvar (cfg, var->dreg, type);
 	}
 }
 
+/*
+ * inline_method:
+ *
+ *   COST_LIMIT is the limit on the IR costs of CMETHOD set by
+ * mono_method_check_inlining (), or 0 to use the default.
+ */
 static int
 inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **sp,
-		guchar *ip, guint real_offset, GList *dont_inline, gboolean inline_always)
+		guchar *ip, guint real_offset, GList *dont_inline, gboolean inline_always, int cost_limit)
 {
 	MonoInst *ins, *rvar = NULL;
 	MonoMethodHeader *cheader;
@@ -5782,6 +6142,9 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 
 	g_assert (cfg->exception_type == MONO_EXCEPTION_NONE);
 
+	if (!cost_limit)
+		cost_limit = 60;
+
 #if (MONO_INLINE_CALLED_LIMITED_METHODS)
 	if ((! inline_always) && ! check_inline_called_method_name_limit (cmethod))
 		return 0;
@@ -5876,11 +6239,13 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	cfg->ret_var_set = prev_ret_var_set;
 	cfg->inline_depth --;
 
-	if ((costs >= 0 && costs < 60) || inline_always) {
+	if ((costs >= 0 && costs < cost_limit) || inline_always) {
 		if (cfg->verbose_level > 2)
 			printf ("INLINE END %s -> %s\n", mono_method_full_name (cfg->method, TRUE), mono_method_full_name (cmethod, TRUE));
 		
 		cfg->stat_inlined_methods++;
+		if (cfg->jit_prof || (cfg->prof_options & MONO_PROFILE_INLINING))
+			mini_jit_prof_inline (cfg, cmethod, TRUE, costs);
 
 		/* always add some code to avoid block split failures */
 		MONO_INST_NEW (cfg, ins, OP_NOP);
@@ -5920,7 +6285,7 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 					if (bb->last_ins && bb->last_ins->opcode == OP_NOT_REACHED) {
 						cfg->cbb = bb;
 
-						emit_init_rvar (cfg, rvar->dreg, fsig->ret);
+						mini_emit_init_rvar (cfg, rvar->dreg, fsig->ret);
 					}
 				}
 			}
@@ -5934,7 +6299,7 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 			 * set, so set it to a dummy value.
 			 */
 			if (!ret_var_set)
-				emit_init_rvar (cfg, rvar->dreg, fsig->ret);
+				mini_emit_init_rvar (cfg, rvar->dreg, fsig->ret);
 
 			EMIT_NEW_TEMPLOAD (cfg, ins, rvar->inst_c0);
 			*sp++ = ins;
@@ -5944,6 +6309,8 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	} else {
 		if (cfg->verbose_level > 2)
 			printf ("INLINE ABORTED %s (cost %d)\n", mono_method_full_name (cmethod, TRUE), costs);
+		if (cfg->jit_prof || (cfg->prof_options & MONO_PROFILE_INLINING))
+			mini_jit_prof_inline (cfg, cmethod, FALSE, costs);
 		cfg->exception_type = MONO_EXCEPTION_NONE;
 		mono_loader_clear_error ();
 
@@ -5954,6 +6321,68 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	return 0;
 }
 
+/*
+ * emit_guarded_virtual_call:
+ *
+ *   Emit the virtual call to CMETHOD at IP as a direct call to TARGET, guarded by
+ * a check that the vtable of the receiver is VTABLE, falling back to the virtual
+ * call otherwise. The direct call is inlined if possible. Return the result of
+ * the call, or NULL if it returns void.
+ */
+static MonoInst*
+emit_guarded_virtual_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **sp,
+						   MonoVTable *vtable, MonoMethod *target, guchar *ip, GList *dont_inline, gboolean try_inline,
+						   int *inline_costs)
+{
+	MonoBasicBlock *virtual_bb, *end_bb;
+	MonoInst **args, *ins, *store, *rvar = NULL;
+	MonoMethodSignature *target_sig = mono_method_signature (target);
+	int n = fsig->param_count + fsig->hasthis;
+	int vtable_reg = alloc_preg (cfg);
+	int costs = 0, cost_limit;
+
+	/* inline_method () pushes the result into ARGS */
+	args = mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * (n + 1));
+	memcpy (args, sp, sizeof (MonoInst*) * n);
+
+	if (!MONO_TYPE_IS_VOID (fsig->ret))
+		rvar = mono_compile_create_var (cfg, fsig->ret, OP_LOCAL);
+
+	NEW_BBLOCK (cfg, virtual_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, sp [0]->dreg, G_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, vtable_reg, vtable);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, virtual_bb);
+
+	if (try_inline && !(target->iflags & METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL) && !(target->flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) &&
+		mono_method_check_inlining (cfg, target, cfg->method, ip - cfg->cil_start, count_const_args (fsig, sp), TRUE, &cost_limit) &&
+		!g_list_find (dont_inline, target)) {
+		costs = inline_method (cfg, target, target_sig, args, ip, cfg->real_offset, dont_inline, FALSE, cost_limit);
+		if (costs) {
+			*inline_costs += costs;
+			ins = args [0];
+		}
+	}
+	if (!costs)
+		ins = mono_emit_method_call_full (cfg, target, target_sig, FALSE, args, NULL, NULL, NULL);
+	if (rvar)
+		EMIT_NEW_TEMPSTORE (cfg, store, rvar->inst_c0, ins);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	MONO_START_BB (cfg, virtual_bb);
+	memcpy (args, sp, sizeof (MonoInst*) * n);
+	ins = mono_emit_method_call_full (cfg, cmethod, fsig, FALSE, args, args [0], NULL, NULL);
+	if (rvar)
+		EMIT_NEW_TEMPSTORE (cfg, store, rvar->inst_c0, ins);
+
+	MONO_START_BB (cfg, end_bb);
+	if (!rvar)
+		return NULL;
+	EMIT_NEW_TEMPLOAD (cfg, ins, rvar->inst_c0);
+	return ins;
+}
+
 /*
  * Some of these comments may well be out-of-date.
  * Design decisions: we do a single pass over the IL code (and we do bblock 
@@ -6601,6 +7030,83 @@ create_magic_tls_access (MonoCompile *cfg, MonoClassField *tls_field, MonoInst *
 	return addr;
 }
 
+/*
+ * mini_emit_jump_table:
+ *
+ *   Emit an indirect branch to TARGETS [SREG], where SREG is an int32 in the
+ * range [0, N). The caller has to emit the range check. This ends the current
+ * bblock.
+ */
+void
+mini_emit_jump_table (MonoCompile *cfg, int sreg, MonoBasicBlock **targets, int n)
+{
+	MonoJumpInfoBBTable *table;
+	MonoInst *ins;
+	gboolean use_op_switch;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		mono_link_bblock (cfg, cfg->cbb, targets [i]);
+		targets [i]->flags |= BB_INDIRECT_JUMP_TARGET;
+	}
+
+	table = mono_mempool_alloc (cfg->mempool, sizeof (MonoJumpInfoBBTable));
+	table->table = targets;
+	table->table_size = n;
+
+	use_op_switch = FALSE;
+#ifdef TARGET_ARM
+	/* ARM implements SWITCH statements differently */
+	/* FIXME: Make it use the generic implementation */
+	if (!cfg->compile_aot)
+		use_op_switch = TRUE;
+#endif
+
+	if (COMPILE_LLVM (cfg))
+		use_op_switch = TRUE;
+
+	cfg->cbb->has_jump_table = 1;
+
+	if (use_op_switch) {
+		MONO_INST_NEW (cfg, ins, OP_SWITCH);
+		ins->sreg1 = sreg;
+		ins->inst_p0 = table;
+		ins->inst_many_bb = targets;
+		ins->klass = GUINT_TO_POINTER (n);
+		MONO_ADD_INS (cfg->cbb, ins);
+	} else {
+		int offset_reg = alloc_preg (cfg);
+		int target_reg = alloc_preg (cfg);
+		int table_reg = alloc_preg (cfg);
+		int sum_reg = alloc_preg (cfg);
+
+		if (sizeof (gpointer) == 8)
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHL_IMM, offset_reg, sreg, 3);
+		else
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHL_IMM, offset_reg, sreg, 2);
+
+#if SIZEOF_REGISTER == 8
+		/* The upper word might not be zero, and we add it to a 64 bit address later */
+		MONO_EMIT_NEW_UNALU (cfg, OP_ZEXT_I4, offset_reg, offset_reg);
+#endif
+
+		if (cfg->compile_aot) {
+			MONO_EMIT_NEW_AOTCONST (cfg, table_reg, table, MONO_PATCH_INFO_SWITCH);
+		} else {
+			MONO_INST_NEW (cfg, ins, OP_JUMP_TABLE);
+			ins->inst_c1 = MONO_PATCH_INFO_SWITCH;
+			ins->inst_p0 = table;
+			ins->dreg = table_reg;
+			MONO_ADD_INS (cfg->cbb, ins);
+		}
+
+		/* FIXME: Use load_memindex */
+		MONO_EMIT_NEW_BIALU (cfg, OP_PADD, sum_reg, table_reg, offset_reg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, target_reg, sum_reg, 0);
+		MONO_EMIT_NEW_UNALU (cfg, OP_BR_REG, -1, target_reg);
+	}
+}
+
 /*
  * mono_method_to_ir:
  *
@@ -6628,7 +7134,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 	MonoGenericContainer *generic_container = NULL;
 	MonoType **param_types;
 	int i, n, start_new_bblock, dreg;
-	int num_calls = 0, inline_costs = 0;
+	int num_calls = 0, inline_costs = 0, inline_cost_limit;
 	int breakpoint_id = 0;
 	guint num_args;
 	MonoBoolean security, pinvoke;
@@ -6964,14 +7470,25 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 		}
 	}
 	
-	if ((init_locals || (cfg->method == method && (cfg->opt & MONO_OPT_SHARED))) || cfg->compile_aot || security || pinvoke) {
+	if ((init_locals || (cfg->method == method && (cfg->opt & MONO_OPT_SHARED))) || cfg->compile_aot || security || pinvoke || cfg->tier_info) {
 		/* we use a separate basic block for the initialization code */
 		NEW_BBLOCK (cfg, init_localsbb);
 		cfg->bb_init = init_localsbb;
 		init_localsbb->real_offset = cfg->real_offset;
-		start_bblock->next_bb = init_localsbb;
+		if (cfg->tier_info && cfg->method == method) {
+			MonoBasicBlock *count_bb;
+
+			/* Count the calls made to tier 0 code so hot methods can be recompiled */
+			NEW_BBLOCK (cfg, count_bb);
+			start_bblock->next_bb = count_bb;
+			link_bblock (cfg, start_bblock, count_bb);
+			cfg->cbb = count_bb;
+			emit_tier0_call_count (cfg, init_localsbb);
+		} else {
+			start_bblock->next_bb = init_localsbb;
+			link_bblock (cfg, start_bblock, init_localsbb);
+		}
 		init_localsbb->next_bb = bblock;
-		link_bblock (cfg, start_bblock, init_localsbb);
 		link_bblock (cfg, init_localsbb, bblock);
 		
 		cfg->cbb = init_localsbb;
@@ -8123,10 +8640,35 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				goto call_end;
 			}
 
+			/* Receiver type feedback, see pic.c */
+			if (cmethod && virtual && cfg->method == method && (cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) && !MONO_METHOD_IS_FINAL (cmethod) &&
+				sp [0]->type == STACK_OBJ && !imt_arg && !vtable_arg && !context_used && !array_rank && !delegate_invoke &&
+				!(ins_flag & MONO_INST_TAILCALL) && !MONO_TYPE_ISSTRUCT (fsig->ret) && !mono_class_is_marshalbyref (cmethod->klass)) {
+				MonoMethod *target;
+				MonoVTable *vtable;
+
+				if (mini_pic_instrument (cfg)) {
+					emit_pic_feedback (cfg, method, ip - header->code, cmethod, sp [0]);
+					bblock = cfg->cbb;
+				} else if ((vtable = mini_pic_get_dominant_receiver (cfg, method, ip - header->code, cmethod, &target))) {
+					ins = emit_guarded_virtual_call (cfg, cmethod, fsig, sp, vtable, target, ip, dont_inline,
+													 (cfg->opt & MONO_OPT_INLINE) && !disable_inline, &inline_costs);
+					bblock = cfg->cbb;
+					goto call_end;
+				}
+			}
+
+			/* Profile the call sites which could be inlined */
+			if (cmethod && cfg->method == method && mini_inliner_instrument (cfg) &&
+				(!virtual || !(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) || MONO_METHOD_IS_FINAL (cmethod)))
+				emit_call_site_counter (cfg, method, ip - header->code);
+
 			/* Inlining */
 			if (cmethod && (cfg->opt & MONO_OPT_INLINE) &&
 				(!virtual || !(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) || MONO_METHOD_IS_FINAL (cmethod)) &&
-			    !disable_inline && mono_method_check_inlining (cfg, cmethod) &&
+			    !disable_inline &&
+				mono_method_check_inlining (cfg, cmethod, method, ip - header->code, count_const_args (fsig, sp),
+											virtual && (cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL), &inline_cost_limit) &&
 				 !g_list_find (dont_inline, cmethod)) {
 				int costs;
 				gboolean always = FALSE;
@@ -8139,7 +8681,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					always = TRUE;
 				}
 
- 				costs = inline_method (cfg, cmethod, fsig, sp, ip, cfg->real_offset, dont_inline, always);
+ 				costs = inline_method (cfg, cmethod, fsig, sp, ip, cfg->real_offset, dont_inline, always, inline_cost_limit);
 				if (costs) {
 					cfg->real_offset += 5;
 					bblock = cfg->cbb;
@@ -8719,12 +9261,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			MonoInst *src1;
 			MonoBasicBlock **targets;
 			MonoBasicBlock *default_bblock;
-			MonoJumpInfoBBTable *table;
-			int offset_reg = alloc_preg (cfg);
-			int target_reg = alloc_preg (cfg);
-			int table_reg = alloc_preg (cfg);
-			int sum_reg = alloc_preg (cfg);
-			gboolean use_op_switch;
 
 			CHECK_OPSIZE (5);
 			CHECK_STACK (1);
@@ -8767,59 +9303,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE_UN, default_bblock);
 			bblock = cfg->cbb;
 
-			for (i = 0; i < n; ++i)
-				link_bblock (cfg, bblock, targets [i]);
-
-			table = mono_mempool_alloc (cfg->mempool, sizeof (MonoJumpInfoBBTable));
-			table->table = targets;
-			table->table_size = n;
-
-			use_op_switch = FALSE;
-#ifdef TARGET_ARM
-			/* ARM implements SWITCH statements differently */
-			/* FIXME: Make it use the generic implementation */
-			if (!cfg->compile_aot)
-				use_op_switch = TRUE;
-#endif
-
-			if (COMPILE_LLVM (cfg))
-				use_op_switch = TRUE;
-
-			cfg->cbb->has_jump_table = 1;
-
-			if (use_op_switch) {
-				MONO_INST_NEW (cfg, ins, OP_SWITCH);
-				ins->sreg1 = src1->dreg;
-				ins->inst_p0 = table;
-				ins->inst_many_bb = targets;
-				ins->klass = GUINT_TO_POINTER (n);
-				MONO_ADD_INS (cfg->cbb, ins);
-			} else {
-				if (sizeof (gpointer) == 8)
-					MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHL_IMM, offset_reg, src1->dreg, 3);
-				else
-					MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHL_IMM, offset_reg, src1->dreg, 2);
-
-#if SIZEOF_REGISTER == 8
-				/* The upper word might not be zero, and we add it to a 64 bit address later */
-				MONO_EMIT_NEW_UNALU (cfg, OP_ZEXT_I4, offset_reg, offset_reg);
-#endif
-
-				if (cfg->compile_aot) {
-					MONO_EMIT_NEW_AOTCONST (cfg, table_reg, table, MONO_PATCH_INFO_SWITCH);
-				} else {
-					MONO_INST_NEW (cfg, ins, OP_JUMP_TABLE);
-					ins->inst_c1 = MONO_PATCH_INFO_SWITCH;
-					ins->inst_p0 = table;
-					ins->dreg = table_reg;
-					MONO_ADD_INS (cfg->cbb, ins);
-				}
-
-				/* FIXME: Use load_memindex */
-				MONO_EMIT_NEW_BIALU (cfg, OP_PADD, sum_reg, table_reg, offset_reg);
-				MONO_EMIT_NEW_LOAD_MEMBASE (cfg, target_reg, sum_reg, 0);
-				MONO_EMIT_NEW_UNALU (cfg, OP_BR_REG, -1, target_reg);
-			}
+			mini_emit_jump_table (cfg, src1->dreg, targets, n);
 			start_new_bblock = 1;
 			inline_costs += (BRANCH_COST * 2);
 			break;
@@ -8947,6 +9431,10 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			ADD_WIDEN_OP (ins, sp [0], sp [1]);
 			ins->dreg = alloc_dreg ((cfg), (ins)->type);
 
+			/* Divisions by constants are strength reduced by mono_decompose_div_by_const () */
+			if ((*ip == CEE_DIV || *ip == CEE_DIV_UN || *ip == CEE_REM || *ip == CEE_REM_UN) && ((sp [1]->opcode == OP_ICONST) || (sp [1]->opcode == OP_I8CONST)))
+				cfg->flags |= MONO_CFG_HAS_DIV_BY_CONST;
+
 			/* FIXME: Pass opcode to is_inst_imm */
 
 			/* Use the immediate opcodes if possible */
@@ -8959,6 +9447,12 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if ((ins->opcode == OP_IREM_UN || ins->opcode == OP_IDIV_UN_IMM) && (cfg->opt & (MONO_OPT_CONSPROP | MONO_OPT_COPYPROP)) && sp [1]->opcode == OP_ICONST && mono_is_power_of_two (sp [1]->inst_c0) >= 0) {
 					imm_opcode = mono_op_to_op_imm (ins->opcode);
 				}
+#ifdef MONO_ARCH_HAVE_IMULH
+				if ((ins->opcode == OP_IDIV || ins->opcode == OP_IDIV_UN || ins->opcode == OP_IREM || ins->opcode == OP_IREM_UN) && (cfg->opt & (MONO_OPT_CONSPROP | MONO_OPT_COPYPROP)) && !COMPILE_LLVM (cfg) &&
+					sp [1]->opcode == OP_ICONST && sp [1]->inst_c0 != 0 && !(sp [1]->inst_c0 == -1 && (ins->opcode == OP_IDIV || ins->opcode == OP_IREM))) {
+					imm_opcode = mono_op_to_op_imm (ins->opcode);
+				}
+#endif
 #endif
 				if (imm_opcode != -1) {
 					ins->opcode = imm_opcode;
@@ -9382,7 +9876,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				
 				if (cmethod->klass->valuetype) {
 					iargs [0] = mono_compile_create_var (cfg, &cmethod->klass->byval_arg, OP_LOCAL);
-					emit_init_rvar (cfg, iargs [0]->dreg, &cmethod->klass->byval_arg);
+					mini_emit_init_rvar (cfg, iargs [0]->dreg, &cmethod->klass->byval_arg);
 					EMIT_NEW_TEMPLOADA (cfg, *sp, iargs [0]->inst_c0);
 
 					alloc = NULL;
@@ -9427,6 +9921,8 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if (mono_class_is_marshalbyref (cmethod->klass))
 					callvirt_this_arg = sp [0];
 
+				if (cfg->method == method && mini_inliner_instrument (cfg))
+					emit_call_site_counter (cfg, method, ip - header->code);
 
 				if (cmethod && (cfg->opt & MONO_OPT_INTRINS) && (ins = mini_emit_inst_for_ctor (cfg, cmethod, fsig, sp))) {
 					if (!MONO_TYPE_IS_VOID (fsig->ret)) {
@@ -9437,12 +9933,12 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 					CHECK_CFG_EXCEPTION;
 				} else if ((cfg->opt & MONO_OPT_INLINE) && cmethod && !context_used && !vtable_arg &&
-				    !disable_inline && mono_method_check_inlining (cfg, cmethod) &&
+				    !disable_inline && mono_method_check_inlining (cfg, cmethod, method, ip - header->code, count_const_args (fsig, sp), FALSE, &inline_cost_limit) &&
 				    !mono_class_is_subclass_of (cmethod->klass, mono_defaults.exception_class, FALSE) &&
 				    !g_list_find (dont_inline, cmethod)) {
 					int costs;
 
-					if ((costs = inline_method (cfg, cmethod, fsig, sp, ip, cfg->real_offset, dont_inline, FALSE))) {
+					if ((costs = inline_method (cfg, cmethod, fsig, sp, ip, cfg->real_offset, dont_inline, FALSE, inline_cost_limit))) {
 						cfg->real_offset += 5;
 						bblock = cfg->cbb;
 
@@ -9501,7 +9997,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			context_used = mini_class_check_context_used (cfg, klass);
 
 			if (!context_used && mini_class_has_reference_variant_generic_argument (cfg, klass, context_used)) {
-				MonoMethod *mono_castclass = mono_marshal_get_castclass_with_cache ();
 				MonoInst *args [3];
 
 				/* obj */
@@ -9514,13 +10009,12 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if (cfg->compile_aot)
 					EMIT_NEW_AOTCONST (cfg, args [2], MONO_PATCH_INFO_CASTCLASS_CACHE, NULL);
 				else
-					EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (gpointer)));
-
-				/*The wrapper doesn't inline well so the bloat of inlining doesn't pay off.*/
+					EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (MonoCastCache)));
 
 				save_cast_details (cfg, klass, sp [0]->dreg, TRUE, &bblock);
-				*sp++ = mono_emit_method_call (cfg, mono_castclass, args, NULL);
+				*sp++ = emit_cast_with_cache (cfg, klass, args, FALSE);
 				reset_cast_details (cfg);
+				bblock = cfg->cbb;
 				ip += 5;
 				inline_costs += 2;
 			} else if (!context_used && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
@@ -9533,7 +10027,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				
 				save_cast_details (cfg, klass, sp [0]->dreg, TRUE, &bblock);
 				costs = inline_method (cfg, mono_castclass, mono_method_signature (mono_castclass), 
-							   iargs, ip, cfg->real_offset, dont_inline, TRUE);
+							   iargs, ip, cfg->real_offset, dont_inline, TRUE, 0);
 				reset_cast_details (cfg);
 				CHECK_CFG_EXCEPTION;
 				g_assert (costs > 0);
@@ -9567,7 +10061,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			context_used = mini_class_check_context_used (cfg, klass);
 
 			if (!context_used && mini_class_has_reference_variant_generic_argument (cfg, klass, context_used)) {
-				MonoMethod *mono_isinst = mono_marshal_get_isinst_with_cache ();
 				MonoInst *args [3];
 
 				/* obj */
@@ -9580,9 +10073,10 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if (cfg->compile_aot)
 					EMIT_NEW_AOTCONST (cfg, args [2], MONO_PATCH_INFO_CASTCLASS_CACHE, NULL);
 				else
-					EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (gpointer)));
+					EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (MonoCastCache)));
 
-				*sp++ = mono_emit_method_call (cfg, mono_isinst, args, NULL);
+				*sp++ = emit_cast_with_cache (cfg, klass, args, TRUE);
+				bblock = cfg->cbb;
 				ip += 5;
 				inline_costs += 2;
 			} else if (!context_used && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
@@ -9594,7 +10088,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				iargs [0] = sp [0];
 
 				costs = inline_method (cfg, mono_isinst, mono_method_signature (mono_isinst), 
-							   iargs, ip, cfg->real_offset, dont_inline, TRUE);
+							   iargs, ip, cfg->real_offset, dont_inline, TRUE, 0);
 				CHECK_CFG_EXCEPTION;
 				g_assert (costs > 0);
 				
@@ -9639,7 +10133,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			if (generic_class_is_reference_type (cfg, klass)) {
 				/* CASTCLASS FIXME kill this huge slice of duplicated code*/
 				if (!context_used && mini_class_has_reference_variant_generic_argument (cfg, klass, context_used)) {
-					MonoMethod *mono_castclass = mono_marshal_get_castclass_with_cache ();
 					MonoInst *args [3];
 
 					/* obj */
@@ -9653,10 +10146,10 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					if (cfg->compile_aot)
 						EMIT_NEW_AOTCONST (cfg, args [2], MONO_PATCH_INFO_CASTCLASS_CACHE, NULL);
 					else
-						EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (gpointer)));
+						EMIT_NEW_PCONST (cfg, args [2], mono_domain_alloc0 (cfg->domain, sizeof (MonoCastCache)));
 
-					/*The wrapper doesn't inline well so the bloat of inlining doesn't pay off.*/
-					*sp++ = mono_emit_method_call (cfg, mono_castclass, args, NULL);
+					*sp++ = emit_cast_with_cache (cfg, klass, args, FALSE);
+					bblock = cfg->cbb;
 					ip += 5;
 					inline_costs += 2;
 				} else if (!context_used && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
@@ -9668,7 +10161,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					iargs [0] = sp [0];
 
 					costs = inline_method (cfg, mono_castclass, mono_method_signature (mono_castclass), 
-										   iargs, ip, cfg->real_offset, dont_inline, TRUE);
+										   iargs, ip, cfg->real_offset, dont_inline, TRUE, 0);
 					CHECK_CFG_EXCEPTION;
 					g_assert (costs > 0);
 				
@@ -9956,7 +10449,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 					if (cfg->opt & MONO_OPT_INLINE || cfg->compile_aot) {
 						costs = inline_method (cfg, stfld_wrapper, mono_method_signature (stfld_wrapper), 
-								       iargs, ip, cfg->real_offset, dont_inline, TRUE);
+								       iargs, ip, cfg->real_offset, dont_inline, TRUE, 0);
 						CHECK_CFG_EXCEPTION;
 						g_assert (costs > 0);
 						      
@@ -10020,7 +10513,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				EMIT_NEW_ICONST (cfg, iargs [3], klass->valuetype ? field->offset - sizeof (MonoObject) : field->offset);
 				if (cfg->opt & MONO_OPT_INLINE || cfg->compile_aot) {
 					costs = inline_method (cfg, wrapper, mono_method_signature (wrapper), 
-										   iargs, ip, cfg->real_offset, dont_inline, TRUE);
+										   iargs, ip, cfg->real_offset, dont_inline, TRUE, 0);
 					CHECK_CFG_EXCEPTION;
 					bblock = cfg->cbb;
 					g_assert (costs > 0);
@@ -10258,7 +10751,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 							class_inits = g_slist_prepend (class_inits, klass);
 						}
 					} else {
-						if (cfg->run_cctors) {
+						if (cfg->run_cctors && !cfg->defer_cctors) {
 							MonoException *ex;
 							/* This makes so that inline cannot trigger */
 							/* .cctors: too many apps depend on them */
@@ -10507,7 +11000,6 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			 * ensure the rva field is big enough
 			 */
 			if ((cfg->opt & MONO_OPT_INTRINS) && ip + 6 < end && ip_in_bb (cfg, bblock, ip + 6) && (len_ins->opcode == OP_ICONST) && (data_ptr = initialize_array_data (method, cfg->compile_aot, ip, klass, len_ins->inst_c0, &data_size, &field_token))) {
-				MonoMethod *memcpy_method = get_memcpy_method ();
 				MonoInst *iargs [3];
 				int add_reg = alloc_ireg_mp (cfg);
 
@@ -10518,7 +11010,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					EMIT_NEW_PCONST (cfg, iargs [1], (char*)data_ptr);
 				}
 				EMIT_NEW_ICONST (cfg, iargs [2], data_size);
-				mono_emit_method_call (cfg, memcpy_method, iargs, NULL);
+				mono_emit_jit_icall (cfg, mono_jit_memcpy, iargs);
 				ip += 11;
 			}
 
@@ -11752,8 +12244,14 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				CHECK_STACK (3);
 				sp -= 3;
 
-				if ((ip [1] == CEE_CPBLK) && (cfg->opt & MONO_OPT_INTRINS) && (sp [2]->opcode == OP_ICONST) && ((n = sp [2]->inst_c0) <= sizeof (gpointer) * 5)) {
+				if ((ip [1] == CEE_CPBLK) && (cfg->opt & MONO_OPT_INTRINS) && (sp [2]->opcode == OP_ICONST) &&
+					emit_vector_memcpy (cfg, sp [0]->dreg, 0, sp [1]->dreg, 0, sp [2]->inst_c0)) {
+					/* Done */
+				} else if ((ip [1] == CEE_CPBLK) && (cfg->opt & MONO_OPT_INTRINS) && (sp [2]->opcode == OP_ICONST) && ((n = sp [2]->inst_c0) <= sizeof (gpointer) * 5)) {
 					mini_emit_memcpy (cfg, sp [0]->dreg, 0, sp [1]->dreg, 0, sp [2]->inst_c0, 0);
+				} else if ((ip [1] == CEE_INITBLK) && (cfg->opt & MONO_OPT_INTRINS) && (sp [2]->opcode == OP_ICONST) && (sp [1]->opcode == OP_ICONST) && (sp [1]->inst_c0 == 0) &&
+						   emit_vector_memset (cfg, sp [0]->dreg, 0, sp [2]->inst_c0)) {
+					/* Done */
 				} else if ((ip [1] == CEE_INITBLK) && (cfg->opt & MONO_OPT_INTRINS) && (sp [2]->opcode == OP_ICONST) && ((n = sp [2]->inst_c0) <= sizeof (gpointer) * 5) && (sp [1]->opcode == OP_ICONST) && (sp [1]->inst_c0 == 0)) {
 					/* emit_memset only works when val == 0 */
 					mini_emit_memset (cfg, sp [0]->dreg, 0, sp [2]->inst_c0, sp [1]->inst_c0, 0);
@@ -11761,13 +12259,10 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					iargs [0] = sp [0];
 					iargs [1] = sp [1];
 					iargs [2] = sp [2];
-					if (ip [1] == CEE_CPBLK) {
-						MonoMethod *memcpy_method = get_memcpy_method ();
-						mono_emit_method_call (cfg, memcpy_method, iargs, NULL);
-					} else {
-						MonoMethod *memset_method = get_memset_method ();
-						mono_emit_method_call (cfg, memset_method, iargs, NULL);
-					}
+					if (ip [1] == CEE_CPBLK)
+						mono_emit_jit_icall (cfg, mono_jit_memcpy, iargs);
+					else
+						mono_emit_jit_icall (cfg, mono_jit_memset, iargs);
 				}
 				ip += 2;
 				inline_costs += 1;
@@ -3983,6 +3983,14 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		case OP_BIGMUL_UN:
 			amd64_mul_reg (code, ins->sreg2, FALSE);
 			break;
+		case OP_IMULH:
+		case OP_IMULH_UN:
+			amd64_mul_reg_size (code, ins->sreg2, ins->opcode == OP_IMULH, 4);
+			break;
+		case OP_LMULH:
+		case OP_LMULH_UN:
+			amd64_mul_reg (code, ins->sreg2, ins->opcode == OP_LMULH);
+			break;
 		case OP_X86_SETEQ_MEMBASE:
 			amd64_set_membase (code, X86_CC_EQ, ins->inst_basereg, ins->inst_offset, TRUE);
 			break;
@@ -103,6 +103,10 @@ struct sigcontext {
 #define MONO_ARCH_USE_SHARED_FP_SIMD_BANK 1
 #endif
 
+#ifndef DISABLE_SIMD
+#define MONO_ARCH_STRING_SIMD 1
+#endif
+
 
 
 #if defined(__APPLE__)
@@ -404,6 +408,8 @@ typedef struct MonoCompileArch {
 #define MONO_ARCH_HAVE_CREATE_LLVM_NATIVE_THUNK 1
 #define MONO_ARCH_HAVE_OP_TAIL_CALL 1
 #define MONO_ARCH_HAVE_TRANSLATE_TLS_OFFSET 1
+#define MONO_ARCH_HAVE_IMULH 1
+#define MONO_ARCH_HAVE_LMULH 1
 
 #if defined(TARGET_OSX) || defined(__linux__)
 #define MONO_ARCH_HAVE_TLS_GET_REG 1
@@ -4552,6 +4552,18 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		case OP_MUL_IMM:
 			g_assert_not_reached ();
 			break;
+		case OP_IMULH:
+		case OP_IMULH_UN: {
+			/* Pre-ARMv6 cores require RdHi and Rm to be different */
+			int rm = ins->dreg == ins->sreg1 ? ins->sreg2 : ins->sreg1;
+			int rs = ins->dreg == ins->sreg1 ? ins->sreg1 : ins->sreg2;
+
+			if (ins->opcode == OP_IMULH)
+				ARM_SMULL (code, ins->dreg, ARMREG_LR, rm, rs);
+			else
+				ARM_UMULL (code, ins->dreg, ARMREG_LR, rm, rs);
+			break;
+		}
 		case OP_IMUL_OVF:
 			/* FIXME: handle ovf/ sreg2 != dreg */
 			ARM_MUL_REG_REG (code, ins->dreg, ins->sreg1, ins->sreg2);
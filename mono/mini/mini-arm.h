@@ -257,6 +257,7 @@ typedef struct MonoCompileArch {
 #define MONO_ARCH_GSHAREDVT_SUPPORTED 1
 #define MONO_ARCH_HAVE_GENERAL_RGCTX_LAZY_FETCH_TRAMPOLINE 1
 #define MONO_ARCH_HAVE_OPCODE_NEEDS_EMULATION 1
+#define MONO_ARCH_HAVE_IMULH 1
 #define MONO_ARCH_HAVE_OBJC_GET_SELECTOR 1
 
 #if defined(__native_client__)
@@ -47,6 +47,7 @@
 #include <mono/metadata/mono-endian.h>
 #include <mono/metadata/environment.h>
 #include <mono/utils/mono-mmap.h>
+#include <mono/utils/mono-counters.h>
 #include <mono/utils/mono-logger-internal.h>
 
 #include "mini.h"
@@ -67,6 +68,8 @@ static gpointer restore_stack_protection_tramp = NULL;
 static MonoUnhandledExceptionFunc unhandled_exception_hook = NULL;
 static gpointer unhandled_exception_hook_data = NULL;
 
+static gint32 eh_cache_hits, eh_cache_misses;
+
 static void try_more_restore (void);
 static void restore_stack_protection (void);
 static void mono_walk_stack_full (MonoJitStackWalk func, MonoContext *start_ctx, MonoDomain *domain, MonoJitTlsData *jit_tls, MonoLMF *lmf, MonoUnwindOptions unwind_options, gpointer user_data);
@@ -109,6 +112,9 @@ mono_exceptions_init (void)
 	cbs.mono_exception_walk_trace = mono_exception_walk_trace;
 	cbs.mono_install_handler_block_guard = mono_install_handler_block_guard;
 	mono_install_eh_callbacks (&cbs);
+
+	mono_counters_register ("EH cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &eh_cache_hits);
+	mono_counters_register ("EH cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &eh_cache_misses);
 }
 
 gpointer
@@ -190,6 +196,178 @@ is_address_protected (MonoJitInfo *ji, MonoJitExceptionInfo *ei, gpointer ip)
 	return TRUE;
 }
 
+/*
+ * Per-ip exception handling cache.
+ *
+ *   Both passes of exception handling unwind the same frames, and code which uses
+ * exceptions for control flow throws through the same call sites over and over again.
+ * This caches the result of the jit info table lookup for an ip, together with the
+ * set of clauses protecting it, so repeated lookups avoid the table search and the
+ * clause/try block hole checks.
+ * The cache is lock-free so it can be used from async contexts: every entry has a
+ * sequence number which is odd while the entry is being written, and readers fall
+ * back to the slow path if it changes under them. The whole cache is invalidated
+ * when jit info is removed from a table or when a domain is unloaded.
+ */
+#define EH_CACHE_SIZE 1024
+#define EH_CACHE_MAX_CLAUSES 32
+
+#define EH_CACHE_HASH(ip) ((((gsize)(ip)) ^ (((gsize)(ip)) >> 10)) & (EH_CACHE_SIZE - 1))
+
+typedef struct {
+	volatile gint32 seq;
+	gpointer ip;
+	MonoDomain *domain;
+	MonoJitInfo *ji;
+	MonoDomain *target_domain;
+	gulong remove_count;
+	gint32 gen;
+	/* Bit I is set if clause I protects IP, only valid if ji->num_clauses <= EH_CACHE_MAX_CLAUSES */
+	guint32 protected_clauses;
+} EHCacheEntry;
+
+static EHCacheEntry eh_cache [EH_CACHE_SIZE];
+static volatile gint32 eh_cache_gen;
+
+/*
+ * mono_eh_cache_invalidate:
+ *
+ *   Invalidate all entries of the exception handling cache. Called when jit info
+ * can go away without going through mono_jit_info_table_remove ().
+ */
+void
+mono_eh_cache_invalidate (void)
+{
+	InterlockedIncrement (&eh_cache_gen);
+}
+
+static guint32
+compute_protected_clauses (MonoJitInfo *ji, gpointer ip)
+{
+	guint32 mask = 0;
+	int i;
+
+	for (i = 0; i < ji->num_clauses && i < EH_CACHE_MAX_CLAUSES; ++i) {
+		if (is_address_protected (ji, &ji->clauses [i], ip))
+			mask |= 1U << i;
+	}
+	return mask;
+}
+
+static gboolean
+eh_cache_lookup (MonoDomain *domain, gpointer ip, MonoJitInfo **out_ji, MonoDomain **out_domain, guint32 *protected_clauses)
+{
+	EHCacheEntry *entry = &eh_cache [EH_CACHE_HASH (ip)];
+	MonoJitInfo *ji;
+	MonoDomain *target_domain;
+	guint32 mask;
+	gint32 seq;
+
+	seq = entry->seq;
+	if (seq & 1)
+		return FALSE;
+	mono_memory_read_barrier ();
+
+	if (entry->ip != ip || entry->domain != domain || entry->gen != eh_cache_gen || entry->remove_count != mono_stats.jit_info_table_remove_count)
+		return FALSE;
+	ji = entry->ji;
+	target_domain = entry->target_domain;
+	mask = entry->protected_clauses;
+
+	mono_memory_read_barrier ();
+	if (entry->seq != seq)
+		return FALSE;
+
+	*out_ji = ji;
+	if (out_domain)
+		*out_domain = target_domain;
+	if (protected_clauses)
+		*protected_clauses = mask;
+	return TRUE;
+}
+
+static void
+eh_cache_insert (MonoDomain *domain, gpointer ip, MonoJitInfo *ji, MonoDomain *target_domain, gulong remove_count, gint32 gen)
+{
+	EHCacheEntry *entry = &eh_cache [EH_CACHE_HASH (ip)];
+	gint32 seq;
+
+	seq = entry->seq;
+	/* Somebody else is writing this entry, possibly a thread we interrupted */
+	if (seq & 1)
+		return;
+	if (InterlockedCompareExchange (&entry->seq, seq + 1, seq) != seq)
+		return;
+
+	entry->ip = ip;
+	entry->domain = domain;
+	entry->ji = ji;
+	entry->target_domain = target_domain;
+	entry->remove_count = remove_count;
+	entry->gen = gen;
+	entry->protected_clauses = compute_protected_clauses (ji, ip);
+
+	mono_memory_write_barrier ();
+	entry->seq = seq + 2;
+}
+
+/*
+ * jit_info_table_find_cached:
+ *
+ *   Same as mini_jit_info_table_find, but go through the exception handling cache.
+ */
+static MonoJitInfo*
+jit_info_table_find_cached (MonoDomain *domain, gpointer ip, MonoDomain **out_domain)
+{
+	MonoJitInfo *ji;
+	gulong remove_count;
+	gint32 gen;
+
+	if (eh_cache_lookup (domain, ip, &ji, out_domain, NULL)) {
+		InterlockedIncrement (&eh_cache_hits);
+		return ji;
+	}
+	InterlockedIncrement (&eh_cache_misses);
+
+	/* Read these before the lookup, so a concurrent removal makes the new entry stale */
+	remove_count = mono_stats.jit_info_table_remove_count;
+	gen = eh_cache_gen;
+	mono_memory_read_barrier ();
+
+	ji = mini_jit_info_table_find (domain, ip, out_domain);
+	/* Async jit info lacks metadata, so it shouldn't be returned to non-async callers */
+	if (ji && !ji->async)
+		eh_cache_insert (domain, ip, ji, out_domain ? *out_domain : NULL, remove_count, gen);
+	return ji;
+}
+
+/*
+ * get_protected_clauses:
+ *
+ *   Return a bitmask of the clauses of JI which protect IP, if JI has at most
+ * EH_CACHE_MAX_CLAUSES clauses. Use clause_is_protected () to test the result.
+ */
+static guint32
+get_protected_clauses (MonoDomain *domain, MonoJitInfo *ji, gpointer ip)
+{
+	MonoJitInfo *cached_ji;
+	guint32 mask;
+
+	if (ji->num_clauses == 0 || ji->num_clauses > EH_CACHE_MAX_CLAUSES)
+		return 0;
+	if (eh_cache_lookup (domain, ip, &cached_ji, NULL, &mask) && cached_ji == ji)
+		return mask;
+	return compute_protected_clauses (ji, ip);
+}
+
+static inline gboolean
+clause_is_protected (MonoJitInfo *ji, int clause, gpointer ip, guint32 protected_clauses)
+{
+	if (ji->num_clauses <= EH_CACHE_MAX_CLAUSES)
+		return (protected_clauses & (1U << clause)) != 0;
+	return is_address_protected (ji, &ji->clauses [clause], ip);
+}
+
 /*
  * find_jit_info:
  *
@@ -357,7 +535,7 @@ mono_find_jit_info_ext (MonoDomain *domain, MonoJitTlsData *jit_tls,
 	if (prev_ji && (ip > prev_ji->code_start && ((guint8*)ip < ((guint8*)prev_ji->code_start) + prev_ji->code_size)))
 		ji = prev_ji;
 	else
-		ji = mini_jit_info_table_find (domain, ip, &target_domain);
+		ji = jit_info_table_find_cached (domain, ip, &target_domain);
 
 	if (!target_domain)
 		target_domain = domain;
@@ -1053,20 +1231,19 @@ callback_get_stack_frames_security_info (StackFrameInfo *frame, MonoContext *ctx
 }
 
 static MonoArray *
-glist_to_array (GList *list, MonoClass *eclass) 
+ptr_array_to_array (GPtrArray *arr, MonoClass *eclass)
 {
 	MonoDomain *domain = mono_domain_get ();
 	MonoArray *res;
-	int len, i;
+	int i;
 
-	if (!list)
+	if (!arr || !arr->len)
 		return NULL;
 
-	len = g_list_length (list);
-	res = mono_array_new (domain, eclass, len);
+	res = mono_array_new (domain, eclass, arr->len);
 
-	for (i = 0; list; list = list->next, i++)
-		mono_array_set (res, gpointer, i, list->data);
+	for (i = 0; i < arr->len; i++)
+		mono_array_set (res, gpointer, i, g_ptr_array_index (arr, i));
 
 	return res;
 }
@@ -1276,14 +1453,14 @@ build_native_trace (void)
 
 #define setup_managed_stacktrace_information() do {	\
 	if (mono_ex && !initial_trace_ips) {	\
-		trace_ips = g_list_reverse (trace_ips);	\
-		MONO_OBJECT_SETREF (mono_ex, trace_ips, glist_to_array (trace_ips, mono_defaults.int_class));	\
+		MONO_OBJECT_SETREF (mono_ex, trace_ips, ptr_array_to_array (trace_ips, mono_defaults.int_class));	\
 		MONO_OBJECT_SETREF (mono_ex, native_trace_ips, build_native_trace ());	\
 		if (has_dynamic_methods)	\
 			/* These methods could go away anytime, so compute the stack trace now */	\
 			MONO_OBJECT_SETREF (mono_ex, stack_trace, ves_icall_System_Exception_get_trace (mono_ex));	\
 	}	\
-	g_list_free (trace_ips);	\
+	if (trace_ips)	\
+		g_ptr_array_free (trace_ips, TRUE);	\
 	trace_ips = NULL;	\
 } while (0)
 /*
@@ -1302,7 +1479,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 	MonoJitTlsData *jit_tls = mono_native_tls_get_value (mono_jit_tls_id);
 	MonoLMF *lmf = mono_get_lmf ();
 	MonoArray *initial_trace_ips = NULL;
-	GList *trace_ips = NULL;
+	GPtrArray *trace_ips = NULL;
 	MonoException *mono_ex;
 	gboolean stack_overflow = FALSE;
 	MonoContext initial_ctx;
@@ -1348,6 +1525,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 		guint32 free_stack;
 		int clause_index_start = 0;
 		gboolean unwind_res = TRUE;
+		guint32 protected_clauses;
 		
 		StackFrameInfo frame;
 
@@ -1386,9 +1564,11 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 			 * overflow.
 			 */
 			if (!initial_trace_ips && (frame_count < 1000)) {
-				trace_ips = g_list_prepend (trace_ips, MONO_CONTEXT_GET_IP (ctx));
-				trace_ips = g_list_prepend (trace_ips,
-											get_generic_info_from_stack_frame (ji, ctx));
+				/* Only raw ips are stored, they are resolved lazily when the trace is requested */
+				if (!trace_ips)
+					trace_ips = g_ptr_array_sized_new (32);
+				g_ptr_array_add (trace_ips, MONO_CONTEXT_GET_IP (ctx));
+				g_ptr_array_add (trace_ips, get_generic_info_from_stack_frame (ji, ctx));
 			}
 		}
 
@@ -1404,6 +1584,8 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 			free_stack = 0xffffff;
 		}
 				
+		protected_clauses = get_protected_clauses (domain, ji, MONO_CONTEXT_GET_IP (ctx));
+
 		for (i = clause_index_start; i < ji->num_clauses; i++) {
 			MonoJitExceptionInfo *ei = &ji->clauses [i];
 			gboolean filtered = FALSE;
@@ -1415,7 +1597,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, gpointer obj, gint3
 			if (free_stack <= (64 * 1024))
 				continue;
 
-			if (is_address_protected (ji, ei, MONO_CONTEXT_GET_IP (ctx))) {
+			if (clause_is_protected (ji, i, MONO_CONTEXT_GET_IP (ctx), protected_clauses)) {
 				/* catch block */
 				MonoClass *catch_class = get_exception_catch_class (ei, ji, ctx);
 
@@ -1662,6 +1844,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 		guint32 free_stack;
 		int clause_index_start = 0;
 		gboolean unwind_res = TRUE;
+		guint32 protected_clauses;
 		
 		if (resume) {
 			resume = FALSE;
@@ -1705,6 +1888,8 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 			free_stack = 0xffffff;
 		}
 				
+		protected_clauses = get_protected_clauses (domain, ji, MONO_CONTEXT_GET_IP (ctx));
+
 		for (i = clause_index_start; i < ji->num_clauses; i++) {
 			MonoJitExceptionInfo *ei = &ji->clauses [i];
 			gboolean filtered = FALSE;
@@ -1716,7 +1901,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 			if (free_stack <= (64 * 1024))
 				continue;
 
-			if (is_address_protected (ji, ei, MONO_CONTEXT_GET_IP (ctx))) {
+			if (clause_is_protected (ji, i, MONO_CONTEXT_GET_IP (ctx), protected_clauses)) {
 				/* catch block */
 				MonoClass *catch_class = get_exception_catch_class (ei, ji, ctx);
 
@@ -1803,7 +1988,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 
 					return 0;
 				}
-				if (is_address_protected (ji, ei, MONO_CONTEXT_GET_IP (ctx)) &&
+				if (clause_is_protected (ji, i, MONO_CONTEXT_GET_IP (ctx), protected_clauses) &&
 					(ei->flags == MONO_EXCEPTION_CLAUSE_FAULT)) {
 					if (mono_trace_is_enabled () && mono_trace_eval (method))
 						g_print ("EXCEPTION: fault clause %d of %s\n", i, mono_method_full_name (method, TRUE));
@@ -1812,7 +1997,7 @@ mono_handle_exception_internal (MonoContext *ctx, gpointer obj, gboolean resume,
 					jit_tls->orig_ex_ctx_set = FALSE;
 					call_filter (ctx, ei->handler_start);
 				}
-				if (is_address_protected (ji, ei, MONO_CONTEXT_GET_IP (ctx)) &&
+				if (clause_is_protected (ji, i, MONO_CONTEXT_GET_IP (ctx), protected_clauses) &&
 					(ei->flags == MONO_EXCEPTION_CLAUSE_FINALLY)) {
 					if (mono_trace_is_enabled () && mono_trace_eval (method))
 						g_print ("EXCEPTION: finally clause %d of %s\n", i, mono_method_full_name (method, TRUE));
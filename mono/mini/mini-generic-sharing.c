@@ -937,10 +937,9 @@ class_type_info (MonoDomain *domain, MonoClass *class, MonoRgctxInfoType info_ty
 		return vtable;
 	}
 	case MONO_RGCTX_INFO_CAST_CACHE: {
-		/*First slot is the cache itself, the second the vtable.*/
-		gpointer **cache_data = mono_domain_alloc0 (domain, sizeof (gpointer) * 2);
-		cache_data [1] = (gpointer)class;
-		return cache_data;
+		MonoCastCache *cache = mono_domain_alloc0 (domain, sizeof (MonoCastCache));
+		cache->klass = class;
+		return cache;
 	}
 	case MONO_RGCTX_INFO_ARRAY_ELEMENT_SIZE:
 		return GUINT_TO_POINTER (mono_class_array_element_size (class));
@@ -1783,10 +1782,18 @@ mono_class_rgctx_get_array_size (int n, gboolean mrgctx)
 {
 	g_assert (n >= 0 && n < 30);
 
+	/*
+	 * The first array is made large enough to hold the slots of most
+	 * methods/classes, so lookups don't have to follow the link chain
+	 * and the JIT can inline them as a single indexed load. The cost is
+	 * memory: on 64 bit, every RGCTX is 96 bytes larger than with the old
+	 * 4 slot first array and every MRGCTX 32 bytes larger, even if it
+	 * only ever uses one slot.
+	 */
 	if (mrgctx)
-		return 6 << n;
+		return n == 0 ? 8 + MONO_SIZEOF_METHOD_RUNTIME_GENERIC_CONTEXT / sizeof (gpointer) : 8 << n;
 	else
-		return 4 << n;
+		return 16 << n;
 }
 
 /*
@@ -544,6 +544,13 @@ MINI_OP(OP_ENDFINALLY,  "endfinally", NONE, NONE, NONE)
 /* inline (long)int * (long)int */
 MINI_OP(OP_BIGMUL, "bigmul", LREG, IREG, IREG)
 MINI_OP(OP_BIGMUL_UN, "bigmul_un", LREG, IREG, IREG)
+
+/* high word of a full width multiplication, used to strength reduce division by constants */
+MINI_OP(OP_IMULH, "int_mulh", IREG, IREG, IREG)
+MINI_OP(OP_IMULH_UN, "int_mulh_un", IREG, IREG, IREG)
+MINI_OP(OP_LMULH, "long_mulh", LREG, LREG, LREG)
+MINI_OP(OP_LMULH_UN, "long_mulh_un", LREG, LREG, LREG)
+
 MINI_OP(OP_IMIN_UN, "int_min_un", IREG, IREG, IREG)
 MINI_OP(OP_IMAX_UN, "int_max_un", IREG, IREG, IREG)
 MINI_OP(OP_LMIN_UN, "long_min_un", LREG, LREG, LREG)
@@ -610,6 +617,8 @@ MINI_OP(OP_RESTORE_LMF, "restore_lmf", NONE, NONE, NONE)
 
 /* write barrier */
 MINI_OP(OP_CARD_TABLE_WBARRIER, "card_table_wbarrier", NONE, IREG, IREG)
+/* A write barrier for the store of sreg2 to the address sreg1, see write-barrier.c */
+MINI_OP(OP_WBARRIER, "wbarrier", NONE, IREG, IREG)
 
 /* arch-dep tls access */
 MINI_OP(OP_TLS_GET,            "tls_get", IREG, NONE, NONE)
@@ -623,6 +632,8 @@ MINI_OP(OP_DUMMY_USE, "dummy_use", NONE, IREG, NONE)
 MINI_OP(OP_DUMMY_STORE, "dummy_store", NONE, NONE, NONE)
 MINI_OP(OP_NOT_REACHED, "not_reached", NONE, NONE, NONE)
 MINI_OP(OP_NOT_NULL, "not_null", NONE, IREG, NONE)
+/* Inline (M)RGCTX lookup, inst_p0 is a MonoJumpInfoRgctxEntry, decomposed by mono_decompose_rgctx_fetch () */
+MINI_OP(OP_RGCTX_FETCH, "rgctx_fetch", IREG, IREG, NONE)
 
 /* SIMD opcodes. */
 
@@ -15,6 +15,7 @@
 #include <mono/utils/mono-membar.h>
 
 #include "mini.h"
+#include "jit-prof.h"
 
 /*
  * Address of the trampoline code.  This is used by the debugger to check
@@ -388,6 +389,7 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 	gboolean virtual, variance_used = FALSE;
 	gpointer *orig_vtable_slot, *vtable_slot_to_patch = NULL;
 	MonoJitInfo *ji = NULL;
+	MonoTierInfo *tier_info;
 
 	virtual = (gpointer)vtable_slot > (gpointer)vt;
 
@@ -606,6 +608,15 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 		return addr;
 	}
 
+	/*
+	 * Tier 0 code is replaced later, so the locations patched to it are recorded. Jumps and
+	 * calls through unbox/rgctx trampolines are not tracked, so they keep going through
+	 * this trampoline until the tier 1 code is available.
+	 */
+	tier_info = mini_tiered_lookup_tier0_code (mono_get_addr_from_ftnptr (compiled_method));
+	if (tier_info && (!code || addr != compiled_method))
+		return addr;
+
 	/* the method was jumped to */
 	if (!code) {
 		MonoDomain *domain = mono_domain_get ();
@@ -639,7 +650,12 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 	if (vtable_slot) {
 		if (vtable_slot_to_patch && (mono_aot_is_got_entry (code, (guint8*)vtable_slot_to_patch) || mono_domain_owns_vtable_slot (mono_domain_get (), vtable_slot_to_patch))) {
 			g_assert (*vtable_slot_to_patch);
-			*vtable_slot_to_patch = mono_get_addr_from_ftnptr (addr);
+			if (tier_info)
+				mini_tiered_patch_slot (tier_info, vtable_slot_to_patch);
+			else
+				*vtable_slot_to_patch = mono_get_addr_from_ftnptr (addr);
+			if (G_UNLIKELY (mono_jit_prof_enabled))
+				mini_jit_prof_patch (m, JIT_PROF_PATCH_VTABLE_SLOT);
 		}
 	}
 	else {
@@ -648,6 +664,9 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 		MonoJitInfo *target_ji;
 
 		if (plt_entry) {
+			/* PLT entries are not tracked by tiered compilation */
+			if (tier_info)
+				no_patch = TRUE;
 			if (generic_shared) {
 				target_ji =
 					mini_jit_info_table_find (mono_domain_get (), mono_get_addr_from_ftnptr (compiled_method), NULL);
@@ -658,8 +677,11 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 					no_patch = TRUE;
 				}
 			}
-			if (!no_patch)
+			if (!no_patch) {
 				mono_aot_patch_plt_entry (plt_entry, NULL, regs, addr);
+				if (G_UNLIKELY (mono_jit_prof_enabled))
+					mini_jit_prof_patch (m, JIT_PROF_PATCH_PLT);
+			}
 		} else {
 			if (generic_shared) {
 				if (m->wrapper_type != MONO_WRAPPER_NONE)
@@ -682,8 +704,18 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, guint8* tram
 				no_patch = TRUE;
 			}
 
-			if (!no_patch && mono_method_same_domain (ji, target_ji))
-				mono_arch_patch_callsite (ji->code_start, code, addr);
+			/* The code of dynamic methods is freed, so it can't be repatched at tier-up */
+			if (tier_info && ji && jinfo_get_method (ji)->dynamic)
+				no_patch = TRUE;
+
+			if (!no_patch && mono_method_same_domain (ji, target_ji)) {
+				if (tier_info)
+					mini_tiered_patch_callsite (tier_info, ji->code_start, code);
+				else
+					mono_arch_patch_callsite (ji->code_start, code, addr);
+				if (G_UNLIKELY (mono_jit_prof_enabled))
+					mini_jit_prof_patch (m, JIT_PROF_PATCH_CALLSITE);
+			}
 		}
 	}
 
@@ -990,6 +1022,7 @@ mono_delegate_trampoline (mgreg_t *regs, guint8 *code, gpointer *tramp_data, gui
 	guint8 *impl_nothis = tramp_data [2];
 	MonoError err;
 	MonoMethodSignature *sig;
+	MonoTierInfo *tier_info;
 	gpointer addr, compiled_method;
 
 	trampoline_calls ++;
@@ -1069,9 +1102,17 @@ mono_delegate_trampoline (mgreg_t *regs, guint8 *code, gpointer *tramp_data, gui
 			compiled_method = addr = mono_compile_method (method);
 			addr = mini_add_method_trampoline (NULL, method, compiled_method, need_rgctx_tramp, need_unbox_tramp);
 			delegate->method_ptr = addr;
-			if (enable_caching && delegate->method_code)
+			if (enable_caching && delegate->method_code) {
 				*delegate->method_code = delegate->method_ptr;
+				if (addr == compiled_method && (tier_info = mini_tiered_lookup_tier0_code (mono_get_addr_from_ftnptr (addr))))
+					mini_tiered_patch_slot (tier_info, delegate->method_code);
+			}
 		}
+
+		/* Point the delegate to the tier 1 code once it is installed */
+		tier_info = mini_tiered_lookup_tier0_code (mono_get_addr_from_ftnptr (delegate->method_ptr));
+		if (tier_info)
+			mini_tiered_patch_delegate (tier_info, delegate);
 	} else {
 		if (need_rgctx_tramp)
 			delegate->method_ptr = mono_create_static_rgctx_trampoline (method, delegate->method_ptr);
@@ -1365,9 +1406,15 @@ mono_create_jump_trampoline (MonoDomain *domain, MonoMethod *method, gboolean ad
 	 * method from its native code address, so we use the
 	 * trampoline instead.
 	 * For synchronized methods, the trampoline adds the wrapper.
+	 * Methods precompiled by the jit pool can be found before their class is
+	 * initialized, the trampoline runs the cctor.
 	 */
-	if (code && !ji->has_generic_jit_info && !(method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED))
-		return code;
+	if (code && !ji->has_generic_jit_info && !(method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED)) {
+		MonoVTable *vtable = mono_class_vtable (domain, method->klass);
+
+		if (vtable && vtable->initialized)
+			return code;
+	}
 
 	mono_domain_lock (domain);
 	code = g_hash_table_lookup (domain_jit_info (domain)->jump_trampoline_hash, method);
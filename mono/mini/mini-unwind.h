@@ -131,6 +131,22 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 				   mgreg_t **save_locations, int save_locations_len,
 				   guint8 **out_cfa) MONO_INTERNAL;
 
+typedef struct _MonoUnwindTable MonoUnwindTable;
+
+MonoUnwindTable*
+mono_unwind_get_table (guint8 *unwind_info, guint32 unwind_info_len) MONO_INTERNAL;
+
+gboolean
+mono_unwind_frame_with_table (MonoUnwindTable *table, guint8 *start_ip, guint8 *ip, mgreg_t *regs, int nregs,
+							  mgreg_t **save_locations, int save_locations_len,
+							  guint8 **out_cfa) MONO_INTERNAL;
+
+void
+mono_unwind_frame_jinfo (MonoJitInfo *ji, guint8 *unwind_info, guint32 unwind_info_len,
+						 guint8 *ip, mgreg_t *regs, int nregs,
+						 mgreg_t **save_locations, int save_locations_len,
+						 guint8 **out_cfa) MONO_INTERNAL;
+
 void mono_unwind_init (void) MONO_INTERNAL;
 
 void mono_unwind_cleanup (void) MONO_INTERNAL;
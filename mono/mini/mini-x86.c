@@ -2678,6 +2678,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		case OP_BIGMUL_UN:
 			x86_mul_reg (code, ins->sreg2, FALSE);
 			break;
+		case OP_IMULH:
+		case OP_IMULH_UN:
+			x86_mul_reg (code, ins->sreg2, ins->opcode == OP_IMULH);
+			break;
 		case OP_X86_SETEQ_MEMBASE:
 		case OP_X86_SETNE_MEMBASE:
 			x86_set_membase (code, ins->opcode == OP_X86_SETEQ_MEMBASE ? X86_CC_EQ : X86_CC_NE,
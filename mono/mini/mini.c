@@ -76,7 +76,7 @@
 #include "mini-gc.h"
 #include "debugger-agent.h"
 
-static gpointer mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException **ex);
+static gpointer mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, gboolean jit_only, MonoException **ex);
 
 
 static guint32 default_opt = 0;
@@ -3290,6 +3290,65 @@ mono_patch_info_equal (gconstpointer ka, gconstpointer kb)
 	return 1;
 }
 
+/*
+ * mini_get_rgctx_entry_slot:
+ *
+ *   Return the (M)RGCTX slot which holds the data described by ENTRY, registering
+ * it in the RGCTX template of ENTRY->method if needed.
+ */
+guint32
+mini_get_rgctx_entry_slot (MonoJumpInfoRgctxEntry *entry)
+{
+	guint32 slot = -1;
+
+	switch (entry->data->type) {
+	case MONO_PATCH_INFO_CLASS:
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, &entry->data->data.klass->byval_arg, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	case MONO_PATCH_INFO_METHOD:
+	case MONO_PATCH_INFO_METHODCONST:
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.method, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	case MONO_PATCH_INFO_FIELD:
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.field, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	case MONO_PATCH_INFO_SIGNATURE:
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.sig, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	case MONO_PATCH_INFO_GSHAREDVT_CALL: {
+		MonoJumpInfoGSharedVtCall *call_info = g_malloc0 (sizeof (MonoJumpInfoGSharedVtCall)); //mono_domain_alloc0 (domain, sizeof (MonoJumpInfoGSharedVtCall));
+
+		memcpy (call_info, entry->data->data.gsharedvt, sizeof (MonoJumpInfoGSharedVtCall));
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, call_info, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	}
+	case MONO_PATCH_INFO_GSHAREDVT_METHOD: {
+		MonoGSharedVtMethodInfo *info;
+		MonoGSharedVtMethodInfo *oinfo = entry->data->data.gsharedvt_method;
+		int i;
+
+		/* Make a copy into the domain mempool */
+		info = g_malloc0 (sizeof (MonoGSharedVtMethodInfo)); //mono_domain_alloc0 (domain, sizeof (MonoGSharedVtMethodInfo));
+		info->method = oinfo->method;
+		info->num_entries = oinfo->num_entries;
+		info->entries = g_malloc0 (sizeof (MonoRuntimeGenericContextInfoTemplate) * info->num_entries);
+		for (i = 0; i < oinfo->num_entries; ++i) {
+			MonoRuntimeGenericContextInfoTemplate *otemplate = &oinfo->entries [i];
+			MonoRuntimeGenericContextInfoTemplate *template = &info->entries [i];
+
+			memcpy (template, otemplate, sizeof (MonoRuntimeGenericContextInfoTemplate));
+		}
+		slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, info, entry->info_type, mono_method_get_context (entry->method));
+		break;
+	}
+	default:
+		g_assert_not_reached ();
+		break;
+	}
+
+	return slot;
+}
+
 gpointer
 mono_resolve_patch_target (MonoMethod *method, MonoDomain *domain, guint8 *code, MonoJumpInfo *patch_info, gboolean run_cctors)
 {
@@ -3563,53 +3622,7 @@ mono_resolve_patch_target (MonoMethod *method, MonoDomain *domain, guint8 *code,
 	case MONO_PATCH_INFO_NONE:
 		break;
 	case MONO_PATCH_INFO_RGCTX_FETCH: {
-		MonoJumpInfoRgctxEntry *entry = patch_info->data.rgctx_entry;
-		guint32 slot = -1;
-
-		switch (entry->data->type) {
-		case MONO_PATCH_INFO_CLASS:
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, &entry->data->data.klass->byval_arg, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		case MONO_PATCH_INFO_METHOD:
-		case MONO_PATCH_INFO_METHODCONST:
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.method, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		case MONO_PATCH_INFO_FIELD:
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.field, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		case MONO_PATCH_INFO_SIGNATURE:
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, entry->data->data.sig, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		case MONO_PATCH_INFO_GSHAREDVT_CALL: {
-			MonoJumpInfoGSharedVtCall *call_info = g_malloc0 (sizeof (MonoJumpInfoGSharedVtCall)); //mono_domain_alloc0 (domain, sizeof (MonoJumpInfoGSharedVtCall));
-
-			memcpy (call_info, entry->data->data.gsharedvt, sizeof (MonoJumpInfoGSharedVtCall));
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, call_info, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		}
-		case MONO_PATCH_INFO_GSHAREDVT_METHOD: {
-			MonoGSharedVtMethodInfo *info;
-			MonoGSharedVtMethodInfo *oinfo = entry->data->data.gsharedvt_method;
-			int i;
-
-			/* Make a copy into the domain mempool */
-			info = g_malloc0 (sizeof (MonoGSharedVtMethodInfo)); //mono_domain_alloc0 (domain, sizeof (MonoGSharedVtMethodInfo));
-			info->method = oinfo->method;
-			info->num_entries = oinfo->num_entries;
-			info->entries = g_malloc0 (sizeof (MonoRuntimeGenericContextInfoTemplate) * info->num_entries);
-			for (i = 0; i < oinfo->num_entries; ++i) {
-				MonoRuntimeGenericContextInfoTemplate *otemplate = &oinfo->entries [i];
-				MonoRuntimeGenericContextInfoTemplate *template = &info->entries [i];
-
-				memcpy (template, otemplate, sizeof (MonoRuntimeGenericContextInfoTemplate));
-			}
-			slot = mono_method_lookup_or_register_info (entry->method, entry->in_mrgctx, info, entry->info_type, mono_method_get_context (entry->method));
-			break;
-		}
-		default:
-			g_assert_not_reached ();
-			break;
-		}
+		guint32 slot = mini_get_rgctx_entry_slot (patch_info->data.rgctx_entry);
 
 		target = mono_create_rgctx_lazy_fetch_trampoline (slot);
 		break;
@@ -3648,7 +3661,7 @@ mono_resolve_patch_target (MonoMethod *method, MonoDomain *domain, guint8 *code,
 		break;
 	}
 	case MONO_PATCH_INFO_CASTCLASS_CACHE: {
-		target = mono_domain_alloc0 (domain, sizeof (gpointer));
+		target = mono_domain_alloc0 (domain, sizeof (MonoCastCache));
 		break;
 	}
 	case MONO_PATCH_INFO_JIT_TLS_ID: {
@@ -4033,6 +4046,24 @@ mono_save_seq_point_info (MonoCompile *cfg)
 	cfg->seq_points = NULL;
 }
 
+/*
+ * is_cold_method:
+ *
+ *   Return whenever the code of the method compiled by CFG is unlikely to run
+ * often, so it should be kept away from the rest of the code.
+ */
+static gboolean
+is_cold_method (MonoCompile *cfg)
+{
+	MonoMethod *method = cfg->method;
+
+	/* Tier 0 code is replaced once the method gets hot */
+	if (cfg->tier_info)
+		return TRUE;
+	/* Class constructors only run once */
+	return (method->flags & METHOD_ATTRIBUTE_SPECIAL_NAME) && !strcmp (method->name, ".cctor");
+}
+
 void
 mono_codegen (MonoCompile *cfg)
 {
@@ -4092,6 +4123,8 @@ mono_codegen (MonoCompile *cfg)
 
 	/* emit code all basic blocks */
 	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (bb == cfg->cold_bb)
+			cfg->cold_code_offset = cfg->code_len;
 		bb->native_offset = cfg->code_len;
 		bb->real_native_offset = cfg->code_len;
 		//if ((bb == cfg->bb_entry) || !(bb->region == -1 && !bb->dfn))
@@ -4115,6 +4148,8 @@ mono_codegen (MonoCompile *cfg)
 #ifdef __native_client_codegen__
 	mono_nacl_fix_patches (cfg->native_code, cfg->patch_info);
 #endif
+	if (!cfg->cold_bb)
+		cfg->cold_code_offset = cfg->code_len;
 	mono_arch_emit_exceptions (cfg);
 
 	max_epilog_size = 0;
@@ -4148,8 +4183,15 @@ mono_codegen (MonoCompile *cfg)
 #ifdef MONO_ARCH_HAVE_UNWIND_TABLE
 		unwindlen = mono_arch_unwindinfo_get_size (cfg->arch.unwindinfo);
 #endif
-		code = mono_domain_code_reserve (code_domain, cfg->code_size + unwindlen);
+		if (is_cold_method (cfg)) {
+			code = mono_domain_code_reserve_cold (code_domain, cfg->code_size + unwindlen);
+			cfg->cold_code_offset = 0;
+		} else {
+			code = mono_domain_code_reserve (code_domain, cfg->code_size + unwindlen);
+		}
 	}
+	mono_jit_stats.hot_code_size += cfg->cold_code_offset;
+	mono_jit_stats.cold_code_size += cfg->code_len - cfg->cold_code_offset;
 #if defined(__native_client_codegen__) && defined(__native_client__)
 	nacl_allow_target_modification (TRUE);
 #endif
@@ -4300,6 +4342,21 @@ create_jit_info_for_trampoline (MonoMethod *wrapper, MonoTrampInfo *info)
 
 #ifndef DISABLE_JIT
 
+/*
+ * get_try_end_bblock:
+ *
+ *   Return the bblock whose native offset is the end of the try block of EC.
+ */
+static MonoBasicBlock*
+get_try_end_bblock (MonoCompile *cfg, MonoExceptionClause *ec)
+{
+	int clause_index = ec - cfg->header->clauses;
+
+	if (cfg->cold_try_end_bbs && cfg->cold_try_end_bbs [clause_index])
+		return cfg->cold_try_end_bbs [clause_index];
+	return cfg->cil_offset_to_bb [ec->try_offset + ec->try_len];
+}
+
 static MonoJitInfo*
 create_jit_info (MonoCompile *cfg, MonoMethod *method_to_compile)
 {
@@ -4339,7 +4396,7 @@ create_jit_info (MonoCompile *cfg, MonoMethod *method_to_compile)
 			TryBlockHole *hole = tmp->data;
 			MonoExceptionClause *ec = hole->clause;
 			int hole_end = hole->basic_block->native_offset + hole->basic_block->native_length;
-			MonoBasicBlock *clause_last_bb = cfg->cil_offset_to_bb [ec->try_offset + ec->try_len];
+			MonoBasicBlock *clause_last_bb = get_try_end_bblock (cfg, ec);
 			g_assert (clause_last_bb);
 
 			/* Holes at the end of a try region can be represented by simply reducing the size of the block itself.*/
@@ -4470,7 +4527,7 @@ create_jit_info (MonoCompile *cfg, MonoMethod *method_to_compile)
 			TryBlockHole *hole_data = tmp->data;
 			MonoExceptionClause *ec = hole_data->clause;
 			int hole_end = hole_data->basic_block->native_offset + hole_data->basic_block->native_length;
-			MonoBasicBlock *clause_last_bb = cfg->cil_offset_to_bb [ec->try_offset + ec->try_len];
+			MonoBasicBlock *clause_last_bb = get_try_end_bblock (cfg, ec);
 			g_assert (clause_last_bb);
 
 			/* Holes at the end of a try region can be represented by simply reducing the size of the block itself.*/
@@ -4550,7 +4607,7 @@ create_jit_info (MonoCompile *cfg, MonoMethod *method_to_compile)
 				 */
 				ei->try_start = (guint8*)ei->try_start - MONO_ARCH_MONITOR_ENTER_ADJUSTMENT;
 			}
-			tblock = cfg->cil_offset_to_bb [ec->try_offset + ec->try_len];
+			tblock = get_try_end_bblock (cfg, ec);
 			g_assert (tblock);
 			if (!tblock->native_offset) {
 				int j, end;
@@ -4977,6 +5034,10 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		cfg->generic_sharing_context = (MonoGenericSharingContext*)&cfg->gsctx;
 	cfg->compile_llvm = try_llvm;
 	cfg->token_info_hash = g_hash_table_new (NULL, NULL);
+	cfg->defer_cctors = (flags & JIT_FLAG_DEFER_CCTORS) ? 1 : 0;
+	if (flags & JIT_FLAG_TIER0)
+		cfg->tier_info = mini_tiered_info_new (method, domain);
+	mini_jit_prof_method_begin (cfg);
 
 	if (cfg->gen_seq_points)
 		cfg->seq_points = g_ptr_array_new ();
@@ -5166,7 +5227,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		g_free (method_name);
 	}
 
-	if (cfg->opt & (MONO_OPT_ABCREM | MONO_OPT_SSAPRE))
+	if (cfg->opt & (MONO_OPT_ABCREM | MONO_OPT_SSAPRE | MONO_OPT_GVN))
 		cfg->opt |= MONO_OPT_SSA;
 
 	/* 
@@ -5269,6 +5330,8 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 
 	cfg->stat_basic_blocks += cfg->num_bblocks;
 
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_IR);
+
 	if (COMPILE_LLVM (cfg)) {
 		MonoInst *ins;
 
@@ -5315,23 +5378,55 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 
 	if (!COMPILE_LLVM (cfg))
 		mono_decompose_long_opts (cfg);
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DECOMPOSE);
+
+#ifdef MONO_ARCH_HAVE_IMULH
+	/* Should be done before cprop, since it emits constants into registers */
+	if ((cfg->flags & MONO_CFG_HAS_DIV_BY_CONST) && (cfg->opt & (MONO_OPT_CONSPROP | MONO_OPT_COPYPROP)) && !COMPILE_LLVM (cfg)) {
+		mono_decompose_div_by_const (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DECOMPOSE);
+	}
+#endif
+
+	if (cfg->flags & MONO_CFG_HAS_RGCTX_FETCH) {
+		mono_decompose_rgctx_fetch (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DECOMPOSE);
+	}
 
 	/* Should be done before branch opts */
-	if (cfg->opt & (MONO_OPT_CONSPROP | MONO_OPT_COPYPROP))
+	if (cfg->opt & (MONO_OPT_CONSPROP | MONO_OPT_COPYPROP)) {
 		mono_local_cprop (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_CPROP);
+	}
 
-	if (cfg->opt & MONO_OPT_BRANCH)
+	if (cfg->opt & MONO_OPT_BRANCH) {
+		mono_lower_compare_chains (cfg);
 		mono_optimize_branches (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_BRANCH);
+	}
 
 	/* This must be done _before_ global reg alloc and _after_ decompose */
 	mono_handle_global_vregs (cfg);
-	if (cfg->opt & MONO_OPT_DEADCE)
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_REGALLOC);
+	if (cfg->opt & MONO_OPT_DEADCE) {
 		mono_local_deadce (cfg);
-	if (cfg->opt & MONO_OPT_ALIAS_ANALYSIS)
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DEADCE);
+	}
+	if (cfg->opt & MONO_OPT_ALIAS_ANALYSIS) {
 		mono_local_alias_analysis (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_ALIAS);
+	}
 	/* Disable this for LLVM to make the IR easier to handle */
-	if (!COMPILE_LLVM (cfg))
+	if (!COMPILE_LLVM (cfg)) {
 		mono_if_conversion (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_IF_CONV);
+	}
+
+	/* This adds bblocks, so it has to be done before they are ordered */
+	if (cfg->opt & MONO_OPT_VECTORIZE) {
+		mono_vectorize_loops (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_VECTORIZE);
+	}
 
 	if ((cfg->opt & MONO_OPT_SSAPRE) || cfg->globalra)
 		mono_remove_critical_edges (cfg);
@@ -5383,6 +5478,55 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		mono_compile_dominator_info (cfg, MONO_COMP_DOM | MONO_COMP_IDOM);
 		mono_compute_natural_loops (cfg);
 	}
+	/* This includes the ordering of the bblocks */
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_LOOP);
+
+	if (cfg->opt & MONO_OPT_ESCAPE) {
+		mono_compile_dominator_info (cfg, MONO_COMP_DOM | MONO_COMP_IDOM);
+		mono_escape_analysis (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_ESCAPE);
+	}
+
+	/*
+	 * Expand the write barriers emitted by method_to_ir, removing the redundant ones.
+	 * This is done after escape analysis, which removes the barriers of the stores into
+	 * the objects it replaces, and would treat the expanded ones as escapes.
+	 */
+	if (cfg->flags & MONO_CFG_HAS_WBARRIERS) {
+		int num_bblocks = cfg->num_bblocks;
+		int max_block_num;
+
+		/* Number the bblocks added by the expansion after all the existing ones */
+		cfg->num_bblocks = cfg->max_block_num;
+		mono_lower_write_barriers (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DECOMPOSE);
+
+		max_block_num = cfg->num_bblocks;
+		cfg->num_bblocks = num_bblocks;
+		if (max_block_num != cfg->max_block_num) {
+			MonoBasicBlock *bb;
+
+			/* The new bblocks use vregs defined in other bblocks, and have to be ordered */
+			mono_handle_global_vregs (cfg);
+
+			mono_free_loop_info (cfg);
+			cfg->comp_done &= ~MONO_COMP_DOM;
+			for (bb = cfg->bb_entry; bb; bb = bb->next_bb)
+				bb->dfn = 0;
+
+			cfg->num_bblocks = cfg->max_block_num = max_block_num;
+			cfg->bblocks = mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * (cfg->num_bblocks + 1));
+			dfn = 0;
+			df_visit (cfg->bb_entry, &dfn, cfg->bblocks);
+			cfg->num_bblocks = dfn + 1;
+
+			if (cfg->opt & MONO_OPT_LOOP) {
+				mono_compile_dominator_info (cfg, MONO_COMP_DOM | MONO_COMP_IDOM);
+				mono_compute_natural_loops (cfg);
+			}
+		}
+	}
+	cfg->wbarriers_lowered = TRUE;
 
 	/* after method_to_ir */
 	if (parts == 1) {
@@ -5417,6 +5561,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 			if (cfg->verbose_level >= 2) {
 				print_dfn (cfg);
 			}
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_SSA);
 		}
 	}
 #endif
@@ -5432,6 +5577,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		if (cfg->comp_done & MONO_COMP_SSA && !COMPILE_LLVM (cfg)) {
 #ifndef DISABLE_SSA
 			mono_ssa_cprop (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_SSA_CPROP);
 #endif
 		}
 	}
@@ -5445,19 +5591,37 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 			//mono_local_cprop (cfg);
 		}
 
+		if (cfg->opt & MONO_OPT_GVN) {
+			mono_perform_gvn (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_GVN);
+		}
+
 		if (cfg->opt & MONO_OPT_DEADCE) {
 			mono_ssa_deadce (cfg);
 			deadce_has_run = TRUE;
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DEADCE);
+		}
+
+		if (cfg->opt & MONO_OPT_LOOP) {
+			mono_perform_licm (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_LICM);
 		}
 
-		if ((cfg->flags & (MONO_CFG_HAS_LDELEMA|MONO_CFG_HAS_CHECK_THIS)) && (cfg->opt & MONO_OPT_ABCREM))
+		if ((cfg->flags & (MONO_CFG_HAS_LDELEMA|MONO_CFG_HAS_CHECK_THIS)) && (cfg->opt & MONO_OPT_ABCREM)) {
 			mono_perform_abc_removal (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_ABCREM);
+		}
 
 		mono_ssa_remove (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_SSA);
 		mono_local_cprop (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_CPROP);
 		mono_handle_global_vregs (cfg);
-		if (cfg->opt & MONO_OPT_DEADCE)
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_REGALLOC);
+		if (cfg->opt & MONO_OPT_DEADCE) {
 			mono_local_deadce (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DEADCE);
+		}
 
 		if (cfg->opt & MONO_OPT_BRANCH) {
 			MonoBasicBlock *bb;
@@ -5478,6 +5642,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 				df_visit (cfg->bb_entry, &dfn, cfg->bblocks);
 				cfg->num_bblocks = dfn + 1;
 			}
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_BRANCH);
 		}
 	}
 #endif
@@ -5487,6 +5652,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		/* This removes MONO_INST_FAULT flags too so perform it unconditionally */
 		if (cfg->opt & MONO_OPT_ABCREM)
 			mono_perform_abc_removal (cfg);
+		MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_LICM);
 	}
 
 	/* after SSA removal */
@@ -5506,6 +5672,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		mono_decompose_vtype_opts (cfg);
 	if (cfg->flags & MONO_CFG_HAS_ARRAY_ACCESS)
 		mono_decompose_array_access_opts (cfg);
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DECOMPOSE);
 
 	if (cfg->got_var) {
 #ifndef MONO_ARCH_GOT_REG
@@ -5583,6 +5750,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		if (cfg->exception_type)
 			return cfg;
 	}
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_REGALLOC);
 
 	{
 		MonoBasicBlock *bb;
@@ -5591,14 +5759,24 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		if (!cfg->globalra && !COMPILE_LLVM (cfg)) {
 			mono_spill_global_vars (cfg, &need_local_opts);
 
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_REGALLOC);
+
 			if (need_local_opts || cfg->compile_aot) {
 				/* To optimize code created by spill_global_vars */
 				mono_local_cprop (cfg);
-				if (cfg->opt & MONO_OPT_DEADCE)
+				MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_CPROP);
+				if (cfg->opt & MONO_OPT_DEADCE) {
 					mono_local_deadce (cfg);
+					MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_DEADCE);
+				}
 			}
 		}
 
+		if ((cfg->opt & MONO_OPT_BRANCH) && !COMPILE_LLVM (cfg)) {
+			mono_move_cold_bblocks (cfg);
+			MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_BRANCH);
+		}
+
 		/* Add branches between non-consecutive bblocks */
 		for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
 			if (bb->last_ins && MONO_IS_COND_BRANCH_OP (bb->last_ins) &&
@@ -5676,6 +5854,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	} else {
 		mono_codegen (cfg);
 	}
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_EMIT);
 
 	if (COMPILE_LLVM (cfg))
 		InterlockedIncrement (&mono_jit_stats.methods_with_llvm);
@@ -5739,6 +5918,8 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	}
 	mono_jit_stats.native_code_size += cfg->code_len;
 
+	MONO_JIT_PROF_PHASE (cfg, MONO_JIT_PHASE_JIT_INFO);
+
 	if (MONO_METHOD_COMPILE_END_ENABLED ())
 		MONO_PROBE_METHOD_COMPILE_END (method, TRUE);
 
@@ -5802,6 +5983,12 @@ lookup_method (MonoDomain *domain, MonoMethod *method)
 {
 	MonoJitInfo *info;
 
+	if (domain_jit_info (domain)) {
+		info = mono_conc_hashtable_lookup (domain_jit_info (domain)->jit_code_cache, method);
+		if (info)
+			return info;
+	}
+
 	mono_loader_lock (); /*FIXME lookup_method_inner acquired it*/
 	mono_domain_jit_code_hash_lock (domain);
 	info = lookup_method_inner (domain, method);
@@ -5850,8 +6037,13 @@ mono_jit_map_is_enabled (void)
 
 #endif
 
+/*
+ * mono_jit_compile_method_inner:
+ *
+ *   Compile METHOD, then run the class constructor of its class, unless JIT_ONLY is set.
+ */
 static gpointer
-mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, MonoException **jit_ex)
+mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, gboolean jit_only, MonoException **jit_ex)
 {
 	MonoCompile *cfg;
 	gpointer code = NULL;
@@ -5860,7 +6052,10 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	MonoException *ex = NULL;
 	guint32 prof_options;
 	GTimer *jit_timer;
+	double jit_time;
 	MonoMethod *prof_method;
+	JitFlags jit_flags;
+	guint32 tier_opt;
 
 #ifdef MONO_USE_AOT_COMPILER
 	if (opt & MONO_OPT_AOT) {
@@ -5871,7 +6066,8 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		if ((code = mono_aot_get_method (domain, method))) {
 			vtable = mono_class_vtable (domain, method->klass);
 			g_assert (vtable);
-			mono_runtime_class_init (vtable);
+			if (!jit_only)
+				mono_runtime_class_init (vtable);
 
 			return code;
 		}
@@ -5991,15 +6187,27 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		return NULL;
 	}
 
+	jit_flags = JIT_FLAG_RUN_CCTORS;
+	if (jit_only)
+		jit_flags |= JIT_FLAG_DEFER_CCTORS;
+	tier_opt = opt;
+	if (mini_tiered_method_is_eligible (method, target_domain, opt)) {
+		jit_flags |= JIT_FLAG_TIER0;
+		tier_opt = mini_tiered_tier0_opts (opt);
+	}
+
 	jit_timer = g_timer_new ();
 
-	cfg = mini_method_compile (method, opt, target_domain, JIT_FLAG_RUN_CCTORS, 0);
+	cfg = mini_method_compile (method, tier_opt, target_domain, jit_flags, 0);
 	prof_method = cfg->method;
 
 	g_timer_stop (jit_timer);
-	mono_jit_stats.jit_time += g_timer_elapsed (jit_timer, NULL);
+	jit_time = g_timer_elapsed (jit_timer, NULL);
+	mono_jit_stats.jit_time += jit_time;
 	g_timer_destroy (jit_timer);
 
+	mini_jit_prof_method_end (cfg);
+
 	switch (cfg->exception_type) {
 	case MONO_EXCEPTION_NONE:
 		break;
@@ -6103,7 +6311,14 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	
 	if (code == NULL) {
 		mono_internal_hash_table_insert (&target_domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
+		/* Dynamic methods can be freed, so they are only looked up under the lock */
+		if (!method->dynamic)
+			mono_conc_hashtable_insert (domain_jit_info (target_domain)->jit_code_cache, cfg->jit_info->d.method, cfg->jit_info);
+		if (cfg->tier_info)
+			mini_tiered_register_tier0_code (cfg->tier_info, cfg->jit_info, opt, jit_time);
 		mono_domain_jit_code_hash_unlock (target_domain);
+		/* This does file I/O, so it is done outside the lock */
+		mini_jit_pool_record_method (method);
 		code = cfg->native_code;
 
 		if (cfg->generic_sharing_context && mono_method_is_generic_sharable (method, FALSE))
@@ -6187,16 +6402,18 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		}
 	}
 
-	ex = mono_runtime_class_init_full (vtable, FALSE);
-	if (ex) {
-		*jit_ex = ex;
-		return NULL;
+	if (!jit_only) {
+		ex = mono_runtime_class_init_full (vtable, FALSE);
+		if (ex) {
+			*jit_ex = ex;
+			return NULL;
+		}
 	}
 	return code;
 }
 
 static gpointer
-mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException **ex)
+mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, gboolean jit_only, MonoException **ex)
 {
 	MonoDomain *target_domain, *domain = mono_domain_get ();
 	MonoJitInfo *info;
@@ -6253,6 +6470,8 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException
 			MonoException *tmpEx;
 
 			mono_jit_stats.methods_lookups++;
+			if (jit_only)
+				return mono_create_ftnptr (target_domain, info->code_start);
 			vtable = mono_class_vtable (domain, method->klass);
 			g_assert (vtable);
 			tmpEx = mono_runtime_class_init_full (vtable, ex == NULL);
@@ -6264,7 +6483,7 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoException
 		}
 	}
 
-	code = mono_jit_compile_method_inner (method, target_domain, opt, ex);
+	code = mono_jit_compile_method_inner (method, target_domain, opt, jit_only, ex);
 	if (!code)
 		return NULL;
 
@@ -6301,7 +6520,7 @@ mono_jit_compile_method (MonoMethod *method)
 	MonoException *ex = NULL;
 	gpointer code;
 
-	code = mono_jit_compile_method_with_opt (method, mono_get_optimizations_for_method (method, default_opt), &ex);
+	code = mono_jit_compile_method_with_opt (method, mono_get_optimizations_for_method (method, default_opt), FALSE, &ex);
 	if (!code) {
 		g_assert (ex);
 		mono_raise_exception (ex);
@@ -6310,6 +6529,21 @@ mono_jit_compile_method (MonoMethod *method)
 	return code;
 }
 
+/*
+ * mono_jit_compile_method_jit_only:
+ *
+ *   Same as mono_jit_compile_method (), but don't run the class constructor of
+ * the class of METHOD, and return NULL and set EX instead of throwing an
+ * exception if the method cannot be compiled. The code is registered like
+ * normal, so the first call to METHOD finds it and runs the class constructor
+ * then.
+ */
+gpointer
+mono_jit_compile_method_jit_only (MonoMethod *method, MonoException **ex)
+{
+	return mono_jit_compile_method_with_opt (method, mono_get_optimizations_for_method (method, default_opt), TRUE, ex);
+}
+
 #ifdef MONO_ARCH_HAVE_INVALIDATE_METHOD
 static void
 invalidated_delegate_trampoline (char *desc)
@@ -6539,7 +6773,7 @@ mono_jit_runtime_invoke (MonoMethod *method, void *obj, void **params, MonoObjec
 		if (callee) {
 			MonoException *jit_ex = NULL;
 
-			info->compiled_method = mono_jit_compile_method_with_opt (callee, mono_get_optimizations_for_method (callee, default_opt), &jit_ex);
+			info->compiled_method = mono_jit_compile_method_with_opt (callee, mono_get_optimizations_for_method (callee, default_opt), FALSE, &jit_ex);
 			if (!info->compiled_method) {
 				g_free (info);
 				g_assert (jit_ex);
@@ -7041,10 +7275,31 @@ register_jit_stats (void)
 	mono_counters_register ("Method cache lookups", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_lookups);
 	mono_counters_register ("Compiled CIL code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cil_code_size);
 	mono_counters_register ("Native code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.native_code_size);
+	mono_counters_register ("Hot native code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.hot_code_size);
+	mono_counters_register ("Cold native code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cold_code_size);
 	mono_counters_register ("Aliases found", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.alias_found);
 	mono_counters_register ("Aliases eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.alias_removed);
 	mono_counters_register ("Aliased loads eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.loads_eliminated);
 	mono_counters_register ("Aliased stores eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.stores_eliminated);
+	mono_counters_register ("Valuetype vars promoted", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.vtypes_promoted);
+	mono_counters_register ("Loop invariants hoisted", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.licm_hoisted);
+	mono_counters_register ("Loop invariant loads removed", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.licm_loads_removed);
+	mono_counters_register ("GVN redundant expressions removed", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvn_removed);
+	mono_counters_register ("GVN redundant loads removed", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvn_loads_removed);
+	mono_counters_register ("GVN redundant checks removed", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvn_checks_removed);
+	mono_counters_register ("Loops vectorized", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.loops_vectorized);
+	mono_counters_register ("Allocations scalar replaced", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocs_scalar_replaced);
+	mono_counters_register ("Allocations moved to the stack", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocs_stack_allocated);
+	mono_counters_register ("Boxes eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.boxes_eliminated);
+	mono_counters_register ("Cast cache inline misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cast_cache_inline_misses);
+	mono_counters_register ("Cast cache secondary hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cast_cache_secondary_hits);
+	mono_counters_register ("RGCTX fetches inlined", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.rgctx_fetches_inlined);
+	mono_counters_register ("RGCTX inline fetch misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.rgctx_inline_misses);
+	mono_counters_register ("Compare chains to jump tables", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.chains_to_jump_tables);
+	mono_counters_register ("Compare chains to bit tests", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.chains_to_bit_tests);
+	mono_counters_register ("Compare chains to trees", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.chains_to_trees);
+	mono_counters_register ("Write barriers elided", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.wbarriers_elided);
+	mono_counters_register ("Write barriers coalesced", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.wbarriers_coalesced);
 }
 
 static void runtime_invoke_info_free (gpointer value);
@@ -7064,6 +7319,7 @@ mini_create_jit_domain_info (MonoDomain *domain)
 	info->seq_points = g_hash_table_new_full (mono_aligned_addr_hash, NULL, NULL, seq_point_info_free);
 	info->arch_seq_points = g_hash_table_new (mono_aligned_addr_hash, NULL);
 	info->jump_target_hash = g_hash_table_new (NULL, NULL);
+	info->jit_code_cache = mono_conc_hashtable_new (NULL, NULL);
 
 	domain->runtime_info = info;
 }
@@ -7120,6 +7376,9 @@ mini_free_jit_domain_info (MonoDomain *domain)
 {
 	MonoJitDomainInfo *info = domain_jit_info (domain);
 
+	/* The jit info of the domain is freed without going through mono_jit_info_table_remove () */
+	mono_eh_cache_invalidate ();
+
 	g_hash_table_foreach (info->jump_target_hash, delete_jump_list, NULL);
 	g_hash_table_destroy (info->jump_target_hash);
 	if (info->jump_target_got_slot_hash) {
@@ -7146,6 +7405,7 @@ mini_free_jit_domain_info (MonoDomain *domain)
 		mono_debugger_agent_free_domain_info (domain);
 	if (info->gsharedvt_arg_tramp_hash)
 		g_hash_table_destroy (info->gsharedvt_arg_tramp_hash);
+	mono_conc_hashtable_destroy (info->jit_code_cache);
 
 	g_free (domain->runtime_info);
 	domain->runtime_info = NULL;
@@ -7363,6 +7623,11 @@ mini_init (const char *filename, const char *runtime_version)
 #endif
 
 	register_jit_stats ();
+	mini_inliner_init ();
+	mini_pic_init ();
+	if (mono_tiered_jit)
+		mini_tiered_init ();
+	mini_jit_prof_init ();
 
 #define JIT_CALLS_WORK
 #ifdef JIT_CALLS_WORK
@@ -7538,6 +7803,8 @@ mini_init (const char *filename, const char *runtime_version)
 	register_icall (mono_ldvirtfn, "mono_ldvirtfn", "ptr object ptr", FALSE);
 	register_icall (mono_ldvirtfn_gshared, "mono_ldvirtfn_gshared", "ptr object ptr", FALSE);
 	register_icall (mono_helper_compile_generic_method, "mono_helper_compile_generic_method", "ptr object ptr ptr", FALSE);
+	register_icall (mono_tiered_queue_tier_up, "mono_tiered_queue_tier_up", "void ptr", FALSE);
+	register_icall (mono_pic_record_miss, "mono_pic_record_miss", "void ptr ptr", FALSE);
 	register_icall (mono_helper_ldstr, "mono_helper_ldstr", "object ptr int", FALSE);
 	register_icall (mono_helper_ldstr_mscorlib, "mono_helper_ldstr_mscorlib", "object int", FALSE);
 	register_icall (mono_helper_newobj_mscorlib, "mono_helper_newobj_mscorlib", "object int", FALSE);
@@ -7557,6 +7824,10 @@ mini_init (const char *filename, const char *runtime_version)
 	register_icall (mono_gsharedvt_value_copy, "mono_gsharedvt_value_copy", "void ptr ptr ptr", TRUE);
 
 	register_icall (mono_gc_wbarrier_value_copy_bitmap, "mono_gc_wbarrier_value_copy_bitmap", "void ptr ptr int int", FALSE);
+	register_icall (mono_jit_memcpy, "mono_jit_memcpy", "void ptr ptr int32", FALSE);
+	register_icall (mono_jit_memset, "mono_jit_memset", "void ptr int32 int32", FALSE);
+	register_icall (mono_fill_class_rgctx, "mono_fill_class_rgctx", "ptr ptr int32", FALSE);
+	register_icall (mono_fill_method_rgctx, "mono_fill_method_rgctx", "ptr ptr int32", FALSE);
 
 	register_icall (mono_object_castclass_with_cache, "mono_object_castclass_with_cache", "object object ptr ptr", FALSE);
 	register_icall (mono_object_isinst_with_cache, "mono_object_isinst_with_cache", "object object ptr ptr", FALSE);
@@ -7574,6 +7845,10 @@ mini_init (const char *filename, const char *runtime_version)
 	mono_simd_intrinsics_init ();
 #endif
 
+#ifdef MONO_ARCH_STRING_SIMD
+	mono_string_simd_init ();
+#endif
+
 #if MONO_SUPPORT_TASKLETS
 	mono_tasklets_init ();
 #endif
@@ -7683,6 +7958,10 @@ mini_cleanup (MonoDomain *domain)
 	/* This accesses metadata so needs to be called before runtime shutdown */
 	print_jit_stats ();
 
+	mini_inliner_cleanup ();
+	mini_pic_cleanup ();
+	mini_jit_prof_cleanup ();
+
 	mono_profiler_shutdown ();
 
 #ifndef MONO_CROSS_COMPILE
@@ -7790,18 +8069,23 @@ mono_get_runtime_build_info (void)
 		return g_strdup_printf ("%s (%s)", VERSION, FULL_VERSION);
 }
 
+typedef struct {
+	GHashTable *assemblies;
+	GPtrArray *methods;
+} PrecompileData;
+
 static void
 mono_precompile_assembly (MonoAssembly *ass, void *user_data)
 {
-	GHashTable *assemblies = (GHashTable*)user_data;
+	PrecompileData *data = user_data;
 	MonoImage *image = mono_assembly_get_image (ass);
 	MonoMethod *method, *invoke;
-	int i, count = 0;
+	int i;
 
-	if (g_hash_table_lookup (assemblies, ass))
+	if (g_hash_table_lookup (data->assemblies, ass))
 		return;
 
-	g_hash_table_insert (assemblies, ass, ass);
+	g_hash_table_insert (data->assemblies, ass, ass);
 
 	if (mini_verbose > 0)
 		printf ("PRECOMPILE: %s.\n", mono_image_get_filename (image));
@@ -7810,22 +8094,19 @@ mono_precompile_assembly (MonoAssembly *ass, void *user_data)
 		method = mono_get_method (image, MONO_TOKEN_METHOD_DEF | (i + 1), NULL);
 		if (method->flags & METHOD_ATTRIBUTE_ABSTRACT)
 			continue;
+		/* Open generic methods can only be compiled once they are instantiated */
+		if (method->is_generic || method->klass->generic_container)
+			continue;
 
-		count++;
-		if (mini_verbose > 1) {
-			char * desc = mono_method_full_name (method, TRUE);
-			g_print ("Compiling %d %s\n", count, desc);
-			g_free (desc);
-		}
-		mono_compile_method (method);
+		g_ptr_array_add (data->methods, method);
 		if (strcmp (method->name, "Finalize") == 0) {
 			invoke = mono_marshal_get_runtime_invoke (method, FALSE);
-			mono_compile_method (invoke);
+			g_ptr_array_add (data->methods, invoke);
 		}
 #ifndef DISABLE_REMOTING
 		if (mono_class_is_marshalbyref (method->klass) && mono_method_signature (method)->hasthis) {
 			invoke = mono_marshal_get_remoting_invoke_with_check (method);
-			mono_compile_method (invoke);
+			g_ptr_array_add (data->methods, invoke);
 		}
 #endif
 	}
@@ -7834,17 +8115,32 @@ mono_precompile_assembly (MonoAssembly *ass, void *user_data)
 	for (i = 0; i < mono_image_get_table_rows (image, MONO_TABLE_ASSEMBLYREF); ++i) {
 		mono_assembly_load_reference (image, i);
 		if (image->references [i])
-			mono_precompile_assembly (image->references [i], assemblies);
+			mono_precompile_assembly (image->references [i], data);
 	}
 }
 
+/*
+ * mono_precompile_assemblies:
+ *
+ *   Compile the methods in the recorded method list set with --jit-pool, or
+ * all the methods in the loaded assemblies and their references.
+ */
 void mono_precompile_assemblies ()
 {
-	GHashTable *assemblies = g_hash_table_new (NULL, NULL);
+	GPtrArray *methods;
 
-	mono_assembly_foreach ((GFunc)mono_precompile_assembly, assemblies);
+	methods = mini_jit_pool_load_method_list ();
+	if (!methods) {
+		PrecompileData data;
+
+		data.assemblies = g_hash_table_new (NULL, NULL);
+		data.methods = methods = g_ptr_array_new ();
+		mono_assembly_foreach ((GFunc)mono_precompile_assembly, &data);
+		g_hash_table_destroy (data.assemblies);
+	}
 
-	g_hash_table_destroy (assemblies);
+	/* This takes ownership of METHODS */
+	mini_jit_pool_compile (methods, mini_verbose);
 }
 
 #ifndef DISABLE_JIT
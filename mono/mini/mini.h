@@ -30,6 +30,7 @@
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/mono-tls.h>
 #include <mono/utils/atomic.h>
+#include <mono/utils/mono-conc-hashtable.h>
 
 #define MONO_BREAKPOINT_ARRAY_SIZE 64
 
@@ -122,7 +123,7 @@
 #endif
 
 /* Version number of the AOT file format */
-#define MONO_AOT_FILE_VERSION 97
+#define MONO_AOT_FILE_VERSION 98
 
 //TODO: This is x86/amd64 specific.
 #define mono_simd_shuffle_mask(a,b,c,d) ((a) | ((b) << 2) | ((c) << 4) | ((d) << 6))
@@ -308,6 +309,12 @@ typedef struct
 	/* memcpy/bzero methods specialized for small constant sizes */
 	gpointer *memcpy_addr [17];
 	gpointer *bzero_addr [17];
+	/*
+	 * Lock-free mirror of domain->jit_code_hash, maps MonoMethod -> MonoJitInfo.
+	 * Entries are added/removed together with the ones in jit_code_hash, so
+	 * lookups can avoid the loader and jit_code_hash locks.
+	 */
+	MonoConcurrentHashTable *jit_code_cache;
 } MonoJitDomainInfo;
 
 typedef struct {
@@ -497,6 +504,8 @@ typedef struct MonoCallArgParm MonoCallArgParm;
 typedef struct MonoMethodVar MonoMethodVar;
 typedef struct MonoBasicBlock MonoBasicBlock;
 typedef struct MonoLMF MonoLMF;
+typedef struct MonoTierInfo MonoTierInfo;
+typedef struct MonoJitProfInfo MonoJitProfInfo;
 typedef struct MonoSpillInfo MonoSpillInfo;
 typedef struct MonoTraceSpec MonoTraceSpec;
 
@@ -519,6 +528,9 @@ extern gboolean mono_do_x86_stack_align;
 extern const char *mono_build_date;
 extern gboolean mono_do_signal_chaining;
 extern gboolean mono_use_llvm;
+extern gboolean mono_tiered_jit;
+extern gboolean mono_jit_prof_enabled;
+extern const char *mono_jit_prof_file;
 extern gboolean mono_do_single_method_regression;
 extern guint32 mono_single_method_regression_opt;
 extern MonoMethod *mono_current_single_method;
@@ -978,6 +990,16 @@ typedef struct {
 	MonoLiveRange2 *last_range;
 } MonoLiveInterval;
 
+/*
+ * An allocation of an object whose class is known at compile time, made by
+ * INS. Used by escape analysis and write barrier elimination.
+ */
+typedef struct {
+	MonoInst *ins;
+	MonoClass *klass;
+	MonoVTable *vtable;
+} MonoAllocSite;
+
 /*
  * Additional information about a variable
  */
@@ -1281,7 +1303,11 @@ typedef enum {
 	/* Whenever this is an AOT compilation */
 	JIT_FLAG_AOT = (1 << 1),
 	/* Whenever this is a full AOT compilation */
-	JIT_FLAG_FULL_AOT = (1 << 2)
+	JIT_FLAG_FULL_AOT = (1 << 2),
+	/* Whenever to compile the cheap, call counting version of a method for tiered compilation */
+	JIT_FLAG_TIER0 = (1 << 3),
+	/* Whenever to leave running the cctors of the classes used by the method to the generated code */
+	JIT_FLAG_DEFER_CCTORS = (1 << 4)
 } JitFlags;
 
 /* Bit-fields in the MonoBasicBlock.region */
@@ -1414,6 +1440,8 @@ typedef struct {
 	guint            code_len;
 	guint            prolog_end;
 	guint            epilog_begin;
+	/* The start of the rarely executed code at the end of the method */
+	guint            cold_code_offset;
 	regmask_t        used_int_regs;
 	guint32          opt;
 	guint32          prof_options;
@@ -1429,6 +1457,7 @@ typedef struct {
 	guint            disable_llvm : 1;
 	guint            enable_extended_bblocks : 1;
 	guint            run_cctors : 1;
+	guint            defer_cctors : 1;
 	guint            need_lmf_area : 1;
 	guint            compile_aot : 1;
 	guint            full_aot : 1;
@@ -1461,6 +1490,8 @@ typedef struct {
 	 */
 	guint            lmf_ir_mono_lmf : 1;
 	guint            gen_write_barriers : 1;
+	/* Set after mono_lower_write_barriers (), write barriers are expanded immediately from then on */
+	guint            wbarriers_lowered : 1;
 	guint            init_ref_vars : 1;
 	guint            extend_live_ranges : 1;
 	guint            compute_precise_live_ranges : 1;
@@ -1562,6 +1593,9 @@ typedef struct {
 	/* Method headers which need to be freed after compilation */
 	GSList *headers_to_free;
 
+	/* The MonoAllocSites of the method, used by escape analysis and write barrier elimination */
+	GSList *alloc_sites;
+
 	/* Used by AOT */
 	guint32 got_offset, ex_info_offset, method_info_offset, method_index;
 	/* Symbol used to refer to this method in generated assembly */
@@ -1574,6 +1608,11 @@ typedef struct {
 
 	GSList *try_block_holes;
 
+	/* The first of the bblocks moved to the end of the method by mono_move_cold_bblocks () */
+	MonoBasicBlock *cold_bb;
+	/* Maps clause indexes to the bblock ending their try block if their handler was moved */
+	MonoBasicBlock **cold_try_end_bbs;
+
 	/* DWARF location list for 'this' */
 	GSList *this_loclist;
 
@@ -1598,6 +1637,15 @@ typedef struct {
 	guint8 *gc_map;
 	guint32 gc_map_size;
 
+	/* The tiered compilation state of the method, set for tier 0 compilations */
+	MonoTierInfo *tier_info;
+
+	/* The JIT profiler data of the compilation, set if the JIT profiler is active */
+	MonoJitProfInfo *jit_prof;
+
+	/* The amount of IL inlined beyond the default size limit, see inliner.c */
+	int inline_budget_used;
+
 	/* Stats */
 	int stat_allocate_var;
 	int stat_locals_stack_size;
@@ -1619,7 +1667,10 @@ typedef enum {
 	MONO_CFG_HAS_FPOUT    = 1 << 5, /* there are fp values passed in int registers */
 	MONO_CFG_HAS_SPILLUP  = 1 << 6, /* spill var slots are allocated from bottom to top */
 	MONO_CFG_HAS_CHECK_THIS  = 1 << 7,
-	MONO_CFG_HAS_ARRAY_ACCESS = 1 << 8
+	MONO_CFG_HAS_ARRAY_ACCESS = 1 << 8,
+	MONO_CFG_HAS_DIV_BY_CONST = 1 << 9,
+	MONO_CFG_HAS_RGCTX_FETCH = 1 << 10,
+	MONO_CFG_HAS_WBARRIERS = 1 << 11
 } MonoCompileFlags;
 
 typedef struct {
@@ -1629,6 +1680,8 @@ typedef struct {
 	gint32 allocate_var;
 	gint32 cil_code_size;
 	gint32 native_code_size;
+	gint32 hot_code_size;
+	gint32 cold_code_size;
 	gint32 code_reallocs;
 	gint32 max_code_size_ratio;
 	gint32 biggest_method_size;
@@ -1650,6 +1703,25 @@ typedef struct {
 	gint32 alias_removed;
 	gint32 loads_eliminated;
 	gint32 stores_eliminated;
+	gint32 vtypes_promoted;
+	gint32 licm_hoisted;
+	gint32 licm_loads_removed;
+	gint32 gvn_removed;
+	gint32 gvn_loads_removed;
+	gint32 gvn_checks_removed;
+	gint32 loops_vectorized;
+	gint32 allocs_scalar_replaced;
+	gint32 allocs_stack_allocated;
+	gint32 boxes_eliminated;
+	gint32 cast_cache_inline_misses;
+	gint32 cast_cache_secondary_hits;
+	gint32 rgctx_fetches_inlined;
+	gint32 rgctx_inline_misses;
+	gint32 chains_to_jump_tables;
+	gint32 chains_to_bit_tests;
+	gint32 chains_to_trees;
+	gint32 wbarriers_elided;
+	gint32 wbarriers_coalesced;
 	int methods_with_llvm;
 	int methods_without_llvm;
 	char *max_ratio_method;
@@ -1658,6 +1730,102 @@ typedef struct {
 	gboolean enabled;
 } MonoJitStats;
 
+/*
+ * The state of a method compiled by the first tier of tiered compilation. It
+ * lives in the domain mempool, since it is referenced by the tier 0 code.
+ */
+struct MonoTierInfo {
+	MonoMethod *method;
+	MonoDomain *domain;
+	/* The optimizations to recompile the method with */
+	guint32 opt;
+	/* Number of calls left before the method is queued for tier-up, decremented by the tier 0 code */
+	gint32 count;
+	/* Whenever the method has been queued for tier-up */
+	gint32 queued;
+	MonoJitInfo *tier0_ji;
+	/* The code which replaced the tier 0 code, or the tier 0 code itself if the tier-up failed */
+	gpointer tier1_code;
+	/* The call sites and slots pointing to the tier 0 code, see tiered.c */
+	GSList *patch_sites;
+};
+
+/* The phases of mini_method_compile () timed by the JIT profiler */
+typedef enum {
+	MONO_JIT_PHASE_IR,
+	MONO_JIT_PHASE_DECOMPOSE,
+	MONO_JIT_PHASE_CPROP,
+	MONO_JIT_PHASE_BRANCH,
+	MONO_JIT_PHASE_DEADCE,
+	MONO_JIT_PHASE_ALIAS,
+	MONO_JIT_PHASE_IF_CONV,
+	MONO_JIT_PHASE_VECTORIZE,
+	MONO_JIT_PHASE_LOOP,
+	MONO_JIT_PHASE_ESCAPE,
+	MONO_JIT_PHASE_SSA,
+	MONO_JIT_PHASE_SSA_CPROP,
+	MONO_JIT_PHASE_GVN,
+	MONO_JIT_PHASE_LICM,
+	MONO_JIT_PHASE_ABCREM,
+	MONO_JIT_PHASE_REGALLOC,
+	MONO_JIT_PHASE_EMIT,
+	MONO_JIT_PHASE_JIT_INFO,
+	MONO_JIT_PHASE_NUM
+} MonoJitPhase;
+
+/*
+ * The data collected by the JIT profiler during a compilation, see jit-prof.c.
+ * It lives in the mempool of the MonoCompile.
+ */
+struct MonoJitProfInfo {
+	/* In 100ns ticks */
+	gint64 start, last;
+	gint64 phase_times [MONO_JIT_PHASE_NUM];
+	/* JitProfInline structures, in reverse order */
+	GSList *inlines;
+};
+
+/* Attribute the time since the previous phase ended to PHASE */
+#define MONO_JIT_PROF_PHASE(cfg, phase) do { \
+		if (G_UNLIKELY ((cfg)->jit_prof)) \
+			mini_jit_prof_phase ((cfg), (phase)); \
+	} while (0)
+
+#define MONO_PIC_MAX_ENTRIES 4
+
+/*
+ * The receiver type feedback of a virtual call site in tier 0 code, see pic.c.
+ * It is never freed, since it is referenced by the tier 0 code.
+ */
+typedef struct MonoPicSite MonoPicSite;
+
+struct MonoPicSite {
+	/* The vtables of the receivers, the first one is checked inline */
+	MonoVTable *vtables [MONO_PIC_MAX_ENTRIES];
+	gint32 hits [MONO_PIC_MAX_ENTRIES];
+	/* Calls whose receiver didn't fit into the cache */
+	gint32 misses;
+	MonoMethod *method;
+	MonoMethod *callee;
+	guint32 il_offset;
+	MonoPicSite *next;
+};
+
+#define MONO_CAST_CACHE_SECONDARY_ENTRIES 4
+
+/*
+ * The cache of a castclass/isinst site which can't be checked inline.
+ * Entries hold the vtable of an object which was an instance of the class, or the
+ * vtable with the low bit set for objects which were not. The first entry is checked
+ * inline, the secondary ones by mono_object_castclass/isinst_with_cache ().
+ */
+typedef struct {
+	gpointer cached_vtable;
+	/* The class to cast to, only set in caches created for shared generic code */
+	MonoClass *klass;
+	gpointer secondary [MONO_CAST_CACHE_SECONDARY_ENTRIES];
+} MonoCastCache;
+
 extern MonoJitStats mono_jit_stats;
 
 /* opcodes: value assigned after all the CIL opcodes */
@@ -1963,6 +2131,8 @@ void      mono_remove_bblock                (MonoCompile *cfg, MonoBasicBlock *b
 void      mono_nullify_basic_block          (MonoBasicBlock *bb) MONO_INTERNAL;
 void      mono_merge_basic_blocks           (MonoCompile *cfg, MonoBasicBlock *bb, MonoBasicBlock *bbn) MONO_INTERNAL;
 void      mono_optimize_branches            (MonoCompile *cfg) MONO_INTERNAL;
+void      mono_lower_compare_chains         (MonoCompile *cfg) MONO_INTERNAL;
+void      mono_move_cold_bblocks            (MonoCompile *cfg) MONO_INTERNAL;
 
 void      mono_blockset_print               (MonoCompile *cfg, MonoBitSet *set, const char *name, guint idom) MONO_INTERNAL;
 void      mono_print_ji                     (const MonoJumpInfo *ji) MONO_INTERNAL;
@@ -1991,9 +2161,11 @@ guint     mono_patch_info_hash (gconstpointer data) MONO_INTERNAL;
 gint      mono_patch_info_equal (gconstpointer ka, gconstpointer kb) MONO_INTERNAL;
 MonoJumpInfo *mono_patch_info_list_prepend  (MonoJumpInfo *list, int ip, MonoJumpInfoType type, gconstpointer target) MONO_INTERNAL;
 gpointer  mono_resolve_patch_target         (MonoMethod *method, MonoDomain *domain, guint8 *code, MonoJumpInfo *patch_info, gboolean run_cctors) MONO_LLVM_INTERNAL;
+guint32   mini_get_rgctx_entry_slot         (MonoJumpInfoRgctxEntry *entry) MONO_INTERNAL;
 gpointer  mono_jit_find_compiled_method_with_jit_info (MonoDomain *domain, MonoMethod *method, MonoJitInfo **ji) MONO_INTERNAL;
 gpointer  mono_jit_find_compiled_method     (MonoDomain *domain, MonoMethod *method) MONO_INTERNAL;
 gpointer  mono_jit_compile_method           (MonoMethod *method) MONO_INTERNAL;
+gpointer  mono_jit_compile_method_jit_only  (MonoMethod *method, MonoException **ex) MONO_INTERNAL;
 MonoLMF * mono_get_lmf                      (void) MONO_INTERNAL;
 MonoLMF** mono_get_lmf_addr                 (void) MONO_INTERNAL;
 void      mono_set_lmf                      (MonoLMF *lmf) MONO_INTERNAL;
@@ -2139,6 +2311,52 @@ void     mono_save_trampoline_xdebug_info   (MonoTrampInfo *info) MONO_INTERNAL;
 /* This is an exported function */
 void     mono_xdebug_flush                  (void);
 
+/* Parallel precompilation */
+gboolean  mini_jit_pool_parse_options       (const char *options) MONO_INTERNAL;
+gboolean  mini_jit_pool_enabled             (void) MONO_INTERNAL;
+GPtrArray *mini_jit_pool_load_method_list   (void) MONO_INTERNAL;
+void      mini_jit_pool_compile             (GPtrArray *methods, int verbose) MONO_INTERNAL;
+void      mini_jit_pool_record_method       (MonoMethod *method) MONO_INTERNAL;
+
+/* Profile guided inlining */
+void      mini_inliner_init                 (void) MONO_INTERNAL;
+void      mini_inliner_cleanup              (void) MONO_INTERNAL;
+gboolean  mini_inliner_instrument           (MonoCompile *cfg) MONO_INTERNAL;
+gint32   *mini_inliner_get_call_counter     (MonoMethod *method, guint32 il_offset) MONO_INTERNAL;
+gint32    mini_inliner_get_site_count       (MonoMethod *method, guint32 il_offset) MONO_INTERNAL;
+gboolean  mini_inliner_check_call_site      (MonoCompile *cfg, MonoMethod *caller, guint32 il_offset, MonoMethod *callee,
+											 int code_size, int const_args, gboolean devirt, int *cost_limit) MONO_INTERNAL;
+
+/* Tiered compilation */
+void      mini_tiered_init                  (void) MONO_INTERNAL;
+gboolean  mini_tiered_method_is_eligible    (MonoMethod *method, MonoDomain *domain, guint32 opt) MONO_INTERNAL;
+guint32   mini_tiered_tier0_opts            (guint32 opt) MONO_INTERNAL;
+MonoTierInfo *mini_tiered_info_new          (MonoMethod *method, MonoDomain *domain) MONO_INTERNAL;
+void      mini_tiered_register_tier0_code   (MonoTierInfo *info, MonoJitInfo *ji, guint32 opt, double jit_time) MONO_INTERNAL;
+MonoTierInfo *mini_tiered_lookup_tier0_code (gpointer code) MONO_INTERNAL;
+void      mini_tiered_patch_slot            (MonoTierInfo *info, gpointer *slot) MONO_INTERNAL;
+void      mini_tiered_patch_callsite        (MonoTierInfo *info, guint8 *method_start, guint8 *code) MONO_INTERNAL;
+void      mini_tiered_patch_delegate        (MonoTierInfo *info, MonoDelegate *delegate) MONO_INTERNAL;
+void      mono_tiered_queue_tier_up         (MonoTierInfo *info) MONO_INTERNAL;
+
+/* JIT profiler */
+void      mini_jit_prof_init                (void) MONO_INTERNAL;
+void      mini_jit_prof_cleanup             (void) MONO_INTERNAL;
+void      mini_jit_prof_method_begin        (MonoCompile *cfg) MONO_INTERNAL;
+void      mini_jit_prof_method_end          (MonoCompile *cfg) MONO_INTERNAL;
+void      mini_jit_prof_phase               (MonoCompile *cfg, MonoJitPhase phase) MONO_INTERNAL;
+void      mini_jit_prof_inline              (MonoCompile *cfg, MonoMethod *callee, gboolean inlined, int cost) MONO_INTERNAL;
+void      mini_jit_prof_patch               (MonoMethod *method, int kind) MONO_INTERNAL;
+
+/* Receiver type feedback */
+void      mini_pic_init                     (void) MONO_INTERNAL;
+void      mini_pic_cleanup                  (void) MONO_INTERNAL;
+gboolean  mini_pic_instrument               (MonoCompile *cfg) MONO_INTERNAL;
+MonoPicSite *mini_pic_get_site              (MonoMethod *method, guint32 il_offset, MonoMethod *callee) MONO_INTERNAL;
+MonoVTable *mini_pic_get_dominant_receiver  (MonoCompile *cfg, MonoMethod *method, guint32 il_offset, MonoMethod *callee,
+											 MonoMethod **target) MONO_INTERNAL;
+void      mono_pic_record_miss              (MonoPicSite *site, MonoVTable *vtable) MONO_INTERNAL;
+
 /* LLVM backend */
 void     mono_llvm_init                     (void) MONO_LLVM_INTERNAL;
 void     mono_llvm_cleanup                  (void) MONO_LLVM_INTERNAL;
@@ -2217,6 +2435,9 @@ gboolean          mono_is_regsize_var (MonoType *t) MONO_INTERNAL;
 void              mini_emit_memcpy (MonoCompile *cfg, int destreg, int doffset, int srcreg, int soffset, int size, int align) MONO_INTERNAL;
 void              mini_emit_stobj (MonoCompile *cfg, MonoInst *dest, MonoInst *src, MonoClass *klass, gboolean native) MONO_INTERNAL;
 void              mini_emit_initobj (MonoCompile *cfg, MonoInst *dest, const guchar *ip, MonoClass *klass) MONO_INTERNAL;
+void              mini_emit_init_rvar (MonoCompile *cfg, int dreg, MonoType *rtype) MONO_INTERNAL;
+void              mini_emit_jump_table (MonoCompile *cfg, int sreg, MonoBasicBlock **targets, int n) MONO_INTERNAL;
+void              mini_emit_card_mark (MonoCompile *cfg, int ptr_reg) MONO_INTERNAL;
 CompRelation      mono_opcode_to_cond (int opcode) MONO_LLVM_INTERNAL;
 CompType          mono_opcode_to_type (int opcode, int cmp_opcode) MONO_INTERNAL;
 CompRelation      mono_negate_cond (CompRelation cond) MONO_INTERNAL;
@@ -2244,6 +2465,8 @@ void              mono_decompose_vtype_opts (MonoCompile *cfg) MONO_INTERNAL;
 void              mono_decompose_vtype_opts_llvm (MonoCompile *cfg) MONO_INTERNAL;
 void              mono_decompose_array_access_opts (MonoCompile *cfg) MONO_INTERNAL;
 void              mono_decompose_soft_float (MonoCompile *cfg) MONO_INTERNAL;
+void              mono_decompose_div_by_const (MonoCompile *cfg) MONO_INTERNAL;
+void              mono_decompose_rgctx_fetch (MonoCompile *cfg) MONO_INTERNAL;
 void              mono_handle_global_vregs (MonoCompile *cfg) MONO_INTERNAL;
 void              mono_spill_global_vars (MonoCompile *cfg, gboolean *need_local_opts) MONO_INTERNAL;
 void              mono_if_conversion (MonoCompile *cfg) MONO_INTERNAL;
@@ -2444,6 +2667,7 @@ void     mono_setup_altstack                    (MonoJitTlsData *tls) MONO_INTER
 void     mono_free_altstack                     (MonoJitTlsData *tls) MONO_INTERNAL;
 gpointer mono_altstack_restore_prot             (mgreg_t *regs, guint8 *code, gpointer *tramp_data, guint8* tramp) MONO_INTERNAL;
 MonoJitInfo* mini_jit_info_table_find           (MonoDomain *domain, char *addr, MonoDomain **out_domain) MONO_INTERNAL;
+void     mono_eh_cache_invalidate               (void) MONO_INTERNAL;
 void     mono_resume_unwind                     (MonoContext *ctx) MONO_LLVM_INTERNAL;
 
 MonoJitInfo * mono_find_jit_info                (MonoDomain *domain, MonoJitTlsData *jit_tls, MonoJitInfo *res, MonoJitInfo *prev_ji, MonoContext *ctx, MonoContext *new_ctx, char **trace, MonoLMF **lmf, int *native_offset, gboolean *managed) MONO_INTERNAL;
@@ -2531,6 +2755,20 @@ mono_perform_abc_removal (MonoCompile *cfg) MONO_INTERNAL;
 extern void
 mono_perform_ssapre (MonoCompile *cfg) MONO_INTERNAL;
 extern void
+mono_perform_licm (MonoCompile *cfg) MONO_INTERNAL;
+extern gboolean
+mini_ins_is_pure (MonoInst *ins) MONO_INTERNAL;
+extern gboolean
+mini_ins_may_write_memory (MonoInst *ins) MONO_INTERNAL;
+extern void
+mono_perform_gvn (MonoCompile *cfg) MONO_INTERNAL;
+extern void
+mono_vectorize_loops (MonoCompile *cfg) MONO_INTERNAL;
+extern void
+mono_escape_analysis (MonoCompile *cfg) MONO_INTERNAL;
+extern void
+mono_lower_write_barriers (MonoCompile *cfg) MONO_INTERNAL;
+extern void
 mono_local_cprop (MonoCompile *cfg) MONO_INTERNAL;
 extern void
 mono_local_cprop (MonoCompile *cfg);
@@ -2723,6 +2961,9 @@ MonoInst*   mono_emit_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, Mo
 guint32     mono_arch_cpu_enumerate_simd_versions (void) MONO_INTERNAL;
 void        mono_simd_intrinsics_init (void) MONO_INTERNAL;
 
+MonoInst*   mono_emit_string_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args) MONO_INTERNAL;
+void        mono_string_simd_init (void) MONO_INTERNAL;
+
 MonoInst*   mono_emit_native_types_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args) MONO_INTERNAL;
 MonoType*   mini_native_type_replace_type (MonoType *type) MONO_INTERNAL;
 
@@ -831,6 +831,66 @@ class Tests {
 		return 0;
 	}
 
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static bool is_enumerable_of_object (object o) {
+		return o is System.Collections.Generic.IEnumerable<object>;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static bool cast_to_enumerable_of_object (object o) {
+		try {
+			return (System.Collections.Generic.IEnumerable<object>)o == o;
+		} catch (InvalidCastException) {
+			return false;
+		}
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static bool is_of_type<T> (object o) where T : class {
+		return o is T;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static bool cast_to_type<T> (object o) where T : class {
+		try {
+			return (T)o == o;
+		} catch (InvalidCastException) {
+			return false;
+		}
+	}
+
+	public static int test_0_cast_cache_polymorphic () {
+		/* More classes than cache entries, so entries get evicted */
+		object[] objs = new object [] { new string [1], "A", new object [1], new int [1], new System.Collections.Generic.List<string> (), new System.Collections.Generic.List<int> (), new Duper [1], 1 };
+		bool[] is_enumerable = new bool [] { true, false, true, false, true, false, true, false };
+		bool[] is_cloneable = new bool [] { true, true, true, true, false, false, true, false };
+
+		for (int i = 0; i < 100; ++i) {
+			for (int j = 0; j < objs.Length; ++j) {
+				/* Vary the order so secondary entries get hit too */
+				int k = (j * (i % 3 + 1)) % objs.Length;
+				object o = objs [(i & 1) == 0 ? k : objs.Length - 1 - k];
+				int idx = Array.IndexOf (objs, o);
+
+				if (is_enumerable_of_object (o) != is_enumerable [idx])
+					return 1;
+				if (cast_to_enumerable_of_object (o) != is_enumerable [idx])
+					return 2;
+				if (is_of_type<ICloneable> (o) != is_cloneable [idx])
+					return 3;
+				if (cast_to_type<ICloneable> (o) != is_cloneable [idx])
+					return 4;
+				if (is_of_type<System.Collections.Generic.IEnumerable<object>> (o) != is_enumerable [idx])
+					return 5;
+			}
+		}
+		if (is_enumerable_of_object (null) || is_of_type<ICloneable> (null))
+			return 6;
+		if (!cast_to_enumerable_of_object (null) || !cast_to_type<ICloneable> (null))
+			return 7;
+		return 0;
+	}
+
 	private static int[] daysmonthleap = { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 
 	private static int AbsoluteDays (int year, int month, int day)
@@ -1206,6 +1266,510 @@ ncells ) {
 		return sb.ToString () == "ADC" ? 0 : 1;
 	}
 
+	static string make_string (int len, int seed) {
+		char[] chars = new char [len];
+
+		for (int i = 0; i < len; ++i)
+			chars [i] = (char)('a' + (i + seed) % 26);
+		return new string (chars);
+	}
+
+	static string replace_char (string s, int index, char c) {
+		char[] chars = s.ToCharArray ();
+
+		chars [index] = c;
+		return new string (chars);
+	}
+
+	public static int test_0_intrins_string_indexof () {
+		for (int len = 0; len < 70; ++len) {
+			string s = make_string (len, 0);
+
+			if (s.IndexOf ('#') != -1)
+				return 1;
+			for (int i = 0; i < len; ++i) {
+				string t = replace_char (s, i, 'Ｃ');
+
+				if (t.IndexOf ('Ｃ') != i)
+					return 2;
+				/* The range stops right before the match */
+				if (t.IndexOf ('Ｃ', 0, i) != -1)
+					return 3;
+				if (t.IndexOf ('Ｃ', i, len - i) != i)
+					return 4;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_intrins_string_equals () {
+		for (int len = 0; len < 70; ++len) {
+			string s = make_string (len, 0);
+			string s2 = make_string (len, 0);
+
+			if (!String.Equals (s, s2) || !s.Equals (s2) || s != s2)
+				return 1;
+			if (String.Equals (s, null) || String.Equals (null, s))
+				return 2;
+			if (String.Equals (s, make_string (len + 1, 0)))
+				return 3;
+			for (int i = 0; i < len; ++i) {
+				if (String.Equals (s, replace_char (s, i, 'Ā')))
+					return 4;
+			}
+		}
+		return String.Equals (null, null) ? 0 : 5;
+	}
+
+	static int compare_ordinal_ref (string a, string b) {
+		int len = Math.Min (a.Length, b.Length);
+
+		for (int i = 0; i < len; ++i)
+			if (a [i] != b [i])
+				return a [i] - b [i];
+		return a.Length - b.Length;
+	}
+
+	public static int test_0_intrins_string_compare_ordinal () {
+		for (int len = 0; len < 70; ++len) {
+			string s = make_string (len, 0);
+
+			if (String.CompareOrdinal (s, make_string (len, 0)) != 0)
+				return 1;
+			if (String.CompareOrdinal (s, make_string (len + 3, 0)) != -3)
+				return 2;
+			for (int i = 0; i < len; ++i) {
+				string t = replace_char (s, i, '￿');
+
+				if (String.CompareOrdinal (s, t) != compare_ordinal_ref (s, t))
+					return 3;
+				if (String.CompareOrdinal (t, s) != compare_ordinal_ref (t, s))
+					return 4;
+				if (String.CompareOrdinal (s, i, t, i, len) != s [i] - 0xffff)
+					return 5;
+			}
+		}
+		if (String.CompareOrdinal (null, "a") != -1 || String.CompareOrdinal ("a", null) != 1 || String.CompareOrdinal (null, null) != 0)
+			return 6;
+		return 0;
+	}
+
+	static int string_hash_ref (string s) {
+		int h = 0;
+
+		for (int i = 0; i < s.Length; ++i)
+			h = (h << 5) - h + s [i];
+		return h;
+	}
+
+	public static int test_0_intrins_string_gethashcode () {
+		for (int len = 0; len < 70; ++len) {
+			string s = make_string (len, len);
+
+			if (s.GetHashCode () != string_hash_ref (s))
+				return 1;
+			if (((object)s).GetHashCode () != s.GetHashCode ())
+				return 2;
+			s = replace_char (make_string (len + 1, 0), len, '￿');
+			if (s.GetHashCode () != string_hash_ref (s))
+				return 3;
+		}
+		string n = null;
+		try {
+			n.GetHashCode ();
+			return 4;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
+	unsafe struct Buf17 { public fixed byte b [17]; }
+	unsafe struct Buf40 { public fixed byte b [40]; }
+	unsafe struct Buf100 { public fixed byte b [100]; }
+	unsafe struct Buf128 { public fixed byte b [128]; }
+	unsafe struct Buf300 { public fixed byte b [300]; }
+
+	struct RefBig {
+		public object o;
+		public long l1, l2, l3, l4, l5, l6;
+		public string s;
+	}
+
+	class BufHolder {
+		public Buf17 b17;
+		public Buf100 b100;
+		public Buf300 b300;
+	}
+
+	static unsafe void fill_bytes (byte *p, int size, int seed) {
+		for (int i = 0; i < size; ++i)
+			p [i] = (byte)(i * 7 + seed);
+	}
+
+	static unsafe bool check_bytes (byte *p, int size, int seed) {
+		for (int i = 0; i < size; ++i)
+			if (p [i] != (byte)(i * 7 + seed))
+				return false;
+		return true;
+	}
+
+	static unsafe bool check_zero (byte *p, int size) {
+		for (int i = 0; i < size; ++i)
+			if (p [i] != 0)
+				return false;
+		return true;
+	}
+
+	public static unsafe int test_0_vtype_copy_sizes () {
+		Buf17 a17, c17;
+		Buf40 a40, c40;
+		Buf100 a100, c100;
+		Buf128 a128, c128;
+		Buf300 a300, c300;
+
+		fill_bytes (a17.b, 17, 1);
+		c17 = a17;
+		if (!check_bytes (c17.b, 17, 1))
+			return 1;
+		fill_bytes (a40.b, 40, 2);
+		c40 = a40;
+		if (!check_bytes (c40.b, 40, 2))
+			return 2;
+		fill_bytes (a100.b, 100, 3);
+		c100 = a100;
+		if (!check_bytes (c100.b, 100, 3))
+			return 3;
+		fill_bytes (a128.b, 128, 4);
+		c128 = a128;
+		if (!check_bytes (c128.b, 128, 4))
+			return 4;
+		fill_bytes (a300.b, 300, 5);
+		c300 = a300;
+		if (!check_bytes (c300.b, 300, 5))
+			return 5;
+
+		c17 = new Buf17 ();
+		c40 = new Buf40 ();
+		c100 = new Buf100 ();
+		c128 = new Buf128 ();
+		c300 = new Buf300 ();
+		if (!check_zero (c17.b, 17) || !check_zero (c40.b, 40) || !check_zero (c100.b, 100) || !check_zero (c128.b, 128) || !check_zero (c300.b, 300))
+			return 6;
+		/* The source is left alone */
+		if (!check_bytes (a100.b, 100, 3) || !check_bytes (a300.b, 300, 5))
+			return 7;
+		return 0;
+	}
+
+	public static unsafe int test_0_vtype_copy_heap () {
+		BufHolder h = new BufHolder ();
+		Buf100[] arr = new Buf100 [3];
+		Buf17 a17;
+		Buf100 a100;
+		Buf300 a300;
+
+		fill_bytes (a17.b, 17, 1);
+		fill_bytes (a100.b, 100, 2);
+		fill_bytes (a300.b, 300, 3);
+		h.b17 = a17;
+		h.b100 = a100;
+		h.b300 = a300;
+		arr [1] = a100;
+		fixed (byte *p = h.b17.b) {
+			if (!check_bytes (p, 17, 1))
+				return 1;
+		}
+		fixed (byte *p = h.b100.b) {
+			if (!check_bytes (p, 100, 2))
+				return 2;
+		}
+		fixed (byte *p = h.b300.b) {
+			if (!check_bytes (p, 300, 3))
+				return 3;
+		}
+		fixed (byte *p = arr [1].b) {
+			if (!check_bytes (p, 100, 2))
+				return 4;
+		}
+		fixed (byte *p = arr [0].b) {
+			if (!check_zero (p, 100))
+				return 5;
+		}
+		fixed (byte *p = arr [2].b) {
+			if (!check_zero (p, 100))
+				return 6;
+		}
+		h.b300 = new Buf300 ();
+		fixed (byte *p = h.b300.b) {
+			if (!check_zero (p, 300))
+				return 7;
+		}
+		return 0;
+	}
+
+	public static int test_0_vtype_copy_with_refs () {
+		RefBig a = new RefBig ();
+		a.o = new object ();
+		a.s = "abc";
+		a.l1 = 1;
+		a.l6 = 6;
+
+		RefBig c = a;
+		RefBig[] arr = new RefBig [2];
+		arr [1] = a;
+		GC.Collect ();
+		if (c.o != a.o || c.s != "abc" || c.l1 != 1 || c.l6 != 6)
+			return 1;
+		if (arr [1].o != a.o || arr [1].s != "abc" || arr [1].l6 != 6 || arr [0].o != null)
+			return 2;
+		return 0;
+	}
+
+	struct PromoPair {
+		public int a;
+		public long b;
+	}
+
+	struct PromoSmall {
+		public byte b;
+		public sbyte sb;
+		public char c;
+		public short s;
+	}
+
+	struct PromoVec {
+		public double x, y;
+	}
+
+	[StructLayout (LayoutKind.Explicit)]
+	struct PromoUnion {
+		[FieldOffset (0)] public int i;
+		[FieldOffset (0)] public float f;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static PromoPair promo_make (int a, long b) {
+		PromoPair p;
+		p.a = a;
+		p.b = b;
+		return p;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long promo_sum (PromoPair p) {
+		return p.a + p.b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void promo_bump (ref PromoPair p) {
+		p.a ++;
+	}
+
+	public static int test_0_promote_vtype_loop () {
+		PromoVec acc = new PromoVec ();
+		PromoVec prev = new PromoVec ();
+
+		for (int i = 0; i < 10; ++i) {
+			PromoVec t;
+			t.x = i;
+			t.y = i * 2;
+			if ((i & 1) == 0)
+				prev = acc;
+			acc.x += t.x;
+			acc.y += t.y;
+		}
+		if (acc.x != 45.0 || acc.y != 90.0)
+			return 1;
+		if (prev.x != 28.0 || prev.y != 56.0)
+			return 2;
+		return 0;
+	}
+
+	public static int test_0_promote_vtype_calls () {
+		PromoPair p = promo_make (3, 4);
+		p.a ++;
+		if (promo_sum (p) != 8)
+			return 1;
+		PromoPair q = p;
+		q.b = 1L << 40;
+		if (promo_sum (q) != (1L << 40) + 4 || p.b != 4)
+			return 2;
+		promo_bump (ref q);
+		if (q.a != 5)
+			return 3;
+		return 0;
+	}
+
+	public static int test_0_promote_vtype_arrays () {
+		PromoPair[] arr = new PromoPair [2];
+
+		arr [1] = promo_make (1, 2);
+		PromoPair p = arr [1];
+		p.b = 5;
+		arr [0] = p;
+		if (arr [0].a != 1 || arr [0].b != 5 || arr [1].b != 2)
+			return 1;
+		return 0;
+	}
+
+	public static int test_0_promote_vtype_small_fields () {
+		PromoSmall s = new PromoSmall ();
+
+		s.b = 255;
+		s.b ++;
+		s.sb = -128;
+		s.sb --;
+		s.c = 'A';
+		s.s = short.MinValue;
+		s.s = (short)(s.s - 1);
+		if (s.b != 0 || s.sb != 127 || s.c != 'A' || s.s != short.MaxValue)
+			return 1;
+		PromoSmall t = s;
+		t.c ++;
+		if (t.c != 'B' || s.c != 'A' || t.sb != 127)
+			return 2;
+		return 0;
+	}
+
+	public static int test_0_promote_vtype_union () {
+		PromoUnion u = new PromoUnion ();
+
+		u.f = 1.0f;
+		return u.i == 0x3f800000 ? 0 : 1;
+	}
+
+	public static int test_0_promote_vtype_exception () {
+		PromoPair p = promo_make (1, 1);
+
+		try {
+			p.a = 2;
+			promo_bump (ref p);
+			throw new Exception ();
+		} catch (Exception) {
+			p.b = 7;
+		}
+		return (p.a == 3 && p.b == 7) ? 0 : 1;
+	}
+
+	struct PromoQuad {
+		public long a, b, c, d;
+	}
+
+	/* Valuetype arguments are promoted too, passed in registers or on the stack */
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static double promo_arg_loop (PromoVec v, int n) {
+		double s = 0;
+
+		for (int i = 0; i < n; ++i)
+			s += v.x * i + v.y;
+		return s;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long promo_arg_modify (PromoPair p) {
+		p.a += 10;
+		p.b *= 2;
+		PromoPair q = p;
+		q.a ++;
+		return promo_sum (p) + q.a;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long promo_arg_quad (PromoQuad q, int n) {
+		long s = 0;
+
+		for (int i = 0; i < n; ++i) {
+			s += q.a + q.d;
+			q.b += q.c;
+		}
+		return s + q.b;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int promo_arg_small (PromoSmall s) {
+		s.b ++;
+		return s.b + s.sb + s.c + s.s;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static long promo_arg_exception (PromoPair p) {
+		try {
+			p.a ++;
+			throw new Exception ();
+		} catch (Exception) {
+			p.b = 5;
+		}
+		return p.a + p.b;
+	}
+
+	public static int test_0_promote_vtype_args () {
+		PromoVec v;
+		v.x = 2.0;
+		v.y = 0.5;
+		if (promo_arg_loop (v, 10) != 95.0)
+			return 1;
+
+		PromoPair p = promo_make (1, 2);
+		if (promo_arg_modify (p) != 27)
+			return 2;
+		if (p.a != 1 || p.b != 2)
+			return 3;
+
+		PromoQuad q;
+		q.a = 1;
+		q.b = 2;
+		q.c = 3;
+		q.d = 4;
+		if (promo_arg_quad (q, 10) != 82 || q.b != 2)
+			return 4;
+
+		PromoSmall s;
+		s.b = 255;
+		s.sb = -1;
+		s.c = 'a';
+		s.s = 1000;
+		if (promo_arg_small (s) != 1096 || s.b != 255)
+			return 5;
+
+		if (promo_arg_exception (p) != 7)
+			return 6;
+		return 0;
+	}
+
+	public static int test_0_intrins_array_indexof_byte () {
+		for (int len = 0; len < 100; ++len) {
+			byte[] arr = new byte [len];
+
+			for (int i = 0; i < len; ++i)
+				arr [i] = (byte)(i % 200);
+			for (int i = 0; i < len; ++i) {
+				byte v = arr [i];
+
+				arr [i] = 255;
+				if (Array.IndexOf<byte> (arr, 255) != i)
+					return 1;
+				if (Array.IndexOf<byte> (arr, 255, 0, i) != -1)
+					return 2;
+				if (Array.IndexOf<byte> (arr, 255, i) != i)
+					return 3;
+				arr [i] = v;
+			}
+			if (Array.IndexOf<byte> (arr, 255) != -1)
+				return 4;
+		}
+		try {
+			Array.IndexOf<byte> (null, 1);
+			return 5;
+		} catch (ArgumentNullException) {
+		}
+		try {
+			Array.IndexOf<byte> (new byte [10], 1, 5, 6);
+			return 6;
+		} catch (ArgumentOutOfRangeException) {
+		}
+		return 0;
+	}
+
 	public class Bar {
 		bool allowLocation = true;
         Foo f = new Foo ();	
@@ -1625,6 +2189,316 @@ ncells ) {
 	[MethodImplAttribute (MethodImplOptions.NoInlining)]
 	static void t_14217_inner (BugStruct bug) {
     }
+
+	class EscPoint {
+		public int x, y;
+		public sbyte b;
+		public double d;
+		public object o;
+
+		public EscPoint (int x) {
+			this.x = x;
+		}
+	}
+
+	struct EscPair {
+		public int a;
+		public double d;
+	}
+
+	static EscPoint esc_last;
+
+	public static int test_0_escape_scalar_replace () {
+		int sum = 0;
+		for (int i = 0; i < 10; ++i) {
+			var p = new EscPoint (i) { y = 2 };
+			if (i > 5)
+				p.x = 1;
+			sum += p.x * p.y;
+		}
+		return sum == 38 ? 0 : 1;
+	}
+
+	public static int test_0_escape_field_types () {
+		var p = new EscPoint (1);
+		if (p.b != 0 || p.d != 0.0 || p.o != null)
+			return 1;
+		p.b = (sbyte)-3;
+		p.d = 1.5;
+		p.o = "A";
+		if (p.b != -3 || p.d != 1.5 || (string)p.o != "A")
+			return 2;
+		return 0;
+	}
+
+	public static int test_0_escape_previous_iteration () {
+		EscPoint prev = null;
+		int sum = 0;
+		for (int i = 0; i < 4; ++i) {
+			var p = new EscPoint (i);
+			if (prev != null)
+				sum += prev.x;
+			prev = p;
+		}
+		return sum == 3 ? 0 : 1;
+	}
+
+	public static int test_0_escape_stored () {
+		var p = new EscPoint (5);
+		esc_last = p;
+		p.x = 6;
+		return esc_last.x == 6 ? 0 : 1;
+	}
+
+	public static int test_0_escape_box_unbox () {
+		int sum = 0;
+		for (int i = 0; i < 10; ++i) {
+			object o = i;
+			sum += (int)o;
+		}
+		object e = ByteEnum.Zero;
+		if ((ByteEnum)e != ByteEnum.Zero)
+			return 2;
+		return sum == 45 ? 0 : 1;
+	}
+
+	public static int test_0_escape_box_invalid_unbox () {
+		object o = 5;
+		try {
+			long l = (long)o;
+			return 1;
+		} catch (InvalidCastException) {
+			return 0;
+		}
+	}
+
+	public static int test_0_escape_box_struct () {
+		var s = new EscPair () { a = 1, d = 2.5 };
+		object o = s;
+		s.a = 2;
+		var s2 = (EscPair)o;
+		return (s2.a == 1 && s2.d == 2.5) ? 0 : 1;
+	}
+
+	class EscRefNode {
+		public object o;
+		public int x;
+	}
+
+	class EscIntNode {
+		public int x, y;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int escape_int_nodes (int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			var p = new EscIntNode () { x = i, y = i + 1 };
+			sum += p.y - p.x;
+		}
+		return sum;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int escape_ref_nodes (object o, int n) {
+		int sum = 0;
+		for (int i = 0; i < n; ++i) {
+			var p = new EscRefNode () { o = o, x = i };
+			if (p.o == o)
+				sum += p.x - i + 1;
+		}
+		return sum;
+	}
+
+	/* The write barrier of the reference store must not keep the object from being scalar replaced */
+	public static int test_0_escape_scalar_replace_ref_store () {
+		const int n = 1000000;
+
+		int gcs = GC.CollectionCount (0);
+		if (escape_int_nodes (n) != n)
+			return 1;
+		/* Without escape analysis, the loop allocates enough to run a few collections */
+		bool escape = GC.CollectionCount (0) == gcs;
+
+		gcs = GC.CollectionCount (0);
+		if (escape_ref_nodes ("A", n) != n)
+			return 2;
+		if (escape && GC.CollectionCount (0) != gcs)
+			return 3;
+		return 0;
+	}
+
+	class GvnNode {
+		public int val;
+		public GvnNode next;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int gvn_reload (GvnNode n, GvnNode alias, bool store) {
+		int a = n.val;
+		if (store)
+			alias.val = a + 1;
+		else
+			a += n.next.val;
+		return a + n.val;
+	}
+
+	public static int test_0_gvn_reload_after_store () {
+		var n = new GvnNode () { val = 1, next = new GvnNode () { val = 10 } };
+		if (gvn_reload (n, n, false) != 12)
+			return 1;
+		if (gvn_reload (n, n, true) != 3)
+			return 2;
+		return 0;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int gvn_reload_after_catch (GvnNode n) {
+		int a = n.val;
+		try {
+			n.val = 5;
+			throw new Exception ();
+		} catch (Exception) {
+		}
+		return a + n.val;
+	}
+
+	public static int test_0_gvn_reload_after_catch () {
+		return gvn_reload_after_catch (new GvnNode () { val = 1 }) == 6 ? 0 : 1;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void gvn_set (ref int i, int val) {
+		i = val;
+	}
+
+	public static int test_0_gvn_address_taken_local () {
+		int i = 1;
+		gvn_set (ref i, 2);
+		int a = i;
+		i = 3;
+		return a + i == 5 ? 0 : 1;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int gvn_null_checks (GvnNode n, bool b) {
+		int a = n.val;
+		if (b)
+			return a + n.next.val;
+		return n.next.next.val;
+	}
+
+	public static int test_0_gvn_null_checks () {
+		var n = new GvnNode () { val = 1, next = new GvnNode () { val = 10 } };
+		if (gvn_null_checks (n, true) != 11)
+			return 1;
+		try {
+			gvn_null_checks (n, false);
+			return 2;
+		} catch (NullReferenceException) {
+		}
+		try {
+			gvn_null_checks (null, true);
+			return 3;
+		} catch (NullReferenceException) {
+		}
+		return 0;
+	}
+
+	class WBarrierNode {
+		public WBarrierNode next;
+		public object a, b, c;
+		public int val;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static WBarrierNode wbarrier_build (int n) {
+		WBarrierNode head = null;
+		for (int i = 0; i < n; ++i)
+			head = new WBarrierNode () { next = head, a = "A", b = null, c = head, val = i };
+		return head;
+	}
+
+	public static int test_0_wbarrier_fresh_objects () {
+		WBarrierNode head = wbarrier_build (10000);
+		GC.Collect (0);
+		GC.Collect ();
+		int i = 9999;
+		for (WBarrierNode n = head; n != null; n = n.next) {
+			if (n.val != i || (string)n.a != "A" || n.b != null || n.c != n.next)
+				return 1;
+			i --;
+		}
+		return i == -1 ? 0 : 2;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void wbarrier_fill (WBarrierNode old, int i) {
+		var a = new WBarrierNode () { val = i };
+		var b = new WBarrierNode () { val = i + 1 };
+		var c = new WBarrierNode () { val = i + 2 };
+		var next = new WBarrierNode () { val = i + 3 };
+		old.a = a;
+		old.b = b;
+		old.c = c;
+		old.next = next;
+	}
+
+	public static int test_0_wbarrier_coalesced_stores () {
+		var nodes = new WBarrierNode [64];
+		for (int i = 0; i < nodes.Length; ++i)
+			nodes [i] = new WBarrierNode ();
+		/* Move the nodes out of the nursery */
+		GC.Collect ();
+		for (int iter = 0; iter < 10; ++iter) {
+			for (int i = 0; i < nodes.Length; ++i)
+				wbarrier_fill (nodes [i], i);
+			GC.Collect (0);
+			for (int i = 0; i < nodes.Length; ++i) {
+				var n = nodes [i];
+				if (((WBarrierNode)n.a).val != i || ((WBarrierNode)n.b).val != i + 1 || ((WBarrierNode)n.c).val != i + 2 || n.next.val != i + 3)
+					return iter + 1;
+			}
+		}
+		return 0;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int wbarrier_fill_throw (WBarrierNode old, object a, object b, object c, int[] arr, int i) {
+		old.a = a;
+		old.b = b;
+		/* Throws before the store to c, the stores to a and b still need their card marks */
+		int t = arr [i];
+		old.c = c;
+		return t;
+	}
+
+	public static int test_0_wbarrier_stores_before_exception () {
+		var nodes = new WBarrierNode [64];
+		var arr = new int [1];
+		for (int i = 0; i < nodes.Length; ++i)
+			nodes [i] = new WBarrierNode ();
+		/* Move the nodes out of the nursery */
+		GC.Collect ();
+		for (int i = 0; i < nodes.Length; ++i) {
+			try {
+				wbarrier_fill_throw (nodes [i], new WBarrierNode () { val = i }, new WBarrierNode () { val = i + 1 }, null, arr, 1);
+				return 1;
+			} catch (IndexOutOfRangeException) {
+			}
+		}
+		GC.Collect (0);
+		/* Reuse the nursery, so lost references point to other objects */
+		var filler = new WBarrierNode [10000];
+		for (int i = 0; i < filler.Length; ++i)
+			filler [i] = new WBarrierNode () { val = -1 };
+		for (int i = 0; i < nodes.Length; ++i) {
+			var n = nodes [i];
+			if (((WBarrierNode)n.a).val != i || ((WBarrierNode)n.b).val != i + 1 || n.c != null)
+				return 2;
+		}
+		return 0;
+	}
 }
 
 #if MOBILE
@@ -20,6 +20,7 @@ OPTFLAG(ABCREM   ,18, "abcrem",     "Array bound checks removal")
 OPTFLAG(SSAPRE   ,19, "ssapre",     "SSA based Partial Redundancy Elimination")
 OPTFLAG(EXCEPTION,20, "exception",  "Optimize exception catch blocks")
 OPTFLAG(SSA      ,21, "ssa",        "Use plain SSA form")
+OPTFLAG(ESCAPE   ,22, "escape",     "Escape analysis of allocations")
 OPTFLAG(SSE2     ,23, "sse2",       "SSE2 instructions on x86")
 OPTFLAG(GSHARED  ,25, "gshared",    "Generic Sharing")
 /* The id has to be smaller than gshared's, the parser code depends on this */
@@ -27,3 +28,5 @@ OPTFLAG(GSHAREDVT,24, "gsharedvt",	"Generic sharing for valuetypes")
 OPTFLAG(SIMD	 ,26, "simd",	    "Simd intrinsics")
 OPTFLAG(UNSAFE	 ,27, "unsafe",	    "Remove bound checks and perform other dangerous changes")
 OPTFLAG(ALIAS_ANALYSIS	 ,28, "alias-analysis",      "Alias analysis of locals")
+OPTFLAG(GVN	 ,29, "gvn",	    "Global value numbering")
+OPTFLAG(VECTORIZE,30, "vectorize",  "Loop auto-vectorization")
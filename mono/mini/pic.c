@@ -0,0 +1,334 @@
+/*
+ * pic.c: Receiver type feedback for virtual and interface calls
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * The virtual and interface call sites of tier 0 code (see tiered.c) are
+ * preceded by a small polymorphic inline cache which records the vtables of
+ * the receivers seen by the call site, along with their hit counts. The first
+ * entry is checked inline by the call site, the other ones by
+ * mono_pic_record_miss (), which also fills empty entries. Receivers which
+ * don't fit into the cache are counted as misses, which makes the site
+ * megamorphic.
+ * When the method is recompiled as tier 1 code, a call site where one
+ * receiver class dominates is compiled as:
+ *   if (obj->vtable == VTABLE) <direct call to, or inlined copy of, the target> else <virtual call>
+ * which turns the indirect call into a direct one and makes the target
+ * eligible for inlining.
+ *
+ * This is configured using the MONO_PIC environment variable, a comma
+ * separated list of:
+ * - disable: don't collect type feedback.
+ * - entries=N: the number of entries of the caches, between 1 and 4.
+ * - ratio=N: the percentage of the calls a receiver class needs to receive to
+ *   be dominant.
+ * - stats: print the hit rates of the call sites at shutdown.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mini.h"
+
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-mutex.h>
+#include <mono/utils/atomic.h>
+
+#define DEFAULT_RATIO 90
+/* The number of calls needed before the feedback of a call site is used */
+#define MIN_SAMPLES 16
+
+static gboolean pic_disabled;
+static gboolean print_stats;
+static int num_entries = MONO_PIC_MAX_ENTRIES;
+static int ratio = DEFAULT_RATIO;
+
+/* Maps MonoMethod -> the list of its MonoPicSites */
+static GHashTable *sites;
+/* All the MonoPicSites, for the statistics */
+static GSList *all_sites;
+static mono_mutex_t sites_mutex;
+
+/* Statistics */
+static gint32 pic_call_sites, guarded_calls;
+
+void
+mini_pic_init (void)
+{
+	const char *env;
+
+	mono_mutex_init (&sites_mutex);
+	sites = g_hash_table_new (NULL, NULL);
+
+	env = g_getenv ("MONO_PIC");
+	if (env) {
+		gchar **args, **ptr;
+
+		args = g_strsplit (env, ",", -1);
+		for (ptr = args; ptr && *ptr; ptr++) {
+			const char *arg = *ptr;
+
+			if (strcmp (arg, "disable") == 0) {
+				pic_disabled = TRUE;
+			} else if (strncmp (arg, "entries=", 8) == 0) {
+				num_entries = CLAMP (atoi (arg + 8), 1, MONO_PIC_MAX_ENTRIES);
+			} else if (strncmp (arg, "ratio=", 6) == 0) {
+				ratio = CLAMP (atoi (arg + 6), 1, 100);
+			} else if (strcmp (arg, "stats") == 0) {
+				print_stats = TRUE;
+			} else {
+				fprintf (stderr, "MONO_PIC: unknown option '%s'.\n", arg);
+			}
+		}
+		g_strfreev (args);
+	}
+
+	mono_counters_register ("PIC call sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &pic_call_sites);
+	mono_counters_register ("PIC guarded devirtualizations", MONO_COUNTER_JIT | MONO_COUNTER_INT, &guarded_calls);
+}
+
+static gint32
+site_calls (MonoPicSite *site)
+{
+	gint32 calls = site->misses;
+	int i;
+
+	for (i = 0; i < MONO_PIC_MAX_ENTRIES; ++i)
+		calls += site->hits [i];
+	/* The counters are incremented without synchronization, so they can wrap around */
+	return calls < 0 ? G_MAXINT32 : calls;
+}
+
+static gint
+compare_sites (gconstpointer a, gconstpointer b)
+{
+	gint32 calls1 = site_calls ((MonoPicSite*)a);
+	gint32 calls2 = site_calls ((MonoPicSite*)b);
+
+	return calls1 < calls2 ? 1 : (calls1 > calls2 ? -1 : 0);
+}
+
+static void
+dump_stats (void)
+{
+	GSList *l, *list;
+	int i;
+
+	mono_mutex_lock (&sites_mutex);
+	list = g_slist_sort (g_slist_copy (all_sites), compare_sites);
+	mono_mutex_unlock (&sites_mutex);
+
+	printf ("PIC call site statistics:\n");
+	for (l = list; l; l = l->next) {
+		MonoPicSite *site = l->data;
+		gint32 calls = site_calls (site);
+		char *caller, *callee;
+
+		if (!calls)
+			continue;
+
+		caller = mono_method_full_name (site->method, TRUE);
+		callee = mono_method_full_name (site->callee, TRUE);
+		printf ("%s IL_%04x -> %s: %d calls, %.1f%% hits%s\n", caller, site->il_offset, callee, calls,
+				100.0 * (calls - site->misses) / calls, site->misses ? " (megamorphic)" : "");
+		for (i = 0; i < num_entries && site->vtables [i]; ++i) {
+			MonoClass *klass = site->vtables [i]->klass;
+
+			printf ("\t%5.1f%% %s.%s\n", 100.0 * site->hits [i] / calls, klass->name_space, klass->name);
+		}
+		g_free (caller);
+		g_free (callee);
+	}
+	g_slist_free (list);
+}
+
+void
+mini_pic_cleanup (void)
+{
+	if (print_stats)
+		dump_stats ();
+}
+
+/*
+ * mini_pic_instrument:
+ *
+ *   Return whenever the virtual call sites of the method compiled by CFG should
+ * collect type feedback.
+ */
+gboolean
+mini_pic_instrument (MonoCompile *cfg)
+{
+	if (!cfg->tier_info || pic_disabled)
+		return FALSE;
+	/* The caches are referenced by address */
+	if (cfg->compile_aot)
+		return FALSE;
+	return cfg->method->wrapper_type == MONO_WRAPPER_NONE;
+}
+
+static MonoPicSite*
+lookup_site (MonoMethod *method, guint32 il_offset)
+{
+	MonoPicSite *site;
+
+	for (site = g_hash_table_lookup (sites, method); site; site = site->next) {
+		if (site->il_offset == il_offset)
+			break;
+	}
+	return site;
+}
+
+/*
+ * mini_pic_get_site:
+ *
+ *   Return the inline cache of the call to CALLEE at IL_OFFSET in METHOD. The
+ * cache is never freed.
+ */
+MonoPicSite*
+mini_pic_get_site (MonoMethod *method, guint32 il_offset, MonoMethod *callee)
+{
+	MonoPicSite *site;
+
+	mono_mutex_lock (&sites_mutex);
+	site = lookup_site (method, il_offset);
+	if (!site) {
+		site = g_new0 (MonoPicSite, 1);
+		site->method = method;
+		site->callee = callee;
+		site->il_offset = il_offset;
+		site->next = g_hash_table_lookup (sites, method);
+		g_hash_table_insert (sites, method, site);
+		all_sites = g_slist_prepend (all_sites, site);
+		++pic_call_sites;
+	}
+	mono_mutex_unlock (&sites_mutex);
+
+	return site;
+}
+
+/*
+ * mono_pic_record_miss:
+ *
+ *   Called by tier 0 code when the receiver of the call at SITE doesn't match
+ * the first entry of its cache.
+ */
+void
+mono_pic_record_miss (MonoPicSite *site, MonoVTable *vtable)
+{
+	int i;
+
+	for (i = 0; i < num_entries; ++i) {
+		MonoVTable *cached = site->vtables [i];
+
+		if (!cached) {
+			cached = InterlockedCompareExchangePointer ((gpointer*)&site->vtables [i], vtable, NULL);
+			if (!cached)
+				cached = vtable;
+		}
+		if (cached == vtable) {
+			site->hits [i]++;
+			return;
+		}
+	}
+	site->misses++;
+}
+
+/*
+ * Return the method called by a virtual call to METHOD on an instance of
+ * KLASS, or NULL if it can't be called directly.
+ */
+static MonoMethod*
+resolve_target (MonoClass *klass, MonoMethod *method)
+{
+	MonoMethod *target;
+	int slot;
+
+	if (klass->valuetype || mono_class_is_marshalbyref (klass) || klass == mono_defaults.transparent_proxy_class)
+		return NULL;
+	if (mono_class_is_com_object (klass))
+		return NULL;
+
+	slot = mono_method_get_vtable_slot (method);
+	if (slot == -1)
+		return NULL;
+	mono_class_setup_vtable (klass);
+	if (klass->exception_type || !klass->vtable)
+		return NULL;
+
+	if (method->klass->flags & TYPE_ATTRIBUTE_INTERFACE) {
+		gboolean variance_used = FALSE;
+		int offset = mono_class_interface_offset_with_variance (klass, method->klass, &variance_used);
+
+		if (offset == -1 || variance_used)
+			return NULL;
+		slot += offset;
+	}
+	if (slot >= klass->vtable_size)
+		return NULL;
+
+	target = klass->vtable [slot];
+	if (!target || (target->flags & METHOD_ATTRIBUTE_ABSTRACT) || target->wrapper_type != MONO_WRAPPER_NONE)
+		return NULL;
+	if ((target->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED) || mono_method_signature (target)->generic_param_count)
+		return NULL;
+	if (mono_method_signature (target)->param_count != mono_method_signature (method)->param_count)
+		return NULL;
+	return target;
+}
+
+/*
+ * mini_pic_get_dominant_receiver:
+ *
+ *   Return the vtable of the class which received most of the calls made to
+ * CALLEE at IL_OFFSET in METHOD, according to the type feedback collected by the
+ * tier 0 code, and set TARGET to the method to call for it. Return NULL if no
+ * class dominates the call site.
+ */
+MonoVTable*
+mini_pic_get_dominant_receiver (MonoCompile *cfg, MonoMethod *method, guint32 il_offset, MonoMethod *callee, MonoMethod **target)
+{
+	MonoPicSite *site;
+	MonoVTable *vtable = NULL;
+	gint32 calls;
+	int i;
+
+	/* Only tier 0 code collects type feedback, so avoid taking the lock when there is none */
+	if (!mono_tiered_jit || pic_disabled || !pic_call_sites)
+		return NULL;
+	if (cfg->compile_aot || cfg->domain != mono_get_root_domain ())
+		return NULL;
+
+	mono_mutex_lock (&sites_mutex);
+	site = lookup_site (method, il_offset);
+	mono_mutex_unlock (&sites_mutex);
+	if (!site || site->callee != callee)
+		return NULL;
+
+	calls = site_calls (site);
+	if (calls < MIN_SAMPLES)
+		return NULL;
+	for (i = 0; i < num_entries; ++i) {
+		if (site->vtables [i] && (gint64)site->hits [i] * 100 >= (gint64)calls * ratio) {
+			vtable = site->vtables [i];
+			break;
+		}
+	}
+	if (!vtable)
+		return NULL;
+
+	*target = resolve_target (vtable->klass, callee);
+	if (!*target)
+		return NULL;
+
+	if (cfg->verbose_level > 1) {
+		char *desc = mono_method_full_name (*target, TRUE);
+		printf ("PIC: IL_%04x %d%% of %d calls to %s\n", il_offset, (int)((gint64)site->hits [i] * 100 / calls), calls, desc);
+		g_free (desc);
+	}
+	InterlockedIncrement (&guarded_calls);
+	return vtable;
+}
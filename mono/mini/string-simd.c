@@ -0,0 +1,552 @@
+/*
+ * string-simd.c: vectorized string and byte array primitives
+ *
+ * A few hot corlib string routines are scalar loops over UTF-16 code
+ * units. On x86 they are replaced by calls to the SSE2 or AVX2 kernels
+ * below, the variant being picked when the call site is JITted.
+ *
+ * Copyright 2014 Xamarin Inc
+ */
+
+#include <config.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#ifdef MONO_ARCH_STRING_SIMD
+
+#include <mono/metadata/exception.h>
+#include <mono/utils/mono-hwcap-x86.h>
+
+#include <emmintrin.h>
+
+/*
+ * The kernels are compiled for their instruction set through function
+ * attributes, so the rest of the runtime keeps its baseline codegen.
+ */
+#if defined(_MSC_VER)
+#define SIMD_TARGET(x)
+#define HAVE_SIMD_KERNELS 1
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define SIMD_TARGET(x) __attribute__((target(x)))
+#define HAVE_SIMD_KERNELS 1
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define SIMD_TARGET(x)
+#define HAVE_SIMD_KERNELS 1
+#endif
+
+#ifdef HAVE_SIMD_KERNELS
+
+static inline int
+first_set_bit (guint32 mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+
+	_BitScanForward (&index, mask);
+	return index;
+#else
+	return __builtin_ctz (mask);
+#endif
+}
+
+/* 31^k mod 2^32, the weights of String.GetHashCode's h = h * 31 + c */
+#define POW31_4 0x000e1781
+#define POW31_5 0x01b4d89f
+#define POW31_6 0x34e63b41
+#define POW31_7 0x67e12cdf
+#define POW31_8 0x94446f01
+#define POW31_9 0xf449711f
+#define POW31_10 0x94e4b2c1
+#define POW31_11 0x07b1a55f
+#define POW31_12 0xee830681
+#define POW31_13 0xe1ddc99f
+#define POW31_14 0x59db6a41
+#define POW31_15 0xe191dddf
+#define POW31_16 0x50a9de01
+
+/*
+ * Scalar tails, shared by both variants. None of the kernels read past the
+ * last element, so a string ending just before an unmapped page is safe.
+ */
+
+static inline int
+index_of_char_tail (const gunichar2 *p, int i, int count, gunichar2 c)
+{
+	for (; i < count; ++i)
+		if (p [i] == c)
+			return i;
+	return -1;
+}
+
+static inline int
+index_of_byte_tail (const guint8 *p, int i, int count, guint8 b)
+{
+	for (; i < count; ++i)
+		if (p [i] == b)
+			return i;
+	return -1;
+}
+
+static inline int
+compare_tail (const gunichar2 *a, const gunichar2 *b, int i, int len)
+{
+	for (; i < len; ++i)
+		if (a [i] != b [i])
+			return (int)a [i] - (int)b [i];
+	return 0;
+}
+
+static inline guint32
+hash_tail (const gunichar2 *p, int i, int len, guint32 h)
+{
+	for (; i < len; ++i)
+		h = h * 31 + p [i];
+	return h;
+}
+
+/* SSE2 */
+
+static SIMD_TARGET("sse2") int
+index_of_char_sse2 (const gunichar2 *p, int count, gunichar2 c)
+{
+	__m128i needle = _mm_set1_epi16 ((short)c);
+	int i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m128i eq0 = _mm_cmpeq_epi16 (_mm_loadu_si128 ((const __m128i*)(p + i)), needle);
+		__m128i eq1 = _mm_cmpeq_epi16 (_mm_loadu_si128 ((const __m128i*)(p + i + 8)), needle);
+		guint32 mask = _mm_movemask_epi8 (eq0) | (_mm_movemask_epi8 (eq1) << 16);
+
+		if (mask)
+			return i + (first_set_bit (mask) >> 1);
+	}
+	if (i + 8 <= count) {
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_loadu_si128 ((const __m128i*)(p + i)), needle));
+
+		if (mask)
+			return i + (first_set_bit (mask) >> 1);
+		i += 8;
+	}
+	return index_of_char_tail (p, i, count, c);
+}
+
+static SIMD_TARGET("sse2") int
+index_of_byte_sse2 (const guint8 *p, int count, guint8 b)
+{
+	__m128i needle = _mm_set1_epi8 ((char)b);
+	int i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i*)(p + i)), needle));
+
+		if (mask)
+			return i + first_set_bit (mask);
+	}
+	return index_of_byte_tail (p, i, count, b);
+}
+
+/* Returns the difference of the first mismatching chars, 0 if there is none */
+static SIMD_TARGET("sse2") int
+compare_chars_sse2 (const gunichar2 *a, const gunichar2 *b, int len)
+{
+	int i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		__m128i va = _mm_loadu_si128 ((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128 ((const __m128i*)(b + i));
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi16 (va, vb)) ^ 0xffff;
+
+		if (mask) {
+			int j = i + (first_set_bit (mask) >> 1);
+			return (int)a [j] - (int)b [j];
+		}
+	}
+	return compare_tail (a, b, i, len);
+}
+
+/* SSE2 has no 32 bit low multiply, build it from two 32x32->64 ones */
+static inline SIMD_TARGET("sse2") __m128i
+mullo_epi32_sse2 (__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32 (a, b);
+	__m128i odd = _mm_mul_epu32 (_mm_srli_si128 (a, 4), _mm_srli_si128 (b, 4));
+
+	return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2, 0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+}
+
+/*
+ * The hash is a polynomial in 31, so each lane accumulates every fourth
+ * char pre-multiplied by its weight inside an 8 char block, and the whole
+ * accumulator is scaled by 31^8 per block. Summing the lanes at the end
+ * gives the same value as the sequential loop, modulo 2^32.
+ */
+static SIMD_TARGET("sse2") guint32
+hash_sse2 (const gunichar2 *p, int len)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i w_lo = _mm_set_epi32 (POW31_4, POW31_5, POW31_6, POW31_7);
+	const __m128i w_hi = _mm_set_epi32 (1, 31, 31 * 31, 31 * 31 * 31);
+	const __m128i step = _mm_set1_epi32 ((int)POW31_8);
+	__m128i acc = zero;
+	guint32 lanes [4];
+	int i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		__m128i v = _mm_loadu_si128 ((const __m128i*)(p + i));
+		__m128i lo = mullo_epi32_sse2 (_mm_unpacklo_epi16 (v, zero), w_lo);
+		__m128i hi = mullo_epi32_sse2 (_mm_unpackhi_epi16 (v, zero), w_hi);
+
+		acc = _mm_add_epi32 (mullo_epi32_sse2 (acc, step), _mm_add_epi32 (lo, hi));
+	}
+	_mm_storeu_si128 ((__m128i*)lanes, acc);
+	return hash_tail (p, i, len, lanes [0] + lanes [1] + lanes [2] + lanes [3]);
+}
+
+/* AVX2 */
+
+#ifdef HAVE_AVX2_KERNELS
+
+static SIMD_TARGET("avx2") int
+index_of_char_avx2 (const gunichar2 *p, int count, gunichar2 c)
+{
+	__m256i needle = _mm256_set1_epi16 ((short)c);
+	int i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		__m256i eq0 = _mm256_cmpeq_epi16 (_mm256_loadu_si256 ((const __m256i*)(p + i)), needle);
+		__m256i eq1 = _mm256_cmpeq_epi16 (_mm256_loadu_si256 ((const __m256i*)(p + i + 16)), needle);
+
+		if (!_mm256_testz_si256 (_mm256_or_si256 (eq0, eq1), _mm256_or_si256 (eq0, eq1))) {
+			guint32 mask = _mm256_movemask_epi8 (eq0);
+
+			if (mask)
+				return i + (first_set_bit (mask) >> 1);
+			return i + 16 + (first_set_bit (_mm256_movemask_epi8 (eq1)) >> 1);
+		}
+	}
+	if (i + 16 <= count) {
+		guint32 mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi16 (_mm256_loadu_si256 ((const __m256i*)(p + i)), needle));
+
+		if (mask)
+			return i + (first_set_bit (mask) >> 1);
+		i += 16;
+	}
+	if (i + 8 <= count) {
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_loadu_si128 ((const __m128i*)(p + i)), _mm256_castsi256_si128 (needle)));
+
+		if (mask)
+			return i + (first_set_bit (mask) >> 1);
+		i += 8;
+	}
+	return index_of_char_tail (p, i, count, c);
+}
+
+static SIMD_TARGET("avx2") int
+index_of_byte_avx2 (const guint8 *p, int count, guint8 b)
+{
+	__m256i needle = _mm256_set1_epi8 ((char)b);
+	int i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		guint32 mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i*)(p + i)), needle));
+
+		if (mask)
+			return i + first_set_bit (mask);
+	}
+	if (i + 16 <= count) {
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i*)(p + i)), _mm256_castsi256_si128 (needle)));
+
+		if (mask)
+			return i + first_set_bit (mask);
+		i += 16;
+	}
+	return index_of_byte_tail (p, i, count, b);
+}
+
+static SIMD_TARGET("avx2") int
+compare_chars_avx2 (const gunichar2 *a, const gunichar2 *b, int len)
+{
+	int i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m256i va = _mm256_loadu_si256 ((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256 ((const __m256i*)(b + i));
+		guint32 mask = ~(guint32)_mm256_movemask_epi8 (_mm256_cmpeq_epi16 (va, vb));
+
+		if (mask) {
+			int j = i + (first_set_bit (mask) >> 1);
+			return (int)a [j] - (int)b [j];
+		}
+	}
+	if (i + 8 <= len) {
+		__m128i va = _mm_loadu_si128 ((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128 ((const __m128i*)(b + i));
+		guint32 mask = _mm_movemask_epi8 (_mm_cmpeq_epi16 (va, vb)) ^ 0xffff;
+
+		if (mask) {
+			int j = i + (first_set_bit (mask) >> 1);
+			return (int)a [j] - (int)b [j];
+		}
+		i += 8;
+	}
+	return compare_tail (a, b, i, len);
+}
+
+/* Same scheme as hash_sse2 with 16 char blocks and 8 lanes */
+static SIMD_TARGET("avx2") guint32
+hash_avx2 (const gunichar2 *p, int len)
+{
+	const __m256i w_lo = _mm256_set_epi32 (POW31_8, POW31_9, POW31_10, POW31_11, POW31_12, POW31_13, POW31_14, POW31_15);
+	const __m256i w_hi = _mm256_set_epi32 (1, 31, 31 * 31, 31 * 31 * 31, POW31_4, POW31_5, POW31_6, POW31_7);
+	const __m256i step = _mm256_set1_epi32 ((int)POW31_16);
+	__m256i acc = _mm256_setzero_si256 ();
+	__m128i sum;
+	guint32 lanes [4];
+	int i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m256i lo = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i*)(p + i)));
+		__m256i hi = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i*)(p + i + 8)));
+
+		acc = _mm256_add_epi32 (_mm256_mullo_epi32 (acc, step),
+			_mm256_add_epi32 (_mm256_mullo_epi32 (lo, w_lo), _mm256_mullo_epi32 (hi, w_hi)));
+	}
+	sum = _mm_add_epi32 (_mm256_castsi256_si128 (acc), _mm256_extracti128_si256 (acc, 1));
+	_mm_storeu_si128 ((__m128i*)lanes, sum);
+	return hash_tail (p, i, len, lanes [0] + lanes [1] + lanes [2] + lanes [3]);
+}
+
+#endif /* HAVE_AVX2_KERNELS */
+
+/*
+ * The JIT icalls. They take the objects rather than interior pointers so the
+ * call sites don't create managed pointers into strings; the objects are kept
+ * alive and pinned by the conservatively scanned native frame.
+ */
+
+#define DEFINE_STRING_ICALLS(isa) \
+/* String.IndexOfUnchecked (char, int, int), the caller checked the range */ \
+static gint32 \
+mono_string_index_of_char_##isa (MonoString *str, gint32 value, gint32 start, gint32 count) \
+{ \
+	int index = index_of_char_##isa (mono_string_chars (str) + start, count, (gunichar2)value); \
+ \
+	return index < 0 ? -1 : start + index; \
+} \
+ \
+/* String.Equals (string, string) */ \
+static gint32 \
+mono_string_equals_##isa (MonoString *a, MonoString *b) \
+{ \
+	if (a == b) \
+		return TRUE; \
+	if (!a || !b || mono_string_length (a) != mono_string_length (b)) \
+		return FALSE; \
+	return compare_chars_##isa (mono_string_chars (a), mono_string_chars (b), mono_string_length (a)) == 0; \
+} \
+ \
+/* String.CompareOrdinalUnchecked (string, int, int, string, int, int) */ \
+static gint32 \
+mono_string_compare_ordinal_##isa (MonoString *a, gint32 index_a, gint32 len_a, MonoString *b, gint32 index_b, gint32 len_b) \
+{ \
+	int length_a, length_b, diff; \
+ \
+	if (!a) \
+		return b ? -1 : 0; \
+	if (!b) \
+		return 1; \
+	length_a = MIN (len_a, mono_string_length (a) - index_a); \
+	length_b = MIN (len_b, mono_string_length (b) - index_b); \
+	if (length_a == length_b && index_a == index_b && a == b) \
+		return 0; \
+	diff = compare_chars_##isa (mono_string_chars (a) + index_a, mono_string_chars (b) + index_b, MIN (length_a, length_b)); \
+	return diff ? diff : length_a - length_b; \
+} \
+ \
+/* String.GetHashCode (), the receiver was null checked */ \
+static gint32 \
+mono_string_hash_##isa (MonoString *str) \
+{ \
+	return (gint32)hash_##isa (mono_string_chars (str), mono_string_length (str)); \
+} \
+ \
+/* Array.IndexOf<byte> (byte[], byte, int, int), argument checks included */ \
+static gint32 \
+mono_array_index_of_byte_##isa (MonoArray *arr, gint32 value, gint32 start, gint32 count) \
+{ \
+	int index; \
+ \
+	if (!arr) \
+		mono_raise_exception (mono_get_exception_argument_null ("array")); \
+	if (count < 0 || start < 0 || (gint64)start - 1 > (gint64)mono_array_length (arr) - 1 - count) \
+		mono_raise_exception (mono_get_exception_argument_out_of_range (NULL)); \
+ \
+	index = index_of_byte_##isa (mono_array_addr (arr, guint8, start), count, (guint8)value); \
+	return index < 0 ? -1 : start + index; \
+}
+
+DEFINE_STRING_ICALLS (sse2)
+#ifdef HAVE_AVX2_KERNELS
+DEFINE_STRING_ICALLS (avx2)
+#endif
+
+enum {
+	STRING_SIMD_INDEX_OF_CHAR,
+	STRING_SIMD_EQUALS,
+	STRING_SIMD_COMPARE_ORDINAL,
+	STRING_SIMD_HASH,
+	STRING_SIMD_INDEX_OF_BYTE,
+	STRING_SIMD_NUM
+};
+
+static gpointer sse2_icalls [STRING_SIMD_NUM] = {
+	mono_string_index_of_char_sse2,
+	mono_string_equals_sse2,
+	mono_string_compare_ordinal_sse2,
+	mono_string_hash_sse2,
+	mono_array_index_of_byte_sse2
+};
+
+#ifdef HAVE_AVX2_KERNELS
+static gpointer avx2_icalls [STRING_SIMD_NUM] = {
+	mono_string_index_of_char_avx2,
+	mono_string_equals_avx2,
+	mono_string_compare_ordinal_avx2,
+	mono_string_hash_avx2,
+	mono_array_index_of_byte_avx2
+};
+#endif
+
+#define REGISTER_STRING_ICALLS(isa) do { \
+	mono_register_jit_icall (mono_string_index_of_char_##isa, "mono_string_index_of_char_" #isa, mono_create_icall_signature ("int32 object int32 int32 int32"), FALSE); \
+	mono_register_jit_icall (mono_string_equals_##isa, "mono_string_equals_" #isa, mono_create_icall_signature ("int32 object object"), FALSE); \
+	mono_register_jit_icall (mono_string_compare_ordinal_##isa, "mono_string_compare_ordinal_" #isa, mono_create_icall_signature ("int32 object int32 int32 object int32 int32"), FALSE); \
+	mono_register_jit_icall (mono_string_hash_##isa, "mono_string_hash_" #isa, mono_create_icall_signature ("int32 object"), FALSE); \
+	mono_register_jit_icall (mono_array_index_of_byte_##isa, "mono_array_index_of_byte_" #isa, mono_create_icall_signature ("int32 object int32 int32 int32"), FALSE); \
+	} while (0)
+
+#endif /* HAVE_SIMD_KERNELS */
+
+void
+mono_string_simd_init (void)
+{
+#ifdef HAVE_SIMD_KERNELS
+	/* Register every variant, AOT images refer to them by name */
+	REGISTER_STRING_ICALLS (sse2);
+#ifdef HAVE_AVX2_KERNELS
+	REGISTER_STRING_ICALLS (avx2);
+#endif
+#endif
+}
+
+#ifdef HAVE_SIMD_KERNELS
+/*
+ * Select the kernel for the machine the code will run on. AOT code might run
+ * on a different cpu, so it only gets the baseline variant, which is SSE2 on
+ * amd64 and nothing on x86.
+ */
+static gpointer
+get_icall (MonoCompile *cfg, int op)
+{
+	if (cfg->compile_aot) {
+#ifdef TARGET_AMD64
+		return sse2_icalls [op];
+#else
+		return NULL;
+#endif
+	}
+#ifdef HAVE_AVX2_KERNELS
+	if (mono_hwcap_x86_has_avx2)
+		return avx2_icalls [op];
+#endif
+	if (mono_hwcap_x86_has_sse2)
+		return sse2_icalls [op];
+	return NULL;
+}
+
+static gboolean
+is_string_type (MonoType *t)
+{
+	return t->type == MONO_TYPE_STRING && !t->byref;
+}
+
+static gboolean
+is_int32_type (MonoType *t)
+{
+	return t->type == MONO_TYPE_I4 && !t->byref;
+}
+#endif
+
+/*
+ * mono_emit_string_simd_intrinsics:
+ *
+ *   Replace calls to String.IndexOfUnchecked (char), String.Equals,
+ * String.CompareOrdinalUnchecked, String.GetHashCode and Array.IndexOf<byte>
+ * with calls to the vectorized kernels. Returns NULL if CMETHOD is not one of
+ * them or the cpu lacks SSE2.
+ */
+MonoInst*
+mono_emit_string_simd_intrinsics (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args)
+{
+#ifdef HAVE_SIMD_KERNELS
+	gpointer func;
+
+	if (cmethod->klass == mono_defaults.string_class) {
+		if (!strcmp (cmethod->name, "IndexOfUnchecked") && fsig->hasthis && fsig->param_count == 3 &&
+			fsig->params [0]->type == MONO_TYPE_CHAR && is_int32_type (fsig->params [1]) && is_int32_type (fsig->params [2])) {
+			if (!(func = get_icall (cfg, STRING_SIMD_INDEX_OF_CHAR)))
+				return NULL;
+			MONO_EMIT_NEW_CHECK_THIS (cfg, args [0]->dreg);
+			return mono_emit_jit_icall (cfg, func, args);
+		} else if (!strcmp (cmethod->name, "Equals") && !fsig->hasthis && fsig->param_count == 2 &&
+				   is_string_type (fsig->params [0]) && is_string_type (fsig->params [1])) {
+			if (!(func = get_icall (cfg, STRING_SIMD_EQUALS)))
+				return NULL;
+			return mono_emit_jit_icall (cfg, func, args);
+		} else if (!strcmp (cmethod->name, "CompareOrdinalUnchecked") && !fsig->hasthis && fsig->param_count == 6) {
+			if (!(func = get_icall (cfg, STRING_SIMD_COMPARE_ORDINAL)))
+				return NULL;
+			return mono_emit_jit_icall (cfg, func, args);
+		} else if (!strcmp (cmethod->name, "GetHashCode") && fsig->hasthis && fsig->param_count == 0) {
+			goto hash;
+		}
+	} else if (cmethod->klass == mono_defaults.object_class) {
+		/*
+		 * C# compilers emit callvirt Object::GetHashCode () even when the receiver
+		 * is typed as string. String is sealed, so the override is known.
+		 */
+		if (!strcmp (cmethod->name, "GetHashCode") && fsig->param_count == 0 &&
+			args [0]->type == STACK_OBJ && args [0]->klass == mono_defaults.string_class)
+			goto hash;
+	} else if (cmethod->klass == mono_defaults.array_class) {
+		MonoGenericContext *context;
+
+		if (!cmethod->is_inflated || strcmp (cmethod->name, "IndexOf") || fsig->param_count != 4)
+			return NULL;
+		context = mono_method_get_context (cmethod);
+		if (!context->method_inst || context->method_inst->type_argc != 1 ||
+			context->method_inst->type_argv [0]->type != MONO_TYPE_U1 || context->method_inst->type_argv [0]->byref)
+			return NULL;
+		if (!(func = get_icall (cfg, STRING_SIMD_INDEX_OF_BYTE)))
+			return NULL;
+		return mono_emit_jit_icall (cfg, func, args);
+	}
+	return NULL;
+
+hash:
+	if (!(func = get_icall (cfg, STRING_SIMD_HASH)))
+		return NULL;
+	MONO_EMIT_NEW_CHECK_THIS (cfg, args [0]->dreg);
+	return mono_emit_jit_icall (cfg, func, args);
+#else
+	return NULL;
+#endif
+}
+
+#endif /* MONO_ARCH_STRING_SIMD */
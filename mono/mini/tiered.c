@@ -0,0 +1,402 @@
+/*
+ * tiered.c: Tiered compilation
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * When tiered compilation is enabled, eligible methods are first compiled
+ * with a cheap set of optimizations (tier 0): no SSA, no inlining and no
+ * global register allocation. The tier 0 code counts its calls down inline
+ * in the prolog, and once a method reaches the threshold, it calls out to
+ * queue it for recompilation with the normal optimizations (tier 1) on a
+ * background thread. The tier 1 code then replaces the tier 0 code in the
+ * jit code hash of the domain.
+ * The trampolines patch call sites and vtable/IMT slots to the tier 0 code
+ * like they do for any other code, but they record them in the MonoTierInfo
+ * of the method, and once the tier 1 code is installed, they are patched
+ * again to point to it. The delegate trampoline does the same for the
+ * method_ptr of delegates, which are tracked using weak GC handles. Function
+ * pointers which were handed out directly, like the ones passed to native
+ * code, are not tracked and keep using the tier 0 code.
+ */
+
+#include <config.h>
+
+#include "mini.h"
+
+#include <mono/metadata/threads-types.h>
+#include <mono/metadata/domain-internals.h>
+#include <mono/metadata/gc-internal.h>
+#include <mono/metadata/runtime.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-conc-hashtable.h>
+#include <mono/utils/mono-mutex.h>
+#include <mono/utils/atomic.h>
+
+#define DEFAULT_THRESHOLD 30
+
+/* The optimizations which are not worth their compile time for tier 0 code */
+#define TIER0_EXCLUDED_OPTS (MONO_OPT_INLINE | MONO_OPT_CONSPROP | MONO_OPT_COPYPROP | MONO_OPT_DEADCE | MONO_OPT_LINEARS | \
+							 MONO_OPT_SCHED | MONO_OPT_LOOP | MONO_OPT_ABCREM | MONO_OPT_SSAPRE | MONO_OPT_SSA | MONO_OPT_ALIAS_ANALYSIS | \
+							 MONO_OPT_ESCAPE | MONO_OPT_GVN | MONO_OPT_VECTORIZE)
+
+gboolean mono_tiered_jit = FALSE;
+
+static gint32 threshold = DEFAULT_THRESHOLD;
+
+/*
+ * Maps the code_start of tier 0 methods to their MonoTierInfo. Entries are never
+ * removed, since the trampolines can still find the tier 0 code after tier-up.
+ */
+static MonoConcurrentHashTable *tier0_code;
+
+/* A location patched to point to tier 0 code */
+typedef struct {
+	/* The vtable, IMT, GOT or delegate code slot */
+	gpointer *slot;
+	/* A weak GC handle to a delegate whose method_ptr points to the tier 0 code */
+	guint32 delegate_handle;
+	/* For call sites, the start of the calling method and the address after the call instruction */
+	guint8 *method_start;
+	guint8 *code;
+} TierPatchSite;
+
+/* Protects the patch_sites and tier1_code fields of MonoTierInfo */
+static mono_mutex_t patch_mutex;
+
+/* The queue of methods waiting to be recompiled */
+static mono_mutex_t queue_mutex;
+static GQueue *queue;
+static HANDLE queue_event;
+static gint32 thread_started;
+
+/* Statistics */
+static gint32 tier0_methods, tier_up_queued, tier_up_methods, tier_up_failures, tier_up_patched_sites;
+static double tier0_jit_time, tier1_jit_time;
+
+void
+mini_tiered_init (void)
+{
+	const char *env = g_getenv ("MONO_TIERED_THRESHOLD");
+
+	if (env) {
+		threshold = atoi (env);
+		if (threshold <= 0)
+			threshold = DEFAULT_THRESHOLD;
+	}
+
+	tier0_code = mono_conc_hashtable_new (NULL, NULL);
+	mono_mutex_init (&queue_mutex);
+	mono_mutex_init (&patch_mutex);
+	queue = g_queue_new ();
+
+	mono_counters_register ("Tier 0 methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier0_methods);
+	mono_counters_register ("Tier up requests", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier_up_queued);
+	mono_counters_register ("Tier up compilations", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier_up_methods);
+	mono_counters_register ("Tier up failures", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier_up_failures);
+	mono_counters_register ("Tier up repatched sites", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier_up_patched_sites);
+	mono_counters_register ("Tier 0 JIT time (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &tier0_jit_time);
+	mono_counters_register ("Tier 1 JIT time (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &tier1_jit_time);
+}
+
+/*
+ * mini_tiered_method_is_eligible:
+ *
+ *   Return whenever METHOD should be compiled as tier 0 code first. Code which
+ * might be shared between methods or domains, or freed, is excluded, as well as
+ * code which needs to be debuggable.
+ */
+gboolean
+mini_tiered_method_is_eligible (MonoMethod *method, MonoDomain *domain, guint32 opt)
+{
+	if (!mono_tiered_jit)
+		return FALSE;
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic)
+		return FALSE;
+	if (domain != mono_get_root_domain () || (opt & MONO_OPT_SHARED))
+		return FALSE;
+	if ((opt & MONO_OPT_GSHARED) && mono_method_is_generic_sharable (method, FALSE))
+		return FALSE;
+	if (mini_get_debug_options ()->gen_seq_points)
+		return FALSE;
+	if (mono_runtime_is_shutting_down ())
+		return FALSE;
+	return TRUE;
+}
+
+guint32
+mini_tiered_tier0_opts (guint32 opt)
+{
+	return opt & ~TIER0_EXCLUDED_OPTS;
+}
+
+MonoTierInfo*
+mini_tiered_info_new (MonoMethod *method, MonoDomain *domain)
+{
+	MonoTierInfo *info = mono_domain_alloc0 (domain, sizeof (MonoTierInfo));
+
+	info->method = method;
+	info->domain = domain;
+	info->count = threshold;
+	return info;
+}
+
+/*
+ * mini_tiered_register_tier0_code:
+ *
+ *   Called after the tier 0 code described by JI has been installed in the jit
+ * code hash. OPT is the set of optimizations to recompile the method with.
+ * LOCKING: domain->jit_code_hash_lock
+ */
+void
+mini_tiered_register_tier0_code (MonoTierInfo *info, MonoJitInfo *ji, guint32 opt, double jit_time)
+{
+	info->opt = opt;
+	info->tier0_ji = ji;
+	mono_conc_hashtable_insert (tier0_code, ji->code_start, info);
+
+	++tier0_methods;
+	tier0_jit_time += jit_time;
+}
+
+/*
+ * mini_tiered_lookup_tier0_code:
+ *
+ *   Return the MonoTierInfo of the method if CODE is the start of tier 0 code,
+ * NULL otherwise. Calls to tier 0 code should be patched using
+ * mini_tiered_patch_slot () and mini_tiered_patch_callsite ().
+ */
+MonoTierInfo*
+mini_tiered_lookup_tier0_code (gpointer code)
+{
+	if (!tier0_code)
+		return NULL;
+	return mono_conc_hashtable_lookup (tier0_code, code);
+}
+
+/*
+ * mini_tiered_patch_slot:
+ *
+ *   Patch SLOT to point to the code of the method described by INFO, and if it
+ * is still the tier 0 code, remember SLOT so it is patched again at tier-up.
+ */
+void
+mini_tiered_patch_slot (MonoTierInfo *info, gpointer *slot)
+{
+	mono_mutex_lock (&patch_mutex);
+	if (info->tier1_code) {
+		*slot = info->tier1_code;
+	} else {
+		TierPatchSite *site = g_new0 (TierPatchSite, 1);
+
+		site->slot = slot;
+		info->patch_sites = g_slist_prepend (info->patch_sites, site);
+		*slot = info->tier0_ji->code_start;
+	}
+	mono_mutex_unlock (&patch_mutex);
+}
+
+/*
+ * mini_tiered_patch_callsite:
+ *
+ *   Same as mini_tiered_patch_slot (), for the call made from the method starting
+ * at METHOD_START which returns to CODE. The calling code must never be freed.
+ */
+void
+mini_tiered_patch_callsite (MonoTierInfo *info, guint8 *method_start, guint8 *code)
+{
+	mono_mutex_lock (&patch_mutex);
+	if (info->tier1_code) {
+		mono_arch_patch_callsite (method_start, code, mono_create_ftnptr (info->domain, info->tier1_code));
+	} else {
+		TierPatchSite *site = g_new0 (TierPatchSite, 1);
+
+		site->method_start = method_start;
+		site->code = code;
+		info->patch_sites = g_slist_prepend (info->patch_sites, site);
+		mono_arch_patch_callsite (method_start, code, mono_create_ftnptr (info->domain, info->tier0_ji->code_start));
+	}
+	mono_mutex_unlock (&patch_mutex);
+}
+
+/*
+ * mini_tiered_patch_delegate:
+ *
+ *   Same as mini_tiered_patch_slot (), for the method_ptr field of DELEGATE. The
+ * delegate is only referenced weakly, since it can be moved or collected.
+ */
+void
+mini_tiered_patch_delegate (MonoTierInfo *info, MonoDelegate *delegate)
+{
+	mono_mutex_lock (&patch_mutex);
+	if (info->tier1_code) {
+		delegate->method_ptr = mono_create_ftnptr (info->domain, info->tier1_code);
+	} else {
+		TierPatchSite *site = g_new0 (TierPatchSite, 1);
+
+		site->delegate_handle = mono_gchandle_new_weakref ((MonoObject*)delegate, FALSE);
+		info->patch_sites = g_slist_prepend (info->patch_sites, site);
+		delegate->method_ptr = mono_create_ftnptr (info->domain, info->tier0_ji->code_start);
+	}
+	mono_mutex_unlock (&patch_mutex);
+}
+
+/*
+ * repatch_sites:
+ *
+ *   Set CODE as the final code of the method described by INFO, and patch the
+ * locations which were pointing to its tier 0 code.
+ */
+static void
+repatch_sites (MonoTierInfo *info, gpointer code)
+{
+	GSList *l;
+
+	mono_mutex_lock (&patch_mutex);
+	info->tier1_code = code;
+	for (l = info->patch_sites; l; l = l->next) {
+		TierPatchSite *site = l->data;
+
+		if (site->slot) {
+			*site->slot = code;
+		} else if (site->delegate_handle) {
+			MonoDelegate *delegate = (MonoDelegate*)mono_gchandle_get_target (site->delegate_handle);
+
+			/* The delegate could have been pointed somewhere else by the delegate trampoline */
+			if (delegate && mono_get_addr_from_ftnptr (delegate->method_ptr) == info->tier0_ji->code_start)
+				delegate->method_ptr = mono_create_ftnptr (info->domain, code);
+			mono_gchandle_free (site->delegate_handle);
+		} else {
+			mono_arch_patch_callsite (site->method_start, site->code, mono_create_ftnptr (info->domain, code));
+		}
+		g_free (site);
+		++tier_up_patched_sites;
+	}
+	g_slist_free (info->patch_sites);
+	info->patch_sites = NULL;
+	mono_mutex_unlock (&patch_mutex);
+}
+
+/*
+ * tier_up:
+ *
+ *   Recompile the method described by INFO with all the optimizations, and
+ * replace its tier 0 code with the result.
+ */
+static void
+tier_up (MonoTierInfo *info)
+{
+	MonoDomain *domain = info->domain;
+	MonoMethod *method = info->method;
+	MonoCompile *cfg;
+	GTimer *jit_timer;
+	gboolean installed = FALSE;
+
+	jit_timer = g_timer_new ();
+	cfg = mini_method_compile (method, info->opt, domain, JIT_FLAG_RUN_CCTORS, 0);
+	g_timer_stop (jit_timer);
+	tier1_jit_time += g_timer_elapsed (jit_timer, NULL);
+	g_timer_destroy (jit_timer);
+
+	if (cfg->exception_type != MONO_EXCEPTION_NONE) {
+		/* The tier 0 code is fine, so keep using it */
+		if (cfg->exception_type == MONO_EXCEPTION_OBJECT_SUPPLIED)
+			MONO_GC_UNREGISTER_ROOT (cfg->exception_ptr);
+		mono_loader_clear_error ();
+		mono_destroy_compile (cfg);
+		repatch_sites (info, info->tier0_ji->code_start);
+		++tier_up_failures;
+		return;
+	}
+
+	mono_loader_lock ();
+	mono_domain_lock (domain);
+	mono_domain_jit_code_hash_lock (domain);
+	if (mono_internal_hash_table_lookup (&domain->jit_code_hash, method) == info->tier0_ji) {
+		mono_internal_hash_table_remove (&domain->jit_code_hash, method);
+		mono_internal_hash_table_insert (&domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
+		mono_conc_hashtable_remove (domain_jit_info (domain)->jit_code_cache, method);
+		mono_conc_hashtable_insert (domain_jit_info (domain)->jit_code_cache, cfg->jit_info->d.method, cfg->jit_info);
+		installed = TRUE;
+	}
+	mono_domain_jit_code_hash_unlock (domain);
+
+	/*
+	 * The trampolines now find the tier 1 code, so the recorded call sites and
+	 * slots can be patched. The tier 0 code is not freed, since it could be
+	 * running on other threads, and delegates might still point to it.
+	 */
+	repatch_sites (info, installed ? cfg->jit_info->code_start : info->tier0_ji->code_start);
+
+	if (installed) {
+		++tier_up_methods;
+		mono_emit_jit_map (cfg->jit_info);
+	}
+	mono_domain_unlock (domain);
+	mono_loader_unlock ();
+
+	if (cfg->verbose_level > 0 && installed)
+		printf ("Tiered up %s.\n", mono_method_full_name (method, TRUE));
+
+	mono_destroy_compile (cfg);
+}
+
+static void
+tiered_thread (gpointer unused)
+{
+	MonoInternalThread *thread = mono_thread_internal_current ();
+
+	ves_icall_System_Threading_Thread_SetName_internal (thread, mono_string_new (mono_domain_get (), "Tiered JIT"));
+
+	while (!mono_runtime_is_shutting_down ()) {
+		MonoTierInfo *info;
+
+		/* The wait is alertable so the thread can be suspended during shutdown */
+		WaitForSingleObjectEx (queue_event, 1000, TRUE);
+
+		for (;;) {
+			mono_thread_interruption_checkpoint ();
+			if (mono_runtime_is_shutting_down ())
+				break;
+
+			mono_mutex_lock (&queue_mutex);
+			info = g_queue_pop_head (queue);
+			mono_mutex_unlock (&queue_mutex);
+			if (!info)
+				break;
+
+			tier_up (info);
+		}
+	}
+}
+
+/*
+ * mono_tiered_queue_tier_up:
+ *
+ *   JIT icall called from the prolog of tier 0 code when the method reaches the
+ * call count threshold. Queue the method for recompilation. The count is not
+ * decremented atomically, so this can be called more than once.
+ */
+void
+mono_tiered_queue_tier_up (MonoTierInfo *info)
+{
+	if (InterlockedCompareExchange (&info->queued, 1, 0) != 0)
+		return;
+	if (mono_runtime_is_shutting_down ())
+		return;
+
+	mono_mutex_lock (&queue_mutex);
+	g_queue_push_tail (queue, info);
+	++tier_up_queued;
+	mono_mutex_unlock (&queue_mutex);
+
+	if (!thread_started && InterlockedCompareExchange (&thread_started, 1, 0) == 0) {
+		queue_event = CreateEvent (NULL, FALSE, FALSE, NULL);
+		mono_thread_create_internal (mono_get_root_domain (), tiered_thread, NULL, TRUE, 0);
+	}
+
+	/* The thread empties the queue when it starts, so it doesn't matter if it misses this */
+	if (queue_event)
+		SetEvent (queue_event);
+}
@@ -0,0 +1,285 @@
+using System;
+using System.Threading;
+
+/*
+ * Regression tests for tiered compilation.
+ *
+ * Each test needs to be of the form:
+ *
+ * static int test_<result>_<name> ();
+ *
+ * where <result> is an integer (the value that needs to be returned by
+ * the method to make it pass.
+ * <name> is a user-displayed name used to identify the test.
+ *
+ * The tests call the same methods through call sites, vtable and IMT slots
+ * and delegates many times, sleeping from time to time so the methods are
+ * recompiled in the background, and check the results before and after the
+ * callers are patched to point to the tier 1 code. Run them with --tiered,
+ * both with a low MONO_TIERED_THRESHOLD and with the default one.
+ */
+
+interface ITiered {
+	int Get (int i);
+}
+
+/* More methods than IMT slots, so some of the slots have collisions */
+interface IWide {
+	int M0 (); int M1 (); int M2 (); int M3 (); int M4 (); int M5 (); int M6 ();
+	int M7 (); int M8 (); int M9 (); int M10 (); int M11 (); int M12 (); int M13 ();
+	int M14 (); int M15 (); int M16 (); int M17 (); int M18 (); int M19 (); int M20 ();
+	int M21 (); int M22 (); int M23 ();
+}
+
+class TieredBase : ITiered {
+	public virtual int Get (int i) {
+		return i + 1;
+	}
+}
+
+class TieredDerived : TieredBase {
+	public override int Get (int i) {
+		return i * 2;
+	}
+}
+
+/* Only used after the call sites were profiled with the other classes */
+class TieredLate : TieredBase {
+	public override int Get (int i) {
+		return i + 100;
+	}
+}
+
+class TieredOther : ITiered {
+	public int Get (int i) {
+		return i - 1;
+	}
+}
+
+class Wide : IWide {
+	public int M0 () { return 0; } public int M1 () { return 1; } public int M2 () { return 2; }
+	public int M3 () { return 3; } public int M4 () { return 4; } public int M5 () { return 5; }
+	public int M6 () { return 6; } public int M7 () { return 7; } public int M8 () { return 8; }
+	public int M9 () { return 9; } public int M10 () { return 10; } public int M11 () { return 11; }
+	public int M12 () { return 12; } public int M13 () { return 13; } public int M14 () { return 14; }
+	public int M15 () { return 15; } public int M16 () { return 16; } public int M17 () { return 17; }
+	public int M18 () { return 18; } public int M19 () { return 19; } public int M20 () { return 20; }
+	public int M21 () { return 21; } public int M22 () { return 22; } public int M23 () { return 23; }
+}
+
+struct TieredStruct : ITiered {
+	public int val;
+
+	public int Get (int i) {
+		return i + val;
+	}
+}
+
+class Tests {
+
+	const int iterations = 1000;
+
+	static int Main (string[] args) {
+		return TestDriver.RunTests (typeof (Tests), args);
+	}
+
+	/* Give the tier-up thread a chance to run */
+	static void MaybeSleep (int i) {
+		if (i % 50 == 0)
+			Thread.Sleep (1);
+	}
+
+	static int Add (int a, int b) {
+		return a + b;
+	}
+
+	int factor = 3;
+
+	int Scale (int a) {
+		return a * factor;
+	}
+
+	public static int test_0_direct_calls () {
+		for (int i = 0; i < iterations; ++i) {
+			if (Add (i, 1) != i + 1)
+				return 1;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	public static int test_0_virtual_calls () {
+		TieredBase[] objs = new TieredBase [] { new TieredBase (), new TieredDerived () };
+
+		for (int i = 0; i < iterations; ++i) {
+			if (objs [0].Get (i) != i + 1)
+				return 1;
+			if (objs [1].Get (i) != i * 2)
+				return 2;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	public static int test_0_interface_calls () {
+		ITiered[] objs = new ITiered [] { new TieredBase (), new TieredDerived (), new TieredOther () };
+
+		for (int i = 0; i < iterations; ++i) {
+			if (objs [0].Get (i) != i + 1)
+				return 1;
+			if (objs [1].Get (i) != i * 2)
+				return 2;
+			if (objs [2].Get (i) != i - 1)
+				return 3;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	public static int test_0_interface_calls_imt_collisions () {
+		IWide w = new Wide ();
+
+		for (int i = 0; i < iterations; ++i) {
+			if (w.M0 () != 0 || w.M5 () != 5 || w.M19 () != 19 || w.M23 () != 23)
+				return 1;
+			if (w.M1 () + w.M2 () + w.M3 () + w.M4 () + w.M6 () + w.M7 () + w.M8 () + w.M9 () + w.M10 () + w.M11 () +
+				w.M12 () + w.M13 () + w.M14 () + w.M15 () + w.M16 () + w.M17 () + w.M18 () + w.M20 () + w.M21 () + w.M22 () != 229)
+				return 2;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	public static int test_0_valuetype_interface_calls () {
+		TieredStruct s = new TieredStruct ();
+		s.val = 5;
+		ITiered boxed = s;
+
+		for (int i = 0; i < iterations; ++i) {
+			if (boxed.Get (i) != i + 5)
+				return 1;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	public static int test_0_delegate_calls () {
+		Func<int, int, int> add = Add;
+		Func<int, int> scale = new Tests ().Scale;
+		Func<int, int> get = new TieredDerived ().Get;
+
+		for (int i = 0; i < iterations; ++i) {
+			if (add (i, 2) != i + 2)
+				return 1;
+			if (scale (i) != i * 3)
+				return 2;
+			if (get (i) != i * 2)
+				return 3;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	/*
+	 * The call sites of these methods are profiled by the tier 0 code, so the
+	 * tier 1 code can guard a direct call to the dominant receiver class.
+	 */
+	static int CallGet (TieredBase b, int i) {
+		return b.Get (i);
+	}
+
+	static int CallInterfaceGet (ITiered t, int i) {
+		return t.Get (i);
+	}
+
+	static int Expected (object o, int i) {
+		if (o is TieredLate)
+			return i + 100;
+		if (o is TieredDerived)
+			return i * 2;
+		if (o is TieredBase)
+			return i + 1;
+		return i - 1;
+	}
+
+	/* Run with the default threshold, so there is enough type feedback when the methods tier up */
+	public static int test_0_guarded_call_receiver_changes () {
+		TieredBase[] objs = new TieredBase [] { new TieredBase (), new TieredDerived (), new TieredLate () };
+
+		/* Only TieredBase while profiling */
+		for (int i = 0; i < iterations; ++i) {
+			if (CallGet (objs [0], i) != i + 1)
+				return 1;
+			MaybeSleep (i);
+		}
+		/* Then the other classes, which fail the guard */
+		for (int i = 0; i < iterations; ++i) {
+			if (CallGet (objs [1], i) != i * 2)
+				return 2;
+			if (CallGet (objs [2], i) != i + 100)
+				return 3;
+		}
+		for (int i = 0; i < iterations; ++i) {
+			TieredBase o = objs [i % 3];
+			if (CallGet (o, i) != Expected (o, i))
+				return 4;
+		}
+		return 0;
+	}
+
+	public static int test_0_guarded_interface_call_receiver_changes () {
+		ITiered[] objs = new ITiered [] { new TieredDerived (), new TieredOther (), new TieredLate () };
+
+		for (int i = 0; i < iterations; ++i) {
+			if (CallInterfaceGet (objs [0], i) != i * 2)
+				return 1;
+			MaybeSleep (i);
+		}
+		for (int i = 0; i < iterations; ++i) {
+			if (CallInterfaceGet (objs [1], i) != i - 1)
+				return 2;
+			if (CallInterfaceGet (objs [2], i) != i + 100)
+				return 3;
+		}
+		for (int i = 0; i < iterations; ++i) {
+			ITiered o = objs [i % 3];
+			if (CallInterfaceGet (o, i) != Expected (o, i))
+				return 4;
+		}
+		return 0;
+	}
+
+	static int Sub (int a, int b) {
+		return a - b;
+	}
+
+	/* Delegates pointing to the tier 0 code which are collected before the tier-up */
+	public static int test_0_delegate_calls_collected () {
+		for (int i = 0; i < 100; ++i) {
+			Func<int, int, int> sub = Sub;
+			if (sub (i, 1) != i - 1)
+				return 1;
+		}
+		GC.Collect ();
+		GC.WaitForPendingFinalizers ();
+
+		Func<int, int, int> d = Sub;
+		for (int i = 0; i < iterations; ++i) {
+			if (d (i, 1) != i - 1)
+				return 2;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+
+	/* Delegates created after the tier-up */
+	public static int test_0_delegate_calls_after_tier_up () {
+		for (int i = 0; i < iterations; ++i) {
+			Func<int, int, int> add = Add;
+			if (add (i, 2) != i + 2)
+				return 1;
+			MaybeSleep (i);
+		}
+		return 0;
+	}
+}
@@ -511,12 +511,306 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 	*out_cfa = cfa_val;
 }
 
+/*
+ * Pre-decoded unwind tables.
+ *
+ *   Interpreting the unwind ops on every frame step is slow, so the unwind info of a
+ * method is decoded once into an array of rows sorted by code offset, one for each
+ * offset where the unwind state changes. Unwinding a frame is then a binary search
+ * and a few loads. The tables only depend on the unwind info, so they are shared by
+ * the methods using the same unwind info, and they are only freed at shutdown.
+ */
+typedef struct {
+	/* Hardware register number */
+	guint16 hreg;
+	/* Offset of the save slot from the CFA */
+	gint32 offset;
+} UnwindSlot;
+
+typedef struct {
+	guint32 code_offset;
+	gint32 cfa_offset;
+	/* Hardware register number */
+	guint16 cfa_reg;
+	guint16 nslots;
+	guint32 first_slot;
+} UnwindRow;
+
+struct _MonoUnwindTable {
+	int nrows;
+	UnwindRow *rows;
+	UnwindSlot *slots;
+};
+
+/* Maps unwind info pointers to their MonoUnwindTable */
+static GHashTable *unwind_tables;
+/* Statistics */
+static int unwind_table_size;
+
+static void
+add_unwind_row (GArray *rows, GArray *slots, int pos, int cfa_reg, int cfa_offset, Loc *locations, guint8 *reg_saved)
+{
+	UnwindRow row;
+	UnwindSlot slot;
+	int i;
+
+	row.code_offset = pos;
+	row.cfa_reg = mono_dwarf_reg_to_hw_reg (cfa_reg);
+	row.cfa_offset = cfa_offset;
+	row.first_slot = slots->len;
+	row.nslots = 0;
+	for (i = 0; i < NUM_REGS; ++i) {
+		if (reg_saved [i] && locations [i].loc_type == LOC_OFFSET) {
+			slot.hreg = mono_dwarf_reg_to_hw_reg (i);
+			slot.offset = locations [i].offset;
+			g_array_append_val (slots, slot);
+			row.nslots ++;
+		}
+	}
+	g_array_append_val (rows, row);
+}
+
+/*
+ * decode_unwind_table:
+ *
+ *   Execute the unwind ops in UNWIND_INFO the same way as mono_unwind_frame () does,
+ * recording the state at every offset where it changes. Returns an empty table if
+ * the info contains ops which are not supported.
+ */
+static MonoUnwindTable*
+decode_unwind_table (guint8 *unwind_info, guint32 unwind_info_len)
+{
+	Loc locations [NUM_REGS];
+	guint8 reg_saved [NUM_REGS];
+	int pos, reg, cfa_reg, cfa_offset, offset, size;
+	gboolean changed, failed;
+	GArray *rows, *slots;
+	MonoUnwindTable *table;
+	guint8 *p;
+
+	memset (reg_saved, 0, sizeof (reg_saved));
+	rows = g_array_new (FALSE, FALSE, sizeof (UnwindRow));
+	slots = g_array_new (FALSE, FALSE, sizeof (UnwindSlot));
+
+	p = unwind_info;
+	pos = 0;
+	cfa_reg = -1;
+	cfa_offset = -1;
+	changed = FALSE;
+	failed = FALSE;
+	while (p < unwind_info + unwind_info_len && !failed) {
+		int op = *p & 0xc0;
+
+		switch (op) {
+		case DW_CFA_advance_loc:
+			/* The state in effect before the advance starts at POS */
+			if (changed && cfa_reg != -1)
+				add_unwind_row (rows, slots, pos, cfa_reg, cfa_offset, locations, reg_saved);
+			changed = FALSE;
+			pos += *p & 0x3f;
+			p ++;
+			break;
+		case DW_CFA_offset:
+			reg = *p & 0x3f;
+			p ++;
+			reg_saved [reg] = TRUE;
+			locations [reg].loc_type = LOC_OFFSET;
+			locations [reg].offset = decode_uleb128 (p, &p) * DWARF_DATA_ALIGN;
+			changed = TRUE;
+			break;
+		case 0: {
+			int ext_op = *p;
+			p ++;
+			switch (ext_op) {
+			case DW_CFA_def_cfa:
+				cfa_reg = decode_uleb128 (p, &p);
+				cfa_offset = decode_uleb128 (p, &p);
+				break;
+			case DW_CFA_def_cfa_offset:
+				cfa_offset = decode_uleb128 (p, &p);
+				break;
+			case DW_CFA_def_cfa_register:
+				cfa_reg = decode_uleb128 (p, &p);
+				break;
+			case DW_CFA_offset_extended_sf:
+			case DW_CFA_offset_extended:
+				reg = decode_uleb128 (p, &p);
+				if (ext_op == DW_CFA_offset_extended_sf)
+					offset = decode_sleb128 (p, &p);
+				else
+					offset = decode_uleb128 (p, &p);
+				if (reg >= NUM_REGS) {
+					failed = TRUE;
+					break;
+				}
+				reg_saved [reg] = TRUE;
+				locations [reg].loc_type = LOC_OFFSET;
+				locations [reg].offset = offset * DWARF_DATA_ALIGN;
+				break;
+			case DW_CFA_advance_loc4:
+				if (changed && cfa_reg != -1)
+					add_unwind_row (rows, slots, pos, cfa_reg, cfa_offset, locations, reg_saved);
+				changed = FALSE;
+				pos += read32 (p);
+				p += 4;
+				break;
+			default:
+				failed = TRUE;
+				break;
+			}
+			if (ext_op != DW_CFA_advance_loc4)
+				changed = TRUE;
+			break;
+		}
+		default:
+			failed = TRUE;
+			break;
+		}
+	}
+	if (changed && cfa_reg != -1 && !failed)
+		add_unwind_row (rows, slots, pos, cfa_reg, cfa_offset, locations, reg_saved);
+
+	if (failed) {
+		g_array_set_size (rows, 0);
+		g_array_set_size (slots, 0);
+	}
+
+	size = sizeof (MonoUnwindTable) + rows->len * sizeof (UnwindRow) + slots->len * sizeof (UnwindSlot);
+	table = g_malloc0 (size);
+	table->nrows = rows->len;
+	table->rows = (UnwindRow*)(table + 1);
+	table->slots = (UnwindSlot*)(table->rows + rows->len);
+	memcpy (table->rows, rows->data, rows->len * sizeof (UnwindRow));
+	memcpy (table->slots, slots->data, slots->len * sizeof (UnwindSlot));
+	unwind_table_size += size;
+
+	g_array_free (rows, TRUE);
+	g_array_free (slots, TRUE);
+
+	return table;
+}
+
+/*
+ * mono_unwind_get_table:
+ *
+ *   Return the pre-decoded unwind table for UNWIND_INFO, creating it if needed.
+ * UNWIND_INFO should be alive until shutdown, like the data returned by
+ * mono_get_cached_unwind_info () or by the AOT runtime.
+ * This function is not signal safe.
+ */
+MonoUnwindTable*
+mono_unwind_get_table (guint8 *unwind_info, guint32 unwind_info_len)
+{
+	MonoUnwindTable *table;
+
+	unwind_lock ();
+	if (!unwind_tables)
+		unwind_tables = g_hash_table_new (NULL, NULL);
+	table = g_hash_table_lookup (unwind_tables, unwind_info);
+	if (!table) {
+		table = decode_unwind_table (unwind_info, unwind_info_len);
+		/* Make the table visible to lock-free readers only when it is complete */
+		mono_memory_write_barrier ();
+		g_hash_table_insert (unwind_tables, unwind_info, table);
+	}
+	unwind_unlock ();
+
+	return table;
+}
+
+/*
+ * mono_unwind_frame_with_table:
+ *
+ *   Same as mono_unwind_frame (), but use the pre-decoded unwind TABLE of the method
+ * starting at START_IP. Returns FALSE if the table doesn't cover IP, in which case
+ * the caller should use mono_unwind_frame ().
+ * This function is signal safe.
+ */
+gboolean
+mono_unwind_frame_with_table (MonoUnwindTable *table, guint8 *start_ip, guint8 *ip, mgreg_t *regs, int nregs,
+							  mgreg_t **save_locations, int save_locations_len,
+							  guint8 **out_cfa)
+{
+	guint32 pos = ip - start_ip;
+	int lo, hi, i;
+	UnwindRow *row;
+	guint8 *cfa_val;
+
+	if (table->nrows == 0 || pos < table->rows [0].code_offset)
+		return FALSE;
+
+	/* Find the last row starting at or before POS */
+	lo = 0;
+	hi = table->nrows;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+
+		if (table->rows [mid].code_offset <= pos)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	row = &table->rows [lo];
+
+	if (save_locations)
+		memset (save_locations, 0, save_locations_len * sizeof (mgreg_t*));
+
+	cfa_val = (guint8*)regs [row->cfa_reg] + row->cfa_offset;
+	for (i = 0; i < row->nslots; ++i) {
+		UnwindSlot *slot = &table->slots [row->first_slot + i];
+
+		g_assert (slot->hreg < nregs);
+		regs [slot->hreg] = *(mgreg_t*)(cfa_val + slot->offset);
+		if (save_locations && slot->hreg < save_locations_len)
+			save_locations [slot->hreg] = (mgreg_t*)(cfa_val + slot->offset);
+	}
+
+	*out_cfa = cfa_val;
+	return TRUE;
+}
+
+/*
+ * mono_unwind_frame_jinfo:
+ *
+ *   Same as mono_unwind_frame () for a frame of the method described by JI, whose
+ * unwind info is UNWIND_INFO. The pre-decoded unwind table of the method is created
+ * and cached in JI the first time the method is unwound outside of an async context.
+ * This function is signal safe.
+ */
+void
+mono_unwind_frame_jinfo (MonoJitInfo *ji, guint8 *unwind_info, guint32 unwind_info_len,
+						 guint8 *ip, mgreg_t *regs, int nregs,
+						 mgreg_t **save_locations, int save_locations_len,
+						 guint8 **out_cfa)
+{
+	MonoUnwindTable *table = ji->unwind_table;
+
+	if (!table && !mono_thread_info_is_async_context ()) {
+		table = mono_unwind_get_table (unwind_info, unwind_info_len);
+		ji->unwind_table = table;
+	}
+
+	if (table && mono_unwind_frame_with_table (table, ji->code_start, ip, regs, nregs, save_locations, save_locations_len, out_cfa))
+		return;
+
+	mono_unwind_frame (unwind_info, unwind_info_len, ji->code_start,
+					   (guint8*)ji->code_start + ji->code_size,
+					   ip, regs, nregs, save_locations, save_locations_len, out_cfa);
+}
+
 void
 mono_unwind_init (void)
 {
 	InitializeCriticalSection (&unwind_mutex);
 
 	mono_counters_register ("Unwind info size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_info_size);
+	mono_counters_register ("Unwind table size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_table_size);
+}
+
+static void
+free_unwind_table (gpointer key, gpointer value, gpointer user_data)
+{
+	g_free (value);
 }
 
 void
@@ -526,6 +820,12 @@ mono_unwind_cleanup (void)
 
 	DeleteCriticalSection (&unwind_mutex);
 
+	if (unwind_tables) {
+		g_hash_table_foreach (unwind_tables, free_unwind_table, NULL);
+		g_hash_table_destroy (unwind_tables);
+		unwind_tables = NULL;
+	}
+
 	if (!cached_info)
 		return;
 
@@ -0,0 +1,1197 @@
+/*
+ * vectorize.c: Loop auto-vectorization
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * Innermost counted loops over arrays are rewritten to process several 16 byte
+ * vectors of elements per iteration, using the SSE opcodes of the SIMD
+ * intrinsics: UNROLL vectors (32 bytes), or UNROLL_SUMS vectors (64 bytes) for
+ * loops computing sums. The loops handled have the shape produced by the C#
+ * compiler for
+ *   for (; i < n; ++i) <body>
+ * i.e. a body bblock followed by a condition bblock, where:
+ * - i is a local incremented by one at the end of the body, and n is loop
+ *   invariant or the length of a loop invariant array.
+ * - the body accesses the elements of loop invariant arrays at index i, and the
+ *   elements all have the same size.
+ * - the element values are combined using operations which have a vector
+ *   equivalent, possibly with loop invariant values.
+ * - the results are stored to elements at index i, or summed into int locals.
+ * The original loop is kept, and a vector loop is inserted in front of it:
+ *   if (all arrays are non-null && i >= 0) {
+ *     vend = min (n, all array lengths) - (W - 1);
+ *     while (i < vend) { <W elements>; i += W; }
+ *   }
+ *   <original loop>
+ * so the vector loop can't throw, and the original loop handles the remaining
+ * elements, along with any exception it would have thrown. There is no alignment
+ * prologue, the vectors are loaded and stored using unaligned moves.
+ * Since every element is accessed at the same index, the order of the accesses
+ * to the elements of different iterations doesn't matter, even if the arrays are
+ * the same.
+ * The local register allocator can only handle xregs which are used inside one
+ * bblock, so vector values don't outlive an iteration of the vector loop, and
+ * sums are reduced to a scalar at the end of each iteration.
+ * The scalar code does float arithmetic in double precision, so it is only
+ * vectorized when rounding the result once gives the same value, i.e. for a
+ * single operation on float values.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#if !defined(DISABLE_JIT) && defined(MONO_ARCH_SIMD_INTRINSICS)
+
+/* The size of the vectors in bytes */
+#define VECTOR_SIZE 16
+
+/* The number of vectors processed by an iteration of the vector loop */
+#define UNROLL 2
+#define UNROLL_SUMS 4
+
+typedef enum {
+	VAL_NONE,
+	/* The index of the current iteration */
+	VAL_INDEX,
+	/* The address of the current element of an array */
+	VAL_ADDR,
+	/* A value computed from the current elements */
+	VAL_LANE,
+	/* A loop invariant value */
+	VAL_SCALAR
+} ValueKind;
+
+typedef struct {
+	guint8 kind;
+	/* The element size of VAL_ADDR and VAL_LANE values */
+	guint8 esize;
+	guint8 is_float;
+	/*
+	 * For lanes, whenever the value is the element itself, i.e. it is not the
+	 * result of an operation which could overflow the element. For float scalars,
+	 * whenever the value is a float.
+	 */
+	guint8 exact;
+	/* Whenever an exact integer lane was sign extended by its load */
+	guint8 is_signed;
+} ValueInfo;
+
+typedef enum {
+	ACT_SKIP,
+	/* Loop invariant instructions and address computations, emitted once per iteration */
+	ACT_SHARED,
+	/* Moves and conversions which don't change the lanes */
+	ACT_ALIAS,
+	ACT_LOAD,
+	ACT_STORE,
+	ACT_LANE_OP,
+	ACT_SUM
+} ActionKind;
+
+typedef struct {
+	MonoInst *ins;
+	ActionKind action;
+	/* The vector opcode of ACT_LANE_OP */
+	int opcode;
+	/* The broadcasted immediate of ACT_LANE_OP in the current iteration */
+	int imm_reg;
+} VecIns;
+
+typedef struct {
+	MonoCompile *cfg;
+	MonoBasicBlock *pre, *body, *cond;
+	int num_vregs;
+	ValueInfo *values;
+	/* The number of definitions and uses of each vreg in the loop */
+	int *num_defs, *num_uses;
+	/* The induction variable */
+	int iv;
+	/* The loop bound, a vreg, the length of an array, or a constant */
+	int bound_reg, bound_array;
+	gint32 bound_imm;
+	/* The element size of the arrays accessed by the loop */
+	int esize;
+	/* The invariant objects which need to be non-null, as vregs */
+	GSList *objects;
+	/* The invariant arrays whose elements are accessed, as vregs */
+	GSList *arrays;
+	/* The int locals summing lanes, as vregs */
+	GSList *sums;
+	int simd_versions;
+	VecIns *insts;
+	int num_insts;
+	/* The instruction being analyzed, for the debug output */
+	MonoInst *cur_ins;
+	/* Maps the vregs of the original loop to the vregs of the vector loop */
+	int *vmap;
+	/* Maps scalar vregs to their broadcasted value in the current iteration */
+	int *bcast;
+	/* Maps sum vregs to the vector accumulating them in the current iteration */
+	int *acc;
+} VecLoop;
+
+static int simd_versions = -1;
+
+static void
+add_object (VecLoop *loop, int vreg)
+{
+	if (!g_slist_find (loop->objects, GINT_TO_POINTER (vreg)))
+		loop->objects = g_slist_prepend_mempool (loop->cfg->mempool, loop->objects, GINT_TO_POINTER (vreg));
+}
+
+static void
+add_array (VecLoop *loop, int vreg)
+{
+	add_object (loop, vreg);
+	if (!g_slist_find (loop->arrays, GINT_TO_POINTER (vreg)))
+		loop->arrays = g_slist_prepend_mempool (loop->cfg->mempool, loop->arrays, GINT_TO_POINTER (vreg));
+}
+
+static gboolean
+is_invariant_var (VecLoop *loop, int vreg)
+{
+	return vreg >= 0 && vreg < loop->num_vregs && get_vreg_to_inst (loop->cfg, vreg) && !loop->num_defs [vreg] && !vreg_is_volatile (loop->cfg, vreg);
+}
+
+/*
+ * get_value:
+ *
+ *   Return the information about VREG, or NULL if the loop can't be vectorized
+ * when it is used.
+ */
+static ValueInfo*
+get_value (VecLoop *loop, int vreg)
+{
+	ValueInfo *info;
+
+	if (vreg < MONO_MAX_IREGS || vreg >= loop->num_vregs)
+		return NULL;
+	info = &loop->values [vreg];
+	if (info->kind == VAL_NONE && is_invariant_var (loop, vreg)) {
+		MonoInst *var = get_vreg_to_inst (loop->cfg, vreg);
+
+		info->kind = VAL_SCALAR;
+		if (var->type == STACK_R8) {
+			info->is_float = TRUE;
+			info->exact = !var->inst_vtype->byref && var->inst_vtype->type == MONO_TYPE_R4;
+		}
+	}
+	return info->kind == VAL_NONE ? NULL : info;
+}
+
+static gboolean
+is_array_var (VecLoop *loop, int vreg)
+{
+	ValueInfo *info = get_value (loop, vreg);
+
+	return info && info->kind == VAL_SCALAR && get_vreg_to_inst (loop->cfg, vreg) && get_vreg_to_inst (loop->cfg, vreg)->type == STACK_OBJ;
+}
+
+static gboolean
+is_index (VecLoop *loop, int vreg)
+{
+	ValueInfo *info = get_value (loop, vreg);
+
+	return info && info->kind == VAL_INDEX;
+}
+
+/* Return whenever the loop processes elements of size ESIZE */
+static gboolean
+set_esize (VecLoop *loop, int esize)
+{
+	if (loop->esize && loop->esize != esize)
+		return FALSE;
+	loop->esize = esize;
+	return TRUE;
+}
+
+static int
+load_esize (int opcode, gboolean *is_float, gboolean *is_signed)
+{
+	*is_float = FALSE;
+	*is_signed = FALSE;
+	switch (opcode) {
+	case OP_LOADI1_MEMBASE:
+		*is_signed = TRUE;
+		return 1;
+	case OP_LOADU1_MEMBASE:
+		return 1;
+	case OP_LOADI2_MEMBASE:
+		*is_signed = TRUE;
+		return 2;
+	case OP_LOADU2_MEMBASE:
+		return 2;
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+		*is_signed = TRUE;
+		return 4;
+	case OP_LOADR4_MEMBASE:
+		*is_float = TRUE;
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static int
+store_esize (int opcode, gboolean *is_float, gboolean *is_imm)
+{
+	*is_float = FALSE;
+	*is_imm = FALSE;
+	switch (opcode) {
+	case OP_STOREI1_MEMBASE_IMM:
+		*is_imm = TRUE;
+	case OP_STOREI1_MEMBASE_REG:
+		return 1;
+	case OP_STOREI2_MEMBASE_IMM:
+		*is_imm = TRUE;
+	case OP_STOREI2_MEMBASE_REG:
+		return 2;
+	case OP_STOREI4_MEMBASE_IMM:
+		*is_imm = TRUE;
+	case OP_STOREI4_MEMBASE_REG:
+		return 4;
+	case OP_STORER4_MEMBASE_REG:
+		*is_float = TRUE;
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+/* Return the opcode taking a register instead of the immediate of OPCODE, or -1 */
+static int
+imm_to_op (int opcode)
+{
+	switch (opcode) {
+	case OP_IADD_IMM:
+		return OP_IADD;
+	case OP_ISUB_IMM:
+		return OP_ISUB;
+	case OP_IMUL_IMM:
+		return OP_IMUL;
+	case OP_IAND_IMM:
+		return OP_IAND;
+	case OP_IOR_IMM:
+		return OP_IOR;
+	case OP_IXOR_IMM:
+		return OP_IXOR;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * lane_opcode:
+ *
+ *   Return the vector opcode computing the scalar OPCODE on lanes of size ESIZE,
+ * or -1.
+ */
+static int
+lane_opcode (VecLoop *loop, int opcode, int esize, gboolean is_float, gboolean is_signed)
+{
+	gboolean sse41 = (loop->simd_versions & SIMD_VERSION_SSE41) != 0;
+
+	if (is_float) {
+		switch (opcode) {
+		case OP_FADD:
+			return OP_ADDPS;
+		case OP_FSUB:
+			return OP_SUBPS;
+		case OP_FMUL:
+			return OP_MULPS;
+		case OP_FDIV:
+			return OP_DIVPS;
+		default:
+			return -1;
+		}
+	}
+
+	switch (opcode) {
+	case OP_IADD:
+		return esize == 1 ? OP_PADDB : (esize == 2 ? OP_PADDW : OP_PADDD);
+	case OP_ISUB:
+		return esize == 1 ? OP_PSUBB : (esize == 2 ? OP_PSUBW : OP_PSUBD);
+	case OP_IAND:
+		return OP_PAND;
+	case OP_IOR:
+		return OP_POR;
+	case OP_IXOR:
+		return OP_PXOR;
+	case OP_IMUL:
+		if (esize == 2)
+			return OP_PMULW;
+		if (esize == 4 && sse41)
+			return OP_PMULD;
+		return -1;
+	case OP_IMIN:
+		if (esize == 1)
+			return is_signed ? (sse41 ? OP_PMINB : -1) : OP_PMINB_UN;
+		if (esize == 2)
+			return is_signed ? OP_PMINW : (sse41 ? OP_PMINW_UN : -1);
+		return sse41 ? OP_PMIND : -1;
+	case OP_IMAX:
+		if (esize == 1)
+			return is_signed ? (sse41 ? OP_PMAXB : -1) : OP_PMAXB_UN;
+		if (esize == 2)
+			return is_signed ? OP_PMAXW : (sse41 ? OP_PMAXW_UN : -1);
+		return sse41 ? OP_PMAXD : -1;
+	default:
+		return -1;
+	}
+}
+
+static gboolean
+is_bounds_check_compare (VecLoop *loop, MonoInst *ins)
+{
+#if defined(TARGET_AMD64)
+	if (ins->opcode != OP_AMD64_ICOMPARE_MEMBASE_REG)
+		return FALSE;
+#elif defined(TARGET_X86)
+	if (ins->opcode != OP_X86_COMPARE_MEMBASE_REG)
+		return FALSE;
+#else
+	return FALSE;
+#endif
+	return ins->inst_offset == G_STRUCT_OFFSET (MonoArray, max_length) && is_array_var (loop, ins->inst_basereg) && is_index (loop, ins->sreg2) &&
+		ins->next && ins->next->opcode == OP_COND_EXC_LE_UN;
+}
+
+/*
+ * analyze_cond:
+ *
+ *   Check that the condition bblock of the loop only compares the induction
+ * variable with the loop bound.
+ */
+static gboolean
+analyze_cond (VecLoop *loop)
+{
+	MonoInst *ins;
+	int len_reg = -1;
+
+	MONO_BB_FOR_EACH_INS (loop->cond, ins) {
+		loop->cur_ins = ins;
+		switch (ins->opcode) {
+		case OP_NOP:
+			break;
+		case OP_CHECK_THIS:
+		case OP_NOT_NULL:
+			if (!is_array_var (loop, ins->sreg1))
+				return FALSE;
+			add_object (loop, ins->sreg1);
+			break;
+		case OP_LDLEN:
+			if (len_reg != -1 || !is_array_var (loop, ins->sreg1) || get_vreg_to_inst (loop->cfg, ins->dreg))
+				return FALSE;
+			len_reg = ins->dreg;
+			loop->bound_array = ins->sreg1;
+			add_array (loop, ins->sreg1);
+			break;
+		case OP_ICOMPARE:
+			if (ins->sreg1 != loop->iv || !ins->next || ins->next->opcode != OP_IBLT)
+				return FALSE;
+			if (ins->sreg2 == len_reg) {
+				loop->bound_reg = -1;
+			} else {
+				ValueInfo *info = get_value (loop, ins->sreg2);
+
+				if (!info || info->kind != VAL_SCALAR || info->is_float)
+					return FALSE;
+				loop->bound_reg = ins->sreg2;
+				loop->bound_array = -1;
+			}
+			break;
+		case OP_ICOMPARE_IMM:
+			if (ins->sreg1 != loop->iv || !ins->next || ins->next->opcode != OP_IBLT)
+				return FALSE;
+			loop->bound_reg = -1;
+			loop->bound_array = -1;
+			loop->bound_imm = ins->inst_imm;
+			break;
+		case OP_IBLT:
+			if (ins != loop->cond->last_ins || ins->inst_true_bb != loop->body)
+				return FALSE;
+			break;
+		default:
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * analyze_lane_op:
+ *
+ *   Check that the arithmetic INS can be computed on the lanes of vectors.
+ */
+static gboolean
+analyze_lane_op (VecLoop *loop, VecIns *vins)
+{
+	MonoInst *ins = vins->ins;
+	ValueInfo *dest = &loop->values [ins->dreg];
+	ValueInfo *v1, *v2, *lane;
+	int opcode = ins->opcode;
+	gboolean is_imm = FALSE;
+
+	if (imm_to_op (opcode) != -1) {
+		opcode = imm_to_op (opcode);
+		is_imm = TRUE;
+	}
+
+	v1 = get_value (loop, ins->sreg1);
+	v2 = is_imm ? NULL : get_value (loop, ins->sreg2);
+	if (!v1 || (!is_imm && !v2))
+		return FALSE;
+
+	if (v1->kind == VAL_SCALAR && (is_imm || v2->kind == VAL_SCALAR)) {
+		/* Invariant integer arithmetic is recomputed in each iteration */
+		if (v1->is_float)
+			return FALSE;
+		switch (opcode) {
+		case OP_IADD:
+		case OP_ISUB:
+		case OP_IMUL:
+		case OP_IAND:
+		case OP_IOR:
+		case OP_IXOR:
+			dest->kind = VAL_SCALAR;
+			vins->action = ACT_SHARED;
+			return TRUE;
+		default:
+			return FALSE;
+		}
+	}
+
+	lane = v1->kind == VAL_LANE ? v1 : (v2 && v2->kind == VAL_LANE ? v2 : NULL);
+	if (!lane)
+		return FALSE;
+	if (v1->kind != VAL_LANE && v1->kind != VAL_SCALAR)
+		return FALSE;
+	if (v2 && v2->kind != VAL_LANE && v2->kind != VAL_SCALAR)
+		return FALSE;
+
+	if (lane->is_float) {
+		/* Only one float operation on float values, see above */
+		if (!v2 || !v1->is_float || !v1->exact || !v2->is_float || !v2->exact)
+			return FALSE;
+#if MONO_ARCH_USE_FPSTACK
+		if (v1->kind == VAL_SCALAR || v2->kind == VAL_SCALAR)
+			return FALSE;
+#endif
+	} else {
+		if (v1->is_float || (v2 && v2->is_float))
+			return FALSE;
+	}
+
+	if (opcode == OP_IMIN || opcode == OP_IMAX) {
+		/* The comparison needs the element values, and the same extension on both sides */
+		if (v1->kind != VAL_LANE || v2->kind != VAL_LANE || !v1->exact || !v2->exact || v1->is_signed != v2->is_signed)
+			return FALSE;
+	}
+
+	vins->opcode = lane_opcode (loop, opcode, lane->esize, lane->is_float, lane->is_signed);
+	if (vins->opcode == -1)
+		return FALSE;
+
+	dest->kind = VAL_LANE;
+	dest->esize = lane->esize;
+	dest->is_float = lane->is_float;
+	dest->is_signed = lane->is_signed;
+	/* The elements of int lanes wrap around, like int arithmetic does */
+	dest->exact = (opcode == OP_IMIN || opcode == OP_IMAX || (!lane->is_float && lane->esize == 4));
+	vins->action = ACT_LANE_OP;
+	vins->imm_reg = -1;
+	return TRUE;
+}
+
+/*
+ * analyze_body:
+ *
+ *   Classify the instructions of the loop body, and check that they can be
+ * executed on vectors of elements.
+ */
+static gboolean
+analyze_body (VecLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+	int n = 0;
+
+	MONO_BB_FOR_EACH_INS (loop->body, ins)
+		n ++;
+	loop->insts = mono_mempool_alloc0 (cfg->mempool, sizeof (VecIns) * n);
+
+	MONO_BB_FOR_EACH_INS (loop->body, ins) {
+		const char *spec = INS_INFO (ins->opcode);
+		VecIns *vins = &loop->insts [loop->num_insts ++];
+		ValueInfo *dest = NULL, *src;
+		gboolean is_float, is_signed, is_imm;
+		int esize;
+
+		vins->ins = ins;
+		vins->action = ACT_SKIP;
+		loop->cur_ins = ins;
+
+		if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins)) {
+			if (ins->dreg < MONO_MAX_IREGS || ins->dreg >= loop->num_vregs)
+				return FALSE;
+			/* The only locals which can be modified are the induction variable and the sums */
+			if (get_vreg_to_inst (cfg, ins->dreg) && ins->dreg != loop->iv && ins->opcode != OP_IADD)
+				return FALSE;
+			dest = &loop->values [ins->dreg];
+		}
+
+		switch (ins->opcode) {
+		case OP_NOP:
+			break;
+		case OP_CHECK_THIS:
+		case OP_NOT_NULL:
+			if (!is_array_var (loop, ins->sreg1))
+				return FALSE;
+			add_object (loop, ins->sreg1);
+			break;
+		case OP_BOUNDS_CHECK:
+			if (!is_array_var (loop, ins->sreg1) || !is_index (loop, ins->sreg2) || ins->inst_imm != G_STRUCT_OFFSET (MonoArray, max_length))
+				return FALSE;
+			add_array (loop, ins->sreg1);
+			break;
+		case OP_COND_EXC_LE_UN:
+			/* Checked together with the compare */
+			if (!ins->prev || !is_bounds_check_compare (loop, ins->prev))
+				return FALSE;
+			break;
+		case OP_BR:
+			if (ins != loop->body->last_ins || ins->inst_target_bb != loop->cond)
+				return FALSE;
+			break;
+		case OP_ICONST:
+			dest->kind = VAL_SCALAR;
+			vins->action = ACT_SHARED;
+			break;
+		case OP_R4CONST:
+#if MONO_ARCH_USE_FPSTACK
+			return FALSE;
+#else
+			dest->kind = VAL_SCALAR;
+			dest->is_float = TRUE;
+			dest->exact = TRUE;
+			vins->action = ACT_SHARED;
+			break;
+#endif
+		case OP_SEXT_I4:
+			if (ins->sreg1 != loop->iv)
+				return FALSE;
+			dest->kind = VAL_INDEX;
+			vins->action = ACT_SHARED;
+			break;
+		case OP_MOVE:
+		case OP_FMOVE:
+			src = get_value (loop, ins->sreg1);
+			if (!src || get_vreg_to_inst (cfg, ins->dreg))
+				return FALSE;
+			*dest = *src;
+			vins->action = ACT_ALIAS;
+			break;
+		case OP_ICONV_TO_I1:
+		case OP_ICONV_TO_U1:
+		case OP_ICONV_TO_I2:
+		case OP_ICONV_TO_U2:
+			/* Truncating a lane to its element size is a nop */
+			src = get_value (loop, ins->sreg1);
+			esize = (ins->opcode == OP_ICONV_TO_I1 || ins->opcode == OP_ICONV_TO_U1) ? 1 : 2;
+			if (!src || src->kind != VAL_LANE || src->is_float || src->esize != esize)
+				return FALSE;
+			*dest = *src;
+			dest->exact = FALSE;
+			vins->action = ACT_ALIAS;
+			break;
+		case OP_FCONV_TO_R4:
+			/* Rounds the result of an operation to float */
+			src = get_value (loop, ins->sreg1);
+			if (!src || src->kind != VAL_LANE || !src->is_float)
+				return FALSE;
+			*dest = *src;
+			dest->exact = TRUE;
+			vins->action = ACT_ALIAS;
+			break;
+		case OP_X86_LEA:
+			if (!is_array_var (loop, ins->sreg1) || !is_index (loop, ins->sreg2))
+				return FALSE;
+			if (ins->inst_imm != G_STRUCT_OFFSET (MonoArray, vector) || ins->backend.shift_amount > 2)
+				return FALSE;
+			add_array (loop, ins->sreg1);
+			dest->kind = VAL_ADDR;
+			dest->esize = 1 << ins->backend.shift_amount;
+			vins->action = ACT_SHARED;
+			break;
+		case OP_IADD_IMM:
+			if (ins->dreg == loop->iv) {
+				/* The increment of the induction variable ends the body */
+				if (ins->sreg1 != loop->iv || ins->inst_imm != 1)
+					return FALSE;
+				if (!(ins->next == NULL || (ins->next->opcode == OP_BR && ins->next->next == NULL)))
+					return FALSE;
+				break;
+			}
+			if (!analyze_lane_op (loop, vins))
+				return FALSE;
+			break;
+		case OP_IADD:
+			if (get_vreg_to_inst (cfg, ins->dreg)) {
+				/* s += <lane> */
+				int sum = ins->dreg;
+				MonoInst *var = get_vreg_to_inst (cfg, sum);
+				int other = ins->sreg1 == sum ? ins->sreg2 : ins->sreg1;
+
+				if (sum == loop->iv || (ins->sreg1 != sum && ins->sreg2 != sum) || other == sum)
+					return FALSE;
+				if (var->type != STACK_I4 || vreg_is_volatile (cfg, sum) || loop->num_defs [sum] != 1 || loop->num_uses [sum] != 1)
+					return FALSE;
+				src = get_value (loop, other);
+				if (!src || src->kind != VAL_LANE || src->is_float || src->esize != 4)
+					return FALSE;
+				loop->sums = g_slist_prepend_mempool (cfg->mempool, loop->sums, GINT_TO_POINTER (sum));
+				vins->action = ACT_SUM;
+				break;
+			}
+			if (!analyze_lane_op (loop, vins))
+				return FALSE;
+			break;
+		case OP_ISUB:
+		case OP_IMUL:
+		case OP_IAND:
+		case OP_IOR:
+		case OP_IXOR:
+		case OP_IMIN:
+		case OP_IMAX:
+		case OP_ISUB_IMM:
+		case OP_IMUL_IMM:
+		case OP_IAND_IMM:
+		case OP_IOR_IMM:
+		case OP_IXOR_IMM:
+		case OP_FADD:
+		case OP_FSUB:
+		case OP_FMUL:
+		case OP_FDIV:
+			if (!analyze_lane_op (loop, vins))
+				return FALSE;
+			break;
+		default:
+			if (is_bounds_check_compare (loop, ins)) {
+				add_array (loop, ins->inst_basereg);
+				break;
+			}
+
+			esize = load_esize (ins->opcode, &is_float, &is_signed);
+			if (esize) {
+				src = get_value (loop, ins->inst_basereg);
+				if (!src || src->kind != VAL_ADDR || src->esize != esize || ins->inst_offset != 0 || (ins->flags & MONO_INST_VOLATILE))
+					return FALSE;
+				if (!set_esize (loop, esize))
+					return FALSE;
+				dest->kind = VAL_LANE;
+				dest->esize = esize;
+				dest->is_float = is_float;
+				dest->is_signed = is_signed;
+				dest->exact = TRUE;
+				vins->action = ACT_LOAD;
+				break;
+			}
+
+			esize = store_esize (ins->opcode, &is_float, &is_imm);
+			if (esize) {
+				ValueInfo *addr = get_value (loop, ins->inst_destbasereg);
+
+				if (!addr || addr->kind != VAL_ADDR || addr->esize != esize || ins->inst_offset != 0 || (ins->flags & MONO_INST_VOLATILE))
+					return FALSE;
+				if (!set_esize (loop, esize))
+					return FALSE;
+				if (!is_imm) {
+					src = get_value (loop, ins->sreg1);
+					if (!src || src->is_float != is_float)
+						return FALSE;
+					if (src->kind == VAL_LANE) {
+						if (src->esize != esize)
+							return FALSE;
+					} else if (src->kind == VAL_SCALAR) {
+#if MONO_ARCH_USE_FPSTACK
+						if (is_float)
+							return FALSE;
+#endif
+					} else {
+						return FALSE;
+					}
+				}
+				vins->action = ACT_STORE;
+				vins->imm_reg = -1;
+				break;
+			}
+			return FALSE;
+		}
+	}
+
+	loop->cur_ins = NULL;
+	return loop->esize != 0;
+}
+
+static void
+count_defs_uses (VecLoop *loop, MonoBasicBlock *bb)
+{
+	MonoInst *ins;
+
+	MONO_BB_FOR_EACH_INS (bb, ins) {
+		const char *spec = INS_INFO (ins->opcode);
+		int sregs [MONO_MAX_SRC_REGS];
+		int i, num_sregs;
+
+		if (spec [MONO_INST_DEST] != ' ' && ins->dreg >= 0 && ins->dreg < loop->num_vregs) {
+			if (MONO_IS_STORE_MEMBASE (ins))
+				loop->num_uses [ins->dreg] ++;
+			else
+				loop->num_defs [ins->dreg] ++;
+		}
+		num_sregs = mono_inst_get_src_registers (ins, sregs);
+		for (i = 0; i < num_sregs; ++i) {
+			if (sregs [i] >= 0 && sregs [i] < loop->num_vregs)
+				loop->num_uses [sregs [i]] ++;
+		}
+	}
+}
+
+static int
+map_reg (VecLoop *loop, int vreg)
+{
+	if (vreg >= 0 && vreg < loop->num_vregs && loop->vmap [vreg] != -1)
+		return loop->vmap [vreg];
+	return vreg;
+}
+
+static int
+broadcast_opcode (int esize, gboolean is_float)
+{
+	if (is_float)
+		return OP_EXPAND_R4;
+	return esize == 1 ? OP_EXPAND_I1 : (esize == 2 ? OP_EXPAND_I2 : OP_EXPAND_I4);
+}
+
+/* Return a vector whose lanes contain the scalar VREG */
+static int
+emit_broadcast (VecLoop *loop, int vreg)
+{
+	MonoCompile *cfg = loop->cfg;
+	ValueInfo *info = &loop->values [vreg];
+	int xreg;
+
+	if (loop->bcast [vreg] != -1)
+		return loop->bcast [vreg];
+	xreg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_UNALU (cfg, broadcast_opcode (loop->esize, info->is_float), xreg, map_reg (loop, vreg));
+	loop->bcast [vreg] = xreg;
+	return xreg;
+}
+
+static int
+emit_broadcast_imm (VecLoop *loop, gint32 imm)
+{
+	MonoCompile *cfg = loop->cfg;
+	int ireg = alloc_ireg (cfg);
+	int xreg = alloc_ireg (cfg);
+
+	MONO_EMIT_NEW_ICONST (cfg, ireg, imm);
+	MONO_EMIT_NEW_UNALU (cfg, broadcast_opcode (loop->esize, FALSE), xreg, ireg);
+	return xreg;
+}
+
+/* Return the vector computed by the operand VREG of a lane operation */
+static int
+lane_operand (VecLoop *loop, int vreg)
+{
+	if (loop->values [vreg].kind == VAL_LANE)
+		return loop->vmap [vreg];
+	return emit_broadcast (loop, vreg);
+}
+
+static void
+emit_part (VecLoop *loop, int part)
+{
+	MonoCompile *cfg = loop->cfg;
+	int i, offset = part * VECTOR_SIZE;
+
+	for (i = 0; i < loop->num_insts; ++i) {
+		VecIns *vins = &loop->insts [i];
+		MonoInst *ins = vins->ins, *copy;
+		int xreg, sreg1, sreg2;
+
+		switch (vins->action) {
+		case ACT_SKIP:
+			break;
+		case ACT_SHARED:
+			if (part > 0)
+				break;
+			MONO_INST_NEW (cfg, copy, ins->opcode);
+			memcpy (copy, ins, sizeof (MonoInst));
+			copy->next = copy->prev = NULL;
+			copy->sreg1 = map_reg (loop, ins->sreg1);
+			copy->sreg2 = map_reg (loop, ins->sreg2);
+			if (INS_INFO (ins->opcode) [MONO_INST_DEST] == 'f')
+				copy->dreg = alloc_freg (cfg);
+			else if (ins->opcode == OP_X86_LEA)
+				copy->dreg = alloc_ireg_mp (cfg);
+			else
+				copy->dreg = alloc_ireg (cfg);
+			loop->vmap [ins->dreg] = copy->dreg;
+			MONO_ADD_INS (cfg->cbb, copy);
+			break;
+		case ACT_ALIAS:
+			loop->vmap [ins->dreg] = map_reg (loop, ins->sreg1);
+			break;
+		case ACT_LOAD:
+			xreg = alloc_ireg (cfg);
+			MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADX_MEMBASE, xreg, map_reg (loop, ins->inst_basereg), offset);
+			loop->vmap [ins->dreg] = xreg;
+			break;
+		case ACT_STORE: {
+			gboolean is_float, is_imm;
+
+			store_esize (ins->opcode, &is_float, &is_imm);
+			if (is_imm) {
+				if (vins->imm_reg == -1)
+					vins->imm_reg = emit_broadcast_imm (loop, ins->inst_imm);
+				xreg = vins->imm_reg;
+			} else {
+				xreg = lane_operand (loop, ins->sreg1);
+			}
+			MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREX_MEMBASE, map_reg (loop, ins->inst_destbasereg), offset, xreg);
+			break;
+		}
+		case ACT_LANE_OP:
+			sreg1 = lane_operand (loop, ins->sreg1);
+			if (imm_to_op (ins->opcode) != -1) {
+				if (vins->imm_reg == -1)
+					vins->imm_reg = emit_broadcast_imm (loop, ins->inst_imm);
+				sreg2 = vins->imm_reg;
+			} else {
+				sreg2 = lane_operand (loop, ins->sreg2);
+			}
+			xreg = alloc_ireg (cfg);
+			MONO_EMIT_NEW_BIALU (cfg, vins->opcode, xreg, sreg1, sreg2);
+			loop->vmap [ins->dreg] = xreg;
+			break;
+		case ACT_SUM: {
+			int sum = ins->dreg;
+			int lane = loop->vmap [ins->sreg1 == sum ? ins->sreg2 : ins->sreg1];
+
+			if (loop->acc [sum] == -1) {
+				loop->acc [sum] = lane;
+			} else {
+				xreg = alloc_ireg (cfg);
+				MONO_EMIT_NEW_BIALU (cfg, OP_PADDD, xreg, loop->acc [sum], lane);
+				loop->acc [sum] = xreg;
+			}
+			break;
+		}
+		default:
+			g_assert_not_reached ();
+		}
+	}
+}
+
+/* Add the lanes of the accumulator of SUM to it */
+static void
+emit_sum_reduction (VecLoop *loop, int sum)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+	int acc = loop->acc [sum];
+	int t1, t2, t3, t4, res;
+
+	/* Add the high half to the low half, then the second lane to the first */
+	t1 = alloc_ireg (cfg);
+	MONO_INST_NEW (cfg, ins, OP_PSHUFLED);
+	ins->dreg = t1;
+	ins->sreg1 = acc;
+	ins->inst_c0 = 0x4e;
+	MONO_ADD_INS (cfg->cbb, ins);
+	t2 = alloc_ireg (cfg);
+	MONO_EMIT_NEW_BIALU (cfg, OP_PADDD, t2, acc, t1);
+	t3 = alloc_ireg (cfg);
+	MONO_INST_NEW (cfg, ins, OP_PSHUFLED);
+	ins->dreg = t3;
+	ins->sreg1 = t2;
+	ins->inst_c0 = 0xb1;
+	MONO_ADD_INS (cfg->cbb, ins);
+	t4 = alloc_ireg (cfg);
+	MONO_EMIT_NEW_BIALU (cfg, OP_PADDD, t4, t2, t3);
+	res = alloc_ireg (cfg);
+	MONO_INST_NEW (cfg, ins, OP_EXTRACT_I4);
+	ins->dreg = res;
+	ins->sreg1 = t4;
+	ins->inst_c0 = 0;
+	MONO_ADD_INS (cfg->cbb, ins);
+	MONO_EMIT_NEW_BIALU (cfg, OP_IADD, sum, sum, res);
+}
+
+static MonoBasicBlock*
+new_bblock (VecLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *bb;
+
+	NEW_BBLOCK (cfg, bb);
+	bb->region = loop->cond->region;
+	bb->real_offset = loop->cond->real_offset;
+	bb->cil_code = loop->cond->cil_code;
+	return bb;
+}
+
+static void
+emit_branch (MonoCompile *cfg, int opcode, MonoBasicBlock *true_bb, MonoBasicBlock *false_bb)
+{
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, opcode);
+	ins->inst_many_bb = mono_mempool_alloc (cfg->mempool, sizeof (gpointer) * 2);
+	ins->inst_true_bb = true_bb;
+	ins->inst_false_bb = false_bb;
+	MONO_ADD_INS (cfg->cbb, ins);
+}
+
+/*
+ * vectorize_loop:
+ *
+ *   Insert the vector loop in front of the analyzed loop.
+ */
+static void
+vectorize_loop (VecLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *guard_bb, *pre_bb, *vbody_bb;
+	MonoInst *vend;
+	GSList *l;
+	int unroll = loop->sums ? UNROLL_SUMS : UNROLL;
+	int width = unroll * VECTOR_SIZE / loop->esize;
+	int flag, t1, t2, lim;
+
+	guard_bb = new_bblock (loop);
+	pre_bb = new_bblock (loop);
+	vbody_bb = new_bblock (loop);
+	vend = mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL);
+
+	/* Enter the vector loop if the arrays are non-null and the index is not negative */
+	cfg->cbb = guard_bb;
+	t1 = alloc_ireg (cfg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->iv, 0);
+	MONO_EMIT_NEW_UNALU (cfg, OP_ICLT, t1, -1);
+	flag = t1;
+	for (l = loop->objects; l; l = l->next) {
+		t1 = alloc_ireg (cfg);
+		t2 = alloc_ireg (cfg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, GPOINTER_TO_INT (l->data), 0);
+		MONO_EMIT_NEW_UNALU (cfg, OP_PCEQ, t1, -1);
+		MONO_EMIT_NEW_BIALU (cfg, OP_IOR, t2, flag, t1);
+		flag = t2;
+	}
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, flag, 0);
+	emit_branch (cfg, OP_IBNE_UN, loop->cond, pre_bb);
+
+	/* vend = min (n, array lengths) - (width - 1) */
+	cfg->cbb = pre_bb;
+	if (loop->bound_array != -1) {
+		lim = alloc_ireg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP_FLAGS (cfg, OP_LOADI4_MEMBASE, lim, loop->bound_array, G_STRUCT_OFFSET (MonoArray, max_length), MONO_INST_INVARIANT_LOAD);
+	} else if (loop->bound_reg != -1) {
+		/* Clamp a negative bound to 0 so the computations below can't overflow */
+		t1 = alloc_ireg (cfg);
+		t2 = alloc_ireg (cfg);
+		lim = alloc_ireg (cfg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISHR_IMM, t1, loop->bound_reg, 31);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IXOR_IMM, t2, t1, -1);
+		MONO_EMIT_NEW_BIALU (cfg, OP_IAND, lim, loop->bound_reg, t2);
+	} else {
+		lim = alloc_ireg (cfg);
+		MONO_EMIT_NEW_ICONST (cfg, lim, MAX (loop->bound_imm, 0));
+	}
+	for (l = loop->arrays; l; l = l->next) {
+		int array = GPOINTER_TO_INT (l->data);
+		int len, diff, mask, min;
+
+		if (array == loop->bound_array)
+			continue;
+		/* min (lim, len) = len + ((lim - len) & ((lim - len) >> 31)) */
+		len = alloc_ireg (cfg);
+		diff = alloc_ireg (cfg);
+		mask = alloc_ireg (cfg);
+		min = alloc_ireg (cfg);
+		t1 = alloc_ireg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP_FLAGS (cfg, OP_LOADI4_MEMBASE, len, array, G_STRUCT_OFFSET (MonoArray, max_length), MONO_INST_INVARIANT_LOAD);
+		MONO_EMIT_NEW_BIALU (cfg, OP_ISUB, diff, lim, len);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISHR_IMM, mask, diff, 31);
+		MONO_EMIT_NEW_BIALU (cfg, OP_IAND, t1, diff, mask);
+		MONO_EMIT_NEW_BIALU (cfg, OP_IADD, min, len, t1);
+		lim = min;
+	}
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, vend->dreg, lim, width - 1);
+	MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, loop->iv, vend->dreg);
+	emit_branch (cfg, OP_IBGE, loop->cond, vbody_bb);
+
+	/* The vector loop */
+	cfg->cbb = vbody_bb;
+	loop->vmap = mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->num_vregs);
+	loop->bcast = mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->num_vregs);
+	loop->acc = mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->num_vregs);
+	memset (loop->vmap, 0xff, sizeof (int) * loop->num_vregs);
+	memset (loop->bcast, 0xff, sizeof (int) * loop->num_vregs);
+	memset (loop->acc, 0xff, sizeof (int) * loop->num_vregs);
+	for (t1 = 0; t1 < unroll; ++t1)
+		emit_part (loop, t1);
+	for (l = loop->sums; l; l = l->next)
+		emit_sum_reduction (loop, GPOINTER_TO_INT (l->data));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, loop->iv, loop->iv, width);
+	MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, loop->iv, vend->dreg);
+	emit_branch (cfg, OP_IBLT, vbody_bb, loop->cond);
+
+	/* Link the new bblocks between the preheader and the loop */
+	if (loop->pre->last_ins && loop->pre->last_ins->opcode == OP_BR)
+		loop->pre->last_ins->inst_target_bb = guard_bb;
+	vbody_bb->next_bb = loop->pre->next_bb;
+	pre_bb->next_bb = vbody_bb;
+	guard_bb->next_bb = pre_bb;
+	loop->pre->next_bb = guard_bb;
+
+	mono_unlink_bblock (cfg, loop->pre, loop->cond);
+	mono_link_bblock (cfg, loop->pre, guard_bb);
+	mono_link_bblock (cfg, guard_bb, loop->cond);
+	mono_link_bblock (cfg, guard_bb, pre_bb);
+	mono_link_bblock (cfg, pre_bb, loop->cond);
+	mono_link_bblock (cfg, pre_bb, vbody_bb);
+	mono_link_bblock (cfg, vbody_bb, vbody_bb);
+	mono_link_bblock (cfg, vbody_bb, loop->cond);
+
+	if (cfg->verbose_level > 1) {
+		printf ("VECTORIZE: loop BB%d/BB%d, %d elements per iteration in BB%d\n", loop->cond->block_num, loop->body->block_num, width, vbody_bb->block_num);
+		mono_print_bb (vbody_bb, "VECTORIZED LOOP");
+	}
+
+	mono_jit_stats.loops_vectorized ++;
+}
+
+/*
+ * Return the body of the loop whose condition bblock is COND, and set PRE to
+ * the bblock entering it.
+ */
+static MonoBasicBlock*
+get_loop_body (MonoCompile *cfg, MonoBasicBlock *cond, MonoBasicBlock **pre)
+{
+	MonoBasicBlock *body, *entry;
+
+	if (!cond->last_ins || cond->last_ins->opcode != OP_IBLT || cond->in_count != 2 || cond->out_count != 2)
+		return NULL;
+	body = cond->last_ins->inst_true_bb;
+	if (body == cond || body->in_count != 1 || body->in_bb [0] != cond || body->out_count != 1 || body->out_bb [0] != cond)
+		return NULL;
+	if (body->region != cond->region || (body->flags & BB_EXCEPTION_HANDLER) || (cond->flags & BB_EXCEPTION_HANDLER))
+		return NULL;
+	/* The body either falls through to the condition or branches to it */
+	if (body->next_bb != cond && (!body->last_ins || body->last_ins->opcode != OP_BR))
+		return NULL;
+
+	entry = cond->in_bb [0] == body ? cond->in_bb [1] : cond->in_bb [0];
+	if (entry == body || entry == cfg->bb_entry || entry->out_count != 1 || entry->region != cond->region)
+		return NULL;
+	if (entry->last_ins && entry->last_ins->opcode == OP_BR) {
+		if (entry->last_ins->inst_target_bb != cond)
+			return NULL;
+	} else if (entry->next_bb != cond || (entry->last_ins && MONO_IS_BRANCH_OP (entry->last_ins))) {
+		return NULL;
+	}
+
+	*pre = entry;
+	return body;
+}
+
+/*
+ * mono_vectorize_loops:
+ *
+ *   Rewrite the innermost counted loops over arrays of the method to use SSE
+ * vectors. This has to run before the bblocks are ordered.
+ */
+void
+mono_vectorize_loops (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb, *body, *pre;
+	GSList *candidates = NULL, *l;
+
+	if (cfg->gen_seq_points || COMPILE_LLVM (cfg))
+		return;
+
+	if (simd_versions == -1)
+		simd_versions = mono_arch_cpu_enumerate_simd_versions ();
+	if (!(simd_versions & SIMD_VERSION_SSE2))
+		return;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (get_loop_body (cfg, bb, &pre))
+			candidates = g_slist_prepend_mempool (cfg->mempool, candidates, bb);
+	}
+
+	for (l = candidates; l; l = l->next) {
+		MonoBasicBlock *cond = l->data;
+		MonoInst *compare;
+		VecLoop loop;
+
+		/* Vectorizing a previous loop can't change the shape of this one */
+		body = get_loop_body (cfg, cond, &pre);
+		g_assert (body);
+
+		compare = cond->last_ins->prev;
+		if (!compare || (compare->opcode != OP_ICOMPARE && compare->opcode != OP_ICOMPARE_IMM))
+			continue;
+
+		memset (&loop, 0, sizeof (loop));
+		loop.cfg = cfg;
+		loop.pre = pre;
+		loop.body = body;
+		loop.cond = cond;
+		loop.iv = compare->sreg1;
+		loop.simd_versions = simd_versions;
+		loop.bound_reg = -1;
+		loop.bound_array = -1;
+		loop.num_vregs = cfg->next_vreg;
+
+		if (!get_vreg_to_inst (cfg, loop.iv) || vreg_is_volatile (cfg, loop.iv) || get_vreg_to_inst (cfg, loop.iv)->type != STACK_I4)
+			continue;
+
+		loop.values = g_new0 (ValueInfo, loop.num_vregs);
+		loop.num_defs = g_new0 (int, loop.num_vregs);
+		loop.num_uses = g_new0 (int, loop.num_vregs);
+		count_defs_uses (&loop, body);
+		count_defs_uses (&loop, cond);
+		loop.values [loop.iv].kind = VAL_INDEX;
+
+		if (loop.num_defs [loop.iv] == 1 && analyze_cond (&loop) && analyze_body (&loop))
+			vectorize_loop (&loop);
+		else if (cfg->verbose_level > 2) {
+			printf ("VECTORIZE: can't vectorize loop BB%d/BB%d\n", cond->block_num, body->block_num);
+			if (loop.cur_ins)
+				mono_print_ins (loop.cur_ins);
+		}
+
+		g_free (loop.values);
+		g_free (loop.num_defs);
+		g_free (loop.num_uses);
+	}
+}
+
+#else /* !DISABLE_JIT && MONO_ARCH_SIMD_INTRINSICS */
+
+void
+mono_vectorize_loops (MonoCompile *cfg)
+{
+}
+
+#endif
@@ -0,0 +1,657 @@
+/*
+ * write-barrier.c: Elimination of redundant write barriers
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+/*
+ * method_to_ir () emits an OP_WBARRIER after each store of a reference into
+ * the heap. mono_lower_write_barriers () removes the ones which are not
+ * needed, then expands the rest. It runs after escape analysis, which removes
+ * the barriers of the stores into the objects it replaces, so the expanded
+ * barriers don't make them look like they escape. No barrier is emitted for:
+ * - stores of null or of a constant object. The objects embedded in the code,
+ *   like the strings loaded by ldstr, are pinned outside of the nursery and
+ *   referenced from the roots, so they never need a card mark.
+ * - stores into an object allocated by handle_alloc () earlier in the same
+ *   bblock, with no call in between. Such objects are almost always in the
+ *   nursery, which is scanned completely by every collection, so only stores
+ *   into older objects need to mark a card. After the last store, a single
+ *   check of the object address marks the cards of the stored fields if the
+ *   object was allocated outside of the nursery, like in degraded mode.
+ * - three or more stores into the same object which are less than a card
+ *   apart, with no call in between. They are replaced by marks of the cards of
+ *   the lowest and the highest address after the last store.
+ * Delaying the card marks is safe because the stored values are kept alive
+ * until then using OP_DUMMY_USE, like a single barrier does for its store,
+ * so a collection in between finds them on the stack and pins
+ * them. This depends on the managed frames being scanned conservatively, so
+ * only the first rule is used if they are scanned precisely. The marks are also
+ * emitted before any instruction which can throw, since the exception would skip
+ * them. Memory accesses are assumed to fault unless their base is known to be
+ * non-null, like an object already accessed in the bblock.
+ * The analysis is local to each bblock. Vregs are mapped to value numbers, so
+ * copies of the same reference, like the ones made when inlining, are
+ * recognized. Addresses are represented by the value number of an object and
+ * an offset.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#include <mono/metadata/gc-internal.h>
+
+#ifndef DISABLE_JIT
+
+/* Bounds the number of cards marked after the stores into a fresh object outside of the nursery */
+#define MAX_FRESH_OBJECT_SIZE 4096
+
+/* Groups of stores into other objects with fewer barriers are only coalesced if all the stores are to the same address */
+#define MIN_GROUP_SIZE 3
+
+typedef struct {
+	/* The value number of the object stored into */
+	int base;
+	/* Whenever the object was allocated in the same bblock */
+	gboolean fresh;
+	/* The barriers of the group, the last one first */
+	GSList *barriers;
+	int count;
+	gint32 min_offset, max_offset;
+	gboolean closed;
+	/* The vregs holding the stored values, set when the group is coalesced */
+	int *values;
+} BarrierGroup;
+
+typedef struct {
+	MonoCompile *cfg;
+	/*
+	 * The value number of each vreg, and if it is an address, the value
+	 * number of the object and the offset. Only valid if the stamp of the vreg
+	 * is equal to STAMP.
+	 */
+	int *values;
+	int *bases;
+	gint32 *offsets;
+	guint32 *stamps;
+	guint32 stamp;
+	int next_value;
+	/* The group keeping each vreg alive, or NULL */
+	BarrierGroup **value_groups;
+	/* Maps the instructions of the alloc sites to their MonoAllocSite */
+	GHashTable *alloc_sites;
+	/* The value numbers of the objects allocated since the last call */
+	GHashTable *fresh;
+	/* The value numbers of the objects or addresses known to be non-null in the bblock */
+	GHashTable *nonnull;
+	/* Maps value numbers to the constants defining them */
+	GHashTable *consts;
+	/* Maps the value numbers of objects to the open group of stores into them */
+	GHashTable *groups;
+	GSList *open_groups;
+	gboolean coalesce;
+	gint32 card_size;
+	guint8 *nursery_start;
+	size_t nursery_size;
+} WBarrierCtx;
+
+static gboolean
+is_volatile_vreg (MonoCompile *cfg, int vreg)
+{
+	MonoInst *var = get_vreg_to_inst (cfg, vreg);
+
+	/* The value of these can change without a definition in the IR */
+	return var && (var->flags & (MONO_INST_VOLATILE | MONO_INST_INDIRECT));
+}
+
+static void
+lookup_vreg (WBarrierCtx *ctx, int vreg, int *value, int *base, gint32 *offset)
+{
+	if (is_volatile_vreg (ctx->cfg, vreg)) {
+		*value = ctx->next_value ++;
+		*base = -1;
+		*offset = 0;
+		return;
+	}
+
+	if (ctx->stamps [vreg] != ctx->stamp) {
+		ctx->stamps [vreg] = ctx->stamp;
+		ctx->values [vreg] = ctx->next_value ++;
+		ctx->bases [vreg] = -1;
+		ctx->offsets [vreg] = 0;
+	}
+	*value = ctx->values [vreg];
+	*base = ctx->bases [vreg];
+	*offset = ctx->offsets [vreg];
+}
+
+static void
+define_vreg (WBarrierCtx *ctx, int vreg, int value, int base, gint32 offset)
+{
+	if (is_volatile_vreg (ctx->cfg, vreg))
+		return;
+
+	ctx->stamps [vreg] = ctx->stamp;
+	ctx->values [vreg] = value;
+	ctx->bases [vreg] = base;
+	ctx->offsets [vreg] = offset;
+}
+
+/*
+ * is_safepoint:
+ *
+ *   Return whenever INS can run a collection.
+ */
+static gboolean
+is_safepoint (MonoInst *ins)
+{
+	if (MONO_IS_CALL (ins))
+		return TRUE;
+
+	switch (ins->opcode) {
+	case OP_NEWARR:
+	case OP_CALL_HANDLER:
+	case OP_THROW:
+	case OP_RETHROW:
+	case OP_LOCALLOC:
+	case OP_LOCALLOC_IMM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * is_dereference:
+ *
+ *   Return whenever a memory access using the base register REG can fault,
+ * and record that the base is non-null after it.
+ */
+static gboolean
+is_dereference (WBarrierCtx *ctx, int reg)
+{
+	MonoInst *def;
+	int value, base;
+	gint32 offset;
+
+	/* The frame and stack pointers */
+	if (reg < MONO_MAX_IREGS)
+		return FALSE;
+
+	lookup_vreg (ctx, reg, &value, &base, &offset);
+	if (base == -1)
+		base = value;
+
+	if (g_hash_table_lookup (ctx->nonnull, GINT_TO_POINTER (base)))
+		return FALSE;
+	def = g_hash_table_lookup (ctx->consts, GINT_TO_POINTER (base));
+	if (def && def->opcode == OP_PCONST && def->inst_p0)
+		return FALSE;
+
+	g_hash_table_insert (ctx->nonnull, GINT_TO_POINTER (base), GINT_TO_POINTER (1));
+	return TRUE;
+}
+
+/*
+ * can_throw:
+ *
+ *   Return whenever INS can raise an exception, which leaves the bblock
+ * before the card marks of the open groups.
+ */
+static gboolean
+can_throw (WBarrierCtx *ctx, MonoInst *ins)
+{
+	if ((ins->opcode >= OP_COND_EXC_EQ && ins->opcode <= OP_COND_EXC_NC) ||
+		(ins->opcode >= OP_COND_EXC_IEQ && ins->opcode <= OP_COND_EXC_INC) ||
+		(ins->opcode >= OP_ICONV_TO_OVF_I && ins->opcode <= OP_ICONV_TO_OVF_U8) ||
+		(ins->opcode >= OP_LCONV_TO_OVF_I && ins->opcode <= OP_LCONV_TO_OVF_U8) ||
+		(ins->opcode >= OP_FCONV_TO_OVF_I && ins->opcode <= OP_FCONV_TO_OVF_U8))
+		return TRUE;
+
+	switch (ins->opcode) {
+	case OP_IDIV:
+	case OP_IDIV_UN:
+	case OP_IREM:
+	case OP_IREM_UN:
+	case OP_IDIV_IMM:
+	case OP_IDIV_UN_IMM:
+	case OP_IREM_IMM:
+	case OP_IREM_UN_IMM:
+	case OP_LDIV:
+	case OP_LDIV_UN:
+	case OP_LREM:
+	case OP_LREM_UN:
+	case OP_LDIV_IMM:
+	case OP_LDIV_UN_IMM:
+	case OP_LREM_IMM:
+	case OP_LREM_UN_IMM:
+	case OP_DIV_IMM:
+	case OP_REM_IMM:
+	case OP_CKFINITE:
+	case OP_BOUNDS_CHECK:
+	case OP_LDELEMA2D:
+	case OP_IMPLICIT_EXCEPTION:
+		return TRUE;
+	case OP_CHECK_THIS:
+	case OP_LDLEN:
+	case OP_STRLEN:
+		return is_dereference (ctx, ins->sreg1);
+	default:
+		if (MONO_IS_LOAD_MEMBASE (ins) && !(ins->flags & MONO_INST_INVARIANT_LOAD))
+			return is_dereference (ctx, ins->inst_basereg);
+		if (MONO_IS_STORE_MEMBASE (ins))
+			return is_dereference (ctx, ins->inst_destbasereg);
+		return FALSE;
+	}
+}
+
+/*
+ * is_constant_object:
+ *
+ *   Return whenever DEF loads null or an object which is never in the nursery.
+ */
+static gboolean
+is_constant_object (MonoCompile *cfg, MonoInst *def)
+{
+	if (def->opcode == OP_PCONST) {
+		guint8 *nursery_start;
+		int nursery_shift_bits;
+		size_t nursery_size;
+
+		if (!def->inst_p0)
+			return TRUE;
+		if (cfg->compile_aot)
+			return FALSE;
+
+		nursery_start = mono_gc_get_nursery (&nursery_shift_bits, &nursery_size);
+		return !nursery_start || (guint8*)def->inst_p0 < nursery_start || (guint8*)def->inst_p0 >= nursery_start + nursery_size;
+	}
+
+	/* Interned strings are allocated in pinned chunks */
+	return def->opcode == OP_GOT_ENTRY && def->inst_right->inst_i1 == (gpointer)MONO_PATCH_INFO_LDSTR;
+}
+
+static void
+close_group (WBarrierCtx *ctx, BarrierGroup *group)
+{
+	MonoInst *last;
+	GSList *l;
+	int i;
+
+	if (group->closed)
+		return;
+	group->closed = TRUE;
+
+	if (g_hash_table_lookup (ctx->groups, GINT_TO_POINTER (group->base)) == group)
+		g_hash_table_remove (ctx->groups, GINT_TO_POINTER (group->base));
+	for (l = group->barriers; l; l = l->next) {
+		MonoInst *ins = l->data;
+
+		if (ctx->value_groups [ins->sreg2] == group)
+			ctx->value_groups [ins->sreg2] = NULL;
+	}
+
+	if (!group->fresh && group->count < MIN_GROUP_SIZE && !(group->count > 1 && group->min_offset == group->max_offset))
+		return;
+
+	group->values = mono_mempool_alloc (ctx->cfg->mempool, sizeof (int) * group->count);
+	i = 0;
+	for (l = group->barriers; l; l = l->next) {
+		MonoInst *ins = l->data;
+
+		group->values [i ++] = ins->sreg2;
+		if (l != group->barriers)
+			NULLIFY_INS (ins);
+	}
+
+	last = group->barriers->data;
+	last->inst_p0 = group;
+
+	if (ctx->cfg->verbose_level > 2) {
+		printf ("WBARRIER: coalesced %d barriers into ", group->count);
+		mono_print_ins (last);
+	}
+
+	if (group->fresh)
+		mono_jit_stats.wbarriers_elided += group->count;
+	else
+		mono_jit_stats.wbarriers_coalesced += group->count;
+}
+
+static void
+close_groups (WBarrierCtx *ctx)
+{
+	GSList *l;
+
+	for (l = ctx->open_groups; l; l = l->next)
+		close_group (ctx, l->data);
+	ctx->open_groups = NULL;
+	g_assert (g_hash_table_size (ctx->groups) == 0);
+}
+
+static void
+add_to_group (WBarrierCtx *ctx, MonoInst *ins, int base, gint32 offset, gboolean fresh)
+{
+	BarrierGroup *group;
+
+	/* A vreg can only be kept alive by one group */
+	if (ctx->value_groups [ins->sreg2] && ctx->value_groups [ins->sreg2]->base != base)
+		close_group (ctx, ctx->value_groups [ins->sreg2]);
+
+	group = g_hash_table_lookup (ctx->groups, GINT_TO_POINTER (base));
+	if (group && !group->fresh && (offset - group->min_offset >= ctx->card_size || group->max_offset - offset >= ctx->card_size)) {
+		close_group (ctx, group);
+		group = NULL;
+	}
+	if (!group) {
+		group = mono_mempool_alloc0 (ctx->cfg->mempool, sizeof (BarrierGroup));
+		group->base = base;
+		group->fresh = fresh;
+		group->min_offset = group->max_offset = offset;
+		g_hash_table_insert (ctx->groups, GINT_TO_POINTER (base), group);
+		ctx->open_groups = g_slist_prepend_mempool (ctx->cfg->mempool, ctx->open_groups, group);
+	}
+
+	group->barriers = g_slist_prepend_mempool (ctx->cfg->mempool, group->barriers, ins);
+	group->count ++;
+	group->min_offset = MIN (group->min_offset, offset);
+	group->max_offset = MAX (group->max_offset, offset);
+	ins->inst_imm = offset;
+	ctx->value_groups [ins->sreg2] = group;
+}
+
+static void
+process_barrier (WBarrierCtx *ctx, MonoInst *ins)
+{
+	MonoInst *def;
+	int value, base, vvalue, vbase;
+	gint32 offset, voffset;
+
+	lookup_vreg (ctx, ins->sreg1, &value, &base, &offset);
+	if (base == -1) {
+		base = value;
+		offset = 0;
+	}
+	lookup_vreg (ctx, ins->sreg2, &vvalue, &vbase, &voffset);
+
+	def = g_hash_table_lookup (ctx->consts, GINT_TO_POINTER (vvalue));
+	if (def && is_constant_object (ctx->cfg, def)) {
+		if (ctx->cfg->verbose_level > 2) {
+			printf ("WBARRIER: elided ");
+			mono_print_ins (ins);
+		}
+		NULLIFY_INS (ins);
+		mono_jit_stats.wbarriers_elided ++;
+		return;
+	}
+
+	if (!ctx->coalesce || is_volatile_vreg (ctx->cfg, ins->sreg2))
+		return;
+
+	add_to_group (ctx, ins, base, offset, ctx->nursery_start && g_hash_table_lookup (ctx->fresh, GINT_TO_POINTER (base)));
+}
+
+static void
+process_def (WBarrierCtx *ctx, MonoInst *ins)
+{
+	MonoAllocSite *site;
+	int dreg = ins->dreg;
+	int value, base;
+	gint32 offset;
+
+	/* The barriers of the group need the old value */
+	if (ctx->value_groups [dreg])
+		close_group (ctx, ctx->value_groups [dreg]);
+
+	switch (ins->opcode) {
+	case OP_MOVE:
+		lookup_vreg (ctx, ins->sreg1, &value, &base, &offset);
+		define_vreg (ctx, dreg, value, base, offset);
+		break;
+	case OP_ADD_IMM:
+#if SIZEOF_REGISTER == 8
+	case OP_LADD_IMM:
+#else
+	case OP_IADD_IMM:
+#endif
+		lookup_vreg (ctx, ins->sreg1, &value, &base, &offset);
+		if (base == -1) {
+			base = value;
+			offset = 0;
+		}
+		if (ins->inst_imm >= G_MININT32 / 2 && ins->inst_imm <= G_MAXINT32 / 2 && ABS (offset) <= G_MAXINT32 / 2)
+			define_vreg (ctx, dreg, ctx->next_value ++, base, offset + (gint32)ins->inst_imm);
+		else
+			define_vreg (ctx, dreg, ctx->next_value ++, -1, 0);
+		break;
+	default:
+		value = ctx->next_value ++;
+		define_vreg (ctx, dreg, value, -1, 0);
+		if (ins->opcode == OP_PCONST || ins->opcode == OP_GOT_ENTRY)
+			g_hash_table_insert (ctx->consts, GINT_TO_POINTER (value), ins);
+		site = g_hash_table_lookup (ctx->alloc_sites, ins);
+		if (site && site->klass->instance_size <= MAX_FRESH_OBJECT_SIZE)
+			g_hash_table_insert (ctx->fresh, GINT_TO_POINTER (value), GINT_TO_POINTER (1));
+		if (site || ins->opcode == OP_LDADDR)
+			g_hash_table_insert (ctx->nonnull, GINT_TO_POINTER (value), GINT_TO_POINTER (1));
+		break;
+	}
+}
+
+static void
+analyze_bb (WBarrierCtx *ctx, MonoBasicBlock *bb)
+{
+	MonoInst *ins;
+
+	ctx->stamp ++;
+	g_hash_table_remove_all (ctx->fresh);
+	g_hash_table_remove_all (ctx->consts);
+	g_hash_table_remove_all (ctx->nonnull);
+
+	MONO_BB_FOR_EACH_INS (bb, ins) {
+		if (ins->opcode == OP_WBARRIER) {
+			process_barrier (ctx, ins);
+			continue;
+		}
+
+		if (is_safepoint (ins)) {
+			close_groups (ctx);
+			g_hash_table_remove_all (ctx->fresh);
+		} else if (can_throw (ctx, ins)) {
+			close_groups (ctx);
+		}
+
+		/* The dreg of stores is their base register */
+		if (INS_INFO (ins->opcode) [MONO_INST_DEST] != ' ' && ins->dreg != -1 && !MONO_IS_STORE_MEMBASE (ins))
+			process_def (ctx, ins);
+	}
+
+	close_groups (ctx);
+}
+
+static void
+emit_card_mark (MonoCompile *cfg, MonoInst *ins, gint32 offset)
+{
+	int addr_reg = alloc_preg (cfg);
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PADD_IMM, addr_reg, ins->sreg1, offset - (gint32)ins->inst_imm);
+	mini_emit_card_mark (cfg, addr_reg);
+}
+
+/*
+ * emit_barrier:
+ *
+ *   Emit the code of the barrier INS, the same way as expand_write_barrier ().
+ */
+static void
+emit_barrier (MonoCompile *cfg, MonoInst *ins)
+{
+	MonoInst *dummy_use;
+	gpointer card_table_mask;
+	guint8 *card_table;
+	int card_table_shift_bits, nursery_shift_bits;
+	size_t nursery_size;
+	gboolean has_card_table_wb = FALSE;
+
+	card_table = mono_gc_get_card_table (&card_table_shift_bits, &card_table_mask);
+
+	mono_gc_get_nursery (&nursery_shift_bits, &nursery_size);
+
+#ifdef MONO_ARCH_HAVE_CARD_TABLE_WBARRIER
+	has_card_table_wb = TRUE;
+#endif
+
+	if (has_card_table_wb && !cfg->compile_aot && card_table && nursery_shift_bits > 0 && !COMPILE_LLVM (cfg)) {
+		MonoInst *wbarrier;
+
+		MONO_INST_NEW (cfg, wbarrier, OP_CARD_TABLE_WBARRIER);
+		wbarrier->sreg1 = ins->sreg1;
+		wbarrier->sreg2 = ins->sreg2;
+		MONO_ADD_INS (cfg->cbb, wbarrier);
+	} else if (card_table) {
+		mini_emit_card_mark (cfg, ins->sreg1);
+	} else {
+		MonoInst *ptr;
+
+		EMIT_NEW_UNALU (cfg, ptr, OP_MOVE, alloc_preg (cfg), ins->sreg1);
+		ptr->type = STACK_MP;
+		mono_emit_method_call (cfg, mono_gc_get_write_barrier (), &ptr, NULL);
+	}
+
+	MONO_INST_NEW (cfg, dummy_use, OP_DUMMY_USE);
+	dummy_use->sreg1 = ins->sreg2;
+	MONO_ADD_INS (cfg->cbb, dummy_use);
+}
+
+/*
+ * emit_group_marks:
+ *
+ *   Emit the card marks replacing the barriers of GROUP, whose last barrier is
+ * INS.
+ */
+static void
+emit_group_marks (WBarrierCtx *ctx, MonoInst *ins, BarrierGroup *group)
+{
+	MonoCompile *cfg = ctx->cfg;
+	MonoBasicBlock *end_bb = NULL;
+	MonoInst *dummy_use, *start;
+	gint32 offset;
+	int i, obj_reg;
+
+	if (group->fresh) {
+		/* Skip the marks if the object is in the nursery */
+		NEW_BBLOCK (cfg, end_bb);
+
+		obj_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PADD_IMM, obj_reg, ins->sreg1, - (gint32)ins->inst_imm);
+		EMIT_NEW_PCONST (cfg, start, ctx->nursery_start);
+		MONO_EMIT_NEW_BIALU (cfg, OP_PSUB, obj_reg, obj_reg, start->dreg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, obj_reg, ctx->nursery_size);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBLT_UN, end_bb);
+
+		/* The stores are not limited to a card, so mark all the cards in between */
+		for (offset = group->min_offset; offset < group->max_offset; offset += ctx->card_size)
+			emit_card_mark (cfg, ins, offset);
+		emit_card_mark (cfg, ins, group->max_offset);
+
+		MONO_START_BB (cfg, end_bb);
+	} else {
+		emit_card_mark (cfg, ins, group->min_offset);
+		if (group->max_offset != group->min_offset)
+			emit_card_mark (cfg, ins, group->max_offset);
+	}
+
+	for (i = 0; i < group->count; ++i) {
+		MONO_INST_NEW (cfg, dummy_use, OP_DUMMY_USE);
+		dummy_use->sreg1 = group->values [i];
+		MONO_ADD_INS (cfg->cbb, dummy_use);
+	}
+}
+
+/*
+ * mono_lower_write_barriers:
+ *
+ *   Remove the redundant OP_WBARRIER instructions, and replace the rest with
+ * the code implementing them.
+ */
+void
+mono_lower_write_barriers (MonoCompile *cfg)
+{
+	WBarrierCtx ctx;
+	MonoBasicBlock *bb, *first_bb;
+	gpointer card_table_mask;
+	int card_table_shift_bits, nursery_shift_bits;
+	gboolean precise;
+	GSList *l;
+
+	memset (&ctx, 0, sizeof (ctx));
+	ctx.cfg = cfg;
+	ctx.values = mono_mempool_alloc (cfg->mempool, sizeof (int) * cfg->next_vreg);
+	ctx.bases = mono_mempool_alloc (cfg->mempool, sizeof (int) * cfg->next_vreg);
+	ctx.offsets = mono_mempool_alloc (cfg->mempool, sizeof (gint32) * cfg->next_vreg);
+	ctx.stamps = mono_mempool_alloc0 (cfg->mempool, sizeof (guint32) * cfg->next_vreg);
+	ctx.value_groups = mono_mempool_alloc0 (cfg->mempool, sizeof (BarrierGroup*) * cfg->next_vreg);
+	ctx.alloc_sites = g_hash_table_new (NULL, NULL);
+	ctx.fresh = g_hash_table_new (NULL, NULL);
+	ctx.nonnull = g_hash_table_new (NULL, NULL);
+	ctx.consts = g_hash_table_new (NULL, NULL);
+	ctx.groups = g_hash_table_new (NULL, NULL);
+
+	for (l = cfg->alloc_sites; l; l = l->next) {
+		MonoAllocSite *site = l->data;
+
+		g_hash_table_insert (ctx.alloc_sites, site->ins, site);
+	}
+
+	precise = mono_gc_precise_stack_mark_enabled ();
+	ctx.coalesce = !precise && mono_gc_get_card_table (&card_table_shift_bits, &card_table_mask);
+	ctx.card_size = ctx.coalesce ? 1 << card_table_shift_bits : 0;
+	/* The nursery check of fresh objects embeds the address of the nursery */
+	if (!cfg->compile_aot)
+		ctx.nursery_start = mono_gc_get_nursery (&nursery_shift_bits, &ctx.nursery_size);
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb)
+		analyze_bb (&ctx, bb);
+
+	g_hash_table_destroy (ctx.alloc_sites);
+	g_hash_table_destroy (ctx.fresh);
+	g_hash_table_destroy (ctx.nonnull);
+	g_hash_table_destroy (ctx.consts);
+	g_hash_table_destroy (ctx.groups);
+
+	cfg->cbb = mono_mempool_alloc0 ((cfg)->mempool, sizeof (MonoBasicBlock));
+	first_bb = cfg->cbb;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		MonoInst *ins;
+		MonoInst *prev = NULL;
+
+		cfg->cbb->code = cfg->cbb->last_ins = NULL;
+
+		for (ins = bb->code; ins; ins = ins->next) {
+			if (ins->opcode != OP_WBARRIER) {
+				prev = ins;
+				continue;
+			}
+
+			if (ins->inst_p0)
+				emit_group_marks (&ctx, ins, ins->inst_p0);
+			else
+				emit_barrier (cfg, ins);
+
+			mono_replace_ins (cfg, bb, ins, &prev, first_bb, cfg->cbb);
+			first_bb->code = first_bb->last_ins = NULL;
+			first_bb->in_count = first_bb->out_count = 0;
+			cfg->cbb = first_bb;
+		}
+	}
+}
+
+#else /* !DISABLE_JIT */
+
+MONO_EMPTY_SOURCE_FILE (write_barrier);
+
+#endif /* !DISABLE_JIT */
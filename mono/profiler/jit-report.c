@@ -0,0 +1,447 @@
+/*
+ * jit-report.c: mprof-jit-report program source: summarize the files written
+ * by the JIT profiler of the runtime (--jit-profile=FILE)
+ *
+ * (C) 2014 Xamarin Inc
+ */
+#include <config.h>
+#include <mono/mini/jit-prof.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct {
+	char *name;
+	int compiles;
+	int failures;
+	uint64_t time;
+	uint64_t *phase_times;
+	int il_size;
+	int code_size;
+	int inlines;
+	/* As a callee */
+	int inlined;
+	int inline_aborted;
+	int patches;
+} MethodDesc;
+
+typedef struct {
+	unsigned char *p, *end;
+	int num_phases;
+	char **phase_names;
+	MethodDesc **methods;
+	int num_methods, methods_size;
+	/* Totals */
+	int compiles, failures, tier0, gshared, llvm;
+	uint64_t time, il_size, code_size;
+	uint64_t *phase_times;
+	int inlines_ok, inlines_aborted;
+	int patches [3];
+	uint64_t last_time;
+} JitProfile;
+
+static int top = 20;
+static int show_phases = 0;
+static FILE *outfile;
+
+static uint64_t
+decode_uleb (JitProfile *prof)
+{
+	uint64_t res = 0;
+	int shift = 0;
+
+	while (prof->p < prof->end) {
+		unsigned char b = *prof->p++;
+		res |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return res;
+		shift += 7;
+	}
+	fprintf (stderr, "Truncated JIT profile file.\n");
+	exit (1);
+}
+
+static char*
+decode_string (JitProfile *prof)
+{
+	int len = decode_uleb (prof);
+	char *s;
+
+	if (prof->p + len > prof->end) {
+		fprintf (stderr, "Truncated JIT profile file.\n");
+		exit (1);
+	}
+	s = malloc (len + 1);
+	memcpy (s, prof->p, len);
+	s [len] = 0;
+	prof->p += len;
+	return s;
+}
+
+static MethodDesc*
+lookup_method (JitProfile *prof, int id)
+{
+	static MethodDesc unknown = { (char*)"<unknown method>" };
+
+	if (id < prof->methods_size && prof->methods [id])
+		return prof->methods [id];
+	return &unknown;
+}
+
+static void
+add_method (JitProfile *prof, int id, char *name)
+{
+	MethodDesc *m;
+
+	if (id >= prof->methods_size) {
+		int new_size = prof->methods_size ? prof->methods_size * 2 : 1024;
+
+		while (id >= new_size)
+			new_size *= 2;
+		prof->methods = realloc (prof->methods, new_size * sizeof (MethodDesc*));
+		memset (prof->methods + prof->methods_size, 0, (new_size - prof->methods_size) * sizeof (MethodDesc*));
+		prof->methods_size = new_size;
+	}
+	m = calloc (1, sizeof (MethodDesc));
+	m->name = name;
+	m->phase_times = calloc (prof->num_phases, sizeof (uint64_t));
+	prof->methods [id] = m;
+	if (id >= prof->num_methods)
+		prof->num_methods = id + 1;
+}
+
+static unsigned char*
+load_file (const char *name, size_t *size)
+{
+	FILE *f = strcmp (name, "-") ? fopen (name, "rb") : stdin;
+	unsigned char *data = NULL;
+	size_t len = 0, alloc = 0, n;
+
+	if (!f) {
+		fprintf (stderr, "Cannot open file '%s'.\n", name);
+		exit (1);
+	}
+	do {
+		if (len == alloc) {
+			alloc = alloc ? alloc * 2 : 1024 * 1024;
+			data = realloc (data, alloc);
+		}
+		n = fread (data + len, 1, alloc - len, f);
+		len += n;
+	} while (n);
+	if (f != stdin)
+		fclose (f);
+	*size = len;
+	return data;
+}
+
+static void
+decode_file (JitProfile *prof)
+{
+	uint32_t id;
+	int i;
+
+	if (prof->end - prof->p < 5) {
+		fprintf (stderr, "Not a JIT profile file.\n");
+		exit (1);
+	}
+	id = prof->p [0] | (prof->p [1] << 8) | (prof->p [2] << 16) | ((uint32_t)prof->p [3] << 24);
+	if (id != JIT_PROF_HEADER_ID) {
+		fprintf (stderr, "Not a JIT profile file.\n");
+		exit (1);
+	}
+	if (prof->p [4] != JIT_PROF_VERSION) {
+		fprintf (stderr, "Unsupported JIT profile version %d, expected %d.\n", prof->p [4], JIT_PROF_VERSION);
+		exit (1);
+	}
+	prof->p += 5;
+	prof->num_phases = decode_uleb (prof);
+	prof->phase_names = calloc (prof->num_phases, sizeof (char*));
+	prof->phase_times = calloc (prof->num_phases, sizeof (uint64_t));
+	for (i = 0; i < prof->num_phases; ++i)
+		prof->phase_names [i] = decode_string (prof);
+
+	while (prof->p < prof->end) {
+		int type = *prof->p++;
+
+		switch (type) {
+		case JIT_PROF_METHOD: {
+			int mid = decode_uleb (prof);
+
+			add_method (prof, mid, decode_string (prof));
+			break;
+		}
+		case JIT_PROF_COMPILE: {
+			MethodDesc *m = lookup_method (prof, decode_uleb (prof));
+			uint64_t time = 0;
+			int flags;
+
+			prof->last_time = decode_uleb (prof);
+			flags = decode_uleb (prof);
+			m->il_size = decode_uleb (prof);
+			m->code_size = decode_uleb (prof);
+			/* bblocks and vregs */
+			decode_uleb (prof);
+			decode_uleb (prof);
+			for (i = 0; i < prof->num_phases; ++i) {
+				uint64_t t = decode_uleb (prof);
+
+				if (m->phase_times)
+					m->phase_times [i] += t;
+				prof->phase_times [i] += t;
+				time += t;
+			}
+			m->compiles ++;
+			m->time += time;
+			prof->compiles ++;
+			prof->time += time;
+			prof->il_size += m->il_size;
+			if (flags & JIT_PROF_COMPILE_FAILED) {
+				m->failures ++;
+				prof->failures ++;
+			} else {
+				prof->code_size += m->code_size;
+			}
+			if (flags & JIT_PROF_COMPILE_TIER0)
+				prof->tier0 ++;
+			if (flags & JIT_PROF_COMPILE_GSHARED)
+				prof->gshared ++;
+			if (flags & JIT_PROF_COMPILE_LLVM)
+				prof->llvm ++;
+			break;
+		}
+		case JIT_PROF_INLINE: {
+			MethodDesc *caller = lookup_method (prof, decode_uleb (prof));
+			MethodDesc *callee = lookup_method (prof, decode_uleb (prof));
+			int result = decode_uleb (prof);
+
+			/* cost */
+			decode_uleb (prof);
+			if (result == JIT_PROF_INLINE_OK) {
+				caller->inlines ++;
+				callee->inlined ++;
+				prof->inlines_ok ++;
+			} else {
+				callee->inline_aborted ++;
+				prof->inlines_aborted ++;
+			}
+			break;
+		}
+		case JIT_PROF_PATCH: {
+			MethodDesc *m = lookup_method (prof, decode_uleb (prof));
+			int kind = decode_uleb (prof);
+
+			m->patches ++;
+			if (kind < 3)
+				prof->patches [kind] ++;
+			break;
+		}
+		default:
+			fprintf (stderr, "Unknown record type %d in JIT profile file.\n", type);
+			exit (1);
+		}
+	}
+}
+
+/* The field to sort the methods by */
+static int sort_field;
+
+enum {
+	SORT_TIME,
+	SORT_CODE_SIZE,
+	SORT_INLINED,
+	SORT_INLINE_ABORTED,
+	SORT_PATCHES
+};
+
+static uint64_t
+sort_key (MethodDesc *m)
+{
+	switch (sort_field) {
+	case SORT_TIME:
+		return m->time;
+	case SORT_CODE_SIZE:
+		return m->code_size;
+	case SORT_INLINED:
+		return m->inlined;
+	case SORT_INLINE_ABORTED:
+		return m->inline_aborted;
+	default:
+		return m->patches;
+	}
+}
+
+static int
+compare_methods (const void *a, const void *b)
+{
+	uint64_t ka = sort_key (*(MethodDesc**)a);
+	uint64_t kb = sort_key (*(MethodDesc**)b);
+
+	return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/* Return the TOP methods with the largest nonzero value of FIELD */
+static int
+sort_methods (JitProfile *prof, MethodDesc **sorted, int field)
+{
+	int i, count = 0;
+
+	sort_field = field;
+	for (i = 0; i < prof->num_methods; ++i) {
+		if (prof->methods [i] && sort_key (prof->methods [i]))
+			sorted [count ++] = prof->methods [i];
+	}
+	qsort (sorted, count, sizeof (MethodDesc*), compare_methods);
+	return count < top ? count : top;
+}
+
+/* Times are stored in 100ns units */
+#define MSECS(t) ((t) / 10000.0)
+
+static void
+print_reports (JitProfile *prof)
+{
+	MethodDesc **sorted = malloc ((prof->num_methods + 1) * sizeof (MethodDesc*));
+	int *phase_order = malloc (prof->num_phases * sizeof (int));
+	int i, j, count;
+
+	fprintf (outfile, "JIT summary\n");
+	fprintf (outfile, "\tCompilations: %d (%d failed, %d tier 0, %d gshared, %d llvm)\n", prof->compiles, prof->failures, prof->tier0, prof->gshared, prof->llvm);
+	fprintf (outfile, "\tJIT time: %.3f ms\n", MSECS (prof->time));
+	fprintf (outfile, "\tIL size: %llu bytes, native code size: %llu bytes\n", (unsigned long long)prof->il_size, (unsigned long long)prof->code_size);
+	fprintf (outfile, "\tLast compilation at: %.3f ms\n", MSECS (prof->last_time));
+
+	for (i = 0; i < prof->num_phases; ++i)
+		phase_order [i] = i;
+	for (i = 1; i < prof->num_phases; ++i) {
+		for (j = i; j > 0 && prof->phase_times [phase_order [j]] > prof->phase_times [phase_order [j - 1]]; --j) {
+			int tmp = phase_order [j];
+			phase_order [j] = phase_order [j - 1];
+			phase_order [j - 1] = tmp;
+		}
+	}
+	fprintf (outfile, "\nJIT phases\n");
+	fprintf (outfile, "\t%12s %6s  %s\n", "Time (ms)", "%", "Phase");
+	for (i = 0; i < prof->num_phases; ++i) {
+		int p = phase_order [i];
+
+		if (!prof->phase_times [p])
+			continue;
+		fprintf (outfile, "\t%12.3f %6.2f  %s\n", MSECS (prof->phase_times [p]), prof->time ? prof->phase_times [p] * 100.0 / prof->time : 0, prof->phase_names [p]);
+	}
+
+	count = sort_methods (prof, sorted, SORT_TIME);
+	fprintf (outfile, "\nMost expensive methods to compile\n");
+	fprintf (outfile, "\t%12s %5s %8s %8s %7s  %s\n", "Time (ms)", "Count", "IL size", "Code size", "Inlines", "Method");
+	for (i = 0; i < count; ++i) {
+		MethodDesc *m = sorted [i];
+
+		fprintf (outfile, "\t%12.3f %5d %8d %8d %7d  %s%s\n", MSECS (m->time), m->compiles, m->il_size, m->code_size, m->inlines, m->name, m->failures ? " (failed)" : "");
+		if (show_phases) {
+			for (j = 0; j < prof->num_phases; ++j) {
+				if (m->phase_times [j])
+					fprintf (outfile, "\t\t%12.3f  %s\n", MSECS (m->phase_times [j]), prof->phase_names [j]);
+			}
+		}
+	}
+
+	count = sort_methods (prof, sorted, SORT_CODE_SIZE);
+	fprintf (outfile, "\nLargest methods\n");
+	fprintf (outfile, "\t%9s %8s %6s  %s\n", "Code size", "IL size", "Ratio", "Method");
+	for (i = 0; i < count; ++i) {
+		MethodDesc *m = sorted [i];
+
+		fprintf (outfile, "\t%9d %8d %6.1f  %s\n", m->code_size, m->il_size, m->il_size ? (double)m->code_size / m->il_size : 0, m->name);
+	}
+
+	fprintf (outfile, "\nInlining\n");
+	fprintf (outfile, "\tInlined calls: %d, aborted inlines: %d\n", prof->inlines_ok, prof->inlines_aborted);
+	count = sort_methods (prof, sorted, SORT_INLINED);
+	if (count) {
+		fprintf (outfile, "\tMost inlined methods\n");
+		for (i = 0; i < count; ++i)
+			fprintf (outfile, "\t%9d  %s\n", sorted [i]->inlined, sorted [i]->name);
+	}
+	count = sort_methods (prof, sorted, SORT_INLINE_ABORTED);
+	if (count) {
+		fprintf (outfile, "\tMost aborted inlines\n");
+		for (i = 0; i < count; ++i)
+			fprintf (outfile, "\t%9d  %s\n", sorted [i]->inline_aborted, sorted [i]->name);
+	}
+
+	fprintf (outfile, "\nTrampoline patches\n");
+	fprintf (outfile, "\tCall sites: %d, vtable slots: %d, PLT entries: %d\n", prof->patches [JIT_PROF_PATCH_CALLSITE], prof->patches [JIT_PROF_PATCH_VTABLE_SLOT], prof->patches [JIT_PROF_PATCH_PLT]);
+	count = sort_methods (prof, sorted, SORT_PATCHES);
+	if (count) {
+		fprintf (outfile, "\tMost patched methods\n");
+		for (i = 0; i < count; ++i)
+			fprintf (outfile, "\t%9d  %s\n", sorted [i]->patches, sorted [i]->name);
+	}
+
+	free (phase_order);
+	free (sorted);
+}
+
+static void
+usage (void)
+{
+	printf ("Mono JIT profile report version %d\n", JIT_PROF_VERSION);
+	printf ("Usage: mprof-jit-report [OPTIONS] FILENAME\n");
+	printf ("FILENAME is a file written by mono --jit-profile=FILENAME, it can be '-' to read from standard input.\n");
+	printf ("Options:\n");
+	printf ("\t--help               display this help\n");
+	printf ("\t--out=FILE           write to FILE instead of stdout\n");
+	printf ("\t--top=NUM            list NUM methods in each report (default: %d)\n", top);
+	printf ("\t--phases             show the time of each phase for the most expensive methods\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+	JitProfile prof;
+	unsigned char *data;
+	size_t size;
+	int i;
+
+	outfile = stdout;
+	for (i = 1; i < argc; ++i) {
+		if (strcmp ("--help", argv [i]) == 0) {
+			usage ();
+			return 0;
+		} else if (strncmp ("--out=", argv [i], 6) == 0) {
+			outfile = fopen (argv [i] + 6, "w");
+			if (!outfile) {
+				fprintf (stderr, "Cannot open output file: %s\n", argv [i] + 6);
+				return 1;
+			}
+		} else if (strncmp ("--top=", argv [i], 6) == 0) {
+			top = atoi (argv [i] + 6);
+			if (top <= 0) {
+				usage ();
+				return 1;
+			}
+		} else if (strcmp ("--phases", argv [i]) == 0) {
+			show_phases = 1;
+		} else if (argv [i][0] == '-' && argv [i][1]) {
+			usage ();
+			return 1;
+		} else {
+			break;
+		}
+	}
+	if (i != argc - 1) {
+		usage ();
+		return 2;
+	}
+
+	data = load_file (argv [i], &size);
+	memset (&prof, 0, sizeof (prof));
+	prof.p = data;
+	prof.end = data + size;
+	decode_file (&prof);
+	print_reports (&prof);
+	if (outfile != stdout)
+		fclose (outfile);
+	return 0;
+}
@@ -0,0 +1,42 @@
+using System;
+using System.Collections.Generic;
+using System.Threading;
+
+/*
+ * The methods, properties and events of a class are created without holding the
+ * loader lock, so threads setting up the same class race to publish them.
+ */
+class G<T> {
+	public T P1 { get; set; }
+	public int P2 { get { return 1; } }
+	public event EventHandler E1;
+	public void M1 (T t) { }
+	public T M2 () { return default (T); }
+	public void Fire () { if (E1 != null) E1 (null, null); }
+}
+
+class Tests {
+	static Type[] args = new Type [] { typeof (int), typeof (long), typeof (string), typeof (byte), typeof (short), typeof (char), typeof (double), typeof (float), typeof (object), typeof (Tests) };
+	static int failures;
+
+	static void Run () {
+		foreach (Type a in args) {
+			foreach (Type b in new Type [] { a, a.MakeArrayType (), typeof (List<>).MakeGenericType (a) }) {
+				Type t = typeof (G<>).MakeGenericType (b);
+				if (t.GetMethods ().Length != 12 || t.GetProperties ().Length != 2 || t.GetEvents ().Length != 1)
+					Interlocked.Increment (ref failures);
+			}
+		}
+	}
+
+	static int Main () {
+		Thread[] threads = new Thread [16];
+		for (int i = 0; i < threads.Length; ++i)
+			threads [i] = new Thread (Run);
+		foreach (Thread t in threads)
+			t.Start ();
+		foreach (Thread t in threads)
+			t.Join ();
+		return failures == 0 ? 0 : 1;
+	}
+}
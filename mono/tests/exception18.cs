@@ -0,0 +1,68 @@
+using System;
+using System.Reflection;
+using System.Reflection.Emit;
+using System.Threading;
+
+/*
+ * The exception handling code caches the jit info and the protecting clauses
+ * of the ips it unwinds through. Dynamic methods are freed when they are
+ * collected and new ones can reuse their code memory, so the cached entries
+ * have to go away with the jit info.
+ */
+class Tests {
+	static void Throw (int i) {
+		throw new ArgumentException ();
+	}
+
+	static Func<int, int> CreateMethod (bool catches) {
+		DynamicMethod dm = new DynamicMethod ("Thrower", typeof (int), new Type [] { typeof (int) }, typeof (Tests));
+		ILGenerator ig = dm.GetILGenerator ();
+
+		ig.DeclareLocal (typeof (int));
+		if (catches)
+			ig.BeginExceptionBlock ();
+		ig.Emit (OpCodes.Ldarg_0);
+		ig.Emit (OpCodes.Call, typeof (Tests).GetMethod ("Throw", BindingFlags.Static | BindingFlags.NonPublic));
+		if (catches) {
+			ig.BeginCatchBlock (typeof (Exception));
+			ig.Emit (OpCodes.Pop);
+			ig.Emit (OpCodes.Ldc_I4_2);
+			ig.Emit (OpCodes.Stloc_0);
+			ig.EndExceptionBlock ();
+		}
+		ig.Emit (OpCodes.Ldloc_0);
+		ig.Emit (OpCodes.Ret);
+		return (Func<int, int>)dm.CreateDelegate (typeof (Func<int, int>));
+	}
+
+	static int Call (Func<int, int> f) {
+		try {
+			return f (0);
+		} catch (ArgumentException) {
+			return 1;
+		}
+	}
+
+	static int failures;
+
+	static void Run (bool catches) {
+		Func<int, int> f = CreateMethod (catches);
+
+		for (int i = 0; i < 10; ++i) {
+			if (Call (f) != (catches ? 2 : 1))
+				failures ++;
+		}
+	}
+
+	static int Main () {
+		for (int iter = 0; iter < 100; ++iter) {
+			/* Use another thread, so nothing on this stack keeps the method alive */
+			Thread t = new Thread (() => Run (iter % 2 == 1));
+			t.Start ();
+			t.Join ();
+			GC.Collect ();
+			GC.WaitForPendingFinalizers ();
+		}
+		return failures == 0 ? 0 : 1;
+	}
+}
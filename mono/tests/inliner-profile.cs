@@ -0,0 +1,57 @@
+using System;
+
+/*
+ * Used by the test-inliner target: the call sites in HotLoop () are profiled
+ * with MONO_INLINER=save=FILE, then the profile is loaded, and the inlining
+ * decisions are checked in the trace. The results must be the same with any
+ * inliner settings.
+ */
+class Tests {
+	/* Larger than the default inlining limit, so only inlined at hot call sites */
+	static int Medium (int a, int b) {
+		int r = a * 7 + b;
+		r ^= r >> 3;
+		r += (a - b) * 5;
+		r ^= r << 2;
+		r -= a / (b | 1);
+		return r + (a & 0xff) - (b & 0x3f);
+	}
+
+	/* Small enough to be inlined without a profile, but not at cold call sites */
+	static int Small (int a) {
+		return (a * 3 + (a >> 2) - 7) ^ 5;
+	}
+
+	static int HotLoop (int n) {
+		int r = 0;
+
+		for (int i = 0; i < n; ++i) {
+			r += Medium (i, n);
+			/* Never executed, so the call site is cold */
+			if (i == -1)
+				r += Small (i);
+		}
+		return r;
+	}
+
+	/* Only called when the profile is loaded, so it has no profile data */
+	static int NotProfiled (int n) {
+		return Small (n);
+	}
+
+	static int Main (string[] args) {
+		int r = HotLoop (1000);
+
+		if (r != 12811049) {
+			Console.WriteLine ("HotLoop: {0}", r);
+			return 1;
+		}
+		if (args.Length > 0 && args [0] == "not-profiled") {
+			if (NotProfiled (100) != 315) {
+				Console.WriteLine ("NotProfiled: {0}", NotProfiled (100));
+				return 2;
+			}
+		}
+		return 0;
+	}
+}
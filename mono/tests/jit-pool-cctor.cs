@@ -0,0 +1,62 @@
+using System;
+
+/*
+ * Check that precompiling methods with --jit-pool doesn't run the static
+ * constructors of their classes, they have to run on first use like normal.
+ */
+
+class Log {
+	public static string s = "";
+}
+
+class A {
+	static A () {
+		Log.s += "A";
+	}
+
+	public static int Get () {
+		return 1;
+	}
+}
+
+/* Reached through ldftn, which can use the precompiled code directly */
+class B {
+	static B () {
+		Log.s += "B";
+	}
+
+	public static int Get () {
+		return 2;
+	}
+}
+
+class C {
+	static int f = Init ();
+
+	static int Init () {
+		Log.s += "C";
+		return 3;
+	}
+
+	public static int Get () {
+		return f;
+	}
+}
+
+class Tests {
+	static int Main () {
+		Log.s += "M";
+		if (A.Get () != 1)
+			return 1;
+		Func<int> d = B.Get;
+		if (d () != 2)
+			return 2;
+		if (C.Get () != 3)
+			return 3;
+		if (Log.s != "MABC") {
+			Console.WriteLine ("Static constructors ran in the wrong order: " + Log.s);
+			return 4;
+		}
+		return 0;
+	}
+}
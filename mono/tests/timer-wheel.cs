@@ -0,0 +1,162 @@
+using System;
+using System.Threading;
+
+/*
+ * Timers and timed waits are driven by the runtime timer wheel: check that
+ * timers fire, that Change ()/Dispose () racing with expiration behave, and
+ * that timed waits time out or wake up as expected.
+ */
+class Tests {
+	static int one_shot_count;
+	static int periodic_count;
+
+	static int test_timer_fires () {
+		using (var done = new ManualResetEvent (false)) {
+			int start_ms = Environment.TickCount;
+			using (new Timer (_ => { Interlocked.Increment (ref one_shot_count); done.Set (); }, null, 50, Timeout.Infinite)) {
+				if (!done.WaitOne (5000))
+					return 1;
+				if (Environment.TickCount - start_ms < 45)
+					return 2;
+				Thread.Sleep (200);
+				if (one_shot_count != 1)
+					return 3;
+			}
+		}
+
+		using (new Timer (_ => Interlocked.Increment (ref periodic_count), null, 0, 10)) {
+			Thread.Sleep (500);
+		}
+		if (periodic_count < 5)
+			return 4;
+		return 0;
+	}
+
+	static int test_slow_callback_does_not_block () {
+		int fast = 0;
+		using (var slow_started = new ManualResetEvent (false)) {
+			using (var slow = new Timer (_ => { slow_started.Set (); Thread.Sleep (1000); }, null, 0, Timeout.Infinite)) {
+				if (!slow_started.WaitOne (5000))
+					return 1;
+				using (new Timer (_ => Interlocked.Increment (ref fast), null, 0, 20)) {
+					Thread.Sleep (500);
+				}
+			}
+		}
+		return fast >= 5 ? 0 : 2;
+	}
+
+	static int test_change_dispose_race () {
+		const int num_threads = 8;
+		const int num_timers = 200;
+		var counts = new int [num_threads * num_timers];
+		var timers = new Timer [num_threads * num_timers];
+		var threads = new Thread [num_threads];
+
+		for (int t = 0; t < num_threads; ++t) {
+			int start = t * num_timers;
+			threads [t] = new Thread (() => {
+				var r = new Random (start);
+				for (int i = start; i < start + num_timers; ++i) {
+					int index = i;
+					timers [i] = new Timer (_ => Interlocked.Increment (ref counts [index]), null, r.Next (5), r.Next (1, 5));
+				}
+				for (int iter = 0; iter < 20; ++iter) {
+					for (int i = start; i < start + num_timers; ++i)
+						timers [i].Change (r.Next (3), r.Next (3) == 0 ? Timeout.Infinite : r.Next (1, 5));
+				}
+				for (int i = start; i < start + num_timers; ++i)
+					timers [i].Dispose ();
+			});
+		}
+		foreach (var t in threads)
+			t.Start ();
+		foreach (var t in threads)
+			t.Join ();
+
+		/* Callbacks which were already queued can still run, wait for the threadpool to drain them */
+		int[] snapshot;
+		int waited = 0;
+		do {
+			snapshot = (int[])counts.Clone ();
+			Thread.Sleep (300);
+			waited += 300;
+			if (waited > 10000)
+				return 1;
+		} while (!Same (counts, snapshot));
+
+		/* Periodic timers fire every few ms, so one which survived Dispose () shows up here */
+		Thread.Sleep (500);
+		if (!Same (counts, snapshot))
+			return 2;
+		for (int i = 0; i < timers.Length; ++i) {
+			if (timers [i].Change (0, 0))
+				return 3;
+		}
+		return 0;
+	}
+
+	static bool Same (int[] a, int[] b) {
+		for (int i = 0; i < a.Length; ++i) {
+			if (a [i] != b [i])
+				return false;
+		}
+		return true;
+	}
+
+	static int test_timed_waits () {
+		using (var ev = new ManualResetEvent (false)) {
+			int start_ms = Environment.TickCount;
+			if (ev.WaitOne (100))
+				return 1;
+			if (Environment.TickCount - start_ms < 90)
+				return 2;
+
+			ThreadPool.QueueUserWorkItem (_ => { Thread.Sleep (50); ev.Set (); });
+			start_ms = Environment.TickCount;
+			if (!ev.WaitOne (10000))
+				return 3;
+			if (Environment.TickCount - start_ms > 5000)
+				return 4;
+		}
+
+		/* Many threads whose timed waits expire while the handles are signalled and closed */
+		const int num_threads = 16;
+		int failures = 0;
+		var threads = new Thread [num_threads];
+		for (int t = 0; t < num_threads; ++t) {
+			int seed = t;
+			threads [t] = new Thread (() => {
+				var r = new Random (seed);
+				for (int i = 0; i < 200; ++i) {
+					var ev = new AutoResetEvent (false);
+					int delay = r.Next (3);
+					ThreadPool.QueueUserWorkItem (_ => { Thread.Sleep (delay); ev.Set (); });
+					bool signalled = ev.WaitOne (r.Next (1, 4));
+					if (!signalled && !ev.WaitOne (10000))
+						Interlocked.Increment (ref failures);
+					ev.Close ();
+				}
+			});
+		}
+		foreach (var t in threads)
+			t.Start ();
+		foreach (var t in threads)
+			t.Join ();
+		return failures == 0 ? 0 : 5;
+	}
+
+	static int Main () {
+		int res;
+
+		if ((res = test_timer_fires ()) != 0)
+			return 10 + res;
+		if ((res = test_slow_callback_does_not_block ()) != 0)
+			return 20 + res;
+		if ((res = test_change_dispose_race ()) != 0)
+			return 30 + res;
+		if ((res = test_timed_waits ()) != 0)
+			return 40 + res;
+		return 0;
+	}
+}
@@ -13,15 +13,55 @@
 #include <mono/utils/mono-mmap.h>
 #include <mono/utils/monobitset.h>
 #include <mono/utils/mono-threads.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-time.h>
 #include <mono/utils/lock-free-array-queue.h>
+#include <mono/utils/atomic.h>
 #include <mono/io-layer/io-layer.h>
 
 typedef struct {
 	gpointer p;
 	MonoHazardousFreeFunc free_func;
 	gboolean might_lock;
+	/* When the pointer was retired, in 100ns ticks */
+	gint64 retire_time;
 } DelayedFreeItem;
 
+/*
+ * Pointers retired by registered threads are first collected in a per-thread
+ * retire list, without looking at the hazard pointers. Once the list is long
+ * enough, the hazard table is copied into a sorted snapshot, and the entries
+ * which are not found in it by a binary search are freed. Since the scan
+ * threshold is proportional to the number of hazard pointers, the cost of a
+ * scan is amortized to O(1) per retired pointer.
+ *
+ * A list is only modified by its owner thread, except when it is flushed by
+ * mono_thread_hazardous_try_free_all (). The BUSY flag protects it against
+ * that: the owner only tries to set it, falling back to the global delayed
+ * free queue when it fails, and never calls free functions while holding it.
+ */
+#define RETIRE_LIST_SIZE 256
+/* Minimum length of a retire list before it is scanned */
+#define RETIRE_SCAN_MIN 32
+/* Scan once the list holds this many times the number of hazard pointers */
+#define RETIRE_SCAN_FACTOR 2
+
+typedef struct {
+	volatile gint32 busy;
+	/* Set while the owner is running free functions */
+	gboolean freeing;
+	int num_items;
+	int num_to_free;
+	/* Sorted copy of the hazard table, only grown outside of lock free contexts */
+	gpointer *snapshot;
+	int snapshot_size;
+	/* Statistics, added up by the counter callbacks */
+	guint32 retired, freed, scans;
+	gint64 latency, max_latency;
+	DelayedFreeItem items [RETIRE_LIST_SIZE];
+	DelayedFreeItem to_free [RETIRE_LIST_SIZE];
+} RetireList;
+
 /* The hazard table */
 #if MONO_SMALL_CONFIG
 #define HAZARD_TABLE_MAX_SIZE	256
@@ -42,6 +82,15 @@ static int small_id_next;
 static int highest_small_id = -1;
 static MonoBitSet *small_id_table;
 
+/* The retire lists, indexed by small id, they are allocated with the id and never freed */
+static RetireList **retire_lists;
+
+/* Statistics for pointers which didn't go through a retire list */
+static guint32 queue_retired, queue_freed;
+static gint64 queue_latency, queue_max_latency;
+
+static void retire_list_flush (RetireList *list);
+
 /*
  * Allocate a small thread id.
  *
@@ -110,6 +159,9 @@ mono_thread_small_id_alloc (void)
 			hazard_table [id].hazard_pointers [i] = NULL;
 	}
 
+	if (retire_lists && !retire_lists [id])
+		retire_lists [id] = g_new0 (RetireList, 1);
+
 	if (id > highest_small_id) {
 		highest_small_id = id;
 		mono_memory_write_barrier ();
@@ -128,6 +180,11 @@ mono_thread_small_id_free (int id)
 
 	g_assert (id >= 0 && id < small_id_table->size);
 	g_assert (mono_bitset_test_fast (small_id_table, id));
+
+	/* Hand our retired pointers over to the global queue before the id is reused */
+	if (retire_lists)
+		retire_list_flush (retire_lists [id]);
+
 	mono_bitset_clear_fast (small_id_table, id);
 
 	LeaveCriticalSection (&small_id_mutex);
@@ -196,6 +253,25 @@ get_hazardous_pointer (gpointer volatile *pp, MonoThreadHazardPointers *hp, int
 	return p;
 }
 
+static void
+record_latency (gint64 now, DelayedFreeItem *item, guint32 *freed, gint64 *latency, gint64 *max_latency)
+{
+	gint64 lat = now - item->retire_time;
+
+	++(*freed);
+	*latency += lat;
+	if (lat > *max_latency)
+		*max_latency = lat;
+}
+
+static void
+queue_delayed_free_item (DelayedFreeItem *item)
+{
+	++mono_stats.hazardous_pointer_count;
+
+	mono_lock_free_array_queue_push (&delayed_free_queue, item);
+}
+
 static gboolean
 try_free_delayed_free_item (gboolean lock_free_context)
 {
@@ -210,15 +286,215 @@ try_free_delayed_free_item (gboolean lock_free_context)
 		return FALSE;
 	}
 
+	record_latency (mono_100ns_ticks (), &item, &queue_freed, &queue_latency, &queue_max_latency);
 	item.free_func (item.p);
 
 	return TRUE;
 }
 
+static int
+compare_pointers (const void *p1, const void *p2)
+{
+	gpointer a = *(gpointer*)p1, b = *(gpointer*)p2;
+
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/*
+ * Copy the non-NULL hazard pointers into LIST->snapshot and sort them.
+ * Returns the number of pointers copied, or -1 if the snapshot buffer is too
+ * small and it couldn't be grown.
+ */
+static int
+take_hazard_snapshot (RetireList *list, gboolean lock_free_context)
+{
+	int i, j, n = 0;
+	int highest = highest_small_id;
+	int needed = (highest + 1) * HAZARD_POINTER_COUNT;
+
+	g_assert (highest < hazard_table_size);
+
+	if (needed > list->snapshot_size) {
+		/* g_realloc () might lock */
+		if (lock_free_context)
+			return -1;
+		list->snapshot = g_realloc (list->snapshot, needed * 2 * sizeof (gpointer));
+		list->snapshot_size = needed * 2;
+	}
+
+	/* The retired pointers have to be unlinked before the hazard pointers are read */
+	mono_memory_barrier ();
+
+	for (i = 0; i <= highest; ++i) {
+		for (j = 0; j < HAZARD_POINTER_COUNT; ++j) {
+			gpointer p = hazard_table [i].hazard_pointers [j];
+			if (p)
+				list->snapshot [n++] = p;
+			LOAD_LOAD_FENCE;
+		}
+	}
+
+	qsort (list->snapshot, n, sizeof (gpointer), compare_pointers);
+	return n;
+}
+
+static gboolean
+is_in_snapshot (gpointer *snapshot, int n, gpointer p)
+{
+	int lo = 0, hi = n - 1;
+
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (snapshot [mid] == p)
+			return TRUE;
+		if (snapshot [mid] < p)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return FALSE;
+}
+
+/*
+ * Move the entries of LIST which are not hazardous into LIST->to_free,
+ * compacting the rest.
+ * LOCKING: LIST->busy must be set.
+ */
+static void
+retire_list_scan (RetireList *list, gboolean lock_free_context)
+{
+	int i, num_kept = 0;
+	int num_hazards = take_hazard_snapshot (list, lock_free_context);
+
+	list->scans++;
+	list->num_to_free = 0;
+
+	for (i = 0; i < list->num_items; ++i) {
+		DelayedFreeItem *item = &list->items [i];
+		gboolean hazardous;
+
+		if (lock_free_context && item->might_lock)
+			hazardous = TRUE;
+		else if (num_hazards >= 0)
+			hazardous = is_in_snapshot (list->snapshot, num_hazards, item->p);
+		else
+			hazardous = is_pointer_hazardous (item->p);
+
+		if (hazardous)
+			list->items [num_kept++] = *item;
+		else
+			list->to_free [list->num_to_free++] = *item;
+	}
+
+	list->num_items = num_kept;
+}
+
+static int
+retire_scan_threshold (void)
+{
+	int threshold = (highest_small_id + 1) * HAZARD_POINTER_COUNT * RETIRE_SCAN_FACTOR;
+
+	return CLAMP (threshold, RETIRE_SCAN_MIN, RETIRE_LIST_SIZE);
+}
+
+/*
+ * Add P to LIST, scanning it if it is long enough.
+ * LOCKING: LIST->busy must be set, it is cleared on return.
+ */
+static void
+retire_pointer (RetireList *list, gpointer p, MonoHazardousFreeFunc free_func,
+		gboolean free_func_might_lock, gboolean lock_free_context)
+{
+	DelayedFreeItem *item;
+	int i;
+
+	list->retired++;
+
+	if (list->num_items == RETIRE_LIST_SIZE) {
+		/* Can only happen while we're freeing the previous batch */
+		DelayedFreeItem overflow = { p, free_func, free_func_might_lock, mono_100ns_ticks () };
+
+		mono_memory_barrier ();
+		list->busy = 0;
+		queue_delayed_free_item (&overflow);
+		return;
+	}
+
+	item = &list->items [list->num_items++];
+	item->p = p;
+	item->free_func = free_func;
+	item->might_lock = free_func_might_lock;
+	item->retire_time = mono_100ns_ticks ();
+
+	if (list->freeing || list->num_items < retire_scan_threshold ()) {
+		mono_memory_barrier ();
+		list->busy = 0;
+		return;
+	}
+
+	retire_list_scan (list, lock_free_context);
+
+	/*
+	 * If most of the entries are still hazardous, move them to the global queue,
+	 * otherwise we'd keep rescanning them.
+	 */
+	if (list->num_items >= retire_scan_threshold () / 2) {
+		for (i = 0; i < list->num_items; ++i)
+			queue_delayed_free_item (&list->items [i]);
+		list->num_items = 0;
+	}
+
+	list->freeing = TRUE;
+	mono_memory_barrier ();
+	list->busy = 0;
+
+	/* Free functions can retire pointers too, these go to the list but don't trigger a scan */
+	if (list->num_to_free) {
+		gint64 now = mono_100ns_ticks ();
+
+		for (i = 0; i < list->num_to_free; ++i) {
+			record_latency (now, &list->to_free [i], &list->freed, &list->latency, &list->max_latency);
+			list->to_free [i].free_func (list->to_free [i].p);
+		}
+	}
+	list->num_to_free = 0;
+	list->freeing = FALSE;
+
+	/* Give the pointers which didn't make it through a retire list a chance too */
+	for (i = 0; i < 3; ++i)
+		try_free_delayed_free_item (lock_free_context);
+}
+
+/*
+ * Move all the entries of LIST to the global delayed free queue.
+ */
+static void
+retire_list_flush (RetireList *list)
+{
+	int i;
+
+	if (!list)
+		return;
+
+	/* The owner never blocks while holding the flag */
+	while (InterlockedCompareExchange (&list->busy, 1, 0) != 0)
+		mono_thread_info_yield ();
+
+	for (i = 0; i < list->num_items; ++i)
+		queue_delayed_free_item (&list->items [i]);
+	list->num_items = 0;
+
+	mono_memory_barrier ();
+	list->busy = 0;
+}
+
 void
 mono_thread_hazardous_free_or_queue (gpointer p, MonoHazardousFreeFunc free_func,
 		gboolean free_func_might_lock, gboolean lock_free_context)
 {
+	RetireList *list = NULL;
+	int small_id;
 	int i;
 
 	if (lock_free_context)
@@ -226,6 +502,18 @@ mono_thread_hazardous_free_or_queue (gpointer p, MonoHazardousFreeFunc free_func
 	if (free_func_might_lock)
 		g_assert (!lock_free_context);
 
+	small_id = mono_thread_info_get_small_id ();
+	if (small_id >= 0 && retire_lists)
+		list = retire_lists [small_id];
+
+	if (list && InterlockedCompareExchange (&list->busy, 1, 0) == 0) {
+		retire_pointer (list, p, free_func, free_func_might_lock, lock_free_context);
+		return;
+	}
+
+	/* Unregistered thread, or the list is being flushed */
+	++queue_retired;
+
 	/* First try to free a few entries in the delayed free
 	   table. */
 	for (i = 0; i < 3; ++i)
@@ -234,12 +522,11 @@ mono_thread_hazardous_free_or_queue (gpointer p, MonoHazardousFreeFunc free_func
 	/* Now see if the pointer we're freeing is hazardous.  If it
 	   isn't, free it.  Otherwise put it in the delay list. */
 	if (is_pointer_hazardous (p)) {
-		DelayedFreeItem item = { p, free_func, free_func_might_lock };
-
-		++mono_stats.hazardous_pointer_count;
+		DelayedFreeItem item = { p, free_func, free_func_might_lock, mono_100ns_ticks () };
 
-		mono_lock_free_array_queue_push (&delayed_free_queue, &item);
+		queue_delayed_free_item (&item);
 	} else {
+		++queue_freed;
 		free_func (p);
 	}
 }
@@ -247,6 +534,14 @@ mono_thread_hazardous_free_or_queue (gpointer p, MonoHazardousFreeFunc free_func
 void
 mono_thread_hazardous_try_free_all (void)
 {
+	int i;
+
+	/* Callers expect everything retired so far to be freed, so collect the retire lists too */
+	if (retire_lists) {
+		for (i = 0; i <= highest_small_id; ++i)
+			retire_list_flush (retire_lists [i]);
+	}
+
 	while (try_free_delayed_free_item (FALSE))
 		;
 }
@@ -259,10 +554,65 @@ mono_thread_hazardous_try_free_some (void)
 		try_free_delayed_free_item (FALSE);
 }
 
+#define RETIRE_LIST_STAT_FUNC(name, type, expr) \
+static type \
+name (void) \
+{ \
+	type res = 0; \
+	int i; \
+	for (i = 0; i <= highest_small_id; ++i) { \
+		RetireList *list = retire_lists [i]; \
+		if (list) \
+			expr; \
+	} \
+	return res; \
+}
+
+RETIRE_LIST_STAT_FUNC (hazardous_retired_count, guint, res += list->retired)
+RETIRE_LIST_STAT_FUNC (hazardous_freed_count, guint, res += list->freed)
+RETIRE_LIST_STAT_FUNC (hazardous_scan_count, guint, res += list->scans)
+RETIRE_LIST_STAT_FUNC (hazardous_latency_total, gint64, res += list->latency)
+RETIRE_LIST_STAT_FUNC (hazardous_latency_max, gint64, res = MAX (res, list->max_latency))
+
+static guint
+hazardous_retired (void)
+{
+	return hazardous_retired_count () + queue_retired;
+}
+
+static guint
+hazardous_freed (void)
+{
+	return hazardous_freed_count () + queue_freed;
+}
+
+/* In usecs, as expected by MONO_COUNTER_TIME_INTERVAL */
+static gint64
+hazardous_latency_avg (void)
+{
+	guint freed = hazardous_freed ();
+
+	return freed ? (hazardous_latency_total () + queue_latency) / freed / 10 : 0;
+}
+
+static gint64
+hazardous_latency_peak (void)
+{
+	return MAX (hazardous_latency_max (), queue_max_latency) / 10;
+}
+
 void
 mono_thread_smr_init (void)
 {
 	InitializeCriticalSection(&small_id_mutex);
+
+	retire_lists = g_new0 (RetireList*, HAZARD_TABLE_MAX_SIZE);
+
+	mono_counters_register ("Hazardous pointers retired", MONO_COUNTER_GC | MONO_COUNTER_UINT | MONO_COUNTER_CALLBACK, hazardous_retired);
+	mono_counters_register ("Hazardous pointers freed", MONO_COUNTER_GC | MONO_COUNTER_UINT | MONO_COUNTER_CALLBACK, hazardous_freed);
+	mono_counters_register ("Hazard pointer scans", MONO_COUNTER_GC | MONO_COUNTER_UINT | MONO_COUNTER_CALLBACK, hazardous_scan_count);
+	mono_counters_register ("Hazardous free latency avg", MONO_COUNTER_GC | MONO_COUNTER_TIME_INTERVAL | MONO_COUNTER_CALLBACK, hazardous_latency_avg);
+	mono_counters_register ("Hazardous free latency max", MONO_COUNTER_GC | MONO_COUNTER_TIME_INTERVAL | MONO_COUNTER_CALLBACK, hazardous_latency_peak);
 }
 
 void
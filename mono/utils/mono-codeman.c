@@ -3,6 +3,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -29,6 +32,10 @@
 
 static uintptr_t code_memory_used = 0;
 
+/* Whenever to back code chunks with huge pages, set using MONO_CODE_HUGE_PAGES */
+static gboolean use_huge_pages;
+static gint32 huge_page_chunks;
+
 /*
  * AMD64 processors maintain icache coherency only for pages which are 
  * marked executable. Also, windows DEP requires us to obtain executable memory from
@@ -71,6 +78,8 @@ static uintptr_t code_memory_used = 0;
 
 #define MONO_PROT_RWX (MONO_MMAP_READ|MONO_MMAP_WRITE|MONO_MMAP_EXEC)
 
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 typedef struct _CodeChunck CodeChunk;
 
 enum {
@@ -93,6 +102,8 @@ struct _MonoCodeManager {
 	int read_only;
 	CodeChunk *current;
 	CodeChunk *full;
+	/* Separate chunks for code which is rarely executed, created on demand */
+	MonoCodeManager *cold;
 #if defined(__native_client_codegen__) && defined(__native_client__)
 	GHashTable *hash;
 #endif
@@ -230,6 +241,29 @@ nacl_inverse_modify_patch_target (unsigned char *target)
 static CRITICAL_SECTION valloc_mutex;
 static GHashTable *valloc_freelists;
 
+/*
+ * Allocate SIZE bytes of executable memory backed by huge pages. Explicit huge
+ * pages are used if the system has some reserved, otherwise a huge page aligned
+ * area is requested to be backed by transparent huge pages.
+ */
+static void*
+codechunk_valloc_huge (guint32 size)
+{
+	void *ptr;
+
+	ptr = mono_valloc (NULL, size, MONO_PROT_RWX | ARCH_MAP_FLAGS | MONO_MMAP_HUGETLB);
+	if (ptr) {
+		++huge_page_chunks;
+		return ptr;
+	}
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+	ptr = mono_valloc_aligned (size, HUGE_PAGE_SIZE, MONO_PROT_RWX | ARCH_MAP_FLAGS);
+	if (ptr && madvise (ptr, size, MADV_HUGEPAGE) == 0)
+		++huge_page_chunks;
+#endif
+	return ptr;
+}
+
 static void*
 codechunk_valloc (guint32 size)
 {
@@ -252,7 +286,11 @@ codechunk_valloc (guint32 size)
 		freelist = g_slist_remove_link (freelist, freelist);
 		g_hash_table_insert (valloc_freelists, GUINT_TO_POINTER (size), freelist);
 	} else {
-		ptr = mono_valloc (NULL, size + MIN_ALIGN - 1, MONO_PROT_RWX | ARCH_MAP_FLAGS);
+		ptr = NULL;
+		if (use_huge_pages)
+			ptr = codechunk_valloc_huge (size);
+		if (!ptr)
+			ptr = mono_valloc (NULL, size + MIN_ALIGN - 1, MONO_PROT_RWX | ARCH_MAP_FLAGS);
 	}
 	LeaveCriticalSection (&valloc_mutex);
 	return ptr;
@@ -298,6 +336,12 @@ codechunk_cleanup (void)
 void
 mono_code_manager_init (void)
 {
+	const char *env = g_getenv ("MONO_CODE_HUGE_PAGES");
+
+	if (env && strcmp (env, "0") != 0)
+		use_huge_pages = TRUE;
+
+	mono_counters_register ("Code chunks using huge pages", MONO_COUNTER_JIT | MONO_COUNTER_INT, &huge_page_chunks);
 }
 
 void
@@ -325,6 +369,7 @@ mono_code_manager_new (void)
 		return NULL;
 	cman->current = NULL;
 	cman->full = NULL;
+	cman->cold = NULL;
 	cman->dynamic = 0;
 	cman->read_only = 0;
 #if defined(__native_client_codegen__) && defined(__native_client__)
@@ -410,6 +455,8 @@ mono_code_manager_destroy (MonoCodeManager *cman)
 {
 	free_chunklist (cman->full);
 	free_chunklist (cman->current);
+	if (cman->cold)
+		mono_code_manager_destroy (cman->cold);
 	free (cman);
 }
 
@@ -436,6 +483,8 @@ mono_code_manager_invalidate (MonoCodeManager *cman)
 		memset (chunk->data, fill_value, chunk->size);
 	for (chunk = cman->full; chunk; chunk = chunk->next)
 		memset (chunk->data, fill_value, chunk->size);
+	if (cman->cold)
+		mono_code_manager_invalidate (cman->cold);
 }
 
 /**
@@ -471,6 +520,8 @@ mono_code_manager_foreach (MonoCodeManager *cman, MonoCodeManagerFunc func, void
 		if (func (chunk->data, chunk->size, chunk->bsize, user_data))
 			return;
 	}
+	if (cman->cold)
+		mono_code_manager_foreach (cman->cold, func, user_data);
 }
 
 /* BIND_ROOM is the divisor for the chunck of code size dedicated
@@ -505,6 +556,11 @@ new_codechunk (int dynamic, int size)
 		flags = CODE_FLAG_MALLOC;
 	} else {
 		minsize = pagesize * MIN_PAGES;
+		if (use_huge_pages) {
+			/* Whole huge pages are allocated */
+			pagesize = HUGE_PAGE_SIZE;
+			minsize = HUGE_PAGE_SIZE;
+		}
 		if (size < minsize)
 			chunk_size = minsize;
 		else {
@@ -684,6 +740,34 @@ mono_code_manager_reserve (MonoCodeManager *cman, int size)
 	return mono_code_manager_reserve_align (cman, size, MIN_ALIGN);
 }
 
+/**
+ * mono_code_manager_reserve_cold:
+ * @cman: a code manager
+ * @size: size of memory to allocate
+ *
+ * Allocates at least @size bytes of memory inside the code manager @cman, for
+ * code which is not expected to run often. Such code is kept in separate chunks
+ * so it doesn't take up space in the i-cache and the iTLB between the frequently
+ * executed methods.
+ *
+ * Returns: the pointer to the allocated memory or #NULL on failure
+ */
+void*
+mono_code_manager_reserve_cold (MonoCodeManager *cman, int size)
+{
+	if (cman->dynamic)
+		return mono_code_manager_reserve (cman, size);
+
+	g_assert (!cman->read_only);
+
+	if (!cman->cold) {
+		cman->cold = mono_code_manager_new ();
+		if (!cman->cold)
+			return NULL;
+	}
+	return mono_code_manager_reserve (cman->cold, size);
+}
+
 /**
  * mono_code_manager_commit:
  * @cman: a code manager
@@ -703,6 +787,8 @@ mono_code_manager_commit (MonoCodeManager *cman, void *data, int size, int newsi
 
 	if (cman->current && (size != newsize) && (data == cman->current->data + cman->current->pos - size)) {
 		cman->current->pos -= size - newsize;
+	} else if (cman->cold) {
+		mono_code_manager_commit (cman->cold, data, size, newsize);
 	}
 #else
 	unsigned char *code;
@@ -768,6 +854,12 @@ mono_code_manager_size (MonoCodeManager *cman, int *used_size)
 		size += chunk->size;
 		used += chunk->pos;
 	}
+	if (cman->cold) {
+		int cold_used;
+
+		size += mono_code_manager_size (cman->cold, &cold_used);
+		used += cold_used;
+	}
 	if (used_size)
 		*used_size = used;
 	return size;
@@ -0,0 +1,449 @@
+/*
+ * mono-conc-hashtable.c: A concurrent hash table with lock-free lookups
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <mono/utils/mono-conc-hashtable.h>
+#include <mono/utils/hazard-pointer.h>
+#include <mono/utils/mono-membar.h>
+#include <mono/utils/mono-mutex.h>
+#include <mono/utils/mono-threads.h>
+#include <mono/utils/atomic.h>
+
+#define INITIAL_SIZE 32
+#define NUM_STRIPES 8
+
+/* Resize once live entries, reserved slots and tombstones fill 3/4 of the table */
+#define TABLE_IS_FULL(used,size) ((used) * 4 > (size) * 3)
+
+struct _MonoConcurrentHashTable {
+	MonoConcHashTableStorage * volatile table;
+	GHashFunc hash_func;
+	GEqualFunc equal_func;
+	GDestroyNotify key_destroy_func, value_destroy_func;
+	MonoConcHashTableAllocFunc alloc_func;
+	MonoConcHashTableFreeFunc free_func;
+	gpointer alloc_user_data;
+	/* Number of live entries, including slots which are being filled */
+	volatile gint32 element_count;
+	volatile gint32 tombstone_count;
+	mono_mutex_t stripes [NUM_STRIPES];
+};
+
+/*
+ * Hash functions like g_direct_hash () leave the low bits of aligned pointers
+ * clear, so scramble the hash before masking it with the table size.
+ */
+static inline guint
+mix_hash (guint hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static inline mono_mutex_t*
+get_stripe (MonoConcurrentHashTable *hash_table, guint hash)
+{
+	/* Use the top bits so the stripe doesn't correlate with the starting slot */
+	return &hash_table->stripes [(hash >> 24) & (NUM_STRIPES - 1)];
+}
+
+static inline gboolean
+keys_equal (MonoConcurrentHashTable *hash_table, gconstpointer k1, gconstpointer k2)
+{
+	return k1 == k2 || (hash_table->equal_func && hash_table->equal_func (k1, k2));
+}
+
+static gpointer
+default_alloc (size_t size, gpointer user_data)
+{
+	return g_malloc0 (size);
+}
+
+static MonoConcHashTableStorage*
+conc_table_new (MonoConcurrentHashTable *hash_table, int size)
+{
+	MonoConcHashTableStorage *table;
+
+	table = hash_table->alloc_func (sizeof (MonoConcHashTableStorage) + size * sizeof (MonoConcHashTableSlot), hash_table->alloc_user_data);
+	table->table_size = size;
+	table->slots = (MonoConcHashTableSlot*)(table + 1);
+	return table;
+}
+
+static void
+lock_all_stripes (MonoConcurrentHashTable *hash_table)
+{
+	int i;
+
+	for (i = 0; i < NUM_STRIPES; ++i)
+		mono_mutex_lock (&hash_table->stripes [i]);
+}
+
+static void
+unlock_all_stripes (MonoConcurrentHashTable *hash_table)
+{
+	int i;
+
+	for (i = NUM_STRIPES - 1; i >= 0; --i)
+		mono_mutex_unlock (&hash_table->stripes [i]);
+}
+
+MonoConcurrentHashTable*
+mono_conc_hashtable_new_with_storage (GHashFunc hash_func, GEqualFunc key_equal_func,
+									  MonoConcHashTableAllocFunc alloc_func, MonoConcHashTableFreeFunc free_func,
+									  gpointer user_data)
+{
+	MonoConcurrentHashTable *res = g_new0 (MonoConcurrentHashTable, 1);
+	int i;
+
+	res->hash_func = hash_func ? hash_func : g_direct_hash;
+	res->equal_func = key_equal_func;
+	res->alloc_func = alloc_func ? alloc_func : default_alloc;
+	res->free_func = free_func ? free_func : g_free;
+	res->alloc_user_data = user_data;
+	for (i = 0; i < NUM_STRIPES; ++i)
+		mono_mutex_init (&res->stripes [i]);
+	res->table = conc_table_new (res, INITIAL_SIZE);
+
+	return res;
+}
+
+MonoConcurrentHashTable*
+mono_conc_hashtable_new (GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+	return mono_conc_hashtable_new_with_storage (hash_func, key_equal_func, NULL, NULL, NULL);
+}
+
+MonoConcurrentHashTable*
+mono_conc_hashtable_new_full (GHashFunc hash_func, GEqualFunc key_equal_func, GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func)
+{
+	MonoConcurrentHashTable *res = mono_conc_hashtable_new (hash_func, key_equal_func);
+
+	res->key_destroy_func = key_destroy_func;
+	res->value_destroy_func = value_destroy_func;
+	return res;
+}
+
+/*
+ * mono_conc_hashtable_destroy:
+ *
+ *   Free HASH_TABLE. The caller must ensure no other thread is accessing it.
+ */
+void
+mono_conc_hashtable_destroy (MonoConcurrentHashTable *hash_table)
+{
+	MonoConcHashTableStorage *table = hash_table->table;
+	int i;
+
+	if (hash_table->key_destroy_func || hash_table->value_destroy_func) {
+		for (i = 0; i < table->table_size; ++i) {
+			MonoConcHashTableSlot *slot = &table->slots [i];
+
+			if (!MONO_CONC_HASHTABLE_KEY_IS_LIVE (slot->key))
+				continue;
+			if (hash_table->key_destroy_func)
+				hash_table->key_destroy_func (slot->key);
+			if (hash_table->value_destroy_func)
+				hash_table->value_destroy_func (slot->value);
+		}
+	}
+
+	hash_table->free_func (table);
+	for (i = 0; i < NUM_STRIPES; ++i)
+		mono_mutex_destroy (&hash_table->stripes [i]);
+	g_free (hash_table);
+}
+
+static gpointer
+conc_table_lookup (MonoConcurrentHashTable *hash_table, MonoConcHashTableStorage *table, gconstpointer key, guint hash)
+{
+	int mask = table->table_size - 1;
+	int i = hash & mask;
+
+	for (;;) {
+		MonoConcHashTableSlot *slot = &table->slots [i];
+		gpointer k = slot->key;
+
+		if (!k)
+			return NULL;
+		if (k != MONO_CONC_HASHTABLE_TOMBSTONE && k != MONO_CONC_HASHTABLE_RESERVED && keys_equal (hash_table, k, key)) {
+			/* Pairs with the barrier between the value and key stores in insert () */
+			mono_memory_read_barrier ();
+			/* This is NULL if the entry is being removed */
+			return slot->value;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+ * mono_conc_hashtable_lookup:
+ *
+ *   Return the value associated with KEY, or NULL. This doesn't take any locks
+ * if the current thread is registered with the runtime.
+ */
+gpointer
+mono_conc_hashtable_lookup (MonoConcurrentHashTable *hash_table, gconstpointer key)
+{
+	MonoThreadHazardPointers *hp;
+	MonoConcHashTableStorage *table;
+	guint hash;
+	gpointer res;
+
+	g_assert (key);
+
+	hash = mix_hash (hash_table->hash_func (key));
+
+	if (G_UNLIKELY (mono_thread_info_get_small_id () < 0)) {
+		/* No hazard pointers for this thread, holding any stripe prevents resizing */
+		mono_mutex_t *stripe = get_stripe (hash_table, hash);
+
+		mono_mutex_lock (stripe);
+		res = conc_table_lookup (hash_table, hash_table->table, key, hash);
+		mono_mutex_unlock (stripe);
+		return res;
+	}
+
+	hp = mono_hazard_pointer_get ();
+	table = get_hazardous_pointer ((gpointer volatile*)&hash_table->table, hp, 0);
+	res = conc_table_lookup (hash_table, table, key, hash);
+	mono_hazard_pointer_clear (hp, 0);
+
+	return res;
+}
+
+/*
+ * Replace the storage of HASH_TABLE with a bigger one if OLD_TABLE is still the
+ * current storage, dropping all tombstones.
+ */
+static void
+conc_table_rehash (MonoConcurrentHashTable *hash_table, MonoConcHashTableStorage *old_table)
+{
+	MonoConcHashTableStorage *new_table;
+	int i, new_size, mask;
+
+	lock_all_stripes (hash_table);
+
+	if (hash_table->table != old_table) {
+		/* Somebody else resized it */
+		unlock_all_stripes (hash_table);
+		return;
+	}
+
+	new_size = old_table->table_size;
+	while (hash_table->element_count * 2 >= new_size)
+		new_size *= 2;
+
+	new_table = conc_table_new (hash_table, new_size);
+	mask = new_size - 1;
+
+	/* All the stripes are held, so there are no reserved slots */
+	for (i = 0; i < old_table->table_size; ++i) {
+		MonoConcHashTableSlot *slot = &old_table->slots [i];
+		int j;
+
+		if (!MONO_CONC_HASHTABLE_KEY_IS_LIVE (slot->key))
+			continue;
+
+		j = mix_hash (hash_table->hash_func (slot->key)) & mask;
+		while (new_table->slots [j].key)
+			j = (j + 1) & mask;
+		new_table->slots [j].value = slot->value;
+		new_table->slots [j].key = slot->key;
+	}
+
+	mono_memory_write_barrier ();
+	hash_table->table = new_table;
+	hash_table->tombstone_count = 0;
+
+	unlock_all_stripes (hash_table);
+
+	mono_thread_hazardous_free_or_queue (old_table, (MonoHazardousFreeFunc)hash_table->free_func, hash_table->free_func != g_free, FALSE);
+}
+
+/*
+ * mono_conc_hashtable_insert:
+ *
+ *   Associate VALUE with KEY, unless KEY is already in the table. Return the
+ * existing value in that case, NULL otherwise.
+ */
+gpointer
+mono_conc_hashtable_insert (MonoConcurrentHashTable *hash_table, gpointer key, gpointer value)
+{
+	MonoConcHashTableStorage *table;
+	mono_mutex_t *stripe;
+	guint hash;
+	int i, mask;
+
+	g_assert (key && key != MONO_CONC_HASHTABLE_TOMBSTONE && key != MONO_CONC_HASHTABLE_RESERVED);
+	g_assert (value);
+
+	hash = mix_hash (hash_table->hash_func (key));
+	stripe = get_stripe (hash_table, hash);
+
+retry:
+	mono_mutex_lock (stripe);
+	table = hash_table->table;
+
+	/* Reserve room for the new entry before claiming a slot */
+	if (TABLE_IS_FULL (InterlockedIncrement (&hash_table->element_count) + hash_table->tombstone_count, table->table_size)) {
+		InterlockedDecrement (&hash_table->element_count);
+		mono_mutex_unlock (stripe);
+		conc_table_rehash (hash_table, table);
+		goto retry;
+	}
+
+	/*
+	 * Equal keys hash to the same stripe, so only this thread can be adding KEY.
+	 * Slots never go back to being empty, so if KEY is in the table we'll find it
+	 * before the first empty slot.
+	 */
+	mask = table->table_size - 1;
+	i = hash & mask;
+	for (;;) {
+		MonoConcHashTableSlot *slot = &table->slots [i];
+		gpointer k = slot->key;
+
+		if (!k) {
+			/* Threads holding other stripes might be racing for this slot */
+			if (InterlockedCompareExchangePointer (&slot->key, MONO_CONC_HASHTABLE_RESERVED, NULL) != NULL)
+				continue;
+			slot->value = value;
+			/* Readers must see the value once they see the key */
+			mono_memory_write_barrier ();
+			slot->key = key;
+			mono_mutex_unlock (stripe);
+			return NULL;
+		}
+		if (k != MONO_CONC_HASHTABLE_TOMBSTONE && k != MONO_CONC_HASHTABLE_RESERVED && keys_equal (hash_table, k, key)) {
+			gpointer res = slot->value;
+
+			InterlockedDecrement (&hash_table->element_count);
+			mono_mutex_unlock (stripe);
+			return res;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+ * mono_conc_hashtable_remove:
+ *
+ *   Remove KEY from the table and return its value, or NULL if it was not found.
+ * The destroy notifiers are not called, since lookups running concurrently could
+ * still return the removed value.
+ */
+gpointer
+mono_conc_hashtable_remove (MonoConcurrentHashTable *hash_table, gconstpointer key)
+{
+	MonoConcHashTableStorage *table;
+	mono_mutex_t *stripe;
+	gpointer res = NULL;
+	guint hash;
+	int i, mask;
+
+	g_assert (key);
+
+	hash = mix_hash (hash_table->hash_func (key));
+	stripe = get_stripe (hash_table, hash);
+
+	mono_mutex_lock (stripe);
+	table = hash_table->table;
+	mask = table->table_size - 1;
+	i = hash & mask;
+	for (;;) {
+		MonoConcHashTableSlot *slot = &table->slots [i];
+		gpointer k = slot->key;
+
+		if (!k)
+			break;
+		if (k != MONO_CONC_HASHTABLE_TOMBSTONE && k != MONO_CONC_HASHTABLE_RESERVED && keys_equal (hash_table, k, key)) {
+			res = slot->value;
+			slot->key = MONO_CONC_HASHTABLE_TOMBSTONE;
+			mono_memory_write_barrier ();
+			slot->value = NULL;
+			InterlockedDecrement (&hash_table->element_count);
+			InterlockedIncrement (&hash_table->tombstone_count);
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	mono_mutex_unlock (stripe);
+
+	return res;
+}
+
+/*
+ * mono_conc_hashtable_foreach:
+ *
+ *   Call FUNC on every entry of the table. Writers are blocked while this runs,
+ * so FUNC must not modify the table.
+ */
+void
+mono_conc_hashtable_foreach (MonoConcurrentHashTable *hash_table, GHFunc func, gpointer user_data)
+{
+	MonoConcHashTableStorage *table;
+	int i;
+
+	lock_all_stripes (hash_table);
+	table = hash_table->table;
+	for (i = 0; i < table->table_size; ++i) {
+		MonoConcHashTableSlot *slot = &table->slots [i];
+
+		if (MONO_CONC_HASHTABLE_KEY_IS_LIVE (slot->key))
+			func (slot->key, slot->value, user_data);
+	}
+	unlock_all_stripes (hash_table);
+}
+
+/*
+ * mono_conc_hashtable_foreach_remove:
+ *
+ *   Remove the entries for which FUNC returns TRUE, calling the destroy notifiers
+ * on them. The caller must ensure no lookups can return the removed entries.
+ * Returns the number of removed entries.
+ */
+guint
+mono_conc_hashtable_foreach_remove (MonoConcurrentHashTable *hash_table, GHRFunc func, gpointer user_data)
+{
+	MonoConcHashTableStorage *table;
+	guint count = 0;
+	int i;
+
+	lock_all_stripes (hash_table);
+	table = hash_table->table;
+	for (i = 0; i < table->table_size; ++i) {
+		MonoConcHashTableSlot *slot = &table->slots [i];
+		gpointer key = slot->key, value = slot->value;
+
+		if (!MONO_CONC_HASHTABLE_KEY_IS_LIVE (key) || !func (key, value, user_data))
+			continue;
+
+		slot->key = MONO_CONC_HASHTABLE_TOMBSTONE;
+		mono_memory_write_barrier ();
+		slot->value = NULL;
+		InterlockedDecrement (&hash_table->element_count);
+		InterlockedIncrement (&hash_table->tombstone_count);
+		if (hash_table->key_destroy_func)
+			hash_table->key_destroy_func (key);
+		if (hash_table->value_destroy_func)
+			hash_table->value_destroy_func (value);
+		count++;
+	}
+	unlock_all_stripes (hash_table);
+
+	return count;
+}
+
+guint
+mono_conc_hashtable_size (MonoConcurrentHashTable *hash_table)
+{
+	return hash_table->element_count;
+}
@@ -0,0 +1,69 @@
+/*
+ * mono-conc-hashtable.h: A concurrent hash table with lock-free lookups
+ *
+ * (C) 2014 Xamarin Inc
+ */
+#ifndef __MONO_UTILS_MONO_CONC_HASHTABLE_H__
+#define __MONO_UTILS_MONO_CONC_HASHTABLE_H__
+
+#include <glib.h>
+#include "mono-compiler.h"
+
+G_BEGIN_DECLS
+
+/*
+ * This is an open addressing (linear probing) hash table meant for read-mostly
+ * runtime caches:
+ * - Lookups don't take any locks, the table they probe is protected by a hazard
+ *   pointer so it can be replaced concurrently by a resize.
+ * - Writers are serialized by a small set of striped locks, selected by the hash
+ *   of the key, so inserts of unrelated keys don't contend with each other.
+ *   Resizing takes all the stripes.
+ * - NULL keys and NULL values are not allowed.
+ * - Removed entries are not freed by the table: readers might still be using
+ *   them, so it's up to the caller to ensure they are not freed too early.
+ */
+
+typedef struct _MonoConcurrentHashTable MonoConcurrentHashTable;
+
+/* Key markers, slots holding these keys don't contain a valid entry */
+#define MONO_CONC_HASHTABLE_TOMBSTONE ((gpointer)(gssize)-1)
+#define MONO_CONC_HASHTABLE_RESERVED ((gpointer)(gssize)-2)
+
+#define MONO_CONC_HASHTABLE_KEY_IS_LIVE(k) ((k) != NULL && (k) != MONO_CONC_HASHTABLE_TOMBSTONE && (k) != MONO_CONC_HASHTABLE_RESERVED)
+
+/*
+ * The layout of the storage of the table, exposed so GC aware users can
+ * scan it. The slots follow the storage header in the same allocation.
+ */
+typedef struct {
+	gpointer key;
+	gpointer value;
+} MonoConcHashTableSlot;
+
+typedef struct {
+	int table_size;
+	MonoConcHashTableSlot *slots;
+} MonoConcHashTableStorage;
+
+/* Allocates SIZE bytes of zeroed memory for a MonoConcHashTableStorage */
+typedef gpointer (*MonoConcHashTableAllocFunc) (size_t size, gpointer user_data);
+typedef void (*MonoConcHashTableFreeFunc) (gpointer storage);
+
+MonoConcurrentHashTable* mono_conc_hashtable_new (GHashFunc hash_func, GEqualFunc key_equal_func) MONO_INTERNAL;
+MonoConcurrentHashTable* mono_conc_hashtable_new_full (GHashFunc hash_func, GEqualFunc key_equal_func,
+													   GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func) MONO_INTERNAL;
+MonoConcurrentHashTable* mono_conc_hashtable_new_with_storage (GHashFunc hash_func, GEqualFunc key_equal_func,
+															   MonoConcHashTableAllocFunc alloc_func, MonoConcHashTableFreeFunc free_func,
+															   gpointer user_data) MONO_INTERNAL;
+void mono_conc_hashtable_destroy (MonoConcurrentHashTable *hash_table) MONO_INTERNAL;
+gpointer mono_conc_hashtable_lookup (MonoConcurrentHashTable *hash_table, gconstpointer key) MONO_INTERNAL;
+gpointer mono_conc_hashtable_insert (MonoConcurrentHashTable *hash_table, gpointer key, gpointer value) MONO_INTERNAL;
+gpointer mono_conc_hashtable_remove (MonoConcurrentHashTable *hash_table, gconstpointer key) MONO_INTERNAL;
+void mono_conc_hashtable_foreach (MonoConcurrentHashTable *hash_table, GHFunc func, gpointer user_data) MONO_INTERNAL;
+guint mono_conc_hashtable_foreach_remove (MonoConcurrentHashTable *hash_table, GHRFunc func, gpointer user_data) MONO_INTERNAL;
+guint mono_conc_hashtable_size (MonoConcurrentHashTable *hash_table) MONO_INTERNAL;
+
+G_END_DECLS
+
+#endif /* __MONO_UTILS_MONO_CONC_HASHTABLE_H__ */
@@ -38,6 +38,8 @@ gboolean mono_hwcap_x86_has_ssse3 = FALSE;
 gboolean mono_hwcap_x86_has_sse41 = FALSE;
 gboolean mono_hwcap_x86_has_sse42 = FALSE;
 gboolean mono_hwcap_x86_has_sse4a = FALSE;
+gboolean mono_hwcap_x86_has_avx = FALSE;
+gboolean mono_hwcap_x86_has_avx2 = FALSE;
 
 #if defined(MONO_CROSS_COMPILE)
 void
@@ -94,9 +96,10 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 #endif
 
 	/* Now issue the actual cpuid instruction. We can use
-	   MSVC's __cpuid on both 32-bit and 64-bit. */
+	   MSVC's __cpuidex on both 32-bit and 64-bit. The
+	   subleaf is always 0, which leaf 7 requires. */
 #if defined(_MSC_VER)
-	__cpuid (info, id);
+	__cpuidex (info, id, 0);
 	*p_eax = info [0];
 	*p_ebx = info [1];
 	*p_ecx = info [2];
@@ -109,23 +112,52 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 		"cpuid\n\t"
 		"xchgl\t%%ebx, %k1\n\t"
 		: "=a" (*p_eax), "=&r" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "0" (id)
+		: "0" (id), "2" (0)
 	);
 #else
 	__asm__ __volatile__ (
 		"cpuid\n\t"
 		: "=a" (*p_eax), "=b" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "a" (id)
+		: "a" (id), "c" (0)
 	);
 #endif
 
 	return TRUE;
 }
 
+/*
+ * The AVX registers are only usable if the OS saves them on context
+ * switches, which it advertises through XCR0.
+ */
+static gboolean
+os_saves_ymm_state (void)
+{
+	unsigned int xcr0;
+
+#if defined(_MSC_VER)
+	xcr0 = (unsigned int) _xgetbv (0);
+#else
+	unsigned int xcr0_hi;
+
+	/* xgetbv, spelled out for old assemblers */
+	__asm__ __volatile__ (
+		".byte 0x0f, 0x01, 0xd0\n\t"
+		: "=a" (xcr0), "=d" (xcr0_hi)
+		: "c" (0)
+	);
+#endif
+
+	return (xcr0 & 0x6) == 0x6;
+}
+
 void
 mono_hwcap_arch_init (void)
 {
 	int eax, ebx, ecx, edx;
+	int max_leaf = 0;
+
+	if (cpuid (0, &eax, &ebx, &ecx, &edx))
+		max_leaf = eax;
 
 	if (cpuid (1, &eax, &ebx, &ecx, &edx)) {
 		if (edx & (1 << 15)) {
@@ -152,6 +184,15 @@ mono_hwcap_arch_init (void)
 
 		if (ecx & (1 << 20))
 			mono_hwcap_x86_has_sse42 = TRUE;
+
+		/* AVX also needs OSXSAVE so that XCR0 can be queried */
+		if ((ecx & (1 << 27)) && (ecx & (1 << 28)) && os_saves_ymm_state ())
+			mono_hwcap_x86_has_avx = TRUE;
+	}
+
+	if (mono_hwcap_x86_has_avx && max_leaf >= 7 && cpuid (7, &eax, &ebx, &ecx, &edx)) {
+		if (ebx & (1 << 5))
+			mono_hwcap_x86_has_avx2 = TRUE;
 	}
 
 	if (cpuid (0x80000000, &eax, &ebx, &ecx, &edx)) {
@@ -182,4 +223,6 @@ mono_hwcap_print (FILE *f)
 	g_fprintf (f, "mono_hwcap_x86_has_sse41 = %i\n", mono_hwcap_x86_has_sse41);
 	g_fprintf (f, "mono_hwcap_x86_has_sse42 = %i\n", mono_hwcap_x86_has_sse42);
 	g_fprintf (f, "mono_hwcap_x86_has_sse4a = %i\n", mono_hwcap_x86_has_sse4a);
+	g_fprintf (f, "mono_hwcap_x86_has_avx = %i\n", mono_hwcap_x86_has_avx);
+	g_fprintf (f, "mono_hwcap_x86_has_avx2 = %i\n", mono_hwcap_x86_has_avx2);
 }
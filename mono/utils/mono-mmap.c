@@ -111,6 +111,10 @@ mono_valloc (void *addr, size_t length, int flags)
 	int prot = prot_from_flags (flags);
 	/* translate the flags */
 
+	/* Large pages require a privilege, so they are not supported */
+	if (flags & MONO_MMAP_HUGETLB)
+		return NULL;
+
 	ptr = VirtualAlloc (addr, length, mflags, prot);
 	return ptr;
 }
@@ -303,11 +307,20 @@ mono_valloc (void *addr, size_t length, int flags)
 		mflags |= MAP_FIXED;
 	if (flags & MONO_MMAP_32BIT)
 		mflags |= MAP_32BIT;
+	if (flags & MONO_MMAP_HUGETLB) {
+#ifdef MAP_HUGETLB
+		mflags |= MAP_HUGETLB;
+#else
+		return NULL;
+#endif
+	}
 
 	mflags |= MAP_ANONYMOUS;
 	mflags |= MAP_PRIVATE;
 
 	ptr = mmap (addr, length, prot, mflags, -1, 0);
+	if (ptr == (void*)-1 && (flags & MONO_MMAP_HUGETLB))
+		return NULL;
 	if (ptr == (void*)-1) {
 		int fd = open ("/dev/zero", O_RDONLY);
 		if (fd != -1) {
@@ -455,6 +468,8 @@ mono_pagesize (void)
 void*
 mono_valloc (void *addr, size_t length, int flags)
 {
+	if (flags & MONO_MMAP_HUGETLB)
+		return NULL;
 	return malloc (length);
 }
 
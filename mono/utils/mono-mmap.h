@@ -17,7 +17,9 @@ enum {
 	MONO_MMAP_SHARED  = 1 << 5,
 	MONO_MMAP_ANON    = 1 << 6,
 	MONO_MMAP_FIXED   = 1 << 7,
-	MONO_MMAP_32BIT   = 1 << 8
+	MONO_MMAP_32BIT   = 1 << 8,
+	/* back the memory with huge pages, fail if they are not available */
+	MONO_MMAP_HUGETLB = 1 << 9
 };
 
 /*
@@ -13,6 +13,7 @@
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/mono-tls.h>
 #include <mono/utils/hazard-pointer.h>
+#include <mono/utils/mono-timer-wheel.h>
 #include <mono/utils/mono-memory-model.h>
 
 #include <errno.h>
@@ -324,6 +325,7 @@ mono_threads_init (MonoThreadInfoCallbacks *callbacks, size_t info_size)
 
 	mono_lls_init (&thread_list, NULL);
 	mono_thread_smr_init ();
+	mono_timer_wheel_init ();
 	mono_threads_init_platform ();
 
 #if defined(__MACH__)
@@ -0,0 +1,384 @@
+/*
+ * mono-timer-wheel.c: A hierarchical timer wheel for runtime timeouts
+ *
+ * (C) 2014 Xamarin Inc
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <mono/utils/mono-timer-wheel.h>
+#include <mono/utils/mono-mutex.h>
+#include <mono/utils/mono-semaphore.h>
+#include <mono/utils/mono-time.h>
+#include <mono/utils/mono-proclib.h>
+#include <mono/utils/mono-threads.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-memory-model.h>
+#include <mono/utils/atomic.h>
+
+/*
+ * The first level has one slot per tick, each of the other levels has one
+ * slot per revolution of the previous one. When the first level wraps
+ * around, the current slot of the next level is cascaded down, so timers
+ * only move towards the first level a few times during their life.
+ * With these sizes, timeouts up to 2^32 ms can be represented.
+ */
+#define ROOT_BITS 8
+#define ROOT_SIZE (1 << ROOT_BITS)
+#define ROOT_MASK (ROOT_SIZE - 1)
+#define LEVEL_BITS 6
+#define LEVEL_SIZE (1 << LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SIZE - 1)
+#define NUM_LEVELS 4
+
+#define LEVEL_SHIFT(n) (ROOT_BITS + (n) * LEVEL_BITS)
+#define MAX_TIMEOUT (((gint64)1 << LEVEL_SHIFT (NUM_LEVELS)) - 1)
+
+/* Number of cpus sharing a wheel and its service thread */
+#define CPUS_PER_WHEEL 8
+
+#define NO_WAKEUP G_MAXINT64
+
+struct _MonoTimerWheel {
+	mono_mutex_t lock;
+	MonoSemType wakeup;
+	/* The last tick which was processed */
+	gint64 current;
+	/* The tick the service thread will wake up at */
+	gint64 wakeup_at;
+	int num_timers;
+	MonoWheelTimer *root [ROOT_SIZE];
+	MonoWheelTimer *levels [NUM_LEVELS][LEVEL_SIZE];
+};
+
+static MonoTimerWheel ** volatile wheels;
+static int num_wheels;
+static gint32 wheels_inited;
+
+/* Statistics */
+static gint32 timers_added, timers_cancelled, timers_expired, timers_cascaded;
+
+static inline gint64
+now_ticks (void)
+{
+	return mono_100ns_ticks () / 10000;
+}
+
+static void
+slot_add (MonoWheelTimer **slot, MonoWheelTimer *timer)
+{
+	timer->next = *slot;
+	if (timer->next)
+		timer->next->prev_next = &timer->next;
+	timer->prev_next = slot;
+	*slot = timer;
+}
+
+static void
+slot_remove (MonoWheelTimer *timer)
+{
+	*timer->prev_next = timer->next;
+	if (timer->next)
+		timer->next->prev_next = timer->prev_next;
+	timer->next = NULL;
+	timer->prev_next = NULL;
+}
+
+/*
+ * Put TIMER into the slot corresponding to its expiration time.
+ * LOCKING: wheel lock
+ */
+static void
+wheel_insert (MonoTimerWheel *wheel, MonoWheelTimer *timer)
+{
+	gint64 expires = timer->expires;
+	gint64 delta = expires - wheel->current;
+	int level;
+
+	if (delta < 0) {
+		/* Already expired, fire it on the next tick */
+		slot_add (&wheel->root [(wheel->current + 1) & ROOT_MASK], timer);
+		return;
+	}
+
+	if (delta < ROOT_SIZE) {
+		slot_add (&wheel->root [expires & ROOT_MASK], timer);
+		return;
+	}
+
+	for (level = 0; level < NUM_LEVELS - 1; ++level) {
+		if (delta < ((gint64)1 << LEVEL_SHIFT (level + 1)))
+			break;
+	}
+	slot_add (&wheel->levels [level][(expires >> LEVEL_SHIFT (level)) & LEVEL_MASK], timer);
+}
+
+/*
+ * Move the timers in slot INDEX of LEVEL to the lower levels. Return INDEX,
+ * if it's 0, the next level has to be cascaded too.
+ * LOCKING: wheel lock
+ */
+static int
+cascade (MonoTimerWheel *wheel, int level, int index)
+{
+	MonoWheelTimer *timer = wheel->levels [level][index];
+
+	wheel->levels [level][index] = NULL;
+	while (timer) {
+		MonoWheelTimer *next = timer->next;
+
+		timer->next = NULL;
+		timer->prev_next = NULL;
+		wheel_insert (wheel, timer);
+		++timers_cascaded;
+		timer = next;
+	}
+	return index;
+}
+
+/*
+ * Process the ticks up to NOW, returning the list of expired timers, linked
+ * through their next fields.
+ * LOCKING: wheel lock
+ */
+static MonoWheelTimer*
+wheel_advance (MonoTimerWheel *wheel, gint64 now)
+{
+	MonoWheelTimer *expired = NULL;
+
+	if (!wheel->num_timers) {
+		wheel->current = MAX (wheel->current, now);
+		return NULL;
+	}
+
+	while (wheel->current < now && wheel->num_timers) {
+		gint64 tick = wheel->current + 1;
+		int index = tick & ROOT_MASK;
+		MonoWheelTimer *timer;
+
+		wheel->current = tick;
+
+		if (!index) {
+			int level;
+
+			for (level = 0; level < NUM_LEVELS; ++level) {
+				if (cascade (wheel, level, (tick >> LEVEL_SHIFT (level)) & LEVEL_MASK))
+					break;
+			}
+		}
+
+		timer = wheel->root [index];
+		wheel->root [index] = NULL;
+		while (timer) {
+			MonoWheelTimer *next = timer->next;
+
+			timer->scheduled = FALSE;
+			timer->prev_next = NULL;
+			timer->next = expired;
+			expired = timer;
+			--wheel->num_timers;
+			++timers_expired;
+			timer = next;
+		}
+	}
+
+	if (!wheel->num_timers)
+		wheel->current = MAX (wheel->current, now);
+
+	return expired;
+}
+
+/*
+ * Return the tick the service thread has to wake up at: the first non empty
+ * slot of the first level, or the next cascade.
+ * LOCKING: wheel lock
+ */
+static gint64
+wheel_next_expiry (MonoTimerWheel *wheel)
+{
+	gint64 tick;
+
+	if (!wheel->num_timers)
+		return NO_WAKEUP;
+
+	for (tick = wheel->current + 1; tick & ROOT_MASK; ++tick) {
+		if (wheel->root [tick & ROOT_MASK])
+			return tick;
+	}
+	return tick;
+}
+
+static mono_native_thread_return_t
+service_thread (void *data)
+{
+	MonoTimerWheel *wheel = data;
+
+	for (;;) {
+		MonoWheelTimer *expired;
+		gint64 next, now;
+		guint32 wait_ms;
+
+		mono_mutex_lock (&wheel->lock);
+		expired = wheel_advance (wheel, now_ticks ());
+		next = wheel_next_expiry (wheel);
+		wheel->wakeup_at = next;
+		mono_mutex_unlock (&wheel->lock);
+
+		/* The callbacks own the expired timers, so the list can't be accessed after them */
+		while (expired) {
+			MonoWheelTimer *timer = expired;
+
+			expired = timer->next;
+			timer->next = NULL;
+			timer->func (timer);
+		}
+
+		now = now_ticks ();
+		if (next == NO_WAKEUP)
+			wait_ms = INFINITE;
+		else if (next <= now)
+			continue;
+		else
+			wait_ms = (guint32)MIN (next - now, G_MAXINT32);
+
+		MONO_SEM_TIMEDWAIT (&wheel->wakeup, wait_ms);
+	}
+
+	return (mono_native_thread_return_t)0;
+}
+
+static MonoTimerWheel*
+wheel_new (void)
+{
+	MonoTimerWheel *wheel = g_new0 (MonoTimerWheel, 1);
+	MonoNativeThreadId tid;
+
+	mono_mutex_init (&wheel->lock);
+	MONO_SEM_INIT (&wheel->wakeup, 0);
+	wheel->current = now_ticks ();
+	wheel->wakeup_at = NO_WAKEUP;
+
+	if (!mono_native_thread_create (&tid, service_thread, wheel))
+		g_error ("Could not create the timer wheel thread");
+
+	return wheel;
+}
+
+/*
+ * Return the wheel used by the current thread, creating the wheels and
+ * their service threads on first use.
+ */
+static MonoTimerWheel*
+get_wheel (void)
+{
+	MonoTimerWheel **w = wheels;
+	int small_id;
+
+	if (G_UNLIKELY (!w)) {
+		int i, count;
+
+		if (InterlockedCompareExchange (&wheels_inited, 1, 0) != 0) {
+			/* Another thread is creating them */
+			while (!(w = wheels))
+				mono_thread_info_yield ();
+		} else {
+			count = MAX (1, (mono_cpu_count () + CPUS_PER_WHEEL - 1) / CPUS_PER_WHEEL);
+			w = g_new0 (MonoTimerWheel*, count);
+			for (i = 0; i < count; ++i)
+				w [i] = wheel_new ();
+
+			num_wheels = count;
+			mono_memory_barrier ();
+			wheels = w;
+		}
+	}
+
+	if (num_wheels <= 1)
+		return w [0];
+
+	small_id = mono_thread_info_get_small_id ();
+	return w [small_id < 0 ? 0 : small_id % num_wheels];
+}
+
+void
+mono_timer_wheel_init (void)
+{
+	mono_counters_register ("Timer wheel timers added", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &timers_added);
+	mono_counters_register ("Timer wheel timers cancelled", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &timers_cancelled);
+	mono_counters_register ("Timer wheel timers expired", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &timers_expired);
+	mono_counters_register ("Timer wheel timers cascaded", MONO_COUNTER_METADATA | MONO_COUNTER_INT, &timers_cascaded);
+}
+
+void
+mono_wheel_timer_init (MonoWheelTimer *timer, MonoWheelTimerFunc func, gpointer user_data)
+{
+	memset (timer, 0, sizeof (MonoWheelTimer));
+	timer->func = func;
+	timer->user_data = user_data;
+}
+
+/**
+ * mono_timer_wheel_add:
+ *
+ *   Schedule TIMER to expire in TIMEOUT_MS milliseconds, at which point its
+ * callback is invoked on the service thread of its wheel. TIMER must not be
+ * already scheduled.
+ */
+void
+mono_timer_wheel_add (MonoWheelTimer *timer, guint32 timeout_ms)
+{
+	MonoTimerWheel *wheel = get_wheel ();
+	gboolean wakeup = FALSE;
+
+	mono_mutex_lock (&wheel->lock);
+
+	g_assert (!timer->scheduled);
+
+	timer->wheel = wheel;
+	/* The current tick might have been processed already */
+	timer->expires = MAX (now_ticks () + MIN ((gint64)timeout_ms, MAX_TIMEOUT), wheel->current + 1);
+	timer->scheduled = TRUE;
+	wheel_insert (wheel, timer);
+	++wheel->num_timers;
+	++timers_added;
+
+	if (timer->expires < wheel->wakeup_at) {
+		wheel->wakeup_at = timer->expires;
+		wakeup = TRUE;
+	}
+
+	mono_mutex_unlock (&wheel->lock);
+
+	if (wakeup)
+		MONO_SEM_POST (&wheel->wakeup);
+}
+
+/**
+ * mono_timer_wheel_cancel:
+ *
+ *   Remove TIMER from its wheel. Return TRUE if it was removed before it
+ * expired. Otherwise its callback is running or about to run, and it owns
+ * the timer from then on.
+ */
+gboolean
+mono_timer_wheel_cancel (MonoWheelTimer *timer)
+{
+	MonoTimerWheel *wheel = timer->wheel;
+	gboolean res = FALSE;
+
+	if (!wheel)
+		return FALSE;
+
+	mono_mutex_lock (&wheel->lock);
+	if (timer->scheduled) {
+		slot_remove (timer);
+		timer->scheduled = FALSE;
+		--wheel->num_timers;
+		++timers_cancelled;
+		res = TRUE;
+	}
+	mono_mutex_unlock (&wheel->lock);
+
+	return res;
+}
@@ -0,0 +1,46 @@
+/*
+ * mono-timer-wheel.h: A hierarchical timer wheel for runtime timeouts
+ *
+ * (C) 2014 Xamarin Inc
+ */
+#ifndef __MONO_UTILS_MONO_TIMER_WHEEL_H__
+#define __MONO_UTILS_MONO_TIMER_WHEEL_H__
+
+#include <glib.h>
+#include "mono-compiler.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Timers are kept in a set of hierarchical timing wheels with a resolution of
+ * 1ms, so adding and cancelling a timer are O(1) regardless of the number of
+ * pending timers. Each group of cpus has its own wheel, serviced by a native
+ * thread which runs the expiration callbacks, so they must not block for long
+ * and must not run managed code.
+ */
+
+typedef struct _MonoTimerWheel MonoTimerWheel;
+typedef struct _MonoWheelTimer MonoWheelTimer;
+
+typedef void (*MonoWheelTimerFunc) (MonoWheelTimer *timer);
+
+struct _MonoWheelTimer {
+	/* Private, these are protected by the lock of the wheel */
+	MonoWheelTimer *next;
+	MonoWheelTimer **prev_next;
+	gint64 expires;
+	gboolean scheduled;
+	MonoTimerWheel *wheel;
+
+	MonoWheelTimerFunc func;
+	gpointer user_data;
+};
+
+void mono_timer_wheel_init (void) MONO_INTERNAL;
+void mono_wheel_timer_init (MonoWheelTimer *timer, MonoWheelTimerFunc func, gpointer user_data) MONO_INTERNAL;
+void mono_timer_wheel_add (MonoWheelTimer *timer, guint32 timeout_ms) MONO_INTERNAL;
+gboolean mono_timer_wheel_cancel (MonoWheelTimer *timer) MONO_INTERNAL;
+
+G_END_DECLS
+
+#endif /* __MONO_UTILS_MONO_TIMER_WHEEL_H__ */